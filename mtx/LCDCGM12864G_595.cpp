@@ -13,6 +13,10 @@ LCDCGM12864G_595::LCDCGM12864G_595(int8_t QRS, int8_t QRD, int8_t QRST, int8_t l
   _qrd = QRD;
   _qrst = QRST;
   _latchPin = latchpin;
+  
+  bytesSent = 0;
+  refreshRun = 0;
+  isFlushAllDue = true;
 }
 
 // the most basic function, set a single pixel
@@ -69,28 +73,51 @@ void LCDCGM12864G_595::begin()
   SPI.endTransaction();
 }
 
-void LCDCGM12864G_595::display(void)
+uint16_t LCDCGM12864G_595::runChecksum(const uint8_t *data)
 {
-  
-  uint8_t col;
-  uint8_t page;
-  uint8_t theByte;
+  //CRC16 CCITT over one run, byte at a time without a table
+  uint16_t crc = 0xFFFF;
+  for(uint8_t i = 0; i < FLUSH_RUN_LEN; i++)
+  {
+    uint8_t x = data[i] ^ (crc & 0xFF);
+    x ^= x << 4;
+    crc = (((uint16_t)x << 8) | (crc >> 8)) ^ (uint8_t)(x >> 4) ^ ((uint16_t)x << 3);
+  }
+  return crc;
+}
 
+void LCDCGM12864G_595::display(void)
+{
+  //Sends the runs that changed since they were last sent, plus one run in turn regardless
   SPI.beginTransaction(SPISettings(8000000, LSBFIRST, SPI_MODE0));
-  for (page = 0xb0; page < 0xb8; page++)
+  
+  bytesSent = 0;
+  uint16_t addressedIdx = 0xFFFF; //buffer index the lcd address points at, if known
+  for(uint8_t run = 0; run < NUM_FLUSH_RUNS; run++)
   {
-    lcdCommand(page);
-    lcdCommand(0x10);
-    lcdCommand(0x00);
-
-    setColumn(4); //not sure why we do this. Couldnt find a datasheet for lcd
-
-    for (col = 0; col < LCDWIDTH; col++)
+    uint16_t dataIdx = run * FLUSH_RUN_LEN;
+    uint16_t crc = runChecksum(&dispBuffer[dataIdx]);
+    if(crc == runCrc[run] && run != refreshRun && !isFlushAllDue)
+      continue;
+    runCrc[run] = crc;
+    
+    //The column address increments as data is written, so a run straight after one just sent on 
+    //the same page carries on without being addressed
+    if(dataIdx != addressedIdx)
     {
-      theByte = dispBuffer[((page & 0x07) * LCDWIDTH + col)];
-      lcdDataWrite(theByte);
+      lcdCommand(0xb0 | (dataIdx / LCDWIDTH));
+      setColumn(4 + dataIdx % LCDWIDTH); //columns start at 4. Couldnt find a datasheet for lcd
     }
+    
+    for(uint8_t i = 0; i < FLUSH_RUN_LEN; i++)
+      lcdDataWrite(dispBuffer[dataIdx++]);
+    bytesSent += FLUSH_RUN_LEN;
+    addressedIdx = (dataIdx % LCDWIDTH == 0) ? 0xFFFF : dataIdx; //the next run is on the next page
   }
+  
+  refreshRun = (refreshRun + 1) % NUM_FLUSH_RUNS;
+  isFlushAllDue = false;
+  
   SPI.endTransaction();
 }
 
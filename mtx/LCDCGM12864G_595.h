@@ -36,6 +36,12 @@ typedef uint8_t PortMask;
 #define LCDWIDTH 128
 #define LCDHEIGHT 64
 
+/* Only runs of columns whose contents changed are sent to the lcd. A CRC of each run as last sent 
+is kept, as a copy of the buffer would take another 1K of RAM. The UI clears and redraws the whole 
+buffer every frame, so tracking which pixels were drawn would mark everything. */
+#define FLUSH_RUN_LEN   32  //columns. Should divide LCDWIDTH
+#define NUM_FLUSH_RUNS  (LCDWIDTH * LCDHEIGHT / 8 / FLUSH_RUN_LEN)
+
 class LCDCGM12864G_595 : public GFX
 {
   public:
@@ -48,18 +54,25 @@ class LCDCGM12864G_595 : public GFX
     void drawPixel(uint8_t x, uint8_t y, uint8_t color);
     uint8_t getPixel(uint8_t x, uint8_t y);
 
+    uint16_t bytesSent; //data bytes sent to the lcd by the last display()
+
   private:
     int8_t _qrs, _qrd, _qrst, _latchPin;
     volatile PortReg *qrsport, *qrdport, *dataPort, *latchPort, *clockPort;
 
     // The memory buffer for holding the data to be sent to the LCD
     uint8_t dispBuffer[LCDWIDTH * LCDHEIGHT / 8];
+    
+    uint16_t runCrc[NUM_FLUSH_RUNS];
+    uint8_t refreshRun;   //sent whether changed or not, so the whole lcd is rewritten every so often
+    bool isFlushAllDue;
 
     PortMask qrspinmask, qrdpinmask, latchpinmask;
 
     void setColumn(uint8_t column);
     void lcdDataWrite(uint8_t data);
     void lcdCommand(uint8_t command);
+    uint16_t runChecksum(const uint8_t *data);
 };
 
 #endif
@@ -16,6 +16,10 @@ LCDKS0108::LCDKS0108(int8_t QRS, int8_t QEN, int8_t QCS1, int8_t QCS2, int8_t la
   _qcs2 = QCS2;
 
   _latchPin = latchpin;
+  
+  bytesSent = 0;
+  refreshRun = 0;
+  isFlushAllDue = true;
 }
 
 // the most basic function, set a single pixel
@@ -74,23 +78,18 @@ void LCDKS0108::begin()
   SPI.endTransaction();
 }
 
-void LCDKS0108::setPage(uint8_t pageNo)
+void LCDKS0108::setAddress(uint8_t pageNo, uint8_t column)
 {
+  //Sets the page and the column within each controller, on both controllers
   lcdCommand(SET_PAGE | pageNo);
-  lcdCommand(SET_Y_ADDRESS);
+  lcdCommand(SET_Y_ADDRESS | (column & 0x3F));
 }
 
-void LCDKS0108::display(void)
+void LCDKS0108::selectChip(uint8_t chip)
 {
-  SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
-
-  uint16_t dataIdx = 0;
-  for(uint8_t page = 0; page < 8; page++)
+  //Enables one controller for data. 0 is the left half, 1 the right
+  if(chip == 0)
   {
-    setPage(page);
-
-    bool isCS2 = false;
-    //enable chip1
 #if defined (CS_ACTIVE_LOW)
     *qcs1port &= ~qcs1pinmask;  
     *qcs2port |= qcs2pinmask;
@@ -98,24 +97,59 @@ void LCDKS0108::display(void)
     *qcs1port |= qcs1pinmask;  
     *qcs2port &= ~qcs2pinmask; 
 #endif 
-
-    for(uint8_t column = 0; column < 128; column++)
-    {
-      if(!isCS2 && column >= 64) 
-      {
-        isCS2 = true;
-        //enable chip2
+  }
+  else
+  {
 #if defined (CS_ACTIVE_LOW)
-        *qcs2port &= ~qcs2pinmask;
-        *qcs1port |= qcs1pinmask;
+    *qcs2port &= ~qcs2pinmask;
+    *qcs1port |= qcs1pinmask;
 #else 
-        *qcs2port |= qcs2pinmask; 
-        *qcs1port &= ~qcs1pinmask;
+    *qcs2port |= qcs2pinmask; 
+    *qcs1port &= ~qcs1pinmask;
 #endif
-      }
-      
-      *qrsport |= qrspinmask; //rs high
-      
+  }
+}
+
+uint16_t LCDKS0108::runChecksum(const uint8_t *data)
+{
+  //CRC16 CCITT over one run, byte at a time without a table
+  uint16_t crc = 0xFFFF;
+  for(uint8_t i = 0; i < FLUSH_RUN_LEN; i++)
+  {
+    uint8_t x = data[i] ^ (crc & 0xFF);
+    x ^= x << 4;
+    crc = (((uint16_t)x << 8) | (crc >> 8)) ^ (uint8_t)(x >> 4) ^ ((uint16_t)x << 3);
+  }
+  return crc;
+}
+
+void LCDKS0108::display(void)
+{
+  //Sends the runs that changed since they were last sent, plus one run in turn regardless
+  SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+
+  bytesSent = 0;
+  uint16_t addressedIdx = 0xFFFF; //buffer index the lcd address points at, if known
+  for(uint8_t run = 0; run < NUM_FLUSH_RUNS; run++)
+  {
+    uint16_t dataIdx = run * FLUSH_RUN_LEN;
+    uint16_t crc = runChecksum(&dispBuffer[dataIdx]);
+    if(crc == runCrc[run] && run != refreshRun && !isFlushAllDue)
+      continue;
+    runCrc[run] = crc;
+    
+    //The column address increments as data is written, so a run straight after one just sent in 
+    //the same half carries on without being addressed
+    if(dataIdx != addressedIdx)
+    {
+      uint8_t column = dataIdx % LCDWIDTH;
+      setAddress(dataIdx / LCDWIDTH, column);
+      selectChip(column / 64);
+    }
+    
+    *qrsport |= qrspinmask; //rs high
+    for(uint8_t i = 0; i < FLUSH_RUN_LEN; i++)
+    {
       *latchPort &= ~latchpinmask; //latch low
       SPI.transfer(dispBuffer[dataIdx++]);
       *latchPort |= latchpinmask; //latch high
@@ -126,7 +160,12 @@ void LCDKS0108::display(void)
       delayMicroseconds(3);
       *qenport &= ~qenpinmask; //EN low
     }
+    bytesSent += FLUSH_RUN_LEN;
+    addressedIdx = (dataIdx % 64 == 0) ? 0xFFFF : dataIdx; //the next run is on the other controller
   }
+  
+  refreshRun = (refreshRun + 1) % NUM_FLUSH_RUNS;
+  isFlushAllDue = false;
 
   SPI.endTransaction();
 }
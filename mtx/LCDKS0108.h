@@ -16,6 +16,12 @@
 #define DISP_ON       0b00111111
 #define DISP_OFF      0b00111110
 
+/* Only runs of columns whose contents changed are sent to the lcd. A CRC of each run as last sent 
+is kept, as a copy of the buffer would take another 1K of RAM. The UI clears and redraws the whole 
+buffer every frame, so tracking which pixels were drawn would mark everything. */
+#define FLUSH_RUN_LEN   32  //columns. Should divide 64 so that a run doesn't span both controllers
+#define NUM_FLUSH_RUNS  (LCDWIDTH * LCDHEIGHT / 8 / FLUSH_RUN_LEN)
+
 typedef volatile uint8_t PortReg;
 typedef uint8_t PortMask;
 
@@ -31,18 +37,26 @@ class LCDKS0108 : public GFX
     void drawPixel(uint8_t x, uint8_t y, uint8_t color);
     uint8_t getPixel(uint8_t x, uint8_t y);
 
+    uint16_t bytesSent; //data bytes sent to the lcd by the last display()
+
   private:
     int8_t _qrs, _qen, _qcs1, _qcs2;
     int8_t _latchPin;
 
     // The memory buffer for holding the data to be sent to the LCD
     uint8_t dispBuffer[LCDWIDTH * LCDHEIGHT / 8];
+    
+    uint16_t runCrc[NUM_FLUSH_RUNS];
+    uint8_t refreshRun;   //sent whether changed or not, so the whole lcd is rewritten every so often
+    bool isFlushAllDue;
 
     volatile PortReg *qrsport, *qenport, *qcs1port, *qcs2port, *latchPort;
     PortMask qrspinmask, qenpinmask, qcs1pinmask, qcs2pinmask, latchpinmask;
 
     void lcdCommand(uint8_t command);
-    void setPage(uint8_t pageNo);
+    void setAddress(uint8_t pageNo, uint8_t column);
+    void selectChip(uint8_t chip);
+    uint16_t runChecksum(const uint8_t *data);
 };
 
 #endif
@@ -44,11 +44,37 @@ uint32_t inputsLastMoved = 0;
 
 uint8_t transmitterPacketRate = 0;
 uint8_t receiverPacketRate = 0;
+uint8_t receiverSlowestChRate = 0;
 
 uint16_t telem_volts = 0x0FFF;
-
-uint8_t outputChConfig[9]; 
-uint8_t maxOutputChConfig[9];
+uint8_t telemBandwidth = 0;
+uint8_t uplinkRateForTelem = 0;
+
+uint8_t receiverLinkQuality = 0;
+bool hasReceivedTelemetry = false;
+uint8_t receiverCrcFailRate = 0;
+uint8_t receiverFecFixRate = 0;
+uint8_t receiverRecoveryRate = 0;
+uint8_t receiverOutputDelay = 0;
+uint8_t receiverProcessTime = 0;
+uint8_t receiverFailsafeDelay = 0;
+uint8_t rfPowerLevelInUse = 0;
+bool isLongRangeInUse = false;
+uint8_t uplinkRssi = 0;
+int8_t  uplinkSnr = 0;
+uint8_t downlinkRssi = 0;
+int8_t  downlinkSnr = 0;
+
+uint16_t receiverStats[NUM_RX_STATS];
+
+uint8_t rxSensorsSeen = 0;
+uint8_t rxSensorType[RX_MAX_SENSORS];
+int16_t rxSensorValue[RX_MAX_SENSORS];
+int16_t rxSensorMin[RX_MAX_SENSORS];
+int16_t rxSensorMax[RX_MAX_SENSORS];
+
+uint8_t outputChConfig[NUM_RX_OUTPUT_CHANNELS]; 
+uint8_t outputChCapability[NUM_RX_OUTPUT_CHANNELS];
 bool gotOutputChConfig = false;
 bool isRequestingOutputChConfig = false;
 bool sendOutputChConfig = false;
@@ -75,6 +101,7 @@ void setDefaultSystemParams()
   
   Sys.telemAlarmEnabled = true;
   Sys.telemVoltsOnHomeScreen = true;
+  Sys.telemRatio = TELEM_RATIO_1_16;
 }
 
 void setDefaultModelName()
@@ -130,6 +157,10 @@ void setDefaultModelBasicParams()
   Model.timer1InitMins = 0;
   
   Model.telemVoltsThresh = 0;
+  Model.telemLQThresh = 0;
+  Model.telemRssiThresh = 0;
+  for(uint8_t i = 0; i < RX_MAX_SENSORS; i++)
+    Model.telemSensorThresh[i] = 0;
 }
 
 void setDefaultModelMixerParams(uint8_t _mixNo)
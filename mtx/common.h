@@ -9,7 +9,8 @@ void setDefaultModelMixerParams(uint8_t _mixNo);
 
 //====================== MISC =====================================================================
 
-#define NUM_PRP_CHANNLES 9  //Number of proportional channels ## Leave this
+#define NUM_PRP_CHANNLES 16  //Number of proportional channels. Max 16. Should match NUM_RC_CHANNELS in the slave mcu
+#define NUM_RX_OUTPUT_CHANNELS 9 //Number of outputs on the receiver. Max 9, limited by the receiver screen
 
 //---- Output channels --------------------
 extern int channelOut[NUM_PRP_CHANNLES];  //Proportional Channels. Centered at 0, range is -500 to 500.
@@ -97,13 +98,68 @@ extern uint32_t inputsLastMoved; //inactivity detection
 
 extern uint8_t transmitterPacketRate;
 extern uint8_t receiverPacketRate;
+extern uint8_t receiverSlowestChRate; //update rate of the least updated channel, as seen by receiver
 
 //---- Telemetry --------------------------
 extern uint16_t telem_volts; // in 10mV, sent by receiver with 12bits.  0x0FFF "No data"
+extern uint8_t telemBandwidth;     //telemetry payload bytes received per second
+extern uint8_t uplinkRateForTelem; //rc packets per second given up for telemetry slots
+
+//Link. Rssi values are in -dBm, with 0 meaning "No data". Snr values are in dB
+extern uint8_t receiverLinkQuality; //percentage of slots in which the receiver got a valid packet
+extern bool hasReceivedTelemetry;   //set once telemetry has come in since power on
+extern uint8_t receiverCrcFailRate; //corrupted packets per second at receiver
+extern uint8_t receiverFecFixRate;  //rc packets per second corrected by fec at receiver
+extern uint8_t receiverRecoveryRate; //lost rc frames per second rebuilt from redundancy records
+extern uint8_t receiverOutputDelay;  //packet arrival to outputs updated at receiver, in 0.1ms. 0 "No data"
+extern uint8_t receiverProcessTime;  //packet arrival to channels decoded at receiver, in 0.1ms. 0 "No data"
+extern uint8_t receiverFailsafeDelay; //last packet to failsafe on the receiver outputs, in 10ms. 0 "No data"
+extern uint8_t rfPowerLevelInUse;    //as set by the slave mcu. Differs from Sys.rfPower if automatic
+extern bool isLongRangeInUse;        //the slave mcu has changed to the long range rate profile
+extern uint8_t uplinkRssi;   
+extern int8_t  uplinkSnr;
+extern uint8_t downlinkRssi;
+extern int8_t  downlinkSnr;
+
+//Link statistics kept by the receiver since it was powered on. In the order the receiver sends them
+enum {
+  RX_STAT_REJECTED = 0,     //packets addressed to the receiver that failed the packet check
+  RX_STAT_FOREIGN,          //packets with other IDs
+  RX_STAT_MISSED_SLOTS,
+  RX_STAT_HOP_TIMEOUTS,     //hops while out of sync because nothing came in
+  RX_STAT_SYNC_LOSSES,
+  RX_STAT_FAILSAFES,
+  RX_STAT_FAILSAFE_LAST,    //in 0.1s
+  RX_STAT_FAILSAFE_LONGEST, //in 0.1s
+  RX_STAT_FAILSAFE_TOTAL,   //in seconds
+  RX_STAT_LONGEST_GAP,      //longest time between rc packets, in ms
+  RX_STAT_EEPROM_ERRORS,    //bytes that didn't save
+  RX_STAT_EEPROM_REFUSED,   //writes the receiver had no room to queue
+  NUM_RX_STATS
+};
+#define RX_STATS_PER_PAGE  5
+#define RX_STATS_NUM_PAGES ((NUM_RX_STATS + RX_STATS_PER_PAGE - 1) / RX_STATS_PER_PAGE)
+extern uint16_t receiverStats[NUM_RX_STATS];
+
+//Sensors on the receiver, numbered in the order they are listed there. Along with the last value, 
+//the lowest and highest seen since power on are kept
+enum {
+  SENSOR_VOLTS = 0, //in 10mV
+  SENSOR_CURRENT,   //in 10mA
+  SENSOR_TEMP,      //in 0.1 degC
+  SENSOR_ALTITUDE,  //in 0.1m
+};
+#define RX_MAX_SENSORS  6
+#define SENSOR_NO_DATA  ((int16_t)0x8000)
+extern uint8_t rxSensorsSeen; //bit per sensor the receiver has reported
+extern uint8_t rxSensorType[RX_MAX_SENSORS];
+extern int16_t rxSensorValue[RX_MAX_SENSORS];
+extern int16_t rxSensorMin[RX_MAX_SENSORS]; //0x7FFF with nothing seen yet
+extern int16_t rxSensorMax[RX_MAX_SENSORS]; //SENSOR_NO_DATA with nothing seen yet
 
 //---- Output channel configuration -----
-extern uint8_t outputChConfig[9]; 
-extern uint8_t maxOutputChConfig[9];
+extern uint8_t outputChConfig[NUM_RX_OUTPUT_CHANNELS]; 
+extern uint8_t outputChCapability[NUM_RX_OUTPUT_CHANNELS]; //bit per supported mode, bit0 is Servo
 extern bool gotOutputChConfig;
 extern bool isRequestingOutputChConfig;
 extern bool sendOutputChConfig;
@@ -141,6 +197,7 @@ typedef struct  {
   
   bool telemAlarmEnabled;
   bool telemVoltsOnHomeScreen;
+  uint8_t telemRatio; //how often the receiver gets a slot to send telemetry. See enum below
   
 } sysParams_t;
 
@@ -163,13 +220,31 @@ enum {
   BACKLIGHT_LAST = BACKLIGHT_ON
 };
 
+enum { //one telemetry slot in every 2, 4, ... 64 slots
+  TELEM_RATIO_1_2 = 0,
+  TELEM_RATIO_1_4,
+  TELEM_RATIO_1_8,
+  TELEM_RATIO_1_16,
+  TELEM_RATIO_1_32,
+  TELEM_RATIO_1_64,
+  TELEM_RATIO_LAST = TELEM_RATIO_1_64
+};
+
 enum {
   RFPOWER_3dBm = 0,
   RFPOWER_7dBm,
   RFPOWER_10dBm,
   RFPOWER_14dBm,
   RFPOWER_17dBm,
-  RFPOWER_LAST = RFPOWER_17dBm
+  //automatic, up to the given level
+  RFPOWER_AUTO_10dBm,
+  RFPOWER_AUTO_14dBm,
+  RFPOWER_AUTO_17dBm,
+  //automatic, with the long range rate profile as the step above the given level
+  RFPOWER_AUTO_10dBm_LR,
+  RFPOWER_AUTO_14dBm_LR,
+  RFPOWER_AUTO_17dBm_LR,
+  RFPOWER_LAST = RFPOWER_AUTO_17dBm_LR
 };
 
 //====================== MODEL PARAMETERS ==========================================================
@@ -186,7 +261,7 @@ typedef struct {
   int8_t endpointL[NUM_PRP_CHANNLES];   //left endpoint, -100 to 0
   int8_t endpointR[NUM_PRP_CHANNLES];   //right endpoint, 0 to 100
   int8_t subtrim[NUM_PRP_CHANNLES];     //-20 to 20
-  int8_t failsafe[NUM_PRP_CHANNLES];    //-101 to 100. -101 means off
+  int8_t failsafe[NUM_PRP_CHANNLES];    //-102 to 100. -101 means hold last value, -102 no pulses
 
   // Ail, Ele, Rud
   uint8_t dualRate;       //Bit0 Ail, Bit1 Ele, Bit2 Rud  
@@ -212,6 +287,9 @@ typedef struct {
   uint8_t timer1InitMins; //if 0, timer will count up, else count down
   
   uint16_t telemVoltsThresh; //as 10mV
+  uint8_t telemLQThresh;     //in percent. 0 is off
+  uint8_t telemRssiThresh;   //as -dBm. 0 is off
+  int16_t telemSensorThresh[RX_MAX_SENSORS]; //in the sensor's units. 0 is off. Low alarm for voltage, high for the rest
 
   //------- mixer params ---------
   
@@ -272,8 +350,8 @@ enum {
   IDX_SLOW1,
   IDX_AIL, IDX_ELE, IDX_THRTL_CURV, IDX_RUD,
   IDX_NONE, 
-  IDX_CH1, IDX_CH2, IDX_CH3, IDX_CH4, IDX_CH5, IDX_CH6, IDX_CH7, IDX_CH8, IDX_CH9,
-  IDX_VRT1, IDX_VRT2,
+  IDX_CH1, IDX_CH2, IDX_CH3, IDX_CH4, //the rest of the channels follow
+  IDX_VRT1 = IDX_CH1 + NUM_PRP_CHANNLES, IDX_VRT2,
  
   NUM_MIXSOURCES //should be last
 };
@@ -35,6 +35,10 @@
 #define DISPLAY_KS0108
 // #define DISPLAY_CGM12864G
 
+// Uncomment to show the number of bytes sent to the lcd each frame in the top right corner of the 
+// home screen. Only what changed is sent, so this is near 32 when nothing on the screen changes
+// #define DEBUG_DISPLAY_FLUSH
+
 //---------- Battery voltage ----
 const int battVoltsMin = 3500; //millivolts
 const int battVoltsMax = 4000; //millivolts
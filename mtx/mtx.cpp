@@ -17,6 +17,7 @@ void sendSerialData();
 void getSerialData();
 void checkBattery();
 uint16_t joinBytes(uint8_t _highByte, uint8_t _lowByte); 
+void writeBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits, uint16_t val);
 
 //===================================== setup ======================================================
 
@@ -191,6 +192,8 @@ void sendSerialData()
       Size        |  1 byte   1 byte   1 byte  20 bytes     1 byte
       Offset      |  0        1        2       3            23
     ---------------------------------------------------------------
+    - Channel data (rc data and failsafe) is packed as 10 bits per channel, msb first, 
+      which fits a max of 16 channels in the general data bytes.
   */
 
   /* Status0 
@@ -206,17 +209,18 @@ void sendSerialData()
   };
   
   /* Status1
-      bit0  failsafe data
-      bit1  write receiver config
-      bit2  get receiver config 
-      bit3  get telemetry
-      bit4  enter bind mode 
+      bit0    failsafe data
+      bit1    write receiver config
+      bit2    get receiver config 
+      bit3    allow the long range rate profile in automatic power mode
+      bit4    enter bind mode 
+      bit5-7  telemetry ratio
   */
   enum {
     FLAG_FAILSAFE_DATA    = 0x01,
     FLAG_WRITE_RX_CONFIG  = 0x02,
     FLAG_GET_RX_CONFIG    = 0x04,
-    FLAG_GET_TELEMETRY    = 0x08,
+    FLAG_LONG_RANGE       = 0x08,
     FLAG_ENTER_BIND       = 0x10,
   };
 
@@ -225,8 +229,11 @@ void sendSerialData()
 
   uint8_t status0 = 0;
   
-  //rf power level
-  status0 |= (Sys.rfPower & 0x07);
+  //rf power level. The long range settings are sent as the automatic ones, plus a flag in status1
+  if(Sys.rfPower >= RFPOWER_AUTO_10dBm_LR)
+    status0 |= Sys.rfPower - (RFPOWER_AUTO_10dBm_LR - RFPOWER_AUTO_10dBm);
+  else
+    status0 |= (Sys.rfPower & 0x07);
   
   //rf enabled
   if(Sys.rfOutputEnabled)
@@ -258,16 +265,9 @@ void sendSerialData()
     isRequestingBind = false;
   }
   
-  //alternately send failsafe or request telemetry every 300ms
-  static bool isRequestingTelemetry = false;
-  if(thisLoopNum % (300 / fixedLoopTime) == 1) 
-  {
-    isRequestingTelemetry = !isRequestingTelemetry;
-    if(isRequestingTelemetry)
-      status1 |= FLAG_GET_TELEMETRY;
-    else
-      status1 |= FLAG_FAILSAFE_DATA;
-  }
+  //send failsafe every 600ms
+  if(thisLoopNum % (600 / fixedLoopTime) == 1) 
+    status1 |= FLAG_FAILSAFE_DATA;
   
   //requesting receiver configuration
   if(isRequestingOutputChConfig)
@@ -275,7 +275,7 @@ void sendSerialData()
     status1 |= FLAG_GET_RX_CONFIG;
     isRequestingOutputChConfig = false;
     //unset other flags
-    status1 &= ~FLAG_GET_TELEMETRY; 
+    status1 &= ~FLAG_FAILSAFE_DATA; 
   }
   
   //sending receiver configuration
@@ -285,8 +285,14 @@ void sendSerialData()
     sendOutputChConfig = false;
     //unset other flags
     status1 &= ~FLAG_FAILSAFE_DATA;
-    status1 &= ~FLAG_GET_TELEMETRY;    
   }
+  
+  //long range rate profile allowed
+  if(Sys.rfPower >= RFPOWER_AUTO_10dBm_LR)
+    status1 |= FLAG_LONG_RANGE;
+  
+  //telemetry ratio. The slave mcu schedules the telemetry slots
+  status1 |= (Sys.telemRatio & 0x07) << 5;
  
  
   uint8_t tmpBuff[24];
@@ -307,36 +313,29 @@ void sendSerialData()
   //
   if(status1 & FLAG_WRITE_RX_CONFIG) //receiver config data
   {
-    for(uint8_t i = 0; i < 9; i++) //###
+    for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; i++)
       tmpBuff[3 + i] = outputChConfig[i];
   }
   else if(status1 & FLAG_FAILSAFE_DATA) //failsafe data
   {
     for(uint8_t i = 0; i < NUM_PRP_CHANNLES; i++)
     {
-      if(Model.failsafe[i] == -101) //failsafe not specified, send 1023
-      {
-        tmpBuff[3 + i*2] = 0x03;
-        tmpBuff[4 + i*2] = 0xFF;
-      }
+      if(Model.failsafe[i] == -101) //hold last value, send 1023
+        writeBits(tmpBuff + 3, i * 10, 10, 1023);
+      else if(Model.failsafe[i] == -102) //no pulses, send 1022
+        writeBits(tmpBuff + 3, i * 10, 10, 1022);
       else //failsafe specified
       {
         int fsf = 5 * Model.failsafe[i];
         fsf = constrain(fsf, 5 * Model.endpointL[i], 5 * Model.endpointR[i]);
-        uint16_t val = (fsf + 500) & 0xFFFF;
-        tmpBuff[3 + i*2] = (val >> 8) & 0xFF;
-        tmpBuff[4 + i*2] = val & 0xFF;
+        writeBits(tmpBuff + 3, i * 10, 10, fsf + 500);
       }
     }
   }
   else //real time RC data
   {
     for(uint8_t i = 0; i < NUM_PRP_CHANNLES; i++)
-    {
-      uint16_t val = (channelOut[i] + 500) & 0xFFFF; 
-      tmpBuff[3 + i*2] = (val >> 8) & 0xFF;
-      tmpBuff[4 + i*2] = val & 0xFF;
-    }
+      writeBits(tmpBuff + 3, i * 10, 10, channelOut[i] + 500);
   }
   
   //add a crc
@@ -365,11 +364,31 @@ void getSerialData()
   Byte2     Transmitter packet rate
   Byte3     Packet rate at receiver side
   Byte4-5   Voltage telemetry
-  Byte6-14  Receiver channel config Ch1 to Ch9
-  Byte15    CRC8
+  Byte6     Update rate of the slowest channel at receiver side
+  Byte7     Telemetry payload bytes received per second
+  Byte8     Rc packets per second given up for telemetry
+  Byte9     Link quality at receiver side, in percent
+  Byte10    Uplink rssi, as -dBm. 0 is "No data"
+  Byte11    Uplink snr, in dB. Signed
+  Byte12    Corrupted packets per second at receiver side
+  Byte13    Downlink rssi, as -dBm. 0 is "No data"
+  Byte14    Downlink snr, in dB. Signed
+  Byte15    Rc packets per second corrected by fec at receiver side
+  Byte16    Lost rc frames per second rebuilt from redundancy records at receiver side
+  Byte17    Bits 2-0 --> Rf power level in use
+            Bit 7    --> Long range rate profile in use
+  Byte18    Packet arrival to outputs updated at receiver side, in 0.1ms. 0 is "No data"
+  Byte19    Packet arrival to channels decoded at receiver side, in 0.1ms. 0 is "No data"
+  Byte20    Last packet to failsafe on the outputs at receiver side, in 10ms. 0 is "No data"
+  Byte21    Receiver link statistics page number. 0xFF is "No data"
+  Byte22-31 Receiver link statistics, 5 values of 2 bytes each, msb first
+  Byte32    Length of the receiver sensor page that follows. 0 is "No data"
+  Byte33-44 Receiver sensor page, up to 4 entries of 3 bytes. See protocols.txt
+  Byte45-n  Receiver channel config, 1 byte per output. n is 44 + NUM_RX_OUTPUT_CHANNELS
+  Byte n+1  CRC8
   */
   
-  const uint8_t msgLength = 16;
+  const uint8_t msgLength = 46 + NUM_RX_OUTPUT_CHANNELS;
   if (Serial.available() < msgLength)
   {
     return;
@@ -406,6 +425,67 @@ void getSerialData()
     
     //-- telemetry voltage --
     telem_volts = joinBytes(tmpBuff[4], tmpBuff[5]);
+    
+    receiverSlowestChRate = tmpBuff[6];
+    
+    telemBandwidth = tmpBuff[7];
+    uplinkRateForTelem = tmpBuff[8];
+    
+    //-- link --
+    receiverLinkQuality = tmpBuff[9];
+    if(receiverLinkQuality > 0)
+      hasReceivedTelemetry = true;
+    uplinkRssi = tmpBuff[10];
+    uplinkSnr = (int8_t) tmpBuff[11];
+    receiverCrcFailRate = tmpBuff[12];
+    downlinkRssi = tmpBuff[13];
+    downlinkSnr = (int8_t) tmpBuff[14];
+    receiverFecFixRate = tmpBuff[15];
+    receiverRecoveryRate = tmpBuff[16];
+    receiverOutputDelay = tmpBuff[18];
+    receiverProcessTime = tmpBuff[19];
+    receiverFailsafeDelay = tmpBuff[20];
+    
+    //-- receiver link statistics, a page at a time --
+    if(tmpBuff[21] < RX_STATS_NUM_PAGES)
+    {
+      for(uint8_t i = 0; i < RX_STATS_PER_PAGE; i++)
+      {
+        uint8_t _idx = tmpBuff[21] * RX_STATS_PER_PAGE + i;
+        if(_idx < NUM_RX_STATS) //the last page may not be full
+          receiverStats[_idx] = joinBytes(tmpBuff[22 + 2 * i], tmpBuff[23 + 2 * i]);
+      }
+    }
+    
+    //-- receiver sensors. Each entry is the sensor number and type, then the value --
+    if(tmpBuff[32] == 0) //telemetry lost
+    {
+      for(uint8_t i = 0; i < RX_MAX_SENSORS; i++)
+        rxSensorValue[i] = SENSOR_NO_DATA;
+    }
+    for(uint8_t i = 0; i + 3 <= tmpBuff[32] && i + 3 <= 12; i += 3)
+    {
+      uint8_t _idx = tmpBuff[33 + i] >> 4;
+      if(_idx >= RX_MAX_SENSORS)
+        continue;
+      if(!(rxSensorsSeen & (1 << _idx)))
+      {
+        rxSensorsSeen |= 1 << _idx;
+        rxSensorMin[_idx] = 0x7FFF;
+        rxSensorMax[_idx] = SENSOR_NO_DATA;
+      }
+      int16_t _val = (int16_t) joinBytes(tmpBuff[34 + i], tmpBuff[35 + i]);
+      rxSensorType[_idx] = tmpBuff[33 + i] & 0x0F;
+      rxSensorValue[_idx] = _val;
+      if(_val != SENSOR_NO_DATA)
+      {
+        if(_val < rxSensorMin[_idx]) rxSensorMin[_idx] = _val;
+        if(_val > rxSensorMax[_idx]) rxSensorMax[_idx] = _val;
+      }
+    }
+    
+    rfPowerLevelInUse = tmpBuff[17] & 0x07;
+    isLongRangeInUse = (tmpBuff[17] >> 7) & 0x01;
 
     //-- power off request --
     if((tmpBuff[0] >> 6) & 0x01)
@@ -431,10 +511,10 @@ void getSerialData()
     if((tmpBuff[0] >> 7) & 0x01)
     {
       gotOutputChConfig = true;
-      for(uint8_t i = 0; i < 9; i++)
+      for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; i++)
       {
-        outputChConfig[i] = tmpBuff[6 + i] & 0x0F;
-        maxOutputChConfig[i] = tmpBuff[6 + i] >> 4;
+        outputChConfig[i] = tmpBuff[45 + i] & 0x0F;
+        outputChCapability[i] = tmpBuff[45 + i] >> 4;
       }
     }
   }
@@ -453,6 +533,22 @@ uint16_t joinBytes(uint8_t _highByte, uint8_t _lowByte)
 
 //==================================================================================================
 
+void writeBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits, uint16_t val)
+{
+  //Writes the lower numBits (max 16) of val starting at bitPos. Bits are packed msb first
+  for(uint8_t i = 0; i < numBits; i++)
+  {
+    uint8_t _pos = bitPos + i;
+    uint8_t _mask = 0x80 >> (_pos % 8);
+    if((val >> (numBits - 1 - i)) & 0x01)
+      buff[_pos / 8] |= _mask;
+    else
+      buff[_pos / 8] &= ~_mask;
+  }
+}
+
+//==================================================================================================
+
 void checkBattery()
 {
   //Low pass filtered using exponential smoothing
@@ -48,9 +48,17 @@ bool modelIsfree(uint8_t _mdlNo);
 void printModelName(char* _buff, uint8_t _lenBuff, uint8_t _mdlNo);
 int8_t adjustTrim(int8_t _lowerLimit, int8_t _upperLimit, int8_t _val);
 void drawTelemVolts(uint8_t xpos, uint8_t ypos);
+bool isLinkQualityLow();
+bool isUplinkRssiLow();
+void printRssiSnr(uint8_t _rssi, int8_t _snr);
+void printTenthsMs(uint8_t _val);
+void printSensorValue(uint8_t _type, int16_t _val);
+bool isSensorAlarm(uint8_t _idx);
+bool isAnySensorAlarm();
 void drawLoadingAnimation(uint8_t xpos, uint8_t ypos, uint8_t _size);
 int incDecOnUpDown(int _val, int _lowerLimit, int _upperLimit, bool _enableWrap, uint8_t _state);
 void drawFullScreenMsg(const char* str);
+void getSrcName(char* _buff, uint8_t _srcIdx, uint8_t _lenBuff);
 
 
 //-- Startup menu strings. Max 15 characters per string
@@ -107,23 +115,17 @@ char const srcName15[] PROGMEM = "Ele";
 char const srcName16[] PROGMEM = "Thrt";
 char const srcName17[] PROGMEM = "Rud";
 char const srcName18[] PROGMEM = "None";
-char const srcName19[] PROGMEM = "Ch1";
-char const srcName20[] PROGMEM = "Ch2";
-char const srcName21[] PROGMEM = "Ch3";
-char const srcName22[] PROGMEM = "Ch4";
-char const srcName23[] PROGMEM = "Ch5";
-char const srcName24[] PROGMEM = "Ch6";
-char const srcName25[] PROGMEM = "Ch7";
-char const srcName26[] PROGMEM = "Ch8";
-char const srcName27[] PROGMEM = "Ch9";
-char const srcName28[] PROGMEM = "Virt1";
-char const srcName29[] PROGMEM = "Virt2";
 
 const char* const srcNames[] PROGMEM = {
   srcName0, srcName1, srcName2, srcName3, srcName4, srcName5, srcName6, srcName7, 
   srcName8, srcName9, srcName10,srcName11, srcName12, srcName13, srcName14,
-  srcName15, srcName16, srcName17, srcName18, srcName19, srcName20, srcName21, 
-  srcName22, srcName23, srcName24, srcName25, srcName26, srcName27, srcName28, srcName29
+  srcName15, srcName16, srcName17, srcName18
+};
+//channel names are generated in getSrcName()
+char const virtName0[] PROGMEM = "Virt1";
+char const virtName1[] PROGMEM = "Virt2";
+const char* const virtNames[] PROGMEM = {
+  virtName0, virtName1
 };
 
 //Mix control switch strings
@@ -195,8 +197,15 @@ char const rfPowerStr1[] PROGMEM = "5mW";
 char const rfPowerStr2[] PROGMEM = "10mW";
 char const rfPowerStr3[] PROGMEM = "25mW";
 char const rfPowerStr4[] PROGMEM = "50mW";
+char const rfPowerStr5[] PROGMEM = "Auto<10mW";
+char const rfPowerStr6[] PROGMEM = "Auto<25mW";
+char const rfPowerStr7[] PROGMEM = "Auto<50mW";
+char const rfPowerStr8[] PROGMEM = "AutoLR<10";
+char const rfPowerStr9[] PROGMEM = "AutoLR<25";
+char const rfPowerStr10[] PROGMEM = "AutoLR<50";
 const char* const rfPowerStr[] PROGMEM = {  
-  rfPowerStr0, rfPowerStr1, rfPowerStr2, rfPowerStr3, rfPowerStr4
+  rfPowerStr0, rfPowerStr1, rfPowerStr2, rfPowerStr3, rfPowerStr4, rfPowerStr5, rfPowerStr6, 
+  rfPowerStr7, rfPowerStr8, rfPowerStr9, rfPowerStr10
 };
 
 //Timer operator strings
@@ -219,7 +228,7 @@ const char* const funcgenStr[] PROGMEM = {
 
 
 //-- Main menu strings. Max 16 characters per string
-#define NUM_ITEMS_MAIN_MENU 9
+#define NUM_ITEMS_MAIN_MENU 10
 char const main0[] PROGMEM = "Main menu"; //heading
 char const main1[] PROGMEM = "Model";
 char const main2[] PROGMEM = "Inputs";
@@ -227,10 +236,11 @@ char const main3[] PROGMEM = "Mixer";
 char const main4[] PROGMEM = "Outputs";
 char const main5[] PROGMEM = "System";
 char const main6[] PROGMEM = "Telemetry";
-char const main7[] PROGMEM = "Receiver";
-char const main8[] PROGMEM = "About";
+char const main7[] PROGMEM = "Link";
+char const main8[] PROGMEM = "Receiver";
+char const main9[] PROGMEM = "About";
 const char* const mainMenu[] PROGMEM = { //table to refer to the strings
-  main0, main1, main2, main3, main4, main5, main6, main7, main8
+  main0, main1, main2, main3, main4, main5, main6, main7, main8, main9
 };
 
 //Assign indices for ui states
@@ -244,6 +254,7 @@ enum
   MODE_OUTPUTS,
   MODE_SYSTEM,
   MODE_TELEMETRY,
+  MODE_LINK,
   MODE_RECEIVER,
   MODE_ABOUT,
   
@@ -424,10 +435,15 @@ void handleMainUI()
   static uint32_t _tWarnEntryLoopNum = 0;
   static bool _tWarnStarted = false;
   
-  if(Sys.telemAlarmEnabled && telem_volts != 0x0FFF)
+  bool _hasVoltsData = telem_volts != 0x0FFF;
+  bool _hasLinkData = receiverLinkQuality > 0;
+  bool _isLQLow = isLinkQualityLow(); //also true once telemetry is lost
+  
+  if(Sys.telemAlarmEnabled && (_hasVoltsData || _hasLinkData || _isLQLow))
   {
     //check and increment or decrement counter
-    if(telem_volts < Model.telemVoltsThresh)
+    if((_hasVoltsData && telem_volts < Model.telemVoltsThresh) || _isLQLow
+       || (_hasLinkData && (isUplinkRssiLow() || isAnySensorAlarm())))
     {
       if(!_tWarnStarted) 
         ++_tCounter;
@@ -449,7 +465,7 @@ void handleMainUI()
       audioToPlay = AUDIO_TELEMWARN;
   }
   
-  if(telem_volts == 0x0FFF)
+  if(!_hasVoltsData && !_hasLinkData && !_isLQLow)
   {
     _tCounter = 0;
     _tWarnStarted = false;
@@ -557,13 +573,21 @@ void handleMainUI()
         if (Sys.rfOutputEnabled)
         {
           display.drawBitmap(85, 0, rf_icon, 7, 7, 1);
-          for(uint8_t i = 0; i < Sys.rfPower + 2; i++)
+          for(uint8_t i = 0; i < rfPowerLevelInUse + 2; i++)
             display.drawVLine(91 + i, 6 - i, i + 1, BLACK);
+          if(isLongRangeInUse) //a full height bar, a step past the top power level
+            display.drawVLine(98, 0, 7, BLACK);
         }
         
         //--------show mute icon------------
         if (Sys.soundMode == SOUND_OFF)
           display.drawBitmap(41, 0, mute_icon, 7, 7, 1);
+        
+#if defined (DEBUG_DISPLAY_FLUSH)
+        //bytes sent to the lcd by the last frame
+        display.setCursor(104, 0);
+        display.print(display.bytesSent);
+#endif
 
         //------show model name-----------
         display.setCursor(14, 16);
@@ -629,7 +653,7 @@ void handleMainUI()
           
           //show current trim
           display.setCursor(88, 34);
-          strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_AIL + selectedTrim])), sizeof(txtBuff));
+          getSrcName(txtBuff, IDX_AIL + selectedTrim, sizeof(txtBuff));
           display.print(txtBuff);
           display.setCursor(88, 42);
           display.print(F("trim"));
@@ -723,7 +747,7 @@ void handleMainUI()
         
         display.setCursor(0, 10);
         display.print(F("Control:   "));
-        strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[Model.timer1ControlSrc])), sizeof(txtBuff));
+        getSrcName(txtBuff, Model.timer1ControlSrc, sizeof(txtBuff));
         display.print(txtBuff);
         
         display.setCursor(0, 19);
@@ -775,12 +799,19 @@ void handleMainUI()
       {
         drawHeader(PSTR("Outputs"));
         
-        for(uint8_t i = 0; i < NUM_PRP_CHANNLES && i < 9; i++)
+        //10 channels per page. Up and down keys change the page
+        static uint8_t _page = 0;
+        isEditMode = true;
+        _page = incDecOnUpDown(_page, 0, (NUM_PRP_CHANNLES - 1) / 10, WRAP, INCDEC_SLOW);
+        isEditMode = false;
+        
+        for(uint8_t i = _page * 10; i < NUM_PRP_CHANNLES && i < (_page + 1) * 10; i++)
         {
-          if(i < 5)
-            display.setCursor(11, 12 + i * 10);
+          uint8_t _row = i - _page * 10;
+          if(_row < 5)
+            display.setCursor(11, 12 + _row * 10);
           else
-            display.setCursor(71, 12 + (i - 5) * 10);
+            display.setCursor(71, 12 + (_row - 5) * 10);
           
           display.print(F("Ch"));          
           display.print(1 + i);  
@@ -1229,9 +1260,9 @@ void handleMainUI()
           
           display.setCursor(8,11);
           if(_page == RUD_CURVE) 
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_RUD])), sizeof(txtBuff)); 
+            getSrcName(txtBuff, IDX_RUD, sizeof(txtBuff)); 
           else 
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_AIL + _page])), sizeof(txtBuff));
+            getSrcName(txtBuff, IDX_AIL + _page, sizeof(txtBuff));
           display.print(txtBuff);
           display.drawHLine(8, 19, strlen(txtBuff) * 6, BLACK);
           
@@ -1281,7 +1312,7 @@ void handleMainUI()
 
           //-----draw text
           display.setCursor(8, 11);
-          strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_THRTL_CURV])), sizeof(txtBuff));
+          getSrcName(txtBuff, IDX_THRTL_CURV, sizeof(txtBuff));
           display.print(txtBuff);
           display.drawHLine(8, 19, strlen(txtBuff) * 6, BLACK);
           
@@ -1351,7 +1382,7 @@ void handleMainUI()
           
           display.setCursor(0, 40);
           display.print(F("Src:   "));
-          strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[Model.slow1Src])), sizeof(txtBuff));
+          getSrcName(txtBuff, Model.slow1Src, sizeof(txtBuff));
           display.print(txtBuff);
           
           if(focusedItem == 2)
@@ -1407,7 +1438,7 @@ void handleMainUI()
           for(uint8_t i = 0; i < 5; i++)
           {
             display.setCursor(11, 21 + i * 9);
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_ROLL + i])), sizeof(txtBuff));
+            getSrcName(txtBuff, IDX_ROLL + i, sizeof(txtBuff));
             display.print(txtBuff);
             display.setCursor(39, 21 + i * 9);
             display.print(_stickVal[i]/5);
@@ -1418,7 +1449,7 @@ void handleMainUI()
           {
             uint8_t _ycord = 12 + i * 9;
             display.setCursor(71, _ycord);
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[IDX_SWA + i])), sizeof(txtBuff));
+            getSrcName(txtBuff, IDX_SWA + i, sizeof(txtBuff));
             display.print(txtBuff);
             
             if(_swState[i] == 0) display.print(F(" -100"));
@@ -1452,7 +1483,7 @@ void handleMainUI()
         display.setCursor(0, 16);
         display.print(F("Output:  "));
         uint8_t _outNameIndex = Model.mixOut[thisMixNum];
-        strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[_outNameIndex])), sizeof(txtBuff));
+        getSrcName(txtBuff, _outNameIndex, sizeof(txtBuff));
         display.print(txtBuff);
         
         display.setCursor(0, 24);
@@ -1463,13 +1494,13 @@ void handleMainUI()
           display.setCursor(54 + i * 43, 24);
           if(_inName[i] == IDX_SLOW1) 
           {
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[Model.slow1Src])), sizeof(txtBuff));
+            getSrcName(txtBuff, Model.slow1Src, sizeof(txtBuff));
             display.print(txtBuff);
             display.drawBitmap(display.getCursorX(), display.getCursorY(), asterisk_small, 3, 3, 1);
           }
           else
           {
-            strlcpy_P(txtBuff, (char *)pgm_read_word(&(srcNames[_inName[i]])), sizeof(txtBuff));
+            getSrcName(txtBuff, _inName[i], sizeof(txtBuff));
             display.print(txtBuff);
           }
         }
@@ -1640,11 +1671,12 @@ void handleMainUI()
         display.setCursor(0,56);
         display.print(F("Ch"));
         
-        // Graph mixer outputs
-        for (uint8_t i = 0; i < NUM_PRP_CHANNLES && i < 9; i++)
+        // Graph mixer outputs. Bars are spaced to fit the number of channels
+        const uint8_t _spacing = 108 / NUM_PRP_CHANNLES;
+        for (uint8_t i = 0; i < NUM_PRP_CHANNLES; i++)
         {
           int _outVal = mixerChOutGraphVals[i] / 5;
-          uint8_t _xOffset = i * 12;
+          uint8_t _xOffset = i * _spacing;
           if (_outVal > 0)
             display.fillRect(17 + _xOffset, 33 - _outVal, 3, _outVal , BLACK);
           else if (_outVal < 0)
@@ -1657,9 +1689,12 @@ void handleMainUI()
             display.drawPixel(18 + _xOffset, 13 + j, j % 2);
           //draw midpoint
           display.drawHLine(13, 33, 107, BLACK);
-          //Show channel numbers
-          display.setCursor(16 + _xOffset, 56);
-          display.print(i + 1);
+          //Show channel numbers. Only every other channel if bars are too close
+          if(_spacing >= 12 || i % 2 == 0)
+          {
+            display.setCursor(16 + _xOffset, 56);
+            display.print(i + 1);
+          }
         }
 
         if(heldButton == SELECT_KEY)
@@ -1816,7 +1851,7 @@ void handleMainUI()
         else if (focusedItem == 3)
           Model.subtrim[_selectedChannel] = incDecOnUpDown(Model.subtrim[_selectedChannel], -20, 20, NOWRAP, INCDEC_SLOW);
         else if (focusedItem == 4)
-          Model.failsafe[_selectedChannel] = incDecOnUpDown(Model.failsafe[_selectedChannel], -101, 100, NOWRAP, INCDEC_NORMAL);
+          Model.failsafe[_selectedChannel] = incDecOnUpDown(Model.failsafe[_selectedChannel], -102, 100, NOWRAP, INCDEC_NORMAL);
         else if (focusedItem == 5)
           Model.endpointL[_selectedChannel] = incDecOnUpDown(Model.endpointL[_selectedChannel], -100, 0, NOWRAP, INCDEC_NORMAL);
         else if (focusedItem == 6)
@@ -1837,8 +1872,10 @@ void handleMainUI()
         
         display.setCursor(0, 32);
         display.print(F("Failsaf:  "));
-        if(Model.failsafe[_selectedChannel]== -101)
-          display.print(F("Off"));
+        if(Model.failsafe[_selectedChannel] == -102)
+          display.print(F("NoPulse"));
+        else if(Model.failsafe[_selectedChannel] == -101)
+          display.print(F("Hold"));
         else
           display.print(Model.failsafe[_selectedChannel]);
 
@@ -1947,49 +1984,333 @@ void handleMainUI()
       {
         drawHeader((char *)pgm_read_word(&mainMenu[MODE_TELEMETRY]));
         
-        display.setCursor(8, 9);
-        strlcpy_P(txtBuff, PSTR("Ext volts"), sizeof(txtBuff));
-        display.print(txtBuff);
-        display.drawHLine(8, 17, strlen(txtBuff) * 6, BLACK);
+        //Voltage page, then a page per sensor the receiver has reported. Up and down keys change the 
+        //page when the first item is being edited
+        static uint8_t _page = 0;
+        uint8_t _numPages = 1;
+        for(uint8_t i = 0; i < RX_MAX_SENSORS; i++)
+        {
+          if(rxSensorsSeen & (1 << i))
+            _numPages = i + 2;
+        }
+        if(_page >= _numPages)
+          _page = 0;
+        if(focusedItem == 1)
+          _page = incDecOnUpDown(_page, 0, _numPages - 1, WRAP, INCDEC_SLOW);
+        
+        if(_page == 0)
+        {
+          display.setCursor(8, 9);
+          strlcpy_P(txtBuff, PSTR("Ext volts"), sizeof(txtBuff));
+          display.print(txtBuff);
+          display.drawHLine(8, 17, strlen(txtBuff) * 6, BLACK);
         
-        display.setCursor(14, 19);
-        display.print(F("Alarm :  "));
-        drawCheckbox(68, 19, Sys.telemAlarmEnabled);
+          display.setCursor(14, 19);
+          display.print(F("Alarm :  "));
+          drawCheckbox(68, 19, Sys.telemAlarmEnabled);
         
-        display.setCursor(14, 28);
-        display.print(F("HmScrn:  "));
-        drawCheckbox(68, 28, Sys.telemVoltsOnHomeScreen);
+          display.setCursor(14, 28);
+          display.print(F("HmScrn:  "));
+          drawCheckbox(68, 28, Sys.telemVoltsOnHomeScreen);
         
-        display.setCursor(14, 37);
-        display.print(F("V low :  "));
-        printVolts(Model.telemVoltsThresh * 10);
+          display.setCursor(14, 37);
+          display.print(F("V low :  "));
+          printVolts(Model.telemVoltsThresh * 10);
+        
+          //telemetry slot ratio, and what it delivers and costs
+          display.setCursor(14, 46);
+          display.print(F("Ratio :  1:"));
+          display.print(2 << Sys.telemRatio);
+        
+          display.setCursor(14, 55);
+          display.print(telemBandwidth);
+          display.print(F("B/s (-"));
+          display.print(uplinkRateForTelem);
+          display.print(F("pps)"));
+
+          //Show the telemetry voltage
+          if(telem_volts != 0x0FFF)
+          {
+            display.drawRect(89, 9, 39, 11, BLACK);
+            drawTelemVolts(91, 11);
+          }
 
-        //Show the telemetry voltage
-        if(telem_volts != 0x0FFF)
+          changeFocusOnUPDOWN(5);
+          toggleEditModeOnSelectClicked();
+          if(focusedItem == 1) 
+            drawCursor(0, 9);
+          else 
+            drawCursor(60, 19 + (focusedItem - 2) * 9);
+        
+          if(focusedItem == 2)
+            Sys.telemAlarmEnabled = incDecOnUpDown(Sys.telemAlarmEnabled, 0, 1, WRAP, INCDEC_PRESSED_ONLY);
+          else if(focusedItem == 3)
+            Sys.telemVoltsOnHomeScreen = incDecOnUpDown(Sys.telemVoltsOnHomeScreen, 0, 1, WRAP, INCDEC_PRESSED_ONLY);
+          else if(focusedItem == 4)
+            Model.telemVoltsThresh = incDecOnUpDown(Model.telemVoltsThresh, 0, 2500, NOWRAP, INCDEC_FAST);
+          else if(focusedItem == 5)
+            Sys.telemRatio = incDecOnUpDown(Sys.telemRatio, 0, TELEM_RATIO_LAST, NOWRAP, INCDEC_PRESSED_ONLY);
+        }
+        else
+        {
+          uint8_t _idx = _page - 1;
+          uint8_t _type = rxSensorType[_idx];
+          
+          display.setCursor(8, 9);
+          display.print(F("Sensor "));
+          display.print(_idx + 1);
+          display.drawHLine(8, 17, 48, BLACK);
+          display.setCursor(68, 9);
+          if(!(rxSensorsSeen & (1 << _idx)))
+            display.print(F("None"));
+          else if(_type == SENSOR_VOLTS)
+            display.print(F("Voltage"));
+          else if(_type == SENSOR_CURRENT)
+            display.print(F("Current"));
+          else if(_type == SENSOR_TEMP)
+            display.print(F("Temp"));
+          else if(_type == SENSOR_ALTITUDE)
+            display.print(F("Altitude"));
+          
+          display.setCursor(14, 19);
+          display.print(F("Value :  "));
+          if(!isSensorAlarm(_idx) || millis() % 1000 < 700)
+            printSensorValue(_type, rxSensorValue[_idx]);
+          
+          display.setCursor(14, 28);
+          display.print(F("Min   :  "));
+          printSensorValue(_type, rxSensorMax[_idx] == SENSOR_NO_DATA ? SENSOR_NO_DATA : rxSensorMin[_idx]);
+          
+          display.setCursor(14, 37);
+          display.print(F("Max   :  "));
+          printSensorValue(_type, rxSensorMax[_idx]);
+          
+          //alarm when below the level for voltage, above it for the rest
+          display.setCursor(14, 46);
+          display.print(F("Alarm :  "));
+          if(Model.telemSensorThresh[_idx] == 0)
+            display.print(F("Off"));
+          else
+          {
+            display.print(_type == SENSOR_VOLTS ? F("<") : F(">"));
+            printSensorValue(_type, Model.telemSensorThresh[_idx]);
+          }
+          
+          display.setCursor(14, 55);
+          display.print(F("Reset min/max"));
+          
+          changeFocusOnUPDOWN(3);
+          toggleEditModeOnSelectClicked();
+          if(focusedItem == 1) 
+            drawCursor(0, 9);
+          else if(focusedItem == 2)
+            drawCursor(60, 46);
+          else
+            drawCursor(6, 55);
+          
+          if(focusedItem == 2)
+          {
+            int16_t _maxThresh = 10000;
+            if(_type == SENSOR_VOLTS)
+              _maxThresh = 2500;
+            else if(_type == SENSOR_TEMP)
+              _maxThresh = 1500;
+            Model.telemSensorThresh[_idx] = incDecOnUpDown(Model.telemSensorThresh[_idx], 0, _maxThresh, NOWRAP, INCDEC_FAST);
+          }
+          else if(focusedItem == 3 && isEditMode)
+          {
+            rxSensorMin[_idx] = 0x7FFF;
+            rxSensorMax[_idx] = SENSOR_NO_DATA;
+            isEditMode = false;
+          }
+        }
+        
+        if (heldButton == SELECT_KEY)
         {
-          display.drawRect(89, 9, 39, 11, BLACK);
-          drawTelemVolts(91, 11);
+          eeSaveSysConfig();
+          changeToScreen(MAIN_MENU);
         }
-
-        changeFocusOnUPDOWN(4);
+      }
+      break;
+      
+    case MODE_LINK:
+      {
+        drawHeader((char *)pgm_read_word(&mainMenu[MODE_LINK]));
+        
+        //Link page, then receiver diagnostics pages. Up and down keys change the page when the first 
+        //item is being edited
+        static uint8_t _page = 0;
+        if(focusedItem == 1)
+          _page = incDecOnUpDown(_page, 0, 3, WRAP, INCDEC_SLOW);
+        
+        if(_page == 0)
+        {
+          //Link quality and corrupted packets, as seen by the receiver
+          display.setCursor(14, 9);
+          display.print(F("LQ    :  "));
+          if(!isLinkQualityLow() || millis() % 1000 < 700)
+          {
+            display.print(receiverLinkQuality);
+            display.print(F("%"));
+          }
+          display.setCursor(98, 9);
+          display.print(F("Rec"));
+          display.print(receiverRecoveryRate); //lost frames rebuilt
+        
+          display.setCursor(14, 18);
+          display.print(F("CRCerr:  "));
+          display.print(receiverCrcFailRate);
+          display.print(F("/s Fix"));
+          display.print(receiverFecFixRate); //corrected by fec
+        
+          //Signal strength and quality in either direction
+          display.setCursor(14, 27);
+          display.print(F("Up  : "));
+          if(!isUplinkRssiLow() || millis() % 1000 < 700)
+            printRssiSnr(uplinkRssi, uplinkSnr);
+        
+          display.setCursor(14, 36);
+          display.print(F("Dn  : "));
+          printRssiSnr(downlinkRssi, downlinkSnr);
+        
+          //Alarm thresholds
+          display.setCursor(14, 45);
+          display.print(F("LQ low:  "));
+          if(Model.telemLQThresh == 0)
+            display.print(F("Off"));
+          else
+          {
+            display.print(Model.telemLQThresh);
+            display.print(F("%"));
+          }
+        
+          display.setCursor(14, 54);
+          display.print(F("RSSIlo:  "));
+          if(Model.telemRssiThresh == 0)
+            display.print(F("Off"));
+          else
+          {
+            display.print(F("-"));
+            display.print(Model.telemRssiThresh);
+            display.print(F("dBm"));
+          }
+          
+          changeFocusOnUPDOWN(3);
+        }
+        else if(_page == 1)
+        {
+          //Timing at the receiver, averaged over the packets between telemetry replies. Then 
+          //eeprom saves at the receiver that failed or were turned down, as settings may be lost
+          display.setCursor(14, 9);
+          display.print(F("Rx timing, eeprom"));
+          
+          display.setCursor(14, 18);
+          display.print(F("OutDly:  "));
+          printTenthsMs(receiverOutputDelay); //packet arrival to outputs updated
+          
+          display.setCursor(14, 27);
+          display.print(F("Decode:  "));
+          printTenthsMs(receiverProcessTime); //packet arrival to channels decoded
+          
+          display.setCursor(14, 36);
+          display.print(F("Fsafe :  "));
+          if(receiverFailsafeDelay == 0)
+            display.print(F("--"));
+          else
+          {
+            display.print(receiverFailsafeDelay * 10); //last packet to failsafe
+            display.print(F("ms"));
+          }
+          
+          display.setCursor(14, 45);
+          display.print(F("EEerr :  "));
+          display.print(receiverStats[RX_STAT_EEPROM_ERRORS]);
+          
+          display.setCursor(14, 54);
+          display.print(F("EEfull:  "));
+          display.print(receiverStats[RX_STAT_EEPROM_REFUSED]);
+          
+          changeFocusOnUPDOWN(1);
+        }
+        else if(_page == 2)
+        {
+          //Packet statistics at the receiver since it was powered on. Many rejected or foreign 
+          //packets with good signal point to interference. Weak signal and missed slots to range
+          display.setCursor(14, 9);
+          display.print(F("Rx packets"));
+          
+          display.setCursor(14, 18);
+          display.print(F("Rejectd:  "));
+          display.print(receiverStats[RX_STAT_REJECTED]);
+          
+          display.setCursor(14, 27);
+          display.print(F("Foreign:  "));
+          display.print(receiverStats[RX_STAT_FOREIGN]);
+          
+          display.setCursor(14, 36);
+          display.print(F("Missed :  "));
+          display.print(receiverStats[RX_STAT_MISSED_SLOTS]);
+          
+          display.setCursor(14, 45);
+          display.print(F("HopTout:  "));
+          display.print(receiverStats[RX_STAT_HOP_TIMEOUTS]);
+          
+          display.setCursor(14, 54);
+          display.print(F("SyncLos:  "));
+          display.print(receiverStats[RX_STAT_SYNC_LOSSES]);
+          
+          changeFocusOnUPDOWN(1);
+        }
+        else
+        {
+          //Failsafe statistics at the receiver since it was powered on. Durations are in 0.1s
+          display.setCursor(14, 9);
+          display.print(F("Rx failsafe"));
+          
+          display.setCursor(14, 18);
+          display.print(F("Count  :  "));
+          display.print(receiverStats[RX_STAT_FAILSAFES]);
+          
+          display.setCursor(14, 27);
+          display.print(F("Last   :  "));
+          display.print(receiverStats[RX_STAT_FAILSAFE_LAST] / 10);
+          display.print(F("."));
+          display.print(receiverStats[RX_STAT_FAILSAFE_LAST] % 10);
+          display.print(F("s"));
+          
+          display.setCursor(14, 36);
+          display.print(F("Longest:  "));
+          display.print(receiverStats[RX_STAT_FAILSAFE_LONGEST] / 10);
+          display.print(F("."));
+          display.print(receiverStats[RX_STAT_FAILSAFE_LONGEST] % 10);
+          display.print(F("s"));
+          
+          display.setCursor(14, 45);
+          display.print(F("Total  :  "));
+          display.print(receiverStats[RX_STAT_FAILSAFE_TOTAL]);
+          display.print(F("s"));
+          
+          display.setCursor(14, 54);
+          display.print(F("MaxGap :  "));
+          display.print(receiverStats[RX_STAT_LONGEST_GAP]);
+          display.print(F("ms"));
+          
+          changeFocusOnUPDOWN(1);
+        }
+        
         toggleEditModeOnSelectClicked();
         if(focusedItem == 1) 
           drawCursor(0, 9);
         else 
-          drawCursor(60, 19 + (focusedItem - 2) * 9);
+          drawCursor(60, 45 + (focusedItem - 2) * 9);
         
         if(focusedItem == 2)
-          Sys.telemAlarmEnabled = incDecOnUpDown(Sys.telemAlarmEnabled, 0, 1, WRAP, INCDEC_PRESSED_ONLY);
+          Model.telemLQThresh = incDecOnUpDown(Model.telemLQThresh, 0, 99, NOWRAP, INCDEC_NORMAL);
         else if(focusedItem == 3)
-          Sys.telemVoltsOnHomeScreen = incDecOnUpDown(Sys.telemVoltsOnHomeScreen, 0, 1, WRAP, INCDEC_PRESSED_ONLY);
-        else if(focusedItem == 4)
-          Model.telemVoltsThresh = incDecOnUpDown(Model.telemVoltsThresh, 0, 2500, NOWRAP, INCDEC_FAST);
+          Model.telemRssiThresh = incDecOnUpDown(Model.telemRssiThresh, 0, 130, NOWRAP, INCDEC_NORMAL);
         
         if (heldButton == SELECT_KEY)
-        {
-          eeSaveSysConfig();
           changeToScreen(MAIN_MENU);
-        }
       }
       break;
       
@@ -2064,7 +2385,7 @@ void handleMainUI()
         {
           drawHeader((char *)pgm_read_word(&mainMenu[MODE_RECEIVER]));
           
-          for(uint8_t i = 0; i < NUM_PRP_CHANNLES && i < 9; ++i)
+          for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; ++i)
           {
             if(i < 5)
               display.setCursor(0, 9 + i * 9);
@@ -2080,6 +2401,10 @@ void handleMainUI()
               display.print(F("Srvo")); 
             else if(outputChConfig[i] == 2) 
               display.print(F("PWM")); 
+            else if(outputChConfig[i] == 3) 
+              display.print(F("PPM")); 
+            else if(outputChConfig[i] == 4) 
+              display.print(F("SBUS")); 
           }
           
           display.setCursor(93, 56);
@@ -2087,18 +2412,24 @@ void handleMainUI()
           
           //Handle navigation
           
-          changeFocusOnUPDOWN(10);
+          changeFocusOnUPDOWN(NUM_RX_OUTPUT_CHANNELS + 1);
           toggleEditModeOnSelectClicked();
           if(focusedItem <= 5) drawCursor(28, focusedItem * 9);
-          else if(focusedItem < 10)  drawCursor(94, (focusedItem - 5) * 9);
-          else if(focusedItem == 10) drawCursor(85, 56);
+          else if(focusedItem <= NUM_RX_OUTPUT_CHANNELS)  drawCursor(94, (focusedItem - 5) * 9);
+          else drawCursor(85, 56);
           
-          if(focusedItem < 10)
+          if(focusedItem <= NUM_RX_OUTPUT_CHANNELS)
           {
             uint8_t _idx = focusedItem - 1;
-            outputChConfig[_idx] = incDecOnUpDown(outputChConfig[_idx], 0, maxOutputChConfig[_idx], WRAP, INCDEC_SLOW);
+            uint8_t _prevVal = outputChConfig[_idx];
+            uint8_t _val = incDecOnUpDown(_prevVal, 0, 4, WRAP, INCDEC_SLOW);
+            //skip the modes this output doesn't support. Digital is always supported
+            bool _isUp = (_val == (_prevVal + 1) % 5);
+            while(_val > 0 && !((outputChCapability[_idx] >> (_val - 1)) & 0x01))
+              _val = _isUp ? (_val + 1) % 5 : _val - 1;
+            outputChConfig[_idx] = _val;
           }
-          else if(focusedItem == 10 && clickedButton == SELECT_KEY)
+          else if(clickedButton == SELECT_KEY)
           {
             _state = _SENDING_CONFIG;
             _entryTime = millis();
@@ -2242,6 +2573,11 @@ void handleMainUI()
         display.print(F(","));
         display.print(receiverPacketRate);
         
+        //Show update rate of the least updated channel at the receiver
+        display.setCursor(0, 55);
+        display.print(F("ChRate:  "));
+        display.print(receiverSlowestChRate);
+        
         //show version
         display.setCursor(0, 37);
         display.print(F("FW ver:  "));
@@ -2281,7 +2617,7 @@ void toggleEditModeOnSelectClicked()
 
 //--------------------------------------------------------------------------------------------------
 
-void printHHMMSS(unsigned long _milliSecs)
+void printHHMMSS(uint32_t _milliSecs)
 {
   //Prints the time as mm:ss or hh:mm:ss at the specified screen cordinates
   
@@ -2337,6 +2673,116 @@ void drawTelemVolts(uint8_t xpos, uint8_t ypos)
 
 //--------------------------------------------------------------------------------------------------
 
+bool isLinkQualityLow()
+{
+  //Telemetry lost reads as 0, the lowest link quality of all. Only once telemetry has come in, so 
+  //there is no alarm before the receiver is powered on, and not with the rf output turned off
+  if(Model.telemLQThresh == 0 || !hasReceivedTelemetry || !Sys.rfOutputEnabled)
+    return false;
+  return receiverLinkQuality < Model.telemLQThresh;
+}
+
+bool isUplinkRssiLow()
+{
+  //Rssi is in -dBm so a weaker signal has a larger value
+  return uplinkRssi != 0 && Model.telemRssiThresh > 0 && uplinkRssi > Model.telemRssiThresh;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void printRssiSnr(uint8_t _rssi, int8_t _snr)
+{
+  if(_rssi == 0) //no data
+  {
+    display.print(F("--"));
+    return;
+  }
+  display.print(F("-"));
+  display.print(_rssi);
+  display.print(F("dBm "));
+  display.print(_snr);
+  display.print(F("dB"));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void printSensorValue(uint8_t _type, int16_t _val)
+{
+  //Prints a receiver sensor value with its unit. Voltage and current have 2 decimals, the rest 1
+  if(_val == SENSOR_NO_DATA)
+  {
+    display.print(F("--"));
+    return;
+  }
+  if(_val < 0)
+  {
+    display.print(F("-"));
+    _val = -_val;
+  }
+  if(_type == SENSOR_VOLTS || _type == SENSOR_CURRENT)
+  {
+    display.print(_val / 100);
+    display.print(F("."));
+    if(_val % 100 < 10)
+      display.print(F("0"));
+    display.print(_val % 100);
+    display.print(_type == SENSOR_VOLTS ? F("V") : F("A"));
+  }
+  else
+  {
+    display.print(_val / 10);
+    display.print(F("."));
+    display.print(_val % 10);
+    if(_type == SENSOR_TEMP)
+      display.print(F("C"));
+    else if(_type == SENSOR_ALTITUDE)
+      display.print(F("m"));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool isSensorAlarm(uint8_t _idx)
+{
+  //True if a receiver sensor is past its alarm level. Below it for voltage, above it for the rest
+  int16_t _thresh = Model.telemSensorThresh[_idx];
+  int16_t _val = rxSensorValue[_idx];
+  if(_thresh == 0 || !(rxSensorsSeen & (1 << _idx)) || _val == SENSOR_NO_DATA)
+    return false;
+  if(rxSensorType[_idx] == SENSOR_VOLTS)
+    return _val < _thresh;
+  return _val > _thresh;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool isAnySensorAlarm()
+{
+  for(uint8_t i = 0; i < RX_MAX_SENSORS; i++)
+  {
+    if(isSensorAlarm(i))
+      return true;
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void printTenthsMs(uint8_t _val)
+{
+  if(_val == 0) //no data
+  {
+    display.print(F("--"));
+    return;
+  }
+  display.print(_val / 10);
+  display.print(F("."));
+  display.print(_val % 10);
+  display.print(F("ms"));
+}
+
+//--------------------------------------------------------------------------------------------------
+
 int incDecOnUpDown(int _val, int _lowerLimit, int _upperLimit, bool _enableWrap, uint8_t _state)
 {
   //Increments/decrements the passed value between the specified limits inclusive. 
@@ -2634,6 +3080,29 @@ void printModelName(char* _buff, uint8_t _lenBuff, uint8_t _mdlNo)
 
 //--------------------------------------------------------------------------------------------------
 
+void getSrcName(char* _buff, uint8_t _srcIdx, uint8_t _lenBuff)
+{
+  //Copies the name of the mixer source into the buffer. 
+  //Channel names are generated instead of stored so as not to have a string for every channel
+  if(_srcIdx < IDX_CH1)
+    strlcpy_P(_buff, (char *)pgm_read_word(&(srcNames[_srcIdx])), _lenBuff);
+  else if(_srcIdx < IDX_CH1 + NUM_PRP_CHANNLES)
+  {
+    uint8_t _chNum = _srcIdx - IDX_CH1 + 1;
+    strlcpy_P(_buff, PSTR("Ch"), _lenBuff);
+    uint8_t _len = strlen(_buff);
+    if(_chNum >= 10 && _len < _lenBuff - 1)
+      _buff[_len++] = '0' + _chNum / 10;
+    if(_len < _lenBuff - 1)
+      _buff[_len++] = '0' + _chNum % 10;
+    _buff[_len] = '\0';
+  }
+  else
+    strlcpy_P(_buff, (char *)pgm_read_word(&(virtNames[_srcIdx - IDX_VRT1])), _lenBuff);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void drawLoadingAnimation(uint8_t xpos, uint8_t ypos, uint8_t _size)
 {
   //active cells on a 4x4 grid. Each new line here is a frame
@@ -18,26 +18,39 @@
 #include <SPI.h>
 #include "LoRa.h"
 #include "crc8.h"
+#include "fec.h"
+#include "servos.h"
+#include "sbus.h"
+#include "stats.h"
+#include "sensors.h"
+#include "eequeue.h"
 #include <EEPROM.h>
 
-#include <Servo.h>
-
 //Pins
-#define PIN_CH1    2
-#define PIN_CH2    5
-#define PIN_CH3    3
-#define PIN_CH4    4
-#define PIN_CH5    A5
-#define PIN_CH6    A4
-#define PIN_CH7    A3
-#define PIN_CH8    A2
-#define PIN_CH9    A1
-
 #define PIN_EXTV_SENSE A0
 
 #define PIN_LED_GREEN  7
 #define PIN_LED_ORANGE 6
 
+/* DIO0 of the lora module. When wired to pin 2 or 3, TX done and RX done come in as an interrupt 
+instead of polling the module over SPI. This saves most of the SPI traffic, but the hop after a 
+reply still waits for the loop to come round, as it does when polling. Both pins are servo outputs 
+in myOutputPins, so the pin used has to be removed from there. Set to -1 when not wired. */
+#define PIN_LORA_DIO0  -1
+
+/* Uncomment to print the lora SPI transactions per second and any register shadow mismatches 
+to the serial port once a second. For debugging the radio driver only. Can't be used along with 
+an SBUS output as both need the serial port. */
+//#define DEBUG_LORA_SPI
+
+/* Uncomment to print the average time taken to smooth one output channel to the serial port once a 
+second. Needs ENABLE_OUTPUT_SMOOTHING. Can't be used along with an SBUS output. */
+//#define DEBUG_OUTPUT_SMOOTHING
+
+/* Uncomment to print the longest time taken by one pass of the main loop to the serial port once a 
+second. Can't be used along with an SBUS output. */
+//#define DEBUG_LOOP_TIME
+
 //--------------- Freq allocation --------------------
 
 /* LPD433 Band ITU region 1
@@ -46,18 +59,121 @@ total of 69 freq channels. Channel_1 is 433.075 Mhz and Channel_69 is 434.775Mhz
 All our communications have to occur on any of these 69 channels. 
 */
 
-/* Frequency list to pick from. The separation here is 300kHz (250kHz total lora bw + 
-50kHz guard band.*/
-uint32_t freqList[] = {433175000, 433475000, 433775000, 434075000, 434375000, 434675000};
-//bind is also transmitted on freqList[0]
+/* Channel plan. The channels are spread evenly across the band, keeping the whole lora bandwidth 
+of each channel within the band edges. With the values here we get 6 channels. 
+Bind is always done on channel 0. */
+#define FREQ_BAND_START    433050000UL //lower band edge in Hz
+#define FREQ_BAND_END      434790000UL //upper band edge in Hz
+#define FREQ_CH_BANDWIDTH  250000UL    //lora signal bandwidth
+#define FREQ_CH_SPACING    290000UL    //min separation between channel centres. Bandwidth + guard band
+#define NUM_FREQ_CHANNELS  ((FREQ_BAND_END - FREQ_BAND_START - FREQ_CH_BANDWIDTH) / FREQ_CH_SPACING + 1)
+
+/* Hop sequence. This is generated from a seed (see generateHopSequence()) so both the transmitter 
+and the receiver produce the same sequence and only the seed has to be exchanged on bind. The seed is 
+received from the transmitter on bind and is stored to eeprom so we don't have to rebind each time 
+we power on.  */
+#define HOP_SEQUENCE_LENGTH  48 
+
+uint8_t hopSequence[HOP_SEQUENCE_LENGTH]; //channel numbers in the channel plan
+uint8_t channelFrf[NUM_FREQ_CHANNELS][3]; //precomputed lora frequency registers of each channel
+uint16_t hopSeed = 0;
+uint8_t idxHopSequence = 0; 
+
+//--------------- Slot timing ------------------------
+
+/* The transmitter sends its packets at the start of fixed length slots and moves to the next hop 
+channel at the end of every slot. Once we have received a packet, we know when the next one is due 
+so we hop on schedule even if a packet is missed, rather than waiting on a channel that the 
+transmitter has already left. Our replies take up the slot following the request. */
+
+/* Rate profiles. The transmitter normally uses the fast profile, and may ask us to change to the 
+long range profile (SF9, with longer slots) when the link gets weak, and back again. Both ends change 
+over at the end of the slot carrying our ack. While not in sync we try both profiles in turn, as the 
+transmitter may have changed over without us. */
+enum {
+  RATE_PROFILE_FAST,
+  RATE_PROFILE_LONG_RANGE
+};
+
+#define SF_FAST        7
+#define SF_LONG_RANGE  9
+
+#define SLOT_PERIOD_FAST_US        30000UL //in microseconds. Should match the transmitter
+#define SLOT_PERIOD_LONG_RANGE_US  96000UL //in microseconds. Should match the transmitter
+
+uint8_t rateProfile = RATE_PROFILE_FAST;
+uint8_t spreadingFactor = SF_FAST;
+uint32_t slotPeriodUs = SLOT_PERIOD_FAST_US;
+uint8_t pendingRateProfile = 0xFF; //asked for by the transmitter, changed to once our ack is sent
+bool isLongRangeSeen = false; //the transmitter has used the long range profile since we started
+
+/* While not in sync, how many slots of a profile to try it for before trying the other one. The 
+transmitter only uses the long range profile if allowed to, so until we have seen it there, we 
+mostly look on the fast profile and give the long range one a short look now and then. */
+#define ACQUIRE_SLOTS_PER_PROFILE  3
+#define ACQUIRE_SLOTS_FAST_UNSEEN  100
+
+/* Lora airtime in microseconds at BW 250kHz, CR 4/5 with an explicit header, SF7 to SF11. See the 
+transmitter for the details. Packets of different lengths end at different times, so we time the 
+slots from where a packet started. */
+#define LORA_PAYLOAD_SYMBOLS(len, crc, sf)  (8 + ((8 * (len) + 16 * (crc) + 27) / (4 * (sf))) * 5)
+#define LORA_AIRTIME_US(len, crc, sf)  ((49UL + 4UL * LORA_PAYLOAD_SYMBOLS(len, crc, sf)) << (sf))
+
+#define MAX_RC_PACKET_SIZE  (19 + FEC_PARITY_LEN) //largest packet from the transmitter
+
+#define SLOT_GUARD_US    2000UL  //How long to keep listening past when a packet was due before hopping
+#define MAX_MISSED_SLOTS 10      //Consecutive slots without a packet after which we consider sync lost
+
+/* Failsafe is applied after this many slots in a row without an rc packet, so the time to failsafe 
+follows the packet rate. 8 slots of 30ms is 240ms, or 768ms with the long range profile. */
+#define FAILSAFE_MISSED_SLOTS  8
+
+/* In ms. While not in sync, we stay on a channel long enough for the transmitter to come back to it.
+As each block of the hop sequence uses every channel once, a channel comes round again within 
+2 * NUM_FREQ_CHANNELS slots. If no packet received within this time, we hop. */
+#define MAX_LISTEN_TIME_ON_HOP_CHANNEL (2 * NUM_FREQ_CHANNELS * slotPeriodUs / 1000)
+
+/* Fast sync. Rather than waiting on one channel for the transmitter to come round to it, we sweep 
+the channels with channel activity detection (CAD) probes of about a millisecond each. A sweep 
+takes about as long as the preamble of a packet, so we can catch the transmitter while its 
+preamble is still going and stay on that channel to receive the packet. The packet then gives us 
+the hop position and slot timing as usual. Comment out to dwell on each channel instead. */
+#define ENABLE_CAD_SYNC
+
+#define CAD_LISTEN_TIME  (slotPeriodUs / 1000) //in ms. How long to listen after activity is detected
+
+/* In us. A probe can also catch the payload of a packet, whose preamble has gone, and the
+transmitter leaves the channel after it. By the airtime of an empty packet the radio has found the
+preamble of one it caught in time, so if it hasn't, we move on rather than listen out the slot. */
+#define CAD_SYNC_TIME_US  LORA_AIRTIME_US(0, 0, spreadingFactor)
+
+enum {
+  CAD_START,
+  CAD_BUSY,
+  CAD_LISTEN
+};
+uint8_t cadState = CAD_START;
 
-uint8_t fhss_schema[3] = {0, 1, 2}; /* Index in freqList. Frequencies to use for hopping. 
-These are changed when we receive a bind command from the transmitter. This schema also gets stored 
-to eeprom so we don't have to rebind each time we power on. */
+enum {
+  SYNC_ACQUIRING, 
+  SYNC_LOCKED
+};
+uint8_t syncState = SYNC_ACQUIRING;
 
-uint8_t idx_fhss_schema = 0; 
+uint32_t slotDeadlineMicros = 0; //if no packet by this time, we hop to the next slot's channel
+uint8_t missedSlots = 0;
 
-#define MAX_LISTEN_TIME_ON_HOP_CHANNEL 112 //in ms. If no packet received within this time, we hop 
+/* Replies to the transmitter are sent without blocking. The packet is left in the packet buffer, 
+sent once the transmitter has had time to switch over to receive, then we hop when it is done. We 
+don't listen or hop on schedule while a reply is going out. */
+enum {
+  REPLY_NONE,
+  REPLY_WAITING, //waiting for the transmitter to switch over
+  REPLY_SENDING
+};
+uint8_t replyState = REPLY_NONE;
+uint8_t replyLen = 0;
+uint32_t replyStartMicros = 0;
 
 //--------------------------------------------------
 
@@ -66,6 +182,64 @@ uint8_t receiverID = 0;    //randomly generated on bind
 
 uint8_t idxRFPowerLevel = 0;
 
+//--------------- Channels -------------------------
+
+/* Number of logical rc channels carried over the air. Should match NUM_PRP_CHANNLES in the master
+mcu and NUM_RC_CHANNELS in the slave mcu. Max 17.
+The first NUM_PRIMARY_CHANNELS are sent in every rc frame. The remaining (secondary) channels are 
+sent in groups of 2, one group per frame, with the transmitter picking the group to send based on 
+how much the values have changed. */
+#define NUM_RC_CHANNELS        16 
+#define NUM_PRIMARY_CHANNELS   9   //## Leave this. Fixed by the air protocol
+#define NUM_SECONDARY_GROUPS   ((NUM_RC_CHANNELS - NUM_PRIMARY_CHANNELS + 1) / 2)
+
+/* Output pins. Each pin is driven by the logical channel of the same index, ie the first pin is
+Ch1, the second pin Ch2, etc. Add or remove pins here to change the number of outputs. Max 15.
+The number of entries should match NUM_RX_OUTPUT_CHANNELS in the transmitter. */
+const int myOutputPins[] = {2, 5, 3, 4, A5, A4, A3, A2, A1};
+
+#define NUM_OUTPUT_CHANNELS  (sizeof(myOutputPins)/sizeof(myOutputPins[0]))
+
+/* Servo frame period in microseconds. 20000 (50Hz) suits analog servos. Digital servos can take 
+shorter frames, down to 3000 (333Hz). All servo pulses start together at the start of the frame. */
+#define SERVO_FRAME_PERIOD_US  20000
+
+#if SERVO_FRAME_PERIOD_US < 2500 || SERVO_FRAME_PERIOD_US > 30000
+  #error SERVO_FRAME_PERIOD_US out of range
+#endif
+
+/* Time from the arrival of an rc packet to the start of the servo frame carrying its values. Should 
+be long enough to cover decoding the packet. Frames in between packets follow SERVO_FRAME_PERIOD_US. */
+#define OUTPUT_LATCH_DELAY_US  2000
+
+/* Output smoothing. Rather than jumping once per packet, servo outputs move from where they are to 
+the new packet's value over the time between packets, a step every servo frame. Worth having with 
+short servo frames. Adds up to a packet period of delay. Moves larger than SMOOTH_MAX_STEP are made 
+at once, so switches still snap. Outputs whose bit is cleared in SMOOTH_OUTPUT_MASK are never 
+smoothed, bit0 being the first pin in myOutputPins. Uncomment to enable. */
+//#define ENABLE_OUTPUT_SMOOTHING
+#define SMOOTH_MAX_STEP     400     //in microseconds of servo pulse
+#define SMOOTH_OUTPUT_MASK  0xFFFF
+
+/* Sensors sent to the transmitter as telemetry. Max 6. The first one should be the receiver 
+battery voltage, as it is also sent in every telemetry reply and drives the voltage alarm.
+Analog sensors are read against the internal 1.1V reference. fullScale is the value with 1.1V at 
+the pin, in the units of the sensor type (see sensors.h), and offset the value with 0V at the pin. 
+A6 and A7 are analog only pins on the TQFP package and free for sensors. A4 and A5 are servo 
+outputs, so I2C sensors need those freed from myOutputPins first, and are read through a function 
+returning the value or SENSOR_NO_DATA. Such a function is called from the main loop so should not 
+wait on the bus. */
+const sensor_t sensors[] = {
+  //type           pin             fullScale  offset  read
+  {SENSOR_VOLTS,   PIN_EXTV_SENSE, 1666,      0,      NULL}, //voltage divider. Adjust fullScale to calibrate
+  //{SENSOR_CURRENT, A6,           3000,      0,      NULL}, //e.g. current sense amplifier, 30A at 1.1V
+  //{SENSOR_TEMP,    A7,           1100,      0,      NULL}, //e.g. LM35, 10mV per degC
+};
+
+const uint8_t numSensors = sizeof(sensors)/sizeof(sensors[0]);
+
+//--------------------------------------------------
+
 #define MAX_PACKET_SIZE  19
 uint8_t packet[MAX_PACKET_SIZE];
 
@@ -77,39 +251,115 @@ enum{
   PAC_ACK_OUTPUT_CH_CONFIG   = 0x4,
   PAC_RC_DATA                = 0x5,
   PAC_TELEMETRY              = 0x6,
+  PAC_LINK_STATS             = 0x7,
+  PAC_SENSORS                = 0x8,
+  PAC_SET_RATE_PROFILE       = 0x9,
+  PAC_ACK_RATE_PROFILE       = 0xA,
 };
 
 
 bool isRequestingTelemetry = false;
-uint16_t externalVolts = 0; //in millivolts
 uint16_t telem_volts = 0x0FFF;     // in 10mV, sent by receiver with 12bits.  0x0FFF "No data"
 
+#define STATS_REPLY_INTERVAL   4 //every 4th telemetry reply is a page of link statistics
+#define SENSORS_REPLY_INTERVAL 2 //others at multiples of 2 are a page of sensor values, if any
+
 bool failsafeEverBeenReceived = false;
 
 uint32_t rcPacketCount = 0;
 uint32_t lastRCPacketMillis = 0;
+uint32_t lastRCPacketMicros = 0; //arrival time of the last rc packet
+
+//--------------- Link quality ---------------------
+
+/* Link quality is the percentage of the last LQ_WINDOW_SLOTS slots in which we received a valid 
+packet. Slots taken up by our own replies are not counted as the transmitter doesn't send in these.*/
+#define LQ_WINDOW_SLOTS  100
+
+uint8_t lqHistory[(LQ_WINDOW_SLOTS + 7) / 8]; //1 bit per slot, set if a valid packet was received
+uint8_t idxLqHistory = 0;
+uint8_t lqCount = 0; //number of set bits in lqHistory
+
+uint16_t fecCorrectedCount = 0;     //rc frames repaired by forward error correction
+uint16_t fecUncorrectableCount = 0; //rc frames with more errors than fec could repair
+
+uint16_t recoveredFrameCount = 0; //lost rc frames rebuilt from the redundancy record in the next frame
+bool lastFrameToggle = false;     //frame toggle of the last non failsafe rc frame received
+bool isLastFrameToggleValid = false;
+
+//Uplink signal, summed over the packets received since the last telemetry was sent
+int32_t rssiSum = 0;
+int16_t snrSum = 0;
+uint8_t signalSampleCount = 0;
+
+int chVals[NUM_RC_CHANNELS];
+int chFailsafes[NUM_RC_CHANNELS];
+
+//Failsafe values that aren't positions. These are sent as 1023 and 1022
+#define FAILSAFE_HOLD       523 //keep the last value
+#define FAILSAFE_NO_PULSES  522 //stop the output's pulses. Servo and PWM outputs only, others hold
 
-int ch1to9Vals[9];
-int ch1to9Failsafes[9];
+uint8_t rcMissedSlots = 0;     //slots in a row without an rc packet
+bool isFailsafeActive = false;
+bool isNewFailsafeVals = false; //failsafe has just been applied and the outputs not yet timed
+bool isRebuiltOutput = false;   //the outputs being written are a frame rebuilt from a redundancy record
+bool isRcValsHeld = false;      //chVals wait for the rebuilt frame's servo frame to start
+uint8_t failsafeDelay = 0;     //last packet to failsafe on the outputs, the last time it happened. In 10ms
+uint32_t failsafeStartMillis = 0;
+uint32_t failsafeTotalMillis = 0;
 
-uint8_t outputChConfig[9]; //0 digital, 1 Servo, 2 PWM
+uint8_t chUpdateCount[NUM_RC_CHANNELS]; //number of times each channel was updated in this second
+uint8_t chUpdateRate[NUM_RC_CHANNELS];  //updates per second of each channel
 
-uint8_t maxOutputChConfig[9];
+/* Output modes. PPM puts the first PPM_NUM_CHANNELS rc channels on the output's pin. SBUS puts all 
+the rc channels on the serial TX pin (pin 1), leaving the output's own pin unused. Only the first 
+output set to PPM or SBUS is used, any others are left low. */
+uint8_t outputChConfig[NUM_OUTPUT_CHANNELS]; //0 digital, 1 Servo, 2 PWM, 3 PPM, 4 SBUS
 
-//Declare an array of servo objects
-Servo myServo[9];
+uint8_t outputChCapability[NUM_OUTPUT_CHANNELS]; //bit per mode the output supports, bit0 is Servo. Digital always supported
 
-//Declare an output pins array
-int myOutputPins[9] = {PIN_CH1, PIN_CH2, PIN_CH3, PIN_CH4, PIN_CH5, PIN_CH6, PIN_CH7, PIN_CH8, PIN_CH9};
+uint8_t servoIdx[NUM_OUTPUT_CHANNELS]; //index of each servo output in the pulse engine, 0xFF if it has none
+
+#define SBUS_RESEND_INTERVAL  20 //in ms. Keep sending frames, flagged as lost, when no packets come in
+bool isSbusEnabled = false;
+bool isPpmEnabled = false;
+uint32_t lastSbusFrameMillis = 0;
+uint32_t lastSbusFrameMicros = 0;
+bool isSbusFramePending = false; //a frame is waiting to be spaced from the one before it
+#define SBUS_MIN_SPACING_US  4000 //a frame takes 3ms to send, plus an idle gap decoders sync on
+
+bool isChValsChanged = true; //outputs only need updating when this is set
+
+//Output timing. Sums are over the rc packets since the last telemetry was sent
+bool isNewRcVals = false;        //chVals were last changed by an rc packet rather than failsafe
+uint32_t rcValsMicros = 0;       //arrival time of the rc packet that last changed chVals
+uint32_t latchPacketMicros = 0;  //arrival time of the packet waiting on the servo frame
+uint32_t servoFrameDueMicros = 0; //when the servo frame carrying the last packet's values should start
+bool isServoFrameDue = false;     //that start has not been set yet, as pulses were going out
+bool isOutputLatchPending = false;
+bool isLatchFailsafe = false;    //the values waiting on the servo frame are failsafe values
+uint32_t outputDelaySum = 0;     //packet arrival to outputs updated
+uint8_t outputDelayCount = 0;
+uint32_t processTimeSum = 0;     //packet arrival to channels decoded
+uint8_t processTimeCount = 0;
+
+#if defined (ENABLE_OUTPUT_SMOOTHING)
+//Servo outputs, in microseconds. 0 means no pulse
+int smoothFrom[NUM_OUTPUT_CHANNELS]; //where the output was when the last packet came in
+int smoothTo[NUM_OUTPUT_CHANNELS];   //where the last packet wants it
+int smoothOut[NUM_OUTPUT_CHANNELS];  //where it is now
+uint32_t smoothStartMicros = 0;          //arrival time of the last packet
+uint32_t smoothPeriodUs = SLOT_PERIOD_FAST_US; //time between the last two packets. The move takes this long
+#endif
 
 //-------------- EEprom stuff --------------------
 
-#define EE_INITFLAG         0xBB 
+#define EE_INITFLAG         0xBC 
 
 #define EE_ADR_INIT_FLAG    0
 #define EE_ADR_TX_ID        1
 #define EE_ADR_RX_ID        2
-#define EE_ADR_FHSS_SCHEMA  3
+#define EE_ADR_HOP_SEED     3
 #define EE_ADR_RX_CH_CONFIG 20
 
 
@@ -117,25 +367,49 @@ int myOutputPins[9] = {PIN_CH1, PIN_CH2, PIN_CH3, PIN_CH4, PIN_CH5, PIN_CH6, PIN
 
 void bind();
 void hop();
+bool cadSweep();
+void setRateProfile(uint8_t profile);
+uint32_t getChannelFreq(uint8_t channel);
+void generateHopSequence(uint16_t seed);
+void syncHopPosition(uint8_t *packetBuff, uint8_t packetSize);
 void sendTelemetry();
+void sendLinkStats();
+void sendSensors();
+void queueReply(uint8_t packetLen, uint16_t delayUs);
+void serviceReply();
+void updateLinkQuality(bool gotPacket);
+void rebuildPreviousFrame(uint8_t *dataBuff, int *curVals);
 void writeOutputs();
-void getExternalVoltage();
+void outputRebuiltFrame();
+void startServoFrameWhenDue();
+void recordOutputTime(uint32_t outputMicros);
+void setSmoothTarget(uint8_t idx, int val);
+void updateSmoothOutputs();
+uint16_t smoothFraction(uint32_t elapsedUs, uint32_t periodUs);
+int smoothStep(int from, int to, uint16_t frac);
+void calcChannelUpdateRates();
+uint16_t readBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits);
 uint8_t buildPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t *dataBuff, uint8_t dataLen);
 bool checkPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t *packetBuff, uint8_t packetSize);
-uint8_t getMaxOutputChConfig(int pin);
+uint8_t getOutputChCapability(int pin);
+void sendSbusFrame(uint8_t flags);
 
 //==================================================================================================
 
 void setup()
 { 
   // initialise values
-  for(uint8_t i = 0; i < 9; ++i)
+  for(uint8_t i = 0; i < NUM_RC_CHANNELS; ++i)
+  {
+    chVals[i] = 0;
+    chFailsafes[i] = 0;
+    chUpdateCount[i] = 0;
+    chUpdateRate[i] = 0;
+  }
+  for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; ++i)
   {
-    ch1to9Vals[i] = 0;
-    ch1to9Failsafes[i] = 0;
-    
     outputChConfig[i] = 1;
-    maxOutputChConfig[i] = getMaxOutputChConfig(myOutputPins[i]);
+    outputChCapability[i] = getOutputChCapability(myOutputPins[i]);
   }
 
   // EEPROM init
@@ -143,7 +417,7 @@ void setup()
   {
     EEPROM.write(EE_ADR_TX_ID, transmitterID);
     EEPROM.write(EE_ADR_RX_ID, receiverID);
-    EEPROM.put(EE_ADR_FHSS_SCHEMA, fhss_schema);
+    EEPROM.put(EE_ADR_HOP_SEED, hopSeed);
     EEPROM.write(EE_ADR_INIT_FLAG, EE_INITFLAG);
     EEPROM.put(EE_ADR_RX_CH_CONFIG, outputChConfig);
   }
@@ -151,8 +425,15 @@ void setup()
   // Read from EEPROM
   transmitterID = EEPROM.read(EE_ADR_TX_ID);
   receiverID = EEPROM.read(EE_ADR_RX_ID);
-  EEPROM.get(EE_ADR_FHSS_SCHEMA, fhss_schema);
+  EEPROM.get(EE_ADR_HOP_SEED, hopSeed);
   EEPROM.get(EE_ADR_RX_CH_CONFIG, outputChConfig);
+  for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; ++i)
+  {
+    if(outputChConfig[i] > 0 && !((outputChCapability[i] >> (outputChConfig[i] - 1)) & 0x01))
+      outputChConfig[i] = 1; //not supported on this pin, fall back to servo
+  }
+  
+  generateHopSequence(hopSeed);
   
   // setup pins
   pinMode(PIN_LED_GREEN, OUTPUT);
@@ -161,15 +442,20 @@ void setup()
 
   //use analog reference internal 1.1V
   analogReference(INTERNAL);
+  sensorsBegin();
   
   //setup lora module
   delay(100);
-  LoRa.setPins(10, 8);
-  if (LoRa.begin(freqList[0]))
+  for(uint8_t i = 0; i < NUM_FREQ_CHANNELS; i++)
+    LoRa.getFrf(getChannelFreq(i), channelFrf[i]);
+  LoRa.setPins(10, 8, PIN_LORA_DIO0);
+  if (LoRa.begin(getChannelFreq(0)))
   {
-    LoRa.setSpreadingFactor(7);
+    LoRa.setSpreadingFactor(SF_FAST);
     LoRa.setCodingRate4(5);
     LoRa.setSignalBandwidth(250E3);
+    LoRa.disableCrc(); //packets carry their own crc8
+    LoRa.enableDio0Interrupt(); //does nothing if not wired
   }
   else //failed to init. Perhaps module isn't plugged in
   {
@@ -184,6 +470,10 @@ void setup()
     }
   }
   
+#if defined (DEBUG_LORA_SPI) || defined (DEBUG_OUTPUT_SMOOTHING) || defined (DEBUG_LOOP_TIME)
+  Serial.begin(115200);
+#endif
+  
   //bind
   bind();
   
@@ -192,51 +482,162 @@ void setup()
 //====================================== MAIN LOOP =================================================
 void loop()
 {
-  //---------- READ INCOMING PACKET (NONBIND PACKETS) ---------- 
+#if defined (DEBUG_LORA_SPI)
+  static uint32_t lastDebugPrint = 0;
+  if(millis() - lastDebugPrint >= 1000)
+  {
+    lastDebugPrint = millis();
+    uint16_t _spiCount = LoRa.spiTransactionCount();
+    uint8_t _mismatches = LoRa.verifyShadow();
+    LoRa.spiTransactionCount(); //leave out the reads done by the check
+    Serial.print(F("SPI/s: "));
+    Serial.print(_spiCount);
+    Serial.print(F("  Shadow mismatches: "));
+    Serial.println(_mismatches);
+  }
+#endif
+
+#if defined (DEBUG_LOOP_TIME)
+  static uint32_t lastLoopMicros = micros();
+  static uint32_t maxLoopMicros = 0;
+  static uint32_t lastLoopTimePrint = 0;
+  uint32_t _loopMicros = micros() - lastLoopMicros;
+  lastLoopMicros = micros();
+  if(_loopMicros > maxLoopMicros)
+    maxLoopMicros = _loopMicros;
+  if(millis() - lastLoopTimePrint >= 1000)
+  {
+    lastLoopTimePrint = millis();
+    Serial.print(F("Max loop us: "));
+    Serial.println(maxLoopMicros);
+    maxLoopMicros = 0;
+    lastLoopMicros = micros(); //leave out the time spent printing
+  }
+#endif
+  
+  //---------- SEND QUEUED REPLY ----------
+  
+  serviceReply();
   
+  //---------- HOP ON SCHEDULE ---------- 
+  
+#if !defined (ENABLE_CAD_SYNC)
   static uint32_t timeOfLastPacket = millis();
-  if(millis() - timeOfLastPacket > MAX_LISTEN_TIME_ON_HOP_CHANNEL)
+#endif
+  static uint32_t profileTryStartMillis = millis();
+  bool isListening = true;
+  if(replyState != REPLY_NONE) //the radio is busy with the reply
+    isListening = false;
+  else if(syncState == SYNC_LOCKED)
   {
-    timeOfLastPacket = millis();
-    hop();
+    if((int32_t)(micros() - slotDeadlineMicros) > 0) //missed the packet in this slot
+    {
+      hop();
+      slotDeadlineMicros += slotPeriodUs;
+      ++missedSlots;
+      statInc(STAT_MISSED_SLOTS);
+      updateLinkQuality(false);
+      if(missedSlots >= MAX_MISSED_SLOTS) //lost sync
+      {
+        syncState = SYNC_ACQUIRING;
+        statInc(STAT_SYNC_LOSSES);
+        profileTryStartMillis = millis();
+#if defined (ENABLE_CAD_SYNC)
+        cadState = CAD_START;
+#else
+        timeOfLastPacket = millis();
+#endif
+      }
+    }
   }
+  else 
+  {
+    //try the other profile every so often
+    uint8_t _trySlots = ACQUIRE_SLOTS_PER_PROFILE;
+    if(rateProfile == RATE_PROFILE_FAST && !isLongRangeSeen)
+      _trySlots = ACQUIRE_SLOTS_FAST_UNSEEN;
+    bool _isProfileTried = (millis() - profileTryStartMillis > _trySlots * slotPeriodUs / 1000);
+#if defined (ENABLE_CAD_SYNC)
+    if(_isProfileTried && cadState != CAD_LISTEN) //not while waiting on a packet
+    {
+      profileTryStartMillis = millis();
+      setRateProfile(rateProfile == RATE_PROFILE_FAST ? RATE_PROFILE_LONG_RANGE : RATE_PROFILE_FAST);
+    }
+    isListening = cadSweep();
+#else
+    if(millis() - timeOfLastPacket > MAX_LISTEN_TIME_ON_HOP_CHANNEL)
+    {
+      timeOfLastPacket = millis();
+      hop();
+      if(_isProfileTried)
+      {
+        profileTryStartMillis = millis();
+        setRateProfile(rateProfile == RATE_PROFILE_FAST ? RATE_PROFILE_LONG_RANGE : RATE_PROFILE_FAST);
+      }
+      statInc(STAT_HOP_TIMEOUTS);
+    }
+#endif
+    //slots keep going by even if we don't know where they are
+    if((int32_t)(micros() - slotDeadlineMicros) > 0)
+    {
+      slotDeadlineMicros = micros() + slotPeriodUs;
+      updateLinkQuality(false);
+    }
+  }
+  
+  //---------- READ INCOMING PACKET (NONBIND PACKETS) ---------- 
   
   bool hasValidPacket = false;
   uint8_t packetType = 0xFF;
+  uint8_t dataLen = 0;
   uint8_t dataBuff[32];
   memset(dataBuff, 0, sizeof(dataBuff));
   
-  int packetSize = LoRa.parsePacket();
+  int packetSize = isListening ? LoRa.parsePacket() : 0;
   if (packetSize > 0) //received a packet
   {
+    uint8_t _airLen = packetSize; //as sent, before any fec parity is taken off
+#if !defined (ENABLE_CAD_SYNC)
     timeOfLastPacket = millis();
+#endif
     
     //read into temporary buffer
     uint8_t msgBuff[30];
     memset(msgBuff, 0, sizeof(msgBuff));
-    uint8_t cntr = 0;
-    while (LoRa.available() > 0) 
+    LoRa.readPacket(msgBuff, sizeof(msgBuff));
+    
+    /* Rc frames with forward error correction end with FEC_PARITY_LEN parity bytes. Decode a copy 
+    so that a plain packet of the same size is left as it is. */
+    bool _isFecSized = (packetSize == 4 + 12 + FEC_PARITY_LEN || packetSize == 4 + 15 + FEC_PARITY_LEN);
+    uint8_t _fecRslt = FEC_UNCORRECTABLE;
+    if(_isFecSized)
     {
-      if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
+      uint8_t _fecBuff[4 + 15 + FEC_PARITY_LEN];
+      memcpy(_fecBuff, msgBuff, packetSize);
+      _fecRslt = fecDecode(_fecBuff, packetSize);
+      if(_fecRslt != FEC_UNCORRECTABLE && (_fecBuff[2] >> 4) == PAC_RC_DATA)
       {
-        msgBuff[cntr] = LoRa.read();
-        cntr++;
+        packetSize -= FEC_PARITY_LEN;
+        memcpy(msgBuff, _fecBuff, packetSize);
       }
-      else // discard any extra data
-        LoRa.read(); 
+      else
+        _fecRslt = FEC_UNCORRECTABLE;
     }
     
-    //hop frequency regardless
-    hop();
+    //find out where the transmitter is in the hop sequence
+    syncHopPosition(msgBuff, packetSize);
     
     //check packet 
     if(checkPacket(transmitterID, receiverID, PAC_RC_DATA, msgBuff, packetSize))
     {
-      if((msgBuff[2] & 0x0F) == 12)
+      //12 bytes if only primary channels, 15 bytes if a secondary group is appended
+      uint8_t _dataLen = msgBuff[2] & 0x0F;
+      if(_dataLen == 12 || _dataLen == 15)
       {
         hasValidPacket = true;
         packetType = PAC_RC_DATA;
-        memcpy(dataBuff, msgBuff + 3, 12);
+        memcpy(dataBuff, msgBuff + 3, _dataLen);
+        dataLen = _dataLen;
       }
     }
     else if(checkPacket(transmitterID, receiverID, PAC_READ_OUTPUT_CH_CONFIG, msgBuff, packetSize))
@@ -246,13 +647,67 @@ void loop()
     }
     else if(checkPacket(transmitterID, receiverID, PAC_SET_OUTPUT_CH_CONFIG, msgBuff, packetSize))
     {
-      if((msgBuff[2] & 0x0F) == 9)
+      if((msgBuff[2] & 0x0F) == NUM_OUTPUT_CHANNELS)
       {
         hasValidPacket = true;
         packetType = PAC_SET_OUTPUT_CH_CONFIG;
-        memcpy(dataBuff, msgBuff + 3, 9);
+        memcpy(dataBuff, msgBuff + 3, NUM_OUTPUT_CHANNELS);
+      }
+    }
+    else if(checkPacket(transmitterID, receiverID, PAC_SET_RATE_PROFILE, msgBuff, packetSize))
+    {
+      if((msgBuff[2] & 0x0F) == 1 && msgBuff[3] <= RATE_PROFILE_LONG_RANGE)
+      {
+        hasValidPacket = true;
+        packetType = PAC_SET_RATE_PROFILE;
+        dataBuff[0] = msgBuff[3];
+      }
+    }
+    
+    if(hasValidPacket)
+    {
+      //sample the signal before hopping
+      if(signalSampleCount < 0xFF)
+      {
+        rssiSum += LoRa.packetRssi();
+        snrSum += (int8_t) LoRa.packetSnr();
+        ++signalSampleCount;
       }
     }
+    else if(msgBuff[0] == transmitterID && msgBuff[1] == receiverID)
+      statInc(STAT_REJECTED); //addressed to us but corrupted
+    else
+      statInc(STAT_FOREIGN);
+    
+    if(_isFecSized && packetType == PAC_RC_DATA && _fecRslt == FEC_CORRECTED && fecCorrectedCount < 0xFFFF)
+      ++fecCorrectedCount;
+    else if(_isFecSized && !hasValidPacket && msgBuff[0] == transmitterID && msgBuff[1] == receiverID 
+            && fecUncorrectableCount < 0xFFFF)
+      ++fecUncorrectableCount;
+    
+    //hop frequency regardless. The packet for this slot has come and gone
+    hop();
+    cadState = CAD_START;
+    
+    //Track the transmitter's slot timing. A valid packet tells us exactly where the slot is. The 
+    //next packet is due a slot after this one started, and may be a longer one
+    if(hasValidPacket)
+    {
+      syncState = SYNC_LOCKED;
+      missedSlots = 0;
+      if(rateProfile == RATE_PROFILE_LONG_RANGE)
+        isLongRangeSeen = true;
+      slotDeadlineMicros = LoRa.packetMicros() - LORA_AIRTIME_US(_airLen, 0, spreadingFactor) + slotPeriodUs 
+                           + LORA_AIRTIME_US(MAX_RC_PACKET_SIZE, 0, spreadingFactor) + SLOT_GUARD_US;
+      updateLinkQuality(true);
+    }
+    else if(syncState == SYNC_LOCKED)
+    {
+      slotDeadlineMicros += slotPeriodUs;
+      ++missedSlots;
+      statInc(STAT_MISSED_SLOTS);
+      updateLinkQuality(false);
+    }
   }
   
   if(hasValidPacket)
@@ -265,32 +720,92 @@ void loop()
         {
           ++rcPacketCount;
           
+          uint32_t _prevRCPacketMillis = lastRCPacketMillis;
           lastRCPacketMillis = millis();
+          lastRCPacketMicros = LoRa.packetMicros();
+          if(rcPacketCount > 1)
+            statMax(STAT_LONGEST_GAP, lastRCPacketMillis - _prevRCPacketMillis);
+          rcMissedSlots = 0;
           digitalWrite(PIN_LED_ORANGE, HIGH);
     
-          //Decode
-          int ch1to9Tmp[9];
-          ch1to9Tmp[0] = ((uint16_t)dataBuff[0] << 2 & 0x3fc) |  ((uint16_t)dataBuff[1] >> 6 & 0x03); //ch1
-          ch1to9Tmp[1] = ((uint16_t)dataBuff[1] << 4 & 0x3f0) |  ((uint16_t)dataBuff[2] >> 4 & 0x0f); //ch2
-          ch1to9Tmp[2] = ((uint16_t)dataBuff[2] << 6 & 0x3c0) |  ((uint16_t)dataBuff[3] >> 2 & 0x3f); //ch3
-          ch1to9Tmp[3] = ((uint16_t)dataBuff[3] << 8 & 0x300) |  ((uint16_t)dataBuff[4]      & 0xff); //ch4
-          ch1to9Tmp[4] = ((uint16_t)dataBuff[5] << 2 & 0x3fc) |  ((uint16_t)dataBuff[6] >> 6 & 0x03); //ch5
-          ch1to9Tmp[5] = ((uint16_t)dataBuff[6] << 4 & 0x3f0) |  ((uint16_t)dataBuff[7] >> 4 & 0x0f); //ch6
-          ch1to9Tmp[6] = ((uint16_t)dataBuff[7] << 6 & 0x3c0) |  ((uint16_t)dataBuff[8] >> 2 & 0x3f); //ch7
-          ch1to9Tmp[7] = ((uint16_t)dataBuff[8] << 8 & 0x300) |  ((uint16_t)dataBuff[9]     & 0xff);  //ch8
-          ch1to9Tmp[8] = ((uint16_t)dataBuff[10] << 2 & 0x3fc) | ((uint16_t)dataBuff[11] >> 6 & 0x03); //ch9
+          //Decode primary channels. These are packed as 10 bits each, starting at bit 0
+          int chTmp[NUM_PRIMARY_CHANNELS + 2];
+          for(uint8_t i = 0; i < NUM_PRIMARY_CHANNELS; i++)
+            chTmp[i] = readBits(dataBuff, i * 10, 10);
           
-          //Check if failsafe data. If so, dont modify outputs
-          if((dataBuff[11] >> 4) & 0x01) //failsafe values
+          //Bytes 12 to 14 carry either a secondary group or a redundancy record
+          bool _hasRecord = (dataBuff[11] >> 5) & 0x01;
+          
+          //Decode secondary group if present. Starts at byte 12 with a 2 bit group index
+          uint8_t numDecoded = NUM_PRIMARY_CHANNELS;
+          uint8_t idxGroupStart = 0;
+          if(dataLen == 15 && !_hasRecord)
           {
+            idxGroupStart = NUM_PRIMARY_CHANNELS + 2 * readBits(dataBuff, 96, 2);
+            chTmp[NUM_PRIMARY_CHANNELS] = readBits(dataBuff, 98, 10);
+            chTmp[NUM_PRIMARY_CHANNELS + 1] = readBits(dataBuff, 108, 10);
+            numDecoded += 2;
+          }
+          
+          //Check if failsafe data. If so, dont modify outputs
+          bool isFailsafeData = (dataBuff[11] >> 4) & 0x01;
+          if(isFailsafeData)
             failsafeEverBeenReceived = true;
-            for(int i = 0; i < 9; i++)
-              ch1to9Failsafes[i] = ch1to9Tmp[i] - 500; //Center at 0 so range is -500 to 500
+          
+          /* If the frame toggle hasn't flipped since the last frame we got, we missed the frame in 
+          between. Rebuild it from the redundancy record and put it out as an update of its own, 
+          before this frame's values go into chVals. */
+          bool _isRebuilt = false;
+          if(dataLen == 15 && !isFailsafeData)
+          {
+            bool _toggle = readBits(dataBuff, 119, 1);
+            if(_hasRecord && isLastFrameToggleValid && _toggle == lastFrameToggle 
+               && lastRCPacketMillis - _prevRCPacketMillis < 3 * slotPeriodUs / 1000 + 10)
+            {
+              rebuildPreviousFrame(dataBuff, chTmp);
+              outputRebuiltFrame();
+              _isRebuilt = true;
+            }
+            lastFrameToggle = _toggle;
+            isLastFrameToggleValid = true;
+          }
+          
+          int *dest = isFailsafeData ? chFailsafes : chVals;
+          for(uint8_t i = 0; i < numDecoded; i++)
+          {
+            uint8_t idx = i;
+            if(i >= NUM_PRIMARY_CHANNELS)
+              idx = idxGroupStart + (i - NUM_PRIMARY_CHANNELS);
+            if(idx >= NUM_RC_CHANNELS) //prevents invalid references
+              continue;
+            dest[idx] = chTmp[i] - 500; //Center at 0 so range is -500 to 500
+            if(!isFailsafeData && chUpdateCount[idx] < 0xFF)
+              ++chUpdateCount[idx];
+          }
+          if(processTimeCount < 0xFF)
+          {
+            processTimeSum += micros() - LoRa.packetMicros();
+            ++processTimeCount;
           }
-          else //normal channel values
+          if(!isFailsafeData)
           {
-            for(int i = 0; i < 9; i++)
-              ch1to9Vals[i] = ch1to9Tmp[i] - 500; //Center at 0 so range is -500 to 500
+            isChValsChanged = true;
+            isNewRcVals = true;
+            rcValsMicros = LoRa.packetMicros();
+            if(isFailsafeActive)
+            {
+              uint32_t _duration = millis() - failsafeStartMillis;
+              failsafeTotalMillis += _duration;
+              statSet(STAT_FAILSAFE_LAST, _duration / 100);
+              statMax(STAT_FAILSAFE_LONGEST, _duration / 100);
+              statSet(STAT_FAILSAFE_TOTAL, failsafeTotalMillis / 1000);
+            }
+            isFailsafeActive = false;
+            isNewFailsafeVals = false;
+            if(isSbusEnabled && _isRebuilt) //spaced from the rebuilt frame's
+              isSbusFramePending = true;
+            else if(isSbusEnabled) //send right away rather than wait for the other outputs
+              sendSbusFrame(0);
           }
           
           //telemetry request
@@ -298,12 +813,6 @@ void loop()
           
           //rf power level
           idxRFPowerLevel = dataBuff[11] & 0x07;
-          
-          //if requested for receiver channel config
-          if((dataBuff[11] >> 5) & 0x01)
-          {
-            
-          }
         }
         break;
         
@@ -311,39 +820,37 @@ void loop()
         {
           //reply with the configuration
           
-          //encode as follows: high nibble --> max supported config, low nibble --> the present output config
-          uint8_t _configData[9];
-          for(uint8_t i = 0; i < 9; i++)
-            _configData[i] = (maxOutputChConfig[i] << 4) | (outputChConfig[i] & 0x0F);
+          //encode as follows: high nibble --> supported modes, low nibble --> the present output config
+          uint8_t _configData[NUM_OUTPUT_CHANNELS];
+          for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; i++)
+            _configData[i] = (outputChCapability[i] << 4) | (outputChConfig[i] & 0x0F);
           
           uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_READ_OUTPUT_CH_CONFIG, _configData, sizeof(_configData));
-          
-          delay(2);
-          if(LoRa.beginPacket())
-          {
-            LoRa.write(packet, _packetLen);
-            LoRa.endPacket(); //block until done transmitting
-            hop();
-          }
+          queueReply(_packetLen, 2000);
         }
         break;
       
       case PAC_SET_OUTPUT_CH_CONFIG:
         {
-          //save config to eeprom. Changes can only be applied on boot.
-          uint8_t _outputChannelConfig[9];
-          memcpy(_outputChannelConfig, dataBuff, 9);
-          EEPROM.put(EE_ADR_RX_CH_CONFIG, _outputChannelConfig);
-          
-          //reply 
-          delay(2);
-          uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_ACK_OUTPUT_CH_CONFIG, NULL, 0);
-          if(LoRa.beginPacket())
+          //save config to eeprom, in the background. Changes can only be applied on boot. Only 
+          //acked once queued, else the transmitter asks again
+          if(eeqPut(EE_ADR_RX_CH_CONFIG, dataBuff, NUM_OUTPUT_CHANNELS))
           {
-            LoRa.write(packet, _packetLen);
-            LoRa.endPacket(); //block until done transmitting
-            hop();
+            uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_ACK_OUTPUT_CH_CONFIG, NULL, 0);
+            queueReply(_packetLen, 2000);
           }
+          else
+            statInc(STAT_EEPROM_REFUSED);
+        }
+        break;
+        
+      case PAC_SET_RATE_PROFILE:
+        {
+          uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_ACK_RATE_PROFILE, dataBuff, 1);
+          queueReply(_packetLen, 2000);
+          pendingRateProfile = dataBuff[0]; //changed to once the ack is out, see serviceReply()
+          if(pendingRateProfile == RATE_PROFILE_LONG_RANGE)
+            isLongRangeSeen = true;
         }
         break;
     }
@@ -364,32 +871,72 @@ void loop()
     LoRa.sleep();
     LoRa.setTxPower(power_dBm[idxRFPowerLevel]);
     LoRa.idle();
+#if defined (ENABLE_CAD_SYNC)
+    if(cadState == CAD_BUSY) //the probe was cut short, its done flag will never come
+      cadState = CAD_START;
+#endif
   }
 
   //---------- FAILSAFE ----------
   
-  if(millis() - lastRCPacketMillis > 1000)
+  if(rcMissedSlots >= FAILSAFE_MISSED_SLOTS && !isFailsafeActive && rcPacketCount > 0)
   {
-    for(int i= 0; i < 9; i++)
+    isFailsafeActive = true;
+    failsafeStartMillis = millis();
+    statInc(STAT_FAILSAFES);
+    for(int i= 0; i < NUM_RC_CHANNELS; i++)
     {
-      if(ch1to9Failsafes[i] != 523) //ignore channels that have failsafe turned off.
-        ch1to9Vals[i] = ch1to9Failsafes[i]; 
+      if(chFailsafes[i] != FAILSAFE_HOLD && chFailsafes[i] != FAILSAFE_NO_PULSES)
+        chVals[i] = chFailsafes[i]; 
     }
+    isChValsChanged = true;
+    isNewFailsafeVals = true;
   }
+  
+  //---------- CHANNEL UPDATE RATES ----------
+  
+  calcChannelUpdateRates();
 
   //---------- SEND TO OUTPUT CHANNELS ---------- 
   
   writeOutputs();
+  
+#if defined (ENABLE_OUTPUT_SMOOTHING)
+  updateSmoothOutputs();
+#endif
+  
+  if(isSbusFramePending && micros() - lastSbusFrameMicros >= SBUS_MIN_SPACING_US)
+  {
+    isSbusFramePending = false;
+    sendSbusFrame(0);
+  }
+  else if(isSbusEnabled && millis() - lastSbusFrameMillis >= SBUS_RESEND_INTERVAL)
+  {
+    uint8_t _flags = SBUS_FLAG_FRAME_LOST;
+    if(isFailsafeActive)
+      _flags |= SBUS_FLAG_FAILSAFE;
+    sendSbusFrame(_flags);
+  }
 
-  //---------- EXTERNAL VOLAGE ------------------
+  //---------- SENSORS ------------------
   
-  getExternalVoltage();
+  sensorsUpdate();
   
   //---------- SEND TELEMETRY TO TRANSMITTER ---------- 
   
   if(isRequestingTelemetry)
   {
-    sendTelemetry();
+    //every few replies carry a page of link statistics instead
+    static uint8_t _replyCount = 0;
+    if(++_replyCount >= STATS_REPLY_INTERVAL)
+    {
+      _replyCount = 0;
+      sendLinkStats();
+    }
+    else if(numSensors > 0 && _replyCount % SENSORS_REPLY_INTERVAL == 0)
+      sendSensors();
+    else
+      sendTelemetry();
     isRequestingTelemetry = false;
   }
 
@@ -400,7 +947,7 @@ void loop()
 void bind()
 {
   LoRa.sleep();
-  LoRa.setFrequency(freqList[0]);
+  LoRa.setFrequency(getChannelFreq(0));
   LoRa.idle();
   
   const uint16_t BIND_LISTEN_TIMEOUT = 300;
@@ -419,22 +966,12 @@ void bind()
     if (packetSize > 0) //received a packet
     {
       //read into buffer
-      uint8_t cntr = 0;
-      while (LoRa.available() > 0) 
-      {
-        if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
-        {
-          msgBuff[cntr] = LoRa.read();
-          cntr++;
-        }
-        else // discard any extra data
-          LoRa.read(); 
-      }
+      LoRa.readPacket(msgBuff, sizeof(msgBuff));
       
       // Check packet
       if( checkPacket(msgBuff[0], 0x00, PAC_BIND, msgBuff, packetSize) && msgBuff[0] > 0x00)
       {
-        if((msgBuff[2] & 0x0F) == sizeof(fhss_schema)/sizeof(fhss_schema[0])) //check length 
+        if((msgBuff[2] & 0x0F) == 2) //check length. 2 bytes of hop seed
         {
           receivedBind = true;
           break; //exit while loop
@@ -452,26 +989,32 @@ void bind()
   
   if(receivedBind)
   {
-    //get transmitterID and hop channels
-    transmitterID = msgBuff[0];
-    for(uint8_t i = 0; i < (sizeof(fhss_schema)/sizeof(fhss_schema[0])); i++)
+    //get transmitterID and hop seed
+    uint8_t _txID = msgBuff[0];
+    uint16_t _hopSeed = ((uint16_t)msgBuff[3] << 8) | msgBuff[4];
+    
+    //generate random receiverID
+    randomSeed(millis()); //Seed PRNG
+    uint8_t _rxID = random(0x01, 0xFF);
+    
+    //save to eeprom, in the background. The IDs and the hop seed are stored one after the other. 
+    //If they can't be queued, we don't ack and stay as we were
+    uint8_t _ids[4] = {_txID, _rxID};
+    memcpy(_ids + 2, &_hopSeed, sizeof(_hopSeed));
+    if(!eeqPut(EE_ADR_TX_ID, _ids, sizeof(_ids)))
     {
-      if(msgBuff[3 + i] < (sizeof(freqList)/sizeof(freqList[0]))) //prevents invalid references
-        fhss_schema[i] = msgBuff[3 + i];
+      statInc(STAT_EEPROM_REFUSED);
+      hop(); //set to operating frequencies
+      return;
     }
-    
-    //save to eeprom
-    EEPROM.write(EE_ADR_TX_ID, transmitterID);
-    EEPROM.put(EE_ADR_FHSS_SCHEMA, fhss_schema);
+    transmitterID = _txID;
+    receiverID = _rxID;
+    hopSeed = _hopSeed;
+    generateHopSequence(hopSeed);
     
     //---- send reply 
     
     uint8_t dataToSend[1]; 
-    
-    //generate random receiverID
-    randomSeed(millis()); //Seed PRNG
-    receiverID = random(0x01, 0xFF);
-    EEPROM.write(EE_ADR_RX_ID, receiverID);
     dataToSend[0] = receiverID;
     delay(2);
     uint8_t _packetLen = buildPacket(0x00, transmitterID, PAC_ACK_BIND, dataToSend, sizeof(dataToSend));
@@ -498,16 +1041,166 @@ void bind()
 
 void hop()
 {
-  idx_fhss_schema++;
-  if(idx_fhss_schema >= sizeof(fhss_schema)/sizeof(fhss_schema[0]))
-    idx_fhss_schema = 0;
+  idxHopSequence++;
+  if(idxHopSequence >= HOP_SEQUENCE_LENGTH)
+    idxHopSequence = 0;
 
-  uint8_t idx_freq = fhss_schema[idx_fhss_schema];
-  if(idx_freq < sizeof(freqList)/sizeof(freqList[0])) //prevents invalid references
+  LoRa.setFrf(channelFrf[hopSequence[idxHopSequence]]);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void setRateProfile(uint8_t profile)
+{
+  //Changes the spreading factor and the slot period
+  rateProfile = profile;
+  spreadingFactor = (profile == RATE_PROFILE_LONG_RANGE) ? SF_LONG_RANGE : SF_FAST;
+  slotPeriodUs = (profile == RATE_PROFILE_LONG_RANGE) ? SLOT_PERIOD_LONG_RANGE_US : SLOT_PERIOD_FAST_US;
+  LoRa.idle();
+  LoRa.setSpreadingFactor(spreadingFactor);
+#if defined (ENABLE_CAD_SYNC)
+  if(cadState == CAD_BUSY) //the probe was cut short, its done flag will never come
+    cadState = CAD_START;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool cadSweep()
+{
+  //Probes the channels in turn for activity while we are not in sync. Returns true while we 
+  //should be listening for a packet on the current channel
+  
+  static uint32_t listenStartMicros = 0;
+  static bool isSyncChecked = false;
+  
+  switch(cadState)
   {
-    LoRa.sleep();
-    LoRa.setFrequency(freqList[idx_freq]);
-    LoRa.idle();
+    case CAD_START:
+    {
+      LoRa.startCad();
+      cadState = CAD_BUSY;
+    }
+    break;
+    
+    case CAD_BUSY:
+    {
+      int _rslt = LoRa.cadResult();
+      if(_rslt == 1) //something is on this channel
+      {
+        cadState = CAD_LISTEN;
+        listenStartMicros = micros();
+        isSyncChecked = false;
+      }
+      else if(_rslt == 0) //nothing, try the next channel
+      {
+        hop();
+        cadState = CAD_START;
+      }
+    }
+    break;
+    
+    case CAD_LISTEN:
+    {
+      uint32_t _listenMicros = micros() - listenStartMicros;
+      bool _isNoPreamble = false;
+      if(!isSyncChecked && _listenMicros > CAD_SYNC_TIME_US)
+      {
+        isSyncChecked = true;
+        _isNoPreamble = !LoRa.isSignalDetected();
+      }
+      if(_isNoPreamble || _listenMicros > CAD_LISTEN_TIME * 1000UL) //no packet. Caught the tail end or just noise
+      {
+        hop();
+        statInc(STAT_HOP_TIMEOUTS);
+        cadState = CAD_START;
+      }
+    }
+    break;
+  }
+  
+  return (cadState == CAD_LISTEN);
+}
+
+//==================================================================================================
+
+uint32_t getChannelFreq(uint8_t channel)
+{
+  //Returns the centre frequency of the channel in Hz. Any space left over after fitting in 
+  //the channels is split equally between both band edges
+  if(channel >= NUM_FREQ_CHANNELS) //prevents invalid references
+    channel = 0;
+  const uint32_t margin = ((FREQ_BAND_END - FREQ_BAND_START - FREQ_CH_BANDWIDTH) - (NUM_FREQ_CHANNELS - 1) * FREQ_CH_SPACING) / 2;
+  return FREQ_BAND_START + (FREQ_CH_BANDWIDTH / 2) + margin + (uint32_t)channel * FREQ_CH_SPACING;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void generateHopSequence(uint16_t seed)
+{
+  /* Each block of NUM_FREQ_CHANNELS hops is a shuffle of all the channels, so all channels get used 
+  equally and a channel is never used twice in a row within the sequence. 
+  A xorshift prng is used instead of random() so that both ends are guaranteed to generate the same
+  sequence from the same seed. */
+  
+  uint16_t _state = (seed == 0) ? 0xACE1 : seed; //xorshift state should never be 0
+  uint8_t _block[NUM_FREQ_CHANNELS];
+  uint8_t _idx = 0;
+  while(_idx < HOP_SEQUENCE_LENGTH)
+  {
+    //shuffle (Fisher-Yates)
+    for(uint8_t i = 0; i < NUM_FREQ_CHANNELS; i++)
+      _block[i] = i;
+    for(uint8_t i = NUM_FREQ_CHANNELS - 1; i > 0; i--)
+    {
+      _state ^= _state << 7;
+      _state ^= _state >> 9;
+      _state ^= _state << 8;
+      uint8_t j = _state % (i + 1);
+      uint8_t _tmp = _block[i];
+      _block[i] = _block[j];
+      _block[j] = _tmp;
+    }
+    //avoid repeating the last channel of the previous block
+    if(_idx > 0 && _block[0] == hopSequence[_idx - 1] && NUM_FREQ_CHANNELS > 1)
+    {
+      _block[0] = _block[1];
+      _block[1] = hopSequence[_idx - 1];
+    }
+    //append
+    for(uint8_t i = 0; i < NUM_FREQ_CHANNELS && _idx < HOP_SEQUENCE_LENGTH; i++)
+      hopSequence[_idx++] = _block[i];
+  }
+  //The sequence loops, so the last channel shouldn't be the first one either. Swapping the last two 
+  //keeps the last block a shuffle
+  if(hopSequence[HOP_SEQUENCE_LENGTH - 1] == hopSequence[0] && HOP_SEQUENCE_LENGTH % NUM_FREQ_CHANNELS != 1)
+  {
+    hopSequence[HOP_SEQUENCE_LENGTH - 1] = hopSequence[HOP_SEQUENCE_LENGTH - 2];
+    hopSequence[HOP_SEQUENCE_LENGTH - 2] = hopSequence[0];
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void syncHopPosition(uint8_t *packetBuff, uint8_t packetSize)
+{
+  /* The transmitter tags each packet's crc with its position in the hop sequence (see buildPacket()).
+  The channel we are on appears several times in the sequence, so try each of those positions 
+  until the crc matches. This way we can tell exactly where the transmitter is after receiving just 
+  one packet. The current position is tried first as it is the most likely. */
+  
+  if(packetSize < 4 || packetSize > MAX_PACKET_SIZE)
+    return;
+  uint8_t _crc = crc8Maxim(packetBuff, packetSize - 1);
+  if((_crc ^ idxHopSequence) == packetBuff[packetSize - 1])
+    return;
+  for(uint8_t i = 0; i < HOP_SEQUENCE_LENGTH; i++)
+  {
+    if(hopSequence[i] == hopSequence[idxHopSequence] && (_crc ^ i) == packetBuff[packetSize - 1])
+    {
+      idxHopSequence = i;
+      return;
+    }
   }
 }
 
@@ -519,38 +1212,228 @@ void sendTelemetry()
   static uint32_t prevRCPacketCount = 0; 
   static uint32_t ttPrevMillis = 0;
   static uint8_t rcPacketsPerSecond = 0; 
+  static uint16_t prevCrcFailCount = 0;
+  static uint8_t crcFailsPerSecond = 0;
+  static uint16_t prevFecCorrectedCount = 0;
+  static uint8_t fecFixesPerSecond = 0;
+  static uint16_t prevRecoveredFrameCount = 0;
+  static uint8_t recoveredFramesPerSecond = 0;
   uint32_t ttElapsed = millis() - ttPrevMillis;
   if (ttElapsed >= 1000)
   {
     ttPrevMillis = millis();
     rcPacketsPerSecond = ((rcPacketCount - prevRCPacketCount) * 1000) / ttElapsed;
     prevRCPacketCount = rcPacketCount;
+    uint32_t _fails = ((uint32_t)(stats[STAT_REJECTED] - prevCrcFailCount) * 1000) / ttElapsed;
+    crcFailsPerSecond = _fails > 0xFF ? 0xFF : _fails;
+    prevCrcFailCount = stats[STAT_REJECTED];
+    uint32_t _fixes = ((uint32_t)(fecCorrectedCount - prevFecCorrectedCount) * 1000) / ttElapsed;
+    fecFixesPerSecond = _fixes > 0xFF ? 0xFF : _fixes;
+    prevFecCorrectedCount = fecCorrectedCount;
+    uint32_t _recovered = ((uint32_t)(recoveredFrameCount - prevRecoveredFrameCount) * 1000) / ttElapsed;
+    recoveredFramesPerSecond = _recovered > 0xFF ? 0xFF : _recovered;
+    prevRecoveredFrameCount = recoveredFrameCount;
   }
   if(millis() - lastRCPacketMillis > 1000)
     rcPacketsPerSecond = 0;
   
   //prepare data and transmit
   
-  uint8_t dataToSend[3];
+  //find the slowest updating channel
+  uint8_t slowestChRate = 0xFF;
+  for(uint8_t i = 0; i < NUM_RC_CHANNELS; i++)
+  {
+    if(chUpdateRate[i] < slowestChRate)
+      slowestChRate = chUpdateRate[i];
+  }
+  
+  uint8_t dataToSend[13];
   dataToSend[0] = rcPacketsPerSecond;
   
-  if(externalVolts < 2000 || millis() < 5000UL)
+  if(numSensors == 0 || sensors[0].type != SENSOR_VOLTS || sensorValue[0] < 200 || millis() < 5000UL)
     telem_volts = 0x0FFF;  //no data
   else
-    telem_volts = externalVolts / 10; //convert to 10mV scale
+    telem_volts = sensorValue[0] > 0x0FFE ? 0x0FFE : sensorValue[0];
   
   dataToSend[1] = (telem_volts >> 4) & 0xFF;
   dataToSend[2] = ((telem_volts << 4) & 0xF0);
+  dataToSend[3] = slowestChRate;
+  
+  //link quality
+  dataToSend[4] = ((uint16_t)lqCount * 100) / LQ_WINDOW_SLOTS;
+  
+  //average uplink rssi and snr. Rssi is sent as -dBm, with 0 meaning "No data"
+  dataToSend[5] = 0;
+  dataToSend[6] = 0;
+  if(signalSampleCount > 0)
+  {
+    int16_t _rssi = rssiSum / signalSampleCount;
+    dataToSend[5] = (_rssi < -255) ? 255 : (_rssi > -1 ? 1 : -_rssi);
+    dataToSend[6] = (int8_t)(snrSum / signalSampleCount);
+    rssiSum = 0;
+    snrSum = 0;
+    signalSampleCount = 0;
+  }
+  
+  dataToSend[7] = crcFailsPerSecond;
+  dataToSend[8] = fecFixesPerSecond;
+  dataToSend[9] = recoveredFramesPerSecond;
+  
+  //average output delay and packet processing time, in 0.1ms. 0 means "No data"
+  dataToSend[10] = 0;
+  dataToSend[11] = 0;
+  if(outputDelayCount > 0)
+  {
+    uint32_t _delay = outputDelaySum / outputDelayCount / 100;
+    dataToSend[10] = _delay > 0xFF ? 0xFF : (_delay < 1 ? 1 : _delay);
+    outputDelaySum = 0;
+    outputDelayCount = 0;
+  }
+  if(processTimeCount > 0)
+  {
+    uint32_t _time = processTimeSum / processTimeCount / 100;
+    dataToSend[11] = _time > 0xFF ? 0xFF : (_time < 1 ? 1 : _time);
+    processTimeSum = 0;
+    processTimeCount = 0;
+  }
+  
+  //how long the outputs took to go to failsafe the last time the link dropped, in 10ms
+  dataToSend[12] = failsafeDelay;
   
   uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_TELEMETRY, dataToSend, sizeof(dataToSend));
   
-  delay(1);
-  if(LoRa.beginPacket())
+  queueReply(_packetLen, 1000);
+}
+
+//==================================================================================================
+
+void queueReply(uint8_t packetLen, uint16_t delayUs)
+{
+  //Queues the packet in the packet buffer to be sent delayUs from now
+  replyLen = packetLen;
+  replyStartMicros = micros() + delayUs;
+  replyState = REPLY_WAITING;
+}
+
+//==================================================================================================
+
+void serviceReply()
+{
+  //Starts the queued reply when it is due, then hops once it is done. Never waits on the radio
+  if(replyState == REPLY_WAITING && (int32_t)(micros() - replyStartMicros) >= 0)
+  {
+    if(LoRa.beginPacket())
+    {
+      LoRa.write(packet, replyLen);
+      LoRa.endPacket(true); //async
+      replyState = REPLY_SENDING;
+    }
+    else
+      replyState = REPLY_NONE;
+  }
+  else if(replyState == REPLY_SENDING && !LoRa.isTransmitting())
   {
-    LoRa.write(packet, _packetLen);
-    LoRa.endPacket(); //block until done transmitting
+    replyState = REPLY_NONE;
     hop();
+    slotDeadlineMicros += slotPeriodUs; //the reply took up a slot
+    
+    //change over along with the transmitter. The next packet is due at the same time, but is longer
+    if(pendingRateProfile != 0xFF)
+    {
+      slotDeadlineMicros -= LORA_AIRTIME_US(MAX_RC_PACKET_SIZE, 0, spreadingFactor);
+      setRateProfile(pendingRateProfile);
+      slotDeadlineMicros += LORA_AIRTIME_US(MAX_RC_PACKET_SIZE, 0, spreadingFactor);
+    }
+  }
+  if(replyState == REPLY_NONE)
+    pendingRateProfile = 0xFF;
+}
+
+//==================================================================================================
+
+void sendLinkStats()
+{
+  //Sends the next page of link statistics
+  static uint8_t _page = 0;
+  uint8_t dataToSend[STATS_PAGE_LEN];
+  statSet(STAT_EEPROM_ERRORS, eeqErrorCount); //counted in the eeprom interrupt
+  statsBuildPage(_page, dataToSend);
+  _page = (_page + 1) % STATS_NUM_PAGES;
+  
+  uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_LINK_STATS, dataToSend, sizeof(dataToSend));
+  
+  queueReply(_packetLen, 1000);
+}
+
+//==================================================================================================
+
+void sendSensors()
+{
+  //Sends the next page of sensor values
+  static uint8_t _first = 0;
+  uint8_t dataToSend[SENSORS_PER_PAGE * SENSORS_ENTRY_LEN];
+  uint8_t _len = sensorsBuildPage(_first, dataToSend);
+  _first += SENSORS_PER_PAGE;
+  if(_first >= numSensors || _first >= SENSORS_MAX)
+    _first = 0;
+  
+  uint8_t _packetLen = buildPacket(receiverID, transmitterID, PAC_SENSORS, dataToSend, _len);
+  
+  queueReply(_packetLen, 1000);
+}
+
+//==================================================================================================
+
+void updateLinkQuality(bool gotPacket)
+{
+  //Records the outcome of a slot in the link quality window, dropping the oldest slot
+  if(!gotPacket && rcMissedSlots < 0xFF)
+    ++rcMissedSlots;
+  
+  uint8_t _mask = 1 << (idxLqHistory % 8);
+  uint8_t *_byte = &lqHistory[idxLqHistory / 8];
+  if(*_byte & _mask)
+    --lqCount;
+  if(gotPacket)
+  {
+    *_byte |= _mask;
+    ++lqCount;
+  }
+  else
+    *_byte &= ~_mask;
+  
+  ++idxLqHistory;
+  if(idxLqHistory >= LQ_WINDOW_SLOTS)
+    idxLqHistory = 0;
+}
+
+//==================================================================================================
+
+void rebuildPreviousFrame(uint8_t *dataBuff, int *curVals)
+{
+  /* Rebuilds the previous frame from the redundancy record in bytes 12 to 14, into chVals.
+  Ch1 to Ch4 are sent as the change from the previous frame, scaled by 1, 2, 4 or 8. 
+  Ch5 to Ch9 are only rebuilt if flagged as unchanged. curVals are the primary channels of this frame */
+  
+  uint8_t _shift = readBits(dataBuff, 96, 2);
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    int _q = readBits(dataBuff, 98 + i * 5, 5);
+    if(_q & 0x10) //negative
+      _q -= 32;
+    chVals[i] = constrain(curVals[i] + _q * (1 << _shift), 0, 1000) - 500;
+    if(chUpdateCount[i] < 0xFF)
+      ++chUpdateCount[i];
+  }
+  
+  if(readBits(dataBuff, 118, 1))
+  {
+    for(uint8_t i = 4; i < NUM_PRIMARY_CHANNELS; i++)
+      chVals[i] = curVals[i] - 500;
   }
+  
+  if(recoveredFrameCount < 0xFFFF)
+    ++recoveredFrameCount;
 }
 
 //==================================================================================================
@@ -569,6 +1452,10 @@ uint8_t buildPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8
     ++dataBuff;
   }
   packet[3 + dataLen] = crc8Maxim(packet, 3 + dataLen);
+  //Tag with the position in the hop sequence. Lets the receiver know where in the sequence we are.
+  //Not done on bind as the sequence isn't known yet.
+  if(dataIdentifier != PAC_BIND && dataIdentifier != PAC_ACK_BIND)
+    packet[3 + dataLen] ^= idxHopSequence;
   return 4 + dataLen; 
 }
 
@@ -582,15 +1469,49 @@ bool checkPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t
   if(packetBuff[0] != srcID || packetBuff[1] != destID || (packetBuff[2] >> 4) != dataIdentifier)
     return false;
   
-  //check packet crc
+  //check packet crc. Also checks that we are at the same position in the hop sequence. See buildPacket()
   uint8_t _crcQQ = packetBuff[packetSize - 1];
   uint8_t _computedCRC = crc8Maxim(packetBuff, packetSize - 1);
+  if(dataIdentifier != PAC_BIND && dataIdentifier != PAC_ACK_BIND)
+    _computedCRC ^= idxHopSequence;
   if(_crcQQ != _computedCRC)
     return false;
   
   return true;
 }
 
+//--------------------------------------------------------------------------------------------------
+
+uint16_t readBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits)
+{
+  //Reads numBits (max 16) starting at bitPos. Bits are packed msb first
+  uint16_t rslt = 0;
+  for(uint8_t i = 0; i < numBits; i++)
+  {
+    uint8_t _pos = bitPos + i;
+    rslt <<= 1;
+    rslt |= (buff[_pos / 8] >> (7 - (_pos % 8))) & 0x01;
+  }
+  return rslt;
+}
+
+//==================================================================================================
+
+void calcChannelUpdateRates()
+{
+  static uint32_t _prevMillis = 0;
+  uint32_t _elapsed = millis() - _prevMillis;
+  if(_elapsed < 1000)
+    return;
+  _prevMillis = millis();
+  
+  for(uint8_t i = 0; i < NUM_RC_CHANNELS; i++)
+  {
+    chUpdateRate[i] = ((uint16_t)chUpdateCount[i] * 1000) / _elapsed;
+    chUpdateCount[i] = 0;
+  }
+}
+
 //==================================================================================================
 
 void writeOutputs()
@@ -603,57 +1524,298 @@ void writeOutputs()
   if(!outputsInitialised)
   {
     //setup outputs
-    for(uint8_t i = 0; i < 9; i++)
+    for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; i++)
     {
       if(outputChConfig[i] == 0)
         pinMode(myOutputPins[i], OUTPUT);
       else if(outputChConfig[i] == 1)
-        myServo[i].attach(myOutputPins[i]);
+        servoIdx[i] = servoAttach(myOutputPins[i]);
+      else if(outputChConfig[i] == 3 && !isPpmEnabled)
+        isPpmEnabled = ppmBegin(myOutputPins[i]);
+      else if(outputChConfig[i] >= 3)
+      {
+        pinMode(myOutputPins[i], OUTPUT);
+        digitalWrite(myOutputPins[i], LOW);
+        if(outputChConfig[i] == 4 && !isSbusEnabled)
+        {
+          Serial.begin(100000, SERIAL_8E2);
+          isSbusEnabled = true;
+        }
+      }
     }
     outputsInitialised = true;
   }
   
-  for(uint8_t i = 0; i < 9; i++)
+  //the servo frame carrying the last packet's values has started
+  if(isOutputLatchPending && isServoLatched)
+  {
+    isOutputLatchPending = false;
+    recordOutputTime(servoLatchMicros);
+  }
+  
+  startServoFrameWhenDue();
+  
+  /* A rebuilt frame gets a servo frame of its own. Had the values after it been committed before 
+  that frame started, they would have replaced it. */
+  if(isRcValsHeld)
+  {
+    if(!isServoLatched)
+      return;
+    isRcValsHeld = false;
+  }
+  
+  if(!isChValsChanged)
+    return;
+  isChValsChanged = false;
+  
+  for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; i++)
   {
     if(outputChConfig[i] == 0)     //digital mode
     {
       //range -500 to -250 becomes LOW
       //range -250 to 250 is ignored
       //range 250 to 500 becomes HIGH
-      if(ch1to9Vals[i] <= -250)
+      if(chVals[i] <= -250)
         digitalWrite(myOutputPins[i], LOW);
-      else if(ch1to9Vals[i] >= 250)
+      else if(chVals[i] >= 250)
         digitalWrite(myOutputPins[i], HIGH);
     }
     else if(outputChConfig[i] == 1) //servo mode
     {
-      int val = map(ch1to9Vals[i], -500, 500, 1000, 2000);
+      int val = map(chVals[i], -500, 500, 1000, 2000);
       val = constrain(val, 1000, 2000);
-      myServo[i].writeMicroseconds(val);
+      if(isFailsafeActive && chFailsafes[i] == FAILSAFE_NO_PULSES)
+        val = 0;
+#if defined (ENABLE_OUTPUT_SMOOTHING)
+      setSmoothTarget(i, val);
+      val = smoothOut[i];
+#endif
+      servoWrite(servoIdx[i], val);
     }
     else if(outputChConfig[i] == 2) //pwm mode
     {
-      int val = map(ch1to9Vals[i], -500, 500, 0, 255);
+      int val = map(chVals[i], -500, 500, 0, 255);
       val = constrain(val, 0, 255);
+      if(isFailsafeActive && chFailsafes[i] == FAILSAFE_NO_PULSES)
+        val = 0;
       analogWrite(myOutputPins[i], val);
     }
   }
+  
+#if defined (ENABLE_OUTPUT_SMOOTHING)
+  if(isNewRcVals)
+  {
+    smoothPeriodUs = constrain(rcValsMicros - smoothStartMicros, slotPeriodUs / 2, 2 * slotPeriodUs);
+    smoothStartMicros = rcValsMicros;
+  }
+#endif
+  
+  bool _isServoPending = servoCommit();
+  
+  /* Start the next servo frame a fixed time after the packet arrived, so the outputs keep a steady 
+  phase to the packets. New servo values are only out once that frame starts, everything else is 
+  out now. */
+  if(isNewRcVals)
+  {
+    servoFrameDueMicros = rcValsMicros + OUTPUT_LATCH_DELAY_US;
+    isServoFrameDue = true;
+    startServoFrameWhenDue();
+  }
+  if(isRebuiltOutput) //not timed, as it didn't arrive on its own
+  {
+    isNewRcVals = false;
+    isRcValsHeld = _isServoPending;
+  }
+  else if(isNewRcVals || isNewFailsafeVals)
+  {
+    //failsafe is timed from the last packet received
+    latchPacketMicros = isNewRcVals ? rcValsMicros : lastRCPacketMicros;
+    isLatchFailsafe = !isNewRcVals;
+    isNewRcVals = false;
+    isNewFailsafeVals = false;
+    isOutputLatchPending = _isServoPending;
+    if(!_isServoPending)
+      recordOutputTime(micros());
+  }
+  else if(_isServoPending)
+    isOutputLatchPending = false; //not timed
+  
+  //ppm carries the rc channels, not the outputs
+  if(isPpmEnabled)
+  {
+    for(uint8_t i = 0; i < PPM_NUM_CHANNELS && i < NUM_RC_CHANNELS; i++)
+    {
+      int val = map(chVals[i], -500, 500, 1000, 2000);
+      ppmWrite(i, constrain(val, 1000, 2000));
+    }
+    ppmCommit();
+  }
+  
+  static bool servosStarted = false;
+  if(!servosStarted)
+  {
+    servoBegin(SERVO_FRAME_PERIOD_US);
+    servosStarted = true;
+  }
+}
+
+//==================================================================================================
+
+void startServoFrameWhenDue()
+{
+  //Pulses going out can hold the frame start off, in which case it is tried again on the next pass
+  if(!isServoFrameDue)
+    return;
+  int32_t _delay = (int32_t)(servoFrameDueMicros - micros());
+  if(servoStartFrameIn(_delay > 0 ? _delay : 0))
+    isServoFrameDue = false;
+}
+
+//==================================================================================================
+
+void outputRebuiltFrame()
+{
+  /* Puts the frame rebuilt by rebuildPreviousFrame() out as an update of its own, timed as if it 
+  had come in a slot before the packet carrying it. Sbus gets a frame straight away, servo outputs 
+  the servo frame starting next, with the packet's own values held back until that frame has 
+  started. PPM only carries what it holds at the start of its frame, so usually skips it. */
+  isRebuiltOutput = true;
+  isChValsChanged = true;
+  isNewRcVals = true;
+  rcValsMicros = LoRa.packetMicros() - slotPeriodUs;
+  writeOutputs();
+  isRebuiltOutput = false;
+  if(isSbusEnabled)
+    sendSbusFrame(0);
 }
 
 //==================================================================================================
 
-uint8_t getMaxOutputChConfig(int pin)
+void recordOutputTime(uint32_t outputMicros)
 {
-  int pwmPins[] = {5, 6, 9, 10, 3, 11}; //on arduino uno
+  //Times values that are now out on the outputs from the packet in latchPacketMicros
+  uint32_t _delay = outputMicros - latchPacketMicros;
+  if(isLatchFailsafe)
+  {
+    _delay = (_delay + 5000) / 10000;
+    failsafeDelay = _delay > 0xFF ? 0xFF : (_delay < 1 ? 1 : _delay);
+  }
+  else if(outputDelayCount < 0xFF)
+  {
+    outputDelaySum += _delay;
+    ++outputDelayCount;
+  }
+}
+
+//==================================================================================================
+
+#if defined (ENABLE_OUTPUT_SMOOTHING)
+
+void setSmoothTarget(uint8_t idx, int val)
+{
+  //Starts moving the output from where it is now to val
+  smoothFrom[idx] = smoothOut[idx];
+  smoothTo[idx] = val;
   
-  uint8_t rslt = 1;
+  //jump instead if not from a packet, or to or from no pulse, or too far, or not to be smoothed
+  int _step = val - smoothOut[idx];
+  if(!isNewRcVals || val == 0 || smoothOut[idx] == 0 || abs(_step) > SMOOTH_MAX_STEP 
+     || !((SMOOTH_OUTPUT_MASK >> idx) & 0x01))
+  {
+    smoothFrom[idx] = val;
+    smoothOut[idx] = val;
+  }
+}
+
+//==================================================================================================
+
+void updateSmoothOutputs()
+{
+  /* Moves the servo outputs a step closer to their targets, once per servo frame. A frame has just 
+  started, so the values worked out here go out in the next one. Position along the move is in 
+  1/256ths, so each output only needs a multiply and a shift. */
+  if(!isServoFrameStarted)
+    return;
+  isServoFrameStarted = false;
+  
+#if defined (DEBUG_OUTPUT_SMOOTHING)
+  static uint32_t _debugMicros = 0;
+  static uint16_t _debugChannels = 0;
+  static uint32_t _lastDebugPrint = 0;
+  uint32_t _debugStart = micros();
+#endif
+  
+  uint16_t _frac = 0xFFFF; //worked out once an output is found moving, as the divide is the dear part
+  
+  for(uint8_t i = 0; i < NUM_OUTPUT_CHANNELS; i++)
+  {
+    if(outputChConfig[i] != 1)
+      continue;
+    if(smoothOut[i] != smoothTo[i])
+    {
+      if(_frac == 0xFFFF)
+        _frac = smoothFraction(micros() - smoothStartMicros + SERVO_FRAME_PERIOD_US, smoothPeriodUs);
+      smoothOut[i] = smoothStep(smoothFrom[i], smoothTo[i], _frac);
+      servoWrite(servoIdx[i], smoothOut[i]);
+#if defined (DEBUG_OUTPUT_SMOOTHING)
+      _debugChannels++;
+#endif
+    }
+  }
+  servoCommit();
+  
+#if defined (DEBUG_OUTPUT_SMOOTHING)
+  _debugMicros += micros() - _debugStart;
+  if(millis() - _lastDebugPrint >= 1000)
+  {
+    _lastDebugPrint = millis();
+    Serial.print(F("Smoothing ns/ch: "));
+    if(_debugChannels > 0)
+      Serial.println(_debugMicros * 1000 / _debugChannels);
+    else
+      Serial.println(F("--"));
+    _debugMicros = 0;
+    _debugChannels = 0;
+  }
+#endif
+}
+
+//==================================================================================================
+
+uint16_t smoothFraction(uint32_t elapsedUs, uint32_t periodUs)
+{
+  //How far along a move taking periodUs we are after elapsedUs, in 1/256ths
+  if(elapsedUs >= periodUs)
+    return 256;
+  return (elapsedUs << 8) / periodUs;
+}
+
+//==================================================================================================
+
+int smoothStep(int from, int to, uint16_t frac)
+{
+  //The output frac/256ths of the way from one value to the other, to the nearest microsecond
+  int32_t _step = ((int32_t)(to - from) * frac + 128) >> 8;
+  return from + (int)_step;
+}
+
+#endif
+
+//==================================================================================================
+
+uint8_t getOutputChCapability(int pin)
+{
+  //Returns a bit per supported mode, starting with Servo at bit0. All pins can do Servo, PPM and SBUS
+  int pwmPins[] = {5, 6, 3, 11}; //on arduino uno. 9 and 10 are lost to the servo timer
+  
+  uint8_t rslt = 0x0D;
   
   //search through array
   for(uint8_t i = 0; i < (sizeof(pwmPins)/sizeof(pwmPins[0])); i++)
   {
     if(pwmPins[i] == pin)
     {
-      rslt = 2;
+      rslt |= 0x02;
       break;
     }
   }
@@ -663,25 +1825,11 @@ uint8_t getMaxOutputChConfig(int pin)
 
 //==================================================================================================
 
-void getExternalVoltage()
+void sendSbusFrame(uint8_t flags)
 {
-  /* 
-  Apply smoothing to measurement using exponential recursive smoothing
-  It works by subtracting out the mean each time, and adding in a new point. 
-  _NUM_SAMPLES parameter defines number of samples to average over. Higher value results in slower
-  response.
-  Formula x = x - x/n + a/n  
-  */
-  static uint32_t _lastMillis = 0;
-  if(millis() - _lastMillis < 10)
-  {
-    return;
-  }
-  _lastMillis = millis();
-  
-  const int _NUM_SAMPLES = 30;
-  const int VFactor = 1627; //adjust this for correction. (##TODO possibly change this on transmitter side)
-  long _millivolts = ((long)analogRead(PIN_EXTV_SENSE) * VFactor) / 100;
-  _millivolts = ((long)externalVolts * (_NUM_SAMPLES - 1) + _millivolts) / _NUM_SAMPLES; 
-  externalVolts = int(_millivolts); 
+  uint8_t _frame[SBUS_FRAME_LEN];
+  sbusEncode(_frame, chVals, NUM_RC_CHANNELS, flags);
+  Serial.write(_frame, SBUS_FRAME_LEN);
+  lastSbusFrameMillis = millis();
+  lastSbusFrameMicros = micros();
 }
@@ -0,0 +1,39 @@
+// SBUS frame encoding. A frame is 25 bytes: a 0x0F header, 16 channels of 11 bits each packed
+// lsb first, a flags byte and a 0x00 footer. Sent at 100000 baud, 8 data bits, even parity and
+// 2 stop bits. The line is inverted, so an inverter is needed between the TX pin and the flight
+// controller unless the flight controller can invert its input.
+// Channel values use the common 172 to 1811 range for 1000 to 2000us, centred on 992.
+
+#define SBUS_FRAME_LEN          25
+#define SBUS_NUM_CHANNELS       16
+#define SBUS_FLAG_FRAME_LOST    0x04
+#define SBUS_FLAG_FAILSAFE      0x08
+
+void sbusEncode(uint8_t *frame, int *chVals, uint8_t numChannels, uint8_t flags)
+{
+  //chVals are in the range -500 to 500. Channels beyond numChannels are sent centred
+  frame[0] = 0x0F;
+
+  uint32_t _bits = 0;
+  uint8_t _numBits = 0;
+  uint8_t _idx = 1;
+  for(uint8_t i = 0; i < SBUS_NUM_CHANNELS; i++)
+  {
+    int _val = 0;
+    if(i < numChannels)
+      _val = constrain(chVals[i], -500, 500);
+    uint16_t _sbusVal = 172 + ((int32_t)(_val + 500) * 1639 + 500) / 1000; //rounded, so 0 is 992
+
+    _bits |= (uint32_t)_sbusVal << _numBits;
+    _numBits += 11;
+    while(_numBits >= 8)
+    {
+      frame[_idx++] = _bits & 0xFF;
+      _bits >>= 8;
+      _numBits -= 8;
+    }
+  }
+
+  frame[23] = flags;
+  frame[24] = 0x00;
+}
@@ -0,0 +1,132 @@
+// Sensors on the receiver, sent to the transmitter a page at a time in place of some of the 
+// telemetry replies. Each sensor is an entry in the sensors[] table in rx.ino.
+// Analog sensors are sampled in turn without waiting on the ADC. A conversion is started on one 
+// pass of the main loop and picked up on a later one, so no pass is held up for the ~110us a 
+// conversion takes, as analogRead() would. The first conversion after switching pins is discarded.
+// Readings are smoothed before being scaled.
+
+enum {
+  SENSOR_VOLTS = 0, //in 10mV
+  SENSOR_CURRENT,   //in 10mA
+  SENSOR_TEMP,      //in 0.1 degC
+  SENSOR_ALTITUDE,  //in 0.1m
+};
+
+typedef struct {
+  uint8_t type;
+  uint8_t pin;        //analog pin. Unused if read is set
+  int16_t fullScale;  //value with the reference voltage (1.1V) at the pin
+  int16_t offset;     //value with 0V at the pin
+  int16_t (*read)();  //for sensors not read through the ADC, e.g. over I2C. NULL for analog sensors
+} sensor_t;
+
+#define SENSOR_NO_DATA        ((int16_t)0x8000)
+#define SENSORS_MAX           6  //limited by the transmitter
+#define SENSORS_PER_PAGE      4
+#define SENSORS_ENTRY_LEN     3  //sensor number and type, then the value msb first
+#define SENSOR_SAMPLE_INTERVAL 10 //in ms. Each sensor is sampled once per interval
+#define SENSOR_SMOOTHING_SHIFT 4  //readings are averaged over about 2^n samples
+
+//defined in rx.ino
+extern const sensor_t sensors[];
+extern const uint8_t numSensors;
+
+int16_t sensorValue[SENSORS_MAX];
+uint16_t sensorFiltered[SENSORS_MAX]; //smoothed ADC reading, scaled up by 2^SENSOR_SMOOTHING_SHIFT
+bool isSensorSampled[SENSORS_MAX];
+
+//--------------------------------------------------------------------------------------------------
+
+void sensorsBegin()
+{
+  for(uint8_t i = 0; i < SENSORS_MAX; i++)
+  {
+    sensorValue[i] = SENSOR_NO_DATA;
+    isSensorSampled[i] = false;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void sensorsUpdate()
+{
+  //Takes at most one step of sampling per call. Should be called on every pass of the main loop
+  static uint8_t _idx = SENSORS_MAX; //sensor being converted. SENSORS_MAX when idle
+  static uint32_t _lastMillis = 0;
+  static bool _isMuxSwitched = false;
+  uint8_t _num = numSensors < SENSORS_MAX ? numSensors : SENSORS_MAX;
+  
+  if(_idx < _num)
+  {
+    //pick up the result of the conversion, if it is done
+    if(ADCSRA & _BV(ADSC))
+      return;
+    uint16_t _raw = ADC;
+    if(_isMuxSwitched)
+    {
+      //The first conversion after switching pins is pulled toward the previous pin, as the sample 
+      //and hold hasn't settled. Throw it away and convert again
+      _isMuxSwitched = false;
+      ADCSRA |= _BV(ADSC);
+      return;
+    }
+    if(isSensorSampled[_idx])
+      sensorFiltered[_idx] += _raw - (sensorFiltered[_idx] >> SENSOR_SMOOTHING_SHIFT);
+    else
+    {
+      sensorFiltered[_idx] = _raw << SENSOR_SMOOTHING_SHIFT;
+      isSensorSampled[_idx] = true;
+    }
+    sensorValue[_idx] = sensors[_idx].offset 
+                        + ((int32_t)sensors[_idx].fullScale * sensorFiltered[_idx] >> (10 + SENSOR_SMOOTHING_SHIFT));
+    _idx++;
+  }
+  else
+  {
+    if(millis() - _lastMillis < SENSOR_SAMPLE_INTERVAL)
+      return;
+    _lastMillis = millis();
+    _idx = 0;
+  }
+  
+  //read the sensors that don't use the ADC, up to the next analog one
+  while(_idx < _num && sensors[_idx].read != NULL)
+  {
+    sensorValue[_idx] = sensors[_idx].read();
+    _idx++;
+  }
+  
+  if(_idx >= _num)
+  {
+    _idx = SENSORS_MAX;
+    return;
+  }
+  
+  //start a conversion against the internal 1.1V reference
+  uint8_t _pin = sensors[_idx].pin;
+  if(_pin >= A0)
+    _pin -= A0;
+  uint8_t _mux = _BV(REFS1) | _BV(REFS0) | (_pin & 0x07);
+  if(ADMUX != _mux) //always so with more than one analog sensor
+  {
+    ADMUX = _mux;
+    _isMuxSwitched = true;
+  }
+  ADCSRA |= _BV(ADSC);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint8_t sensorsBuildPage(uint8_t first, uint8_t *buff)
+{
+  //Fills buff with the sensors starting from first, up to SENSORS_PER_PAGE of them. Returns the 
+  //number of bytes used
+  uint8_t _len = 0;
+  for(uint8_t i = first; i < numSensors && i < SENSORS_MAX && i < first + SENSORS_PER_PAGE; i++)
+  {
+    buff[_len++] = (i << 4) | (sensors[i].type & 0x0F);
+    buff[_len++] = (uint16_t)sensorValue[i] >> 8;
+    buff[_len++] = (uint16_t)sensorValue[i] & 0xFF;
+  }
+  return _len;
+}
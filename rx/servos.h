@@ -0,0 +1,328 @@
+// Servo pulse engine for the Atmega328p. Drives all the servo outputs from Timer1, with one
+// compare interrupt per pulse edge. All the pulses start together at the beginning of a frame and
+// end in order of width, so a frame only has to be longer than the widest pulse. This allows
+// frame rates up to about 333Hz for digital servos.
+// The edge times are sorted outside the interrupt and only when a pulse width changes. The
+// interrupt just clears a pin and loads the next compare value.
+// A PPM sum signal can also be generated on one pin, from compare B of the same timer.
+// Timer1 is taken over, so PWM (analogWrite) on pins 9 and 10 is not available.
+
+#define SERVO_MAX_OUTPUTS   15
+#define SERVO_TICKS_PER_US  2   //Timer1 at 16MHz with prescaler 8
+#define SERVO_MIN_EDGE_GAP  24  //in ticks. Edges closer than this are done within the same interrupt
+#define SERVO_END_LATENCY   6   //in ticks. From a compare match to the pin being cleared in the interrupt
+
+volatile uint8_t *servoPort[SERVO_MAX_OUTPUTS];
+uint8_t servoMask[SERVO_MAX_OUTPUTS];
+uint8_t numServos = 0;
+
+//Ports with outputs on them, and the port of each output
+volatile uint8_t *servoStartPort[3];
+uint8_t numServoStartPorts = 0;
+uint8_t servoStartIdx[SERVO_MAX_OUTPUTS];
+
+uint16_t servoFrameTicks = 20000 * SERVO_TICKS_PER_US;
+uint16_t servoPulseUs[SERVO_MAX_OUTPUTS];
+bool isServoPulseChanged = false;
+
+/* Edge schedule, double buffered. The interrupt plays the active one while the other is filled
+in. The new one is taken up at the start of the next frame, so a frame never mixes old and new
+pulse widths. */
+uint16_t servoEdgeTicks[2][SERVO_MAX_OUTPUTS]; //from the start of the frame, ascending
+uint8_t servoEdgeOutput[2][SERVO_MAX_OUTPUTS]; //output that ends at each edge
+uint8_t servoStartMask[2][3]; //pins to raise at the start of a frame, per port in servoStartPort
+volatile uint8_t servoActiveSchedule = 0;
+volatile bool isServoScheduleReady = false;
+
+volatile uint8_t idxServoEdge = 0; //numServos means we are in the gap before the next frame
+uint16_t servoFrameStart = 0; //when the frame was due to start, for a steady frame period
+uint16_t servoPulseStart = 0; //when the pulses did start, later if the interrupt was held off
+
+volatile uint32_t servoLatchMicros = 0; //when the last new schedule was taken up
+volatile bool isServoLatched = false;   //set by the interrupt when it takes up a new schedule
+volatile bool isServoFrameStarted = false; //set by the interrupt at the start of every frame
+
+//--------------------------------------------------------------------------------------------------
+
+uint8_t servoAttach(uint8_t pin)
+{
+  //Adds an output and returns its index, or 0xFF if the table is full or the pin has no port, 
+  //such as A6 and A7. Should be called before servoBegin()
+  if(numServos >= SERVO_MAX_OUTPUTS || digitalPinToPort(pin) == NOT_A_PIN)
+    return 0xFF;
+
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+
+  volatile uint8_t *_port = portOutputRegister(digitalPinToPort(pin));
+  uint8_t _mask = digitalPinToBitMask(pin);
+  servoPort[numServos] = _port;
+  servoMask[numServos] = _mask;
+  servoPulseUs[numServos] = 1500;
+
+  uint8_t i = 0;
+  while(i < numServoStartPorts && servoStartPort[i] != _port)
+    i++;
+  if(i == numServoStartPorts)
+  {
+    servoStartPort[i] = _port;
+    numServoStartPorts++;
+  }
+  servoStartIdx[numServos] = i;
+
+  isServoPulseChanged = true;
+  return numServos++;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void servoWrite(uint8_t idx, uint16_t pulseUs)
+{
+  //Sets the pulse width of an output. Takes effect on servoCommit(). A width of 0 stops the pulses
+  if(idx < numServos && servoPulseUs[idx] != pulseUs)
+  {
+    servoPulseUs[idx] = pulseUs;
+    isServoPulseChanged = true;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool servoCommit()
+{
+  //Builds a new edge schedule if any pulse width has changed. Returns true if one was built
+  if(!isServoPulseChanged)
+    return false;
+  isServoPulseChanged = false;
+
+  //hold off the interrupt from switching to the buffer we are about to fill
+  isServoScheduleReady = false;
+  uint8_t _buff = servoActiveSchedule ^ 1;
+
+  //outputs with no pulse are left out of the start of the frame
+  memset(servoStartMask[_buff], 0, sizeof(servoStartMask[_buff]));
+  for(uint8_t i = 0; i < numServos; i++)
+  {
+    if(servoPulseUs[i] > 0)
+      servoStartMask[_buff][servoStartIdx[i]] |= servoMask[i];
+  }
+
+  //insertion sort by pulse width
+  for(uint8_t i = 0; i < numServos; i++)
+  {
+    //an output with no pulse still gets an edge, which just clears its already low pin
+    uint16_t _ticks = (servoPulseUs[i] > 0 ? servoPulseUs[i] : 1000) * SERVO_TICKS_PER_US - SERVO_END_LATENCY;
+    uint8_t j = i;
+    while(j > 0 && servoEdgeTicks[_buff][j - 1] > _ticks)
+    {
+      servoEdgeTicks[_buff][j] = servoEdgeTicks[_buff][j - 1];
+      servoEdgeOutput[_buff][j] = servoEdgeOutput[_buff][j - 1];
+      j--;
+    }
+    servoEdgeTicks[_buff][j] = _ticks;
+    servoEdgeOutput[_buff][j] = i;
+  }
+
+  isServoLatched = false;
+  isServoScheduleReady = true;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool servoStartFrameIn(uint16_t delayUs)
+{
+  /* Brings the start of the next frame forward (or back) to delayUs from now, so that the pulses 
+  can be kept in step with the incoming packets. Only done in the gap between frames, as moving 
+  the frame start while pulses are going out would change their widths. Returns false if pulses 
+  are going out, so the caller can try again. */
+  if(numServos == 0)
+    return true;
+  if(delayUs < 50)
+    delayUs = 50;
+  bool _isMoved = false;
+  uint8_t _sreg = SREG;
+  cli();
+  if(idxServoEdge >= numServos && !(TIFR1 & _BV(OCF1A)))
+  {
+    OCR1A = TCNT1 + delayUs * SERVO_TICKS_PER_US;
+    _isMoved = true;
+  }
+  SREG = _sreg;
+  return _isMoved;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void servoBegin(uint16_t framePeriodUs)
+{
+  //Starts generating pulses. Outputs should be attached first
+  if(numServos == 0)
+    return;
+
+  servoFrameTicks = framePeriodUs * SERVO_TICKS_PER_US;
+  servoCommit();
+
+  uint8_t _sreg = SREG;
+  cli();
+  servoActiveSchedule ^= 1;
+  isServoScheduleReady = false;
+  idxServoEdge = numServos;
+  TCCR1A = 0;          //normal mode
+  TCCR1B = _BV(CS11);  //prescaler 8
+  OCR1A = TCNT1 + 100;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  SREG = _sreg;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/* PPM sum. Positive going, with each channel starting with a PPM_MARK_US mark and lasting for its 
+pulse width. A last mark ends the final channel, then the line stays low until the next frame. */
+
+#define PPM_NUM_CHANNELS  8
+#define PPM_MARK_US       300
+#define PPM_FRAME_US      22500
+
+volatile uint8_t *ppmPort;
+uint8_t ppmMask = 0;
+
+uint16_t ppmPulseTicks[PPM_NUM_CHANNELS];     //in use by the interrupt
+uint16_t ppmNextPulseTicks[PPM_NUM_CHANNELS]; //taken up at the start of the next frame
+volatile bool isPpmFrameReady = false;
+
+uint8_t idxPpmChannel = 0;  //channel started by the last mark
+bool isPpmMark = false;
+uint16_t ppmFrameStart = 0;
+uint16_t ppmChannelStart = 0;
+
+//--------------------------------------------------------------------------------------------------
+
+void ppmWrite(uint8_t ch, uint16_t pulseUs)
+{
+  //Sets the pulse width of a channel. Takes effect on ppmCommit()
+  if(ch < PPM_NUM_CHANNELS)
+  {
+    isPpmFrameReady = false;
+    ppmNextPulseTicks[ch] = pulseUs * SERVO_TICKS_PER_US;
+  }
+}
+
+void ppmCommit()
+{
+  isPpmFrameReady = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ppmBegin(uint8_t pin)
+{
+  //Starts generating ppm on the pin. Returns false if the pin has no port
+  if(digitalPinToPort(pin) == NOT_A_PIN)
+    return false;
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  ppmPort = portOutputRegister(digitalPinToPort(pin));
+  ppmMask = digitalPinToBitMask(pin);
+
+  for(uint8_t i = 0; i < PPM_NUM_CHANNELS; i++)
+  {
+    ppmNextPulseTicks[i] = 1500 * SERVO_TICKS_PER_US;
+    ppmPulseTicks[i] = 1500 * SERVO_TICKS_PER_US;
+  }
+
+  uint8_t _sreg = SREG;
+  cli();
+  idxPpmChannel = PPM_NUM_CHANNELS; //next mark starts a frame
+  isPpmMark = false;
+  TCCR1A = 0;          //normal mode
+  TCCR1B = _BV(CS11);  //prescaler 8
+  OCR1B = TCNT1 + 100;
+  TIFR1 = _BV(OCF1B);
+  TIMSK1 |= _BV(OCIE1B);
+  SREG = _sreg;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ISR(TIMER1_COMPB_vect)
+{
+  if(!isPpmMark) //start of a mark
+  {
+    *ppmPort |= ppmMask;
+    isPpmMark = true;
+    if(idxPpmChannel >= PPM_NUM_CHANNELS) //start of a new frame
+    {
+      if(isPpmFrameReady)
+      {
+        memcpy(ppmPulseTicks, ppmNextPulseTicks, sizeof(ppmPulseTicks));
+        isPpmFrameReady = false;
+      }
+      ppmFrameStart = OCR1B;
+      idxPpmChannel = 0;
+    }
+    else
+      idxPpmChannel++;
+    ppmChannelStart = OCR1B;
+    OCR1B = ppmChannelStart + PPM_MARK_US * SERVO_TICKS_PER_US;
+  }
+  else //end of a mark
+  {
+    *ppmPort &= ~ppmMask;
+    isPpmMark = false;
+    if(idxPpmChannel < PPM_NUM_CHANNELS)
+      OCR1B = ppmChannelStart + ppmPulseTicks[idxPpmChannel];
+    else //that was the mark ending the last channel
+      OCR1B = ppmFrameStart + (uint16_t)(PPM_FRAME_US * SERVO_TICKS_PER_US);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ISR(TIMER1_COMPA_vect)
+{
+  uint8_t _buff = servoActiveSchedule;
+  uint8_t _idx = idxServoEdge;
+
+  if(_idx >= numServos) //start of a new frame
+  {
+    if(isServoScheduleReady)
+    {
+      _buff ^= 1;
+      servoActiveSchedule = _buff;
+      isServoScheduleReady = false;
+      servoLatchMicros = micros();
+      isServoLatched = true;
+    }
+    for(uint8_t i = 0; i < numServoStartPorts; i++)
+      *servoStartPort[i] |= servoStartMask[_buff][i];
+    servoPulseStart = TCNT1; //widths from here, so only the end of a pulse can be late
+    servoFrameStart = OCR1A;
+    idxServoEdge = 0;
+    isServoFrameStarted = true;
+    OCR1A = servoPulseStart + servoEdgeTicks[_buff][0];
+    return;
+  }
+
+  //end this pulse, along with any others ending too soon after it to be given their own interrupt
+  while(1)
+  {
+    uint8_t _out = servoEdgeOutput[_buff][_idx];
+    *servoPort[_out] &= ~servoMask[_out];
+    _idx++;
+    if(_idx >= numServos || servoEdgeTicks[_buff][_idx] - servoEdgeTicks[_buff][_idx - 1] >= SERVO_MIN_EDGE_GAP)
+      break;
+    while((uint16_t)(TCNT1 - servoPulseStart) < servoEdgeTicks[_buff][_idx])
+    {
+      //wait
+    }
+  }
+
+  idxServoEdge = _idx;
+  if(_idx < numServos)
+    OCR1A = servoPulseStart + servoEdgeTicks[_buff][_idx];
+  else
+    OCR1A = servoFrameStart + servoFrameTicks;
+}
@@ -0,0 +1,65 @@
+// Link statistics kept by the receiver since power on, for telling interference from range problems.
+// Values are 16 bits and stop at their maximum rather than wrapping round. They are sent to the 
+// transmitter a page at a time, in place of some of the telemetry replies.
+
+enum {
+  //page 0, packets
+  STAT_REJECTED = 0,     //packets addressed to us that failed the packet check
+  STAT_FOREIGN,          //packets with other IDs. Other systems on the channel, or noise
+  STAT_MISSED_SLOTS,     //slots while in sync without a valid packet
+  STAT_HOP_TIMEOUTS,     //hops while out of sync because nothing came in on the channel
+  STAT_SYNC_LOSSES,
+  
+  //page 1, failsafe
+  STAT_FAILSAFES,        //times failsafe was applied
+  STAT_FAILSAFE_LAST,    //how long the last failsafe lasted, in 0.1s
+  STAT_FAILSAFE_LONGEST, //in 0.1s
+  STAT_FAILSAFE_TOTAL,   //in seconds
+  STAT_LONGEST_GAP,      //longest time between rc packets, in ms
+  
+  //page 2, eeprom. The rest of the page is sent as 0
+  STAT_EEPROM_ERRORS,    //bytes that didn't read back right after the retries, see eequeue.h
+  STAT_EEPROM_REFUSED,   //writes not queued, and so not acked, as the queue was full
+  
+  NUM_STATS
+};
+
+#define STATS_PER_PAGE  5
+#define STATS_NUM_PAGES ((NUM_STATS + STATS_PER_PAGE - 1) / STATS_PER_PAGE)
+#define STATS_PAGE_LEN  (1 + 2 * STATS_PER_PAGE) //page number, then the values msb first
+
+uint16_t stats[NUM_STATS];
+
+//--------------------------------------------------------------------------------------------------
+
+void statInc(uint8_t idx)
+{
+  if(stats[idx] < 0xFFFF)
+    stats[idx]++;
+}
+
+void statSet(uint8_t idx, uint32_t val)
+{
+  stats[idx] = val > 0xFFFF ? 0xFFFF : val;
+}
+
+void statMax(uint8_t idx, uint32_t val)
+{
+  if(val > stats[idx])
+    statSet(idx, val);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void statsBuildPage(uint8_t page, uint8_t *buff)
+{
+  //Fills buff with STATS_PAGE_LEN bytes
+  buff[0] = page;
+  for(uint8_t i = 0; i < STATS_PER_PAGE; i++)
+  {
+    uint8_t _idx = page * STATS_PER_PAGE + i;
+    uint16_t _val = _idx < NUM_STATS ? stats[_idx] : 0;
+    buff[1 + 2 * i] = _val >> 8;
+    buff[2 + 2 * i] = _val & 0xFF;
+  }
+}
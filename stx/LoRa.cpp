@@ -18,6 +18,7 @@
 #define REG_FIFO_RX_CURRENT_ADDR 0x10
 #define REG_IRQ_FLAGS            0x12
 #define REG_RX_NB_BYTES          0x13
+#define REG_MODEM_STAT           0x18
 #define REG_PKT_SNR_VALUE        0x19
 #define REG_PKT_RSSI_VALUE       0x1a
 #define REG_MODEM_CONFIG_1       0x1d
@@ -46,16 +47,27 @@
 #define MODE_TX                  0x03
 #define MODE_RX_CONTINUOUS       0x05
 #define MODE_RX_SINGLE           0x06
+#define MODE_CAD                 0x07
 
 // PA config
 #define PA_BOOST                 0x80
 
 // IRQ masks
+#define IRQ_CAD_DETECTED_MASK      0x01
+#define IRQ_CAD_DONE_MASK          0x04
 #define IRQ_TX_DONE_MASK           0x08
 #define IRQ_PAYLOAD_CRC_ERROR_MASK 0x20
 #define IRQ_RX_DONE_MASK           0x40
+#define IRQ_RX_TIMEOUT_MASK        0x80
 
-#define MAX_PKT_LENGTH           255
+// modem status
+#define MODEM_STAT_SIGNAL_DETECTED 0x01
+
+#define MAX_PKT_LENGTH           128
+
+// FIFO split
+#define FIFO_TX_BASE             0x80
+#define FIFO_RX_BASE             0x00
 
 #if (ESP8266 || ESP32)
     #define ISR_PREFIX ICACHE_RAM_ATTR
@@ -71,7 +83,15 @@ LoRaClass::LoRaClass() :
   _packetIndex(0),
   _implicitHeaderMode(0),
   _onReceive(NULL),
-  _onTxDone(NULL)
+  _onTxDone(NULL),
+  _useDio0(false),
+  _isTxBusy(false),
+  _isRxArmed(false),
+  _dio0Flag(false),
+  _dio0Micros(0),
+  _packetMicros(0),
+  _shadowValid(0),
+  _spiCount(0)
 {
   // overide Stream timeout value
   setTimeout(0);
@@ -114,6 +134,9 @@ int LoRaClass::begin(long frequency)
   // start SPI
   _spi->begin();
 
+  // registers are back to their defaults after reset
+  _shadowValid = 0;
+
   // check version
   uint8_t version = readRegister(REG_VERSION);
   if (version != 0x12) {
@@ -126,9 +149,10 @@ int LoRaClass::begin(long frequency)
   // set frequency
   setFrequency(frequency);
 
-  // set base addresses
-  writeRegister(REG_FIFO_TX_BASE_ADDR, 0);
-  writeRegister(REG_FIFO_RX_BASE_ADDR, 0);
+  // set base addresses. Each gets its own half of the FIFO so a packet being sent 
+  // never overwrites one that has been received
+  writeRegister(REG_FIFO_TX_BASE_ADDR, FIFO_TX_BASE);
+  writeRegister(REG_FIFO_RX_BASE_ADDR, FIFO_RX_BASE);
 
   // set LNA boost
   writeRegister(REG_LNA, readRegister(REG_LNA) | 0x03);
@@ -170,7 +194,7 @@ int LoRaClass::beginPacket(int implicitHeader)
   }
 
   // reset FIFO address and paload length
-  writeRegister(REG_FIFO_ADDR_PTR, 0);
+  writeRegister(REG_FIFO_ADDR_PTR, FIFO_TX_BASE);
   writeRegister(REG_PAYLOAD_LENGTH, 0);
 
   return 1;
@@ -179,9 +203,12 @@ int LoRaClass::beginPacket(int implicitHeader)
 int LoRaClass::endPacket(bool async)
 {
   
-  if ((async) && (_onTxDone))
+  if ((async) && (_onTxDone || _useDio0))
       writeRegister(REG_DIO_MAPPING_1, 0x40); // DIO0 => TXDONE
 
+  _dio0Flag = false;
+  _isTxBusy = async && _useDio0;
+
   // put in TX mode
   writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_TX);
 
@@ -192,6 +219,7 @@ int LoRaClass::endPacket(bool async)
     }
     // clear IRQ's
     writeRegister(REG_IRQ_FLAGS, IRQ_TX_DONE_MASK);
+    trackModeChange(IRQ_TX_DONE_MASK);
   }
 
   return 1;
@@ -199,13 +227,25 @@ int LoRaClass::endPacket(bool async)
 
 bool LoRaClass::isTransmitting()
 {
-  if ((readRegister(REG_OP_MODE) & MODE_TX) == MODE_TX) {
-    return true;
+  if (_useDio0) {
+    // no need to ask the radio, DIO0 tells us when it is done
+    if (_isTxBusy && _dio0Flag) {
+      _isTxBusy = false;
+      _dio0Flag = false;
+      writeRegister(REG_IRQ_FLAGS, IRQ_TX_DONE_MASK);
+      trackModeChange(IRQ_TX_DONE_MASK);
+    }
+    return _isTxBusy;
   }
 
-  if (readRegister(REG_IRQ_FLAGS) & IRQ_TX_DONE_MASK) {
+  // the op mode comes from the shadow, so only ask the radio while it is transmitting
+  if ((readRegister(REG_OP_MODE) & 0x07) == MODE_TX) {
+    if ((readRegister(REG_IRQ_FLAGS) & IRQ_TX_DONE_MASK) == 0) {
+      return true;
+    }
     // clear IRQ's
     writeRegister(REG_IRQ_FLAGS, IRQ_TX_DONE_MASK);
+    trackModeChange(IRQ_TX_DONE_MASK);
   }
 
   return false;
@@ -213,6 +253,12 @@ bool LoRaClass::isTransmitting()
 
 int LoRaClass::parsePacket(int size)
 {
+  // while listening, there is nothing to read until DIO0 rises
+  if (_useDio0 && _isRxArmed && !_dio0Flag) {
+    return 0;
+  }
+  _dio0Flag = false;
+
   int packetLength = 0;
   int irqFlags = readRegister(REG_IRQ_FLAGS);
 
@@ -225,11 +271,15 @@ int LoRaClass::parsePacket(int size)
   }
 
   // clear IRQ's
-  writeRegister(REG_IRQ_FLAGS, irqFlags);
+  if (irqFlags) {
+    writeRegister(REG_IRQ_FLAGS, irqFlags);
+    trackModeChange(irqFlags);
+  }
 
   if ((irqFlags & IRQ_RX_DONE_MASK) && (irqFlags & IRQ_PAYLOAD_CRC_ERROR_MASK) == 0) {
     // received a packet
     _packetIndex = 0;
+    _packetMicros = _useDio0 ? _dio0Micros : micros();
 
     // read packet length
     if (_implicitHeaderMode) {
@@ -241,21 +291,61 @@ int LoRaClass::parsePacket(int size)
     // set FIFO address to current RX address
     writeRegister(REG_FIFO_ADDR_PTR, readRegister(REG_FIFO_RX_CURRENT_ADDR));
 
-    // put in standby mode
-    idle();
-  } else if (readRegister(REG_OP_MODE) != (MODE_LONG_RANGE_MODE | MODE_RX_SINGLE)) {
+    // the radio keeps listening, no need to re-arm for the next packet
+  } else if (!_isRxArmed) {
     // not currently in RX mode
 
-    // reset FIFO address
-    writeRegister(REG_FIFO_ADDR_PTR, 0);
+    if (_useDio0) {
+      writeRegister(REG_DIO_MAPPING_1, 0x00); // DIO0 => RXDONE
+    }
 
-    // put in single RX mode
-    writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_SINGLE);
+    // reset FIFO addresses. The radio is in standby or sleep here, and starts writing 
+    // received packets at the RX base again once in RX
+    writeRegister(REG_FIFO_RX_BASE_ADDR, FIFO_RX_BASE);
+    writeRegister(REG_FIFO_ADDR_PTR, FIFO_RX_BASE);
+
+    // put in continuous RX mode. Unlike single RX, it doesn't time out and drop to standby 
+    // after every packet, leaving the radio deaf until the next poll
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_CONTINUOUS);
+    _isRxArmed = true;
   }
 
   return packetLength;
 }
 
+void LoRaClass::startCad()
+{
+  _isRxArmed = false;
+
+  writeRegister(REG_IRQ_FLAGS, IRQ_CAD_DONE_MASK | IRQ_CAD_DETECTED_MASK);
+  writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_CAD);
+}
+
+int LoRaClass::cadResult()
+{
+  uint8_t irqFlags = readRegister(REG_IRQ_FLAGS);
+
+  if ((irqFlags & IRQ_CAD_DONE_MASK) == 0) {
+    return -1;
+  }
+
+  // clear IRQ's
+  writeRegister(REG_IRQ_FLAGS, IRQ_CAD_DONE_MASK | IRQ_CAD_DETECTED_MASK);
+  trackModeChange(irqFlags);
+
+  return (irqFlags & IRQ_CAD_DETECTED_MASK) ? 1 : 0;
+}
+
+bool LoRaClass::isSignalDetected()
+{
+  return (readRegister(REG_MODEM_STAT) & MODEM_STAT_SIGNAL_DETECTED) != 0;
+}
+
+uint32_t LoRaClass::packetMicros()
+{
+  return _packetMicros;
+}
+
 int LoRaClass::packetRssi()
 {
   return (readRegister(REG_PKT_RSSI_VALUE) - (_frequency < 868E6 ? 164 : 157));
@@ -300,9 +390,7 @@ size_t LoRaClass::write(const uint8_t *buffer, size_t size)
   }
 
   // write data
-  for (size_t i = 0; i < size; i++) {
-    writeRegister(REG_FIFO, buffer[i]);
-  }
+  burstWrite(REG_FIFO, buffer, size);
 
   // update length
   writeRegister(REG_PAYLOAD_LENGTH, currentLength + size);
@@ -326,6 +414,32 @@ int LoRaClass::read()
   return readRegister(REG_FIFO);
 }
 
+int LoRaClass::readPacket(uint8_t *buffer, size_t maxLen)
+{
+  int len = available();
+  if (len <= 0) {
+    return 0;
+  }
+
+  // whatever doesn't fit is skipped, the FIFO pointer is reset on the next receive anyway
+  _packetIndex += len;
+  if ((size_t)len > maxLen) {
+    len = maxLen;
+  }
+
+  burstRead(REG_FIFO, buffer, len);
+
+  if (_isRxArmed) {
+    // Left alone, continuous RX writes each packet straight after the last, round all 256 bytes 
+    // and through the TX half. Go through standby so the next one goes in at the RX base
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
+    writeRegister(REG_FIFO_ADDR_PTR, FIFO_RX_BASE);
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_CONTINUOUS);
+  }
+
+  return len;
+}
+
 int LoRaClass::peek()
 {
   if (!available()) {
@@ -399,16 +513,19 @@ void LoRaClass::receive(int size)
   }
 
   writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_RX_CONTINUOUS);
+  _isRxArmed = true;
 }
 #endif
 
 void LoRaClass::idle()
 {
+  _isRxArmed = false;
   writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_STDBY);
 }
 
 void LoRaClass::sleep()
 {
+  _isRxArmed = false;
   writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_SLEEP);
 }
 
@@ -453,11 +570,26 @@ void LoRaClass::setFrequency(long frequency)
 {
   _frequency = frequency;
 
-  uint64_t frf = ((uint64_t)frequency << 19) / 32000000;
+  uint8_t frf[3];
+  getFrf(frequency, frf);
+  burstWrite(REG_FRF_MSB, frf, 3);
+}
+
+void LoRaClass::getFrf(long frequency, uint8_t *frf)
+{
+  uint64_t val = ((uint64_t)frequency << 19) / 32000000;
 
-  writeRegister(REG_FRF_MSB, (uint8_t)(frf >> 16));
-  writeRegister(REG_FRF_MID, (uint8_t)(frf >> 8));
-  writeRegister(REG_FRF_LSB, (uint8_t)(frf >> 0));
+  frf[0] = (uint8_t)(val >> 16);
+  frf[1] = (uint8_t)(val >> 8);
+  frf[2] = (uint8_t)(val >> 0);
+}
+
+void LoRaClass::setFrf(const uint8_t *frf)
+{
+  // the frequency registers can be written in standby, no need to go through sleep.
+  // _frequency is left as is, it only tells which band we are in
+  idle();
+  burstWrite(REG_FRF_MSB, frf, 3);
 }
 
 int LoRaClass::getSpreadingFactor()
@@ -635,7 +767,7 @@ void LoRaClass::dumpRegisters(Stream& out)
     out.print("0x");
     out.print(i, HEX);
     out.print(": 0x");
-    out.println(readRegister(i), HEX);
+    out.println(singleTransfer(i, 0x00), HEX);
   }
 }
 
@@ -653,12 +785,96 @@ void LoRaClass::implicitHeaderMode()
   writeRegister(REG_MODEM_CONFIG_1, readRegister(REG_MODEM_CONFIG_1) | 0x01);
 }
 
+void LoRaClass::enableDio0Interrupt()
+{
+  if (_dio0 < 0 || digitalPinToInterrupt(_dio0) == NOT_AN_INTERRUPT) {
+    return;
+  }
+
+  _useDio0 = true;
+  _isRxArmed = false;
+
+  pinMode(_dio0, INPUT);
+#ifdef SPI_HAS_NOTUSINGINTERRUPT
+  SPI.usingInterrupt(digitalPinToInterrupt(_dio0));
+#endif
+  attachInterrupt(digitalPinToInterrupt(_dio0), LoRaClass::onDio0Rise, RISING);
+}
+
+uint8_t LoRaClass::verifyShadow()
+{
+  uint8_t mismatches = 0;
+
+  for (uint8_t address = 0; address < 0x80; address++) {
+    int8_t idx = shadowIndex(address);
+    if (idx < 0 || !(_shadowValid & (1 << idx))) {
+      continue;
+    }
+    uint8_t value = singleTransfer(address & 0x7f, 0x00);
+    if (value != _shadow[idx]) {
+      mismatches++;
+      _shadow[idx] = value;
+    }
+  }
+
+  return mismatches;
+}
+
+uint16_t LoRaClass::spiTransactionCount()
+{
+  uint16_t count = _spiCount;
+  _spiCount = 0;
+  return count;
+}
+
+int8_t LoRaClass::shadowIndex(uint8_t address)
+{
+  // Registers that only change when we write them. The op mode is the exception, see trackModeChange()
+  switch (address) {
+    case REG_OP_MODE:             return 0;
+    case REG_PA_CONFIG:           return 1;
+    case REG_OCP:                 return 2;
+    case REG_LNA:                 return 3;
+    case REG_MODEM_CONFIG_1:      return 4;
+    case REG_MODEM_CONFIG_2:      return 5;
+    case REG_MODEM_CONFIG_3:      return 6;
+    case REG_DETECTION_OPTIMIZE:  return 7;
+    case REG_DETECTION_THRESHOLD: return 8;
+    case REG_DIO_MAPPING_1:       return 9;
+    case REG_PA_DAC:              return 10;
+    default:                      return -1;
+  }
+}
+
+void LoRaClass::trackModeChange(uint8_t irqFlags)
+{
+  // TX, single RX and CAD drop back to standby on their own when done
+  uint8_t mode = _shadow[0] & 0x07;
+
+  if (((irqFlags & IRQ_TX_DONE_MASK) && mode == MODE_TX) ||
+      ((irqFlags & (IRQ_RX_DONE_MASK | IRQ_RX_TIMEOUT_MASK)) && mode == MODE_RX_SINGLE) ||
+      ((irqFlags & IRQ_CAD_DONE_MASK) && mode == MODE_CAD)) {
+    _shadow[0] = MODE_LONG_RANGE_MODE | MODE_STDBY;
+  }
+}
+
 void LoRaClass::handleDio0Rise()
 {
+  if (_useDio0 && !_onReceive && !_onTxDone) {
+    // only take note, the flags are handled in isTransmitting() and parsePacket(). What follows
+    // a tx done, such as a hop, depends on the sketch's slot state and takes SPI transactions of
+    // its own, so it is left to the loop rather than done here. The loop comes round to it within
+    // a pass, a few tens of us, so there is little to win by doing it in the interrupt
+    _dio0Micros = micros();
+    _dio0Flag = true;
+    return;
+  }
+
   int irqFlags = readRegister(REG_IRQ_FLAGS);
 
   // clear IRQ's
   writeRegister(REG_IRQ_FLAGS, irqFlags);
+  trackModeChange(irqFlags);
 
   if ((irqFlags & IRQ_PAYLOAD_CRC_ERROR_MASK) == 0) {
 
@@ -686,18 +902,45 @@ void LoRaClass::handleDio0Rise()
 
 uint8_t LoRaClass::readRegister(uint8_t address)
 {
-  return singleTransfer(address & 0x7f, 0x00);
+  int8_t idx = shadowIndex(address);
+
+  if (idx >= 0 && (_shadowValid & (1 << idx))) {
+    return _shadow[idx];
+  }
+
+  uint8_t value = singleTransfer(address & 0x7f, 0x00);
+
+  if (idx >= 0) {
+    _shadow[idx] = value;
+    _shadowValid |= (1 << idx);
+  }
+
+  return value;
 }
 
 void LoRaClass::writeRegister(uint8_t address, uint8_t value)
 {
+  int8_t idx = shadowIndex(address);
+
+  // skip if unchanged. The op mode is always written as the shadow can lag behind the chip
+  if (idx > 0 && (_shadowValid & (1 << idx)) && _shadow[idx] == value) {
+    return;
+  }
+
   singleTransfer(address | 0x80, value);
+
+  if (idx >= 0) {
+    _shadow[idx] = value;
+    _shadowValid |= (1 << idx);
+  }
 }
 
 uint8_t LoRaClass::singleTransfer(uint8_t address, uint8_t value)
 {
   uint8_t response;
 
+  _spiCount++;
+
   digitalWrite(_ss, LOW);
 
   _spi->beginTransaction(_spiSettings);
@@ -710,6 +953,38 @@ uint8_t LoRaClass::singleTransfer(uint8_t address, uint8_t value)
   return response;
 }
 
+void LoRaClass::burstRead(uint8_t address, uint8_t *buffer, size_t size)
+{
+  _spiCount++;
+
+  digitalWrite(_ss, LOW);
+
+  _spi->beginTransaction(_spiSettings);
+  _spi->transfer(address & 0x7f);
+  for (size_t i = 0; i < size; i++) {
+    buffer[i] = _spi->transfer(0x00);
+  }
+  _spi->endTransaction();
+
+  digitalWrite(_ss, HIGH);
+}
+
+void LoRaClass::burstWrite(uint8_t address, const uint8_t *buffer, size_t size)
+{
+  _spiCount++;
+
+  digitalWrite(_ss, LOW);
+
+  _spi->beginTransaction(_spiSettings);
+  _spi->transfer(address | 0x80);
+  for (size_t i = 0; i < size; i++) {
+    _spi->transfer(buffer[i]);
+  }
+  _spi->endTransaction();
+
+  digitalWrite(_ss, HIGH);
+}
+
 ISR_PREFIX void LoRaClass::onDio0Rise()
 {
   LoRa.handleDio0Rise();
@@ -1,6 +1,12 @@
 /* Adapted by BUK7456 from Sandeep Mistry's LoRa library
  Changes made:
   - isTransmitting() made public
+  - Optional DIO0 interrupt for TX and RX done, see enableDio0Interrupt()
+  - Burst FIFO access and readPacket()
+  - Precomputed frequency registers, see getFrf() and setFrf()
+  - Shadow of the configuration registers, so unchanged writes and most reads skip the SPI bus
+  - parsePacket() listens in continuous RX mode, with the FIFO split between TX and RX
+  - Channel activity detection, see startCad(), and the modem status, see isSignalDetected()
  
 */
 
@@ -33,6 +39,8 @@
 #define LORA_DEFAULT_DIO0_PIN      2
 #endif
 
+#define LORA_NUM_SHADOW_REGS       11
+
 #define PA_OUTPUT_RFO_PIN          0
 #define PA_OUTPUT_PA_BOOST_PIN     1
 
@@ -49,6 +57,12 @@ public:
   bool isTransmitting(); 
   
   int parsePacket(int size = 0);
+  uint32_t packetMicros(); //time the last packet was received
+  int readPacket(uint8_t *buffer, size_t maxLen); //read the received packet in one go, extra bytes are dropped
+  
+  void startCad(); //look for lora activity on the current frequency
+  int cadResult(); //-1 while still looking, 0 nothing found, 1 activity detected
+  bool isSignalDetected(); //while receiving, the modem has found the preamble of a packet
   int packetRssi();
   float packetSnr();
   long packetFrequencyError();
@@ -74,6 +88,8 @@ public:
 
   void setTxPower(int level, int outputPin = PA_OUTPUT_PA_BOOST_PIN);
   void setFrequency(long frequency);
+  void getFrf(long frequency, uint8_t *frf); //frequency register values for setFrf()
+  void setFrf(const uint8_t *frf); //fast retune to precomputed frequency registers
   void setSpreadingFactor(int sf);
   void setSignalBandwidth(long sbw);
   void setCodingRate4(int denominator);
@@ -95,8 +111,12 @@ public:
   void setPins(int ss = LORA_DEFAULT_SS_PIN, int reset = LORA_DEFAULT_RESET_PIN, int dio0 = LORA_DEFAULT_DIO0_PIN);
   void setSPI(SPIClass& spi);
   void setSPIFrequency(uint32_t frequency);
+  
+  void enableDio0Interrupt(); //let DIO0 signal TX and RX done instead of polling the irq flags
 
   void dumpRegisters(Stream& out);
+  uint8_t verifyShadow(); //compares the register shadow with the chip, returns the number of mismatches
+  uint16_t spiTransactionCount(); //number of SPI transactions since the last call
 
 private:
   void explicitHeaderMode();
@@ -112,6 +132,10 @@ private:
   uint8_t readRegister(uint8_t address);
   void writeRegister(uint8_t address, uint8_t value);
   uint8_t singleTransfer(uint8_t address, uint8_t value);
+  int8_t shadowIndex(uint8_t address);
+  void trackModeChange(uint8_t irqFlags);
+  void burstRead(uint8_t address, uint8_t *buffer, size_t size);
+  void burstWrite(uint8_t address, const uint8_t *buffer, size_t size);
 
   static void onDio0Rise();
 
@@ -126,6 +150,15 @@ private:
   int _implicitHeaderMode;
   void (*_onReceive)(int);
   void (*_onTxDone)();
+  bool _useDio0;
+  bool _isTxBusy;
+  bool _isRxArmed;
+  volatile bool _dio0Flag;
+  volatile uint32_t _dio0Micros;
+  uint32_t _packetMicros;
+  uint8_t _shadow[LORA_NUM_SHADOW_REGS];
+  uint16_t _shadowValid; //bit per shadowed register
+  uint16_t _spiCount;
 };
 
 extern LoRaClass LoRa;
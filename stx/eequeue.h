@@ -0,0 +1,109 @@
+// Background EEPROM writer for the Atmega328p. Writes are queued and done a byte at a time from 
+// the EEPROM ready interrupt, so the caller never waits the 3.3ms each byte takes to write. 
+// Bytes that already hold the value are skipped. Each byte is read back once written and written 
+// again if it doesn't match, up to EEQ_MAX_RETRIES times.
+// Reading back something still in the queue gives the old value, call eeqWait() first.
+
+#define EEQ_SIZE         24 //bytes
+#define EEQ_MAX_RETRIES  2
+
+uint16_t eeqAddr[EEQ_SIZE];
+uint8_t eeqData[EEQ_SIZE];
+volatile uint8_t idxEeqHead = 0; //next byte to write
+volatile uint8_t idxEeqTail = 0; //next free entry
+volatile bool isEeqWriting = false; //the byte at the head is being written
+uint8_t eeqRetries = 0;
+volatile uint8_t eeqErrorCount = 0; //bytes that still didn't match after the retries
+
+//--------------------------------------------------------------------------------------------------
+
+bool eeqPut(uint16_t addr, const void *data, uint8_t len)
+{
+  //Queues len bytes to be written starting at addr. Returns false, queueing nothing, if there 
+  //isn't room for all of them
+  const uint8_t *_src = (const uint8_t *)data;
+  
+  uint8_t _sreg = SREG;
+  cli();
+  uint8_t _used = (idxEeqTail + EEQ_SIZE - idxEeqHead) % EEQ_SIZE;
+  if(_used + len > EEQ_SIZE - 1)
+  {
+    SREG = _sreg;
+    return false;
+  }
+  uint8_t _tail = idxEeqTail;
+  for(uint8_t i = 0; i < len; i++)
+  {
+    eeqAddr[_tail] = addr + i;
+    eeqData[_tail] = _src[i];
+    _tail = (_tail + 1) % EEQ_SIZE;
+  }
+  idxEeqTail = _tail;
+  EECR |= _BV(EERIE); //the interrupt fires right away if the eeprom is free
+  SREG = _sreg;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool eeqIsDone()
+{
+  //True once everything queued has been written
+  return idxEeqHead == idxEeqTail && !isEeqWriting;
+}
+
+void eeqWait()
+{
+  while(!eeqIsDone())
+  {
+    //wait
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ISR(EE_READY_vect)
+{
+  uint8_t _head = idxEeqHead;
+  
+  //the last write is done. Check it
+  if(isEeqWriting)
+  {
+    isEeqWriting = false;
+    EEAR = eeqAddr[_head];
+    EECR |= _BV(EERE);
+    if(EEDR == eeqData[_head] || eeqRetries >= EEQ_MAX_RETRIES)
+    {
+      if(EEDR != eeqData[_head])
+        eeqErrorCount++;
+      eeqRetries = 0;
+      _head = (_head + 1) % EEQ_SIZE;
+    }
+    else
+      eeqRetries++;
+  }
+  
+  //skip bytes that already hold the value
+  while(_head != idxEeqTail)
+  {
+    EEAR = eeqAddr[_head];
+    EECR |= _BV(EERE);
+    if(EEDR != eeqData[_head])
+      break;
+    _head = (_head + 1) % EEQ_SIZE;
+  }
+  idxEeqHead = _head;
+  
+  if(_head == idxEeqTail) //all done
+  {
+    EECR &= ~_BV(EERIE);
+    return;
+  }
+  
+  //start writing the next byte
+  EEAR = eeqAddr[_head];
+  EEDR = eeqData[_head];
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+  isEeqWriting = true;
+}
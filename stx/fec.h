@@ -0,0 +1,90 @@
+// Reed-Solomon code over GF(256) with 2 parity bytes.
+// Corrects any single corrupted byte in a codeword (which covers a burst of flipped bits 
+// within that byte) and detects most other errors. 
+// Field polynomial is x^8 + x^4 + x^3 + x^2 + 1 (0x11D), with generator 2.
+
+#define FEC_PARITY_LEN  2
+
+enum {
+  FEC_NO_ERROR = 0,
+  FEC_CORRECTED,
+  FEC_UNCORRECTABLE
+};
+
+uint8_t gfMul2(uint8_t a)
+{
+  return (a & 0x80) ? ((a << 1) ^ 0x1D) : (a << 1);
+}
+
+uint8_t gfMul(uint8_t a, uint8_t b)
+{
+  uint8_t rslt = 0;
+  while(b)
+  {
+    if(b & 0x01)
+      rslt ^= a;
+    a = gfMul2(a);
+    b >>= 1;
+  }
+  return rslt;
+}
+
+/* The parity bytes p0 and p1 are sent after the data but are treated as the first two symbols 
+of the codeword, so the codeword is p0, p1, data0, data1, ... with symbol i weighted by 2^i.
+A valid codeword has both syndromes (plain sum and weighted sum) equal to zero. */
+
+void fecEncode(uint8_t *buff, uint8_t dataLen)
+{
+  //Appends FEC_PARITY_LEN bytes to the data. The buffer should have room for them
+  uint8_t _sum = 0;
+  uint8_t _weightedSum = 0;
+  for(int8_t i = dataLen - 1; i >= 0; i--)
+  {
+    _sum ^= buff[i];
+    _weightedSum = gfMul2(_weightedSum) ^ buff[i];
+  }
+  _weightedSum = gfMul2(gfMul2(_weightedSum)); //data starts at the third symbol
+  
+  //Solve p0 + p1 = _sum and p0 + 2*p1 = _weightedSum. 0xF4 is the inverse of 3
+  uint8_t _p1 = gfMul(_sum ^ _weightedSum, 0xF4);
+  buff[dataLen] = _sum ^ _p1;
+  buff[dataLen + 1] = _p1;
+}
+
+uint8_t fecDecode(uint8_t *buff, uint8_t len)
+{
+  //Checks and corrects the codeword in place. len includes the parity bytes
+  if(len <= FEC_PARITY_LEN)
+    return FEC_UNCORRECTABLE;
+  
+  uint8_t _dataLen = len - FEC_PARITY_LEN;
+  uint8_t _s0 = 0;
+  uint8_t _s1 = 0;
+  for(int8_t i = _dataLen - 1; i >= 0; i--)
+  {
+    _s0 ^= buff[i];
+    _s1 = gfMul2(_s1) ^ buff[i];
+  }
+  _s0 ^= buff[_dataLen] ^ buff[_dataLen + 1];
+  _s1 = gfMul2(_s1) ^ buff[_dataLen + 1];
+  _s1 = gfMul2(_s1) ^ buff[_dataLen];
+  
+  if(_s0 == 0 && _s1 == 0)
+    return FEC_NO_ERROR;
+  if(_s0 == 0 || _s1 == 0) //more than one symbol in error
+    return FEC_UNCORRECTABLE;
+  
+  //A single error e at symbol j gives _s0 = e and _s1 = e * 2^j. Find j
+  uint8_t _val = _s0;
+  for(uint8_t j = 0; j < len; j++)
+  {
+    if(_val == _s1)
+    {
+      uint8_t _idx = (j < FEC_PARITY_LEN) ? _dataLen + j : j - FEC_PARITY_LEN;
+      buff[_idx] ^= _s0;
+      return FEC_CORRECTED;
+    }
+    _val = gfMul2(_val);
+  }
+  return FEC_UNCORRECTABLE;
+}
@@ -19,7 +19,9 @@
 #include <SPI.h>
 #include "LoRa.h"
 #include "crc8.h"
+#include "fec.h"
 #include <EEPROM.h>
+#include "eequeue.h"
 #include "NonBlockingRtttl.h"
 
 // Pins 
@@ -35,6 +37,8 @@
 #define PIN_POWER_OFF_SENSE A1
 #define PIN_POWER_LATCH     A0
 
+#define PIN_LORA_DIO0       -1  //2 or 3 if DIO0 of the lora module is wired. -1 to poll over SPI instead
+
 //--------------- Freq allocation --------------------
 
 /* LPD433 Band ITU region 1
@@ -43,22 +47,80 @@ total of 69 freq channels. Channel_1 is 433.075 Mhz and Channel_69 is 434.775Mhz
 All our communications have to occur on any of these 69 channels. 
 */
 
-/* Frequency list to pick from. The separation here is 300kHz (250kHz total lora bw + 
-50kHz guard band.*/
-uint32_t freqList[] = {433175000, 433475000, 433775000, 434075000, 434375000, 434675000};
+/* Channel plan. The channels are spread evenly across the band, keeping the whole lora bandwidth 
+of each channel within the band edges. With the values here we get 6 channels. 
+Bind is always done on channel 0. */
+#define FREQ_BAND_START    433050000UL //lower band edge in Hz
+#define FREQ_BAND_END      434790000UL //upper band edge in Hz
+#define FREQ_CH_BANDWIDTH  250000UL    //lora signal bandwidth
+#define FREQ_CH_SPACING    290000UL    //min separation between channel centres. Bandwidth + guard band
+#define NUM_FREQ_CHANNELS  ((FREQ_BAND_END - FREQ_BAND_START - FREQ_CH_BANDWIDTH) / FREQ_CH_SPACING + 1)
+
+/* Hop sequence. This is generated from a seed (see generateHopSequence()) so both the transmitter 
+and the receiver produce the same sequence and only the seed has to be exchanged on bind. The seed is 
+picked when we receive a bind command from the master mcu and is stored to eeprom so we don't have 
+to rebind each time we switch on the transmitter.  */
+#define HOP_SEQUENCE_LENGTH  48 
+
+uint8_t hopSequence[HOP_SEQUENCE_LENGTH]; //channel numbers in the channel plan
+uint8_t channelFrf[NUM_FREQ_CHANNELS][3]; //precomputed lora frequency registers of each channel
+uint16_t hopSeed = 0;
+uint8_t idxHopSequence = 0; 
+
+//--------------- Slot timing ------------------------
+
+/* Packets to the receiver are sent at the start of fixed length slots, and we move on to the next 
+hop channel once each slot is done, whether or not anything was sent in it. This lets the receiver 
+predict when and where the next packet is coming, so it can keep hopping in step with us even when
+it misses packets. A reply from the receiver (telemetry, receiver config) takes up the slot after 
+the one carrying the request. */
+
+/* Rate profiles. The fast profile is the one normally used. The long range profile uses SF9, which 
+can be received about 5dB further down than SF7, but packets take 3.6 times as long so the slots are 
+longer and fewer rc packets get through. The profile is only changed in automatic power mode with 
+long range allowed by the master mcu, where it is treated as one step above the max power level. See 
+adjustAutoPower() and transmitRateProfile(). Bind is always done with the fast profile. */
+enum {
+  RATE_PROFILE_FAST,
+  RATE_PROFILE_LONG_RANGE
+};
+
+#define SF_FAST             7
+#define SF_LONG_RANGE       9
+#define LONG_RANGE_GAIN_DB  5 //how much further down the long range profile receives
+
+/* Slot periods in microseconds. Should match the receiver. Each must be longer than the airtime of 
+the largest packet plus SLOT_MARGIN_US, which is checked where MAX_PACKET_SIZE is defined */
+#define SLOT_PERIOD_FAST_US        30000UL
+#define SLOT_PERIOD_LONG_RANGE_US  96000UL
 
-uint8_t fhss_schema[3] = {0, 1, 2}; /* Index in freqList. Frequencies to use for hopping. 
-These are changed when we receive a bind command from the master mcu. This schema also gets stored 
-to eeprom so we don't have to rebind each time we switch on the transmitter. */
+uint8_t rateProfile = RATE_PROFILE_FAST;
+uint8_t requestedRateProfile = RATE_PROFILE_FAST; //the profile adjustAutoPower() wants
+uint32_t slotPeriodUs = SLOT_PERIOD_FAST_US;
 
-uint8_t idx_fhss_schema = 0; 
+#define SLOT_MARGIN_US  3000UL /* time left in a slot after the largest packet, for the tx done to be 
+picked up, the hop, and the receiver's slot timing being a little off ours */
+
+/* Lora airtime in microseconds at BW 250kHz, CR 4/5 with an explicit header, as given in the 
+Semtech SX127x datasheet. Holds for SF7 to SF11. Symbols are 4 * 2^sf us, 512us at SF7. There are 
+12.25 preamble symbols, and the payload goes out in blocks of 5 symbols holding 4 * sf bits each, 
+after 8 symbols carrying the header.
+With the payload crc off, as set up here, 19 and 21 byte packets both take 38 symbols or 25.7ms at 
+SF7. With the crc on, 21 bytes would take 43 symbols or 28.3ms. At SF9, 21 bytes take 33 symbols or 
+92.7ms. */
+#define LORA_PAYLOAD_SYMBOLS(len, crc, sf)  (8 + ((8 * (len) + 16 * (crc) + 27) / (4 * (sf))) * 5)
+#define LORA_AIRTIME_US(len, crc, sf)  ((49UL + 4UL * LORA_PAYLOAD_SYMBOLS(len, crc, sf)) << (sf))
+
+uint32_t nextSlotMicros = 0;
+uint32_t slotCount = 0;  //incremented at the start of every slot
+bool isNewSlot = false;  //true during the loop iteration in which a slot starts
 
 //-------------- EEprom stuff --------------------
-#define EE_INITFLAG         0xBB 
+#define EE_INITFLAG         0xBC 
 #define EE_ADR_INIT_FLAG    0
 #define EE_ADR_TX_ID        1
 #define EE_ADR_RX_ID        2
-#define EE_ADR_FHSS_SCHEMA  3
+#define EE_ADR_HOP_SEED     3
 
 //-------------- Audio ---------------------------
 enum{  
@@ -104,9 +166,29 @@ const char* trimMovedSound = "trimMove:d=4,o=4,b=250:16a#7";
 
 //------------------------------------------------
 
-#define MAX_PACKET_SIZE  19
+/* Forward error correction on rc frames. Adds FEC_PARITY_LEN bytes to each rc packet so that the 
+receiver can correct a corrupted byte rather than drop the whole frame. The receiver tells fec frames 
+apart by their size, so this only needs setting here. Comment out to disable. */
+#define ENABLE_RC_FEC
+
+/* Redundancy records on rc frames. When enabled, frames in which the sticks moved carry the change 
+from the previous frame in place of a secondary channel group, so the receiver can rebuild the 
+previous frame if it was lost. Secondary groups are then sent less often while the sticks are 
+moving. Comment out to disable. */
+//#define ENABLE_RC_REDUNDANCY
+
+#define MAX_FRAMES_BETWEEN_GROUPS  4 //with redundancy records, send a secondary group at least this often
+
+#define MAX_PACKET_SIZE  (19 + FEC_PARITY_LEN)
 uint8_t packet[MAX_PACKET_SIZE];
 
+#if SLOT_PERIOD_FAST_US < LORA_AIRTIME_US(MAX_PACKET_SIZE, 0, SF_FAST) + SLOT_MARGIN_US
+  #error "SLOT_PERIOD_FAST_US is too short for the largest packet"
+#endif
+#if SLOT_PERIOD_LONG_RANGE_US < LORA_AIRTIME_US(MAX_PACKET_SIZE, 0, SF_LONG_RANGE) + SLOT_MARGIN_US
+  #error "SLOT_PERIOD_LONG_RANGE_US is too short for the largest packet"
+#endif
+
 enum{
   PAC_BIND                   = 0x0,
   PAC_ACK_BIND               = 0x1,
@@ -115,6 +197,10 @@ enum{
   PAC_ACK_OUTPUT_CH_CONFIG   = 0x4,
   PAC_RC_DATA                = 0x5,
   PAC_TELEMETRY              = 0x6,
+  PAC_LINK_STATS             = 0x7,
+  PAC_SENSORS                = 0x8,
+  PAC_SET_RATE_PROFILE       = 0x9,
+  PAC_ACK_RATE_PROFILE       = 0xA,
 };
 
 uint8_t transmitterID = 0; //set on bind
@@ -127,56 +213,132 @@ unsigned long totalPacketsSent = 0;
 bool isRequestingBind = false;
 
 uint8_t bindStatusCode = 0; //1 on success, 2 on fail
+bool isBindSavePending = false; //bind succeeded, success is reported once it is saved to eeprom
+uint8_t bindSaveErrorCount = 0; //eeqErrorCount when the save was queued
 
 bool rfEnabled = false;
 
 uint8_t idxRFPowerLevel = 0;
 
+//--------------- Automatic power control ----------
+
+/* The rf power setting from the master mcu is either a fixed level (0 to 4), or automatic with a 
+maximum level (5 to 7 give a maximum of level 2 to 4). In automatic mode the level is adjusted each 
+time telemetry comes in, from the link quality and the link margin in both directions. The receiver 
+follows our level, so both ends move together. 
+Going up is immediate, going down needs several good reports in a row. Together with the gap 
+between the margin thresholds (much more than a power step) this keeps the level from hunting. 
+If the master mcu allows it, the long range rate profile is the step above the max level. */
+#define NUM_RF_POWER_LEVELS  5
+#define RF_POWER_AUTO_FIRST  5  //first setting value that is automatic
+
+#define APC_MARGIN_LOW     10 //dB. Raise power if the margin in either direction falls below this
+#define APC_MARGIN_HIGH    25 //dB. Margin in both directions needed before lowering power
+#define APC_LQ_LOW         90 //percent. Raise power if link quality falls below this
+#define APC_LQ_HIGH        98 //percent. Link quality needed before lowering power
+#define APC_GOOD_REPORTS   3  //consecutive good telemetry reports needed before lowering power
+
+uint8_t rfPowerSetting = 0xFF;
+bool isLongRangeAllowed = false; //set by the master mcu. Lets automatic mode use the long range profile
+
 bool isFailsafeData = false;
 
 bool isReadOutputChConfig = false;
 bool isSetOutputChConfig = false;
 
+/* Number of logical rc channels. Should match NUM_PRP_CHANNLES in the master mcu and 
+NUM_RC_CHANNELS in the receiver. Max 17.
+The first NUM_PRIMARY_CHANNELS are sent in every rc frame. The remaining (secondary) channels are 
+grouped in pairs and one group is appended to each frame. See transmitRCdata() */
+#define NUM_RC_CHANNELS        16 
+#define NUM_PRIMARY_CHANNELS   9   //## Leave this. Fixed by the air protocol
+#define NUM_SECONDARY_GROUPS   ((NUM_RC_CHANNELS - NUM_PRIMARY_CHANNELS + 1) / 2)
+
+#define NUM_RX_OUTPUT_CHANNELS 9   //Number of outputs on the receiver. Should match the receiver
+
 bool hasPendingRCData = false;
-uint16_t ch1to9[9];
+uint16_t chData[NUM_RC_CHANNELS];
+
+uint16_t prevFrameVals[NUM_PRIMARY_CHANNELS]; //primary channels in the last non failsafe frame sent
+bool frameToggle = false; //flips with every non failsafe frame. Lets the receiver detect a lost frame
 
 enum {
   MODE_BIND, 
   MODE_RC_DATA, 
   MODE_GET_TELEM,
   MODE_GET_RECEIVER_CONFIG,
-  MODE_SEND_RECEIVER_CONFIG
+  MODE_SEND_RECEIVER_CONFIG,
+  MODE_SET_RATE_PROFILE
 };
 uint8_t operatingMode = MODE_RC_DATA;
 
 bool requestPoweroff = false;
 
-uint8_t outputChConfig[9];
+uint8_t outputChConfig[NUM_RX_OUTPUT_CHANNELS];
 bool gotOutputChConfig = false;
 
 uint8_t receiverConfigStatusCode = 0; //1 on success, 2 on fail
 
-unsigned long telemModeEntryTime = 0;
+uint32_t telemModeEntrySlot = 0;
 
-#define TIMEOUT_MODE_GET_TELEM   25
+bool isRequestingTelemetry = false; //set on the rc frame just before a telemetry slot
 
-bool isRequestingTelemetry = false; 
+/* One in every telemRatio slots is given to the receiver for telemetry. Set by the master mcu. 
+Allowed values 2, 4, 8, 16, 32, 64 */
+uint8_t telemRatio = 16; 
+
+unsigned long telemBytesReceived = 0; //telemetry payload bytes
+unsigned long telemSlotsUsed = 0;     //slots given up for telemetry
 
 uint8_t receiverPacketRate = 0;
+uint8_t receiverSlowestChRate = 0; //update rate of the least updated channel, as seen by receiver
 
 uint16_t telem_volts = 0x0FFF;  // in 10mV, sent by receiver with 12bits.  0x0FFF "No data"
 
+//Link. Rssi values are in -dBm, with 0 meaning "No data". Snr values are in dB
+uint8_t receiverLinkQuality = 0; //percentage of slots in which the receiver got a valid packet
+uint8_t receiverCrcFailRate = 0; //corrupted packets per second at receiver
+uint8_t receiverFecFixRate = 0;  //rc packets per second corrected by fec at receiver
+uint8_t receiverRecoveryRate = 0; //lost rc frames per second rebuilt from redundancy records
+uint8_t receiverOutputDelay = 0;  //packet arrival to outputs updated, in 0.1ms. 0 means no data
+uint8_t receiverProcessTime = 0;  //packet arrival to channels decoded, in 0.1ms. 0 means no data
+uint8_t receiverFailsafeDelay = 0; //last packet to failsafe on the outputs, in 10ms. 0 means no data
+
+//Last page of link statistics from the receiver, passed on as is. Page number 0xFF means none yet
+#define RX_STATS_PAGE_LEN  11
+uint8_t receiverStatsPage[RX_STATS_PAGE_LEN] = {0xFF};
+
+//Last page of sensor values from the receiver, passed on as is after a length byte. Length 0 means 
+//none, or that telemetry has been lost
+#define RX_SENSOR_PAGE_LEN  12
+uint8_t receiverSensorPage[1 + RX_SENSOR_PAGE_LEN] = {0};
+uint8_t uplinkRssi = 0;  
+int8_t  uplinkSnr = 0;
+uint8_t downlinkRssi = 0;
+int8_t  downlinkSnr = 0;
+
 
 void doSerialCommunication();
 void readPowerSwitch();
 void powerOff();
 void playTones();
 void doRfCommunication();
-void hop();
+void hopToSlot(uint32_t slot);
+uint32_t getChannelFreq(uint8_t channel);
+void generateHopSequence(uint16_t seed);
 void bind();
 void transmitRCdata();
 void transmitReceiverConfig();
 void getReceiverConfig();
+void getTelemetry();
+void transmitRateProfile();
+void setRateProfile(uint8_t profile);
+uint8_t getNextSecondaryGroup(bool isFailsafe);
+void adjustAutoPower(bool gotTelemetry);
+int8_t getLinkMargin(uint8_t rssi, int8_t snr);
+bool writeRedundancyRecord(uint8_t *buff);
+void writeBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits, uint16_t val);
+uint16_t readBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits);
 uint8_t buildPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t *dataBuff, uint8_t dataLen);
 bool checkPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t *packetBuff, uint8_t packetSize);
 
@@ -204,26 +366,32 @@ void setup()
   {
     EEPROM.write(EE_ADR_TX_ID, transmitterID);
     EEPROM.write(EE_ADR_RX_ID, receiverID);
-    EEPROM.put(EE_ADR_FHSS_SCHEMA, fhss_schema);
+    EEPROM.put(EE_ADR_HOP_SEED, hopSeed);
     EEPROM.write(EE_ADR_INIT_FLAG, EE_INITFLAG);
   }
   
   // Read from EEPROM
   transmitterID = EEPROM.read(EE_ADR_TX_ID);
   receiverID = EEPROM.read(EE_ADR_RX_ID);
-  EEPROM.get(EE_ADR_FHSS_SCHEMA, fhss_schema);
+  EEPROM.get(EE_ADR_HOP_SEED, hopSeed);
+  
+  generateHopSequence(hopSeed);
   
   //init serial port
   Serial.begin(115200);
   delay(200);
   
   //setup lora module
-  LoRa.setPins(10, 8); 
-  if (LoRa.begin(freqList[0]))
+  for(uint8_t i = 0; i < NUM_FREQ_CHANNELS; i++)
+    LoRa.getFrf(getChannelFreq(i), channelFrf[i]);
+  LoRa.setPins(10, 8, PIN_LORA_DIO0); 
+  if (LoRa.begin(getChannelFreq(0)))
   {
-    LoRa.setSpreadingFactor(7); 
+    LoRa.setSpreadingFactor(SF_FAST); 
     LoRa.setCodingRate4(5);
     LoRa.setSignalBandwidth(250E3);
+    LoRa.disableCrc(); //packets carry their own crc8. Keeps them short enough for the slot
+    LoRa.enableDio0Interrupt(); //does nothing if not wired
     radioInitialised = true;
   }
   else
@@ -243,6 +411,13 @@ void loop()
   ///----------- RF COMMUNICATIONS ------------------------
   doRfCommunication();
 
+  ///----------- REPORT BIND ONCE SAVED --------------------
+  if(isBindSavePending && eeqIsDone())
+  {
+    isBindSavePending = false;
+    bindStatusCode = (eeqErrorCount == bindSaveErrorCount) ? 1 : 2; //fail if it didn't save
+  }
+
 }
 
 //==================================================================================================
@@ -269,11 +444,12 @@ void doSerialCommunication()
   */
   
   /* Status1
-      bit0  failsafe data
-      bit1  write receiver config
-      bit2  get receiver config 
-      bit3  get telemetry
-      bit4  enter bind mode 
+      bit0    failsafe data
+      bit1    write receiver config
+      bit2    get receiver config 
+      bit3    allow the long range rate profile in automatic power mode
+      bit4    enter bind mode 
+      bit5-7  telemetry ratio. Ratio is 1:2, 1:4, ... 1:64 for values 0 to 5
   */
 
 
@@ -312,7 +488,15 @@ void doSerialCommunication()
  
   uint8_t status0 = tmpBuff[0];
   
-  idxRFPowerLevel = status0 & 0x07;
+  uint8_t _rfPowerSetting = status0 & 0x07;
+  if(_rfPowerSetting != rfPowerSetting)
+  {
+    rfPowerSetting = _rfPowerSetting;
+    if(rfPowerSetting >= RF_POWER_AUTO_FIRST) //start automatic mode at the max, and work down
+      idxRFPowerLevel = rfPowerSetting - RF_POWER_AUTO_FIRST + 2;
+    else
+      idxRFPowerLevel = rfPowerSetting;
+  }
   
   rfEnabled = (status0 >> 3) & 0x01; 
   
@@ -324,6 +508,15 @@ void doSerialCommunication()
   //--- status byte 1 ---
   
   uint8_t status1 = tmpBuff[1];
+  
+  uint8_t _idxTelemRatio = (status1 >> 5) & 0x07;
+  if(_idxTelemRatio > 5)
+    _idxTelemRatio = 5;
+  telemRatio = 2 << _idxTelemRatio;
+  
+  isLongRangeAllowed = (status1 >> 3) & 0x01;
+  if(!isLongRangeAllowed || rfPowerSetting < RF_POWER_AUTO_FIRST) //go back if no longer allowed
+    requestedRateProfile = RATE_PROFILE_FAST;
 
   if((status1 >> 4) & 0x01)
   {
@@ -336,23 +529,16 @@ void doSerialCommunication()
   else if((status1 >> 1) & 0x01)
   {
     isSetOutputChConfig = true;
-    for(uint8_t i = 0; i < 9; i++)
+    for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; i++)
       outputChConfig[i] = tmpBuff[3 + i];
   }
   else
   {
     isFailsafeData = status1 & 0x01;
     
-    uint8_t prevState_TelemetryRequest = isRequestingTelemetry;
-    isRequestingTelemetry = (status1 >> 3) & 0x01;
-    if(prevState_TelemetryRequest == 1) //skip this data
-      hasPendingRCData = false;
-    else
-    {
-      hasPendingRCData = true;
-      for(uint8_t i = 0; i < 9; i++)
-        ch1to9[i] = (uint16_t)tmpBuff[3 + i * 2] << 8 | (uint16_t)tmpBuff[4 + i * 2]; //combine every two bytes
-    }
+    hasPendingRCData = true;
+    for(uint8_t i = 0; i < NUM_RC_CHANNELS; i++)
+      chData[i] = readBits(tmpBuff + 3, i * 10, 10); //10 bits per channel
   }
     
 
@@ -376,14 +562,36 @@ void doSerialCommunication()
   Byte2     Transmitter packet rate
   Byte3     Packet rate at receiver side
   Byte4-5   Voltage telemetry
-  Byte6-14  Receiver channel config Ch1 to Ch9
-  Byte15    CRC8
+  Byte6     Update rate of the slowest channel at receiver side
+  Byte7     Telemetry payload bytes received per second
+  Byte8     Rc packets per second given up for telemetry
+  Byte9     Link quality at receiver side, in percent
+  Byte10    Uplink rssi, as -dBm. 0 is "No data"
+  Byte11    Uplink snr, in dB. Signed
+  Byte12    Corrupted packets per second at receiver side
+  Byte13    Downlink rssi, as -dBm. 0 is "No data"
+  Byte14    Downlink snr, in dB. Signed
+  Byte15    Rc packets per second corrected by fec at receiver side
+  Byte16    Lost rc frames per second rebuilt from redundancy records at receiver side
+  Byte17    Bits 2-0 --> Rf power level in use
+            Bit 7    --> Long range rate profile in use
+  Byte18    Packet arrival to outputs updated at receiver side, in 0.1ms. 0 is "No data"
+  Byte19    Packet arrival to channels decoded at receiver side, in 0.1ms. 0 is "No data"
+  Byte20    Last packet to failsafe on the outputs at receiver side, in 10ms. 0 is "No data"
+  Byte21    Receiver link statistics page number. 0xFF is "No data"
+  Byte22-31 Receiver link statistics, 5 values of 2 bytes each, msb first
+  Byte32    Length of the receiver sensor page that follows. 0 is "No data"
+  Byte33-44 Receiver sensor page, up to 4 entries of 3 bytes. See protocols.txt
+  Byte45-n  Receiver channel config, 1 byte per output. n is 44 + NUM_RX_OUTPUT_CHANNELS
+  Byte n+1  CRC8
   */
 
   //calc transmitted packets per second
   static uint8_t txPktsPs = 0;
   static unsigned long lastTotalPacketsSent = 0;
   static unsigned long pktsPrevCalcMillis = 0;
+  static uint8_t telemBytesPs = 0;
+  static uint8_t telemSlotsPs = 0;
   unsigned long ttElapsed = millis() - pktsPrevCalcMillis;
   if (ttElapsed >= 1000)
   {
@@ -392,6 +600,16 @@ void doSerialCommunication()
     pps /= ttElapsed;
     txPktsPs = pps & 0xFF;
     lastTotalPacketsSent = totalPacketsSent;
+    
+    //telemetry bandwidth and the cost of it
+    static unsigned long lastTelemBytesReceived = 0;
+    static unsigned long lastTelemSlotsUsed = 0;
+    unsigned long _bytesPs = ((telemBytesReceived - lastTelemBytesReceived) * 1000) / ttElapsed;
+    unsigned long _slotsPs = ((telemSlotsUsed - lastTelemSlotsUsed) * 1000) / ttElapsed;
+    telemBytesPs = _bytesPs > 0xFF ? 0xFF : _bytesPs;
+    telemSlotsPs = _slotsPs > 0xFF ? 0xFF : _slotsPs;
+    lastTelemBytesReceived = telemBytesReceived;
+    lastTelemSlotsUsed = telemSlotsUsed;
   }
   
   // read the 3 position switch. upperPos is 0, lowerPos is 1, midPos is 2
@@ -413,7 +631,7 @@ void doSerialCommunication()
   readPowerSwitch();
   
   //send 
-  uint8_t dataToSend[16];
+  uint8_t dataToSend[23 + RX_STATS_PAGE_LEN + RX_SENSOR_PAGE_LEN + NUM_RX_OUTPUT_CHANNELS];
   memset(dataToSend, 0, sizeof(dataToSend));
   
   dataToSend[0] |= (gotOutputChConfig & 0x01) << 7;
@@ -428,11 +646,28 @@ void doSerialCommunication()
   dataToSend[3] = receiverPacketRate;
   dataToSend[4] = (telem_volts >> 8) & 0xFF;
   dataToSend[5] = telem_volts & 0xFF;
+  dataToSend[6] = receiverSlowestChRate;
+  dataToSend[7] = telemBytesPs;
+  dataToSend[8] = telemSlotsPs;
+  dataToSend[9] = receiverLinkQuality;
+  dataToSend[10] = uplinkRssi;
+  dataToSend[11] = uplinkSnr;
+  dataToSend[12] = receiverCrcFailRate;
+  dataToSend[13] = downlinkRssi;
+  dataToSend[14] = downlinkSnr;
+  dataToSend[15] = receiverFecFixRate;
+  dataToSend[16] = receiverRecoveryRate;
+  dataToSend[17] = idxRFPowerLevel | (rateProfile << 7);
+  dataToSend[18] = receiverOutputDelay;
+  dataToSend[19] = receiverProcessTime;
+  dataToSend[20] = receiverFailsafeDelay;
+  memcpy(dataToSend + 21, receiverStatsPage, RX_STATS_PAGE_LEN);
+  memcpy(dataToSend + 21 + RX_STATS_PAGE_LEN, receiverSensorPage, 1 + RX_SENSOR_PAGE_LEN);
   
-  for(uint8_t i = 0; i < 9; i++)
-    dataToSend[6 + i] = outputChConfig[i];
+  for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; i++)
+    dataToSend[22 + RX_STATS_PAGE_LEN + RX_SENSOR_PAGE_LEN + i] = outputChConfig[i];
   
-  dataToSend[15] = crc8Maxim(dataToSend, 15);
+  dataToSend[sizeof(dataToSend) - 1] = crc8Maxim(dataToSend, sizeof(dataToSend) - 1);
   
   Serial.write(dataToSend, sizeof(dataToSend));
   
@@ -568,6 +803,17 @@ void doRfCommunication()
     return;
   }
   
+  //--- slot timing ---
+  isNewSlot = false;
+  if((int32_t)(micros() - nextSlotMicros) >= 0)
+  {
+    isNewSlot = true;
+    ++slotCount;
+    nextSlotMicros += slotPeriodUs;
+    if((int32_t)(micros() - nextSlotMicros) >= 0) //fell far behind, eg after binding. Restart timing
+      nextSlotMicros = micros() + slotPeriodUs;
+  }
+  
   if(!LoRa.isTransmitting())
   {
     //--- set power level ---
@@ -583,27 +829,30 @@ void doRfCommunication()
     }
     
     //--- Change modes ---
-    if(isRequestingBind)
-    {
-      operatingMode = MODE_BIND;
-      isRequestingBind = false;
-    }
-    else if(isReadOutputChConfig && operatingMode != MODE_BIND)
+    //Only at the start of a slot, so that no slot is left half done
+    if(isNewSlot)
     {
-      operatingMode = MODE_GET_RECEIVER_CONFIG;
-      isReadOutputChConfig = false;
-    }
-    else if(isSetOutputChConfig && operatingMode != MODE_BIND)
-    {
-      operatingMode = MODE_SEND_RECEIVER_CONFIG;
-      isSetOutputChConfig = false;
-    }
-    else if(isRequestingTelemetry && operatingMode == MODE_RC_DATA && !hasPendingRCData)
-    {
-      operatingMode = MODE_GET_TELEM;
-      telemModeEntryTime = millis();
+      if(isRequestingBind)
+      {
+        operatingMode = MODE_BIND;
+        isRequestingBind = false;
+      }
+      else if(isReadOutputChConfig && operatingMode == MODE_RC_DATA)
+      {
+        operatingMode = MODE_GET_RECEIVER_CONFIG;
+        isReadOutputChConfig = false;
+      }
+      else if(isSetOutputChConfig && operatingMode == MODE_RC_DATA)
+      {
+        operatingMode = MODE_SEND_RECEIVER_CONFIG;
+        isSetOutputChConfig = false;
+      }
+      else if(requestedRateProfile != rateProfile && operatingMode == MODE_RC_DATA)
+        operatingMode = MODE_SET_RATE_PROFILE;
     }
   }
+  
+  uint8_t prevOperatingMode = operatingMode;
 
   //state machine
   switch (operatingMode)
@@ -620,36 +869,91 @@ void doRfCommunication()
       transmitReceiverConfig();
       break;
       
+    case MODE_SET_RATE_PROFILE:
+      transmitRateProfile();
+      break;
+      
     case MODE_RC_DATA:
       transmitRCdata();
       break;
       
     case MODE_GET_TELEM:
       getTelemetry();
-      if(millis() - telemModeEntryTime > TIMEOUT_MODE_GET_TELEM)
-      {
-        hop();
-        operatingMode = MODE_RC_DATA;
-      }
       break;
   }
+  
+  //If another mode ended at the start of this slot, the slot can still be used for rc data
+  if(isNewSlot && operatingMode == MODE_RC_DATA && prevOperatingMode != MODE_RC_DATA)
+    transmitRCdata();
+
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void hopToSlot(uint32_t slot)
+{
+  //Tune to the channel of the given slot. Going by the slot count rather than stepping from the 
+  //current channel keeps us in step with the receiver even when we get here late, eg a tx done 
+  //picked up after the next slot has started
+  idxHopSequence = slot % HOP_SEQUENCE_LENGTH;
+  LoRa.setFrf(channelFrf[hopSequence[idxHopSequence]]);
+}
+
+//--------------------------------------------------------------------------------------------------
 
+uint32_t getChannelFreq(uint8_t channel)
+{
+  //Returns the centre frequency of the channel in Hz. Any space left over after fitting in 
+  //the channels is split equally between both band edges
+  if(channel >= NUM_FREQ_CHANNELS) //prevents invalid references
+    channel = 0;
+  const uint32_t margin = ((FREQ_BAND_END - FREQ_BAND_START - FREQ_CH_BANDWIDTH) - (NUM_FREQ_CHANNELS - 1) * FREQ_CH_SPACING) / 2;
+  return FREQ_BAND_START + (FREQ_CH_BANDWIDTH / 2) + margin + (uint32_t)channel * FREQ_CH_SPACING;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-void hop()
+void generateHopSequence(uint16_t seed)
 {
-  idx_fhss_schema++;
-  if(idx_fhss_schema >= sizeof(fhss_schema)/sizeof(fhss_schema[0]))
-    idx_fhss_schema = 0;
+  /* Each block of NUM_FREQ_CHANNELS hops is a shuffle of all the channels, so all channels get used 
+  equally and a channel is never used twice in a row within the sequence. 
+  A xorshift prng is used instead of random() so that both ends are guaranteed to generate the same
+  sequence from the same seed. */
   
-  uint8_t idx_freq = fhss_schema[idx_fhss_schema];
-  if(idx_freq < sizeof(freqList)/sizeof(freqList[0])) //prevents invalid references
+  uint16_t _state = (seed == 0) ? 0xACE1 : seed; //xorshift state should never be 0
+  uint8_t _block[NUM_FREQ_CHANNELS];
+  uint8_t _idx = 0;
+  while(_idx < HOP_SEQUENCE_LENGTH)
   {
-    LoRa.sleep();
-    LoRa.setFrequency(freqList[idx_freq]);
-    LoRa.idle();
+    //shuffle (Fisher-Yates)
+    for(uint8_t i = 0; i < NUM_FREQ_CHANNELS; i++)
+      _block[i] = i;
+    for(uint8_t i = NUM_FREQ_CHANNELS - 1; i > 0; i--)
+    {
+      _state ^= _state << 7;
+      _state ^= _state >> 9;
+      _state ^= _state << 8;
+      uint8_t j = _state % (i + 1);
+      uint8_t _tmp = _block[i];
+      _block[i] = _block[j];
+      _block[j] = _tmp;
+    }
+    //avoid repeating the last channel of the previous block
+    if(_idx > 0 && _block[0] == hopSequence[_idx - 1] && NUM_FREQ_CHANNELS > 1)
+    {
+      _block[0] = _block[1];
+      _block[1] = hopSequence[_idx - 1];
+    }
+    //append
+    for(uint8_t i = 0; i < NUM_FREQ_CHANNELS && _idx < HOP_SEQUENCE_LENGTH; i++)
+      hopSequence[_idx++] = _block[i];
+  }
+  //The sequence loops, so the last channel shouldn't be the first one either. Swapping the last two 
+  //keeps the last block a shuffle
+  if(hopSequence[HOP_SEQUENCE_LENGTH - 1] == hopSequence[0] && HOP_SEQUENCE_LENGTH % NUM_FREQ_CHANNELS != 1)
+  {
+    hopSequence[HOP_SEQUENCE_LENGTH - 1] = hopSequence[HOP_SEQUENCE_LENGTH - 2];
+    hopSequence[HOP_SEQUENCE_LENGTH - 2] = hopSequence[0];
   }
 }
 
@@ -673,38 +977,19 @@ void bind()
   {
     bindModeEntryTime = millis();
 
-    //--- generate random transmitterID and fhss_schema
+    //--- generate random transmitterID and hop seed. The seed is derived from the transmitterID
     
     randomSeed(millis()); //Seed PRNG
     
     transmitterID = random(0x01, 0xFF);
-    
-    memset(fhss_schema, 0xFF, sizeof(fhss_schema)); //clear schema
-    uint8_t idx = 0;
-    while (idx < sizeof(fhss_schema)/sizeof(fhss_schema[0]))
-    {
-      uint8_t genVal = random(sizeof(freqList)/sizeof(freqList[0]));
-      //check uniqueness
-      bool unique = true;
-      for(uint8_t k = 0; k < (sizeof(fhss_schema)/sizeof(fhss_schema[0])); k++)
-      {
-        if(genVal == fhss_schema[k]) //not unique
-        {
-          unique = false;
-          break; //exit for loop
-        }
-      }
-      if(unique)
-      {
-        fhss_schema[idx] = genVal; //add to fhss_schema
-        idx++; //increment index
-      }
-    }
+    hopSeed = ((uint16_t)transmitterID << 8) | random(0x100);
 
     //--- set to bind frequency
     LoRa.sleep();
-    LoRa.setFrequency(freqList[0]);
+    LoRa.setFrequency(getChannelFreq(0));
     LoRa.idle();
+    setRateProfile(RATE_PROFILE_FAST);
+    requestedRateProfile = RATE_PROFILE_FAST;
     
     bindInitialised = true;
   }
@@ -714,7 +999,8 @@ void bind()
   {
     if(LoRa.beginPacket())
     {
-      uint8_t _packetLen = buildPacket(transmitterID, 0x00, PAC_BIND, fhss_schema, sizeof(fhss_schema)/sizeof(fhss_schema[0]));
+      uint8_t _seedBytes[2] = {(uint8_t)(hopSeed >> 8), (uint8_t)(hopSeed & 0xFF)};
+      uint8_t _packetLen = buildPacket(transmitterID, 0x00, PAC_BIND, _seedBytes, sizeof(_seedBytes));
       LoRa.write(packet, _packetLen);
       LoRa.endPacket(true); //non-blocking
       delay(1);
@@ -736,37 +1022,32 @@ void bind()
     {
       uint8_t msgBuff[30];
       memset(msgBuff, 0, sizeof(msgBuff));
-      uint8_t cntr = 0;
-      while (LoRa.available() > 0) 
-      {
-        if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
-        {
-          msgBuff[cntr] = LoRa.read();
-          cntr++;
-        }
-        else // discard any extra data
-          LoRa.read(); 
-      }
+      LoRa.readPacket(msgBuff, sizeof(msgBuff));
       // Check if the packet is valid and extract the data
       if(checkPacket(0x00, transmitterID, PAC_ACK_BIND, msgBuff, packetSize))
       {
         //check length of data and receiverID range
         if((msgBuff[2] & 0x0F) == 1 && msgBuff[3] > 0x00)
         {
-          bindStatusCode = 1; //bind success
           receiverID = msgBuff[3];
           
-          //Save to eeprom
-          EEPROM.write(EE_ADR_TX_ID, transmitterID);
-          EEPROM.write(EE_ADR_RX_ID, receiverID);
-          EEPROM.put(EE_ADR_FHSS_SCHEMA, fhss_schema);
+          //Save to eeprom in the background. Success is reported once saved, failure right away 
+          //if it can't be queued
+          bindSaveErrorCount = eeqErrorCount;
+          if(eeqPut(EE_ADR_TX_ID, &transmitterID, 1) && eeqPut(EE_ADR_RX_ID, &receiverID, 1)
+             && eeqPut(EE_ADR_HOP_SEED, &hopSeed, sizeof(hopSeed)))
+            isBindSavePending = true;
+          else
+            bindStatusCode = 2;
+          
+          generateHopSequence(hopSeed);
           
           //clear flags
           bindInitialised = false;
           isListeningForAck = false;
           transmitInitiated = false;
           
-          hop();
+          hopToSlot(slotCount + 1);
           operatingMode = MODE_RC_DATA;
           
           return;
@@ -785,16 +1066,17 @@ void bind()
       bindStatusCode = 2; //bind failed
       
       //restore so that we don't unintentionally unbind a bound receiver
+      eeqWait();
       transmitterID = EEPROM.read(EE_ADR_TX_ID);
       receiverID = EEPROM.read(EE_ADR_RX_ID);
-      EEPROM.get(EE_ADR_FHSS_SCHEMA, fhss_schema);
+      EEPROM.get(EE_ADR_HOP_SEED, hopSeed);
       
       //clear flags
       bindInitialised = false;
       isListeningForAck = false;
       transmitInitiated = false;
       
-      hop();
+      hopToSlot(slotCount + 1);
       operatingMode = MODE_RC_DATA;
       
       return;
@@ -807,48 +1089,85 @@ void bind()
 
 void transmitRCdata()
 {
-  if(!hasPendingRCData)
-    return;
-  
   static bool transmitInitiated = false;
-  static bool hopPending = false;
+  static uint32_t txSlot = 0;
   
   if(!rfEnabled) //don't send anything
   {
     transmitInitiated = false;
-    hopPending = false;
     hasPendingRCData = false;
     
     return;
   }
 
-  /// START TRANSMIT
-  if(!transmitInitiated) 
+  /// START TRANSMIT AT THE START OF A SLOT
+  if(!transmitInitiated && isNewSlot) 
   {
-    //encode  
-    uint8_t dataToSend[12];
-    memset(dataToSend, 0, sizeof(dataToSend));
+    if(!hasPendingRCData) //nothing new to send. Skip this slot but stay in step with the receiver
+    {
+      hopToSlot(slotCount + 1);
+      return;
+    }
     
-    dataToSend[0]  = (ch1to9[0] >> 2) & 0xFF;
-    dataToSend[1]  = (ch1to9[0] << 6 | ch1to9[1] >> 4) & 0xFF;
-    dataToSend[2]  = (ch1to9[1] << 4 | ch1to9[2] >> 6) & 0xFF;
-    dataToSend[3]  = (ch1to9[2] << 2 | ch1to9[3] >> 8) & 0xFF;
-    dataToSend[4]  = ch1to9[3] & 0xFF;
+    /* Encode. 
+    Primary channels are packed as 10 bits each into bytes 0 to 11, followed by 6 bits of flags.
+    If there are secondary channels, bytes 12 to 14 carry a 2 bit group index and the 2 channels 
+    in that group, 10 bits each. These bytes may instead carry a redundancy record. 
+    The last bit of byte 14 is the frame toggle. */
+    uint8_t dataToSend[15];
+    memset(dataToSend, 0, sizeof(dataToSend));
     
-    dataToSend[5]  = (ch1to9[4] >> 2) & 0xFF;
-    dataToSend[6]  = (ch1to9[4] << 6 | ch1to9[5] >> 4) & 0xFF;
-    dataToSend[7]  = (ch1to9[5] << 4 | ch1to9[6] >> 6) & 0xFF;
-    dataToSend[8]  = (ch1to9[6] << 2 | ch1to9[7] >> 8) & 0xFF;
-    dataToSend[9] = ch1to9[7] & 0xFF;
+    for(uint8_t i = 0; i < NUM_PRIMARY_CHANNELS; i++)
+      writeBits(dataToSend, i * 10, 10, chData[i]);
     
-    dataToSend[10] = (ch1to9[8] >> 2) & 0xFF;
-    dataToSend[11] = (ch1to9[8] << 6) & 0xC0;
+    //Request telemetry if the next slot is a telemetry slot
+    isRequestingTelemetry = ((slotCount + 1) % telemRatio) == 0;
     
     dataToSend[11] |= (isFailsafeData & 0x01) << 4;
     dataToSend[11] |= (isRequestingTelemetry & 0x01) << 3;
     dataToSend[11] |= idxRFPowerLevel & 0x07;
+    
+    uint8_t _dataLen = 12;
+    
+    bool _hasRecord = false;
+#if defined (ENABLE_RC_REDUNDANCY)
+    static uint8_t _framesSinceGroup = 0;
+    if(!isFailsafeData && (NUM_SECONDARY_GROUPS == 0 || _framesSinceGroup < MAX_FRAMES_BETWEEN_GROUPS))
+      _hasRecord = writeRedundancyRecord(dataToSend);
+    _framesSinceGroup = _hasRecord ? _framesSinceGroup + 1 : 0;
+#endif
+    
+    if(_hasRecord)
+    {
+      dataToSend[11] |= 1 << 5;
+      _dataLen = 15;
+    }
+    else if(NUM_SECONDARY_GROUPS > 0)
+    {
+      uint8_t _group = getNextSecondaryGroup(isFailsafeData);
+      uint8_t _idxCh = NUM_PRIMARY_CHANNELS + 2 * _group;
+      writeBits(dataToSend, 96, 2, _group);
+      writeBits(dataToSend, 98, 10, chData[_idxCh]);
+      if(_idxCh + 1 < NUM_RC_CHANNELS)
+        writeBits(dataToSend, 108, 10, chData[_idxCh + 1]);
+      _dataLen = 15;
+    }
+    
+    if(_dataLen == 15)
+      writeBits(dataToSend, 119, 1, frameToggle);
+    if(!isFailsafeData)
+    {
+      frameToggle = !frameToggle;
+      for(uint8_t i = 0; i < NUM_PRIMARY_CHANNELS; i++)
+        prevFrameVals[i] = chData[i];
+    }
 
-    uint8_t _packetLen = buildPacket(transmitterID, receiverID, PAC_RC_DATA, dataToSend, sizeof(dataToSend));
+    uint8_t _packetLen = buildPacket(transmitterID, receiverID, PAC_RC_DATA, dataToSend, _dataLen);
+    
+#if defined (ENABLE_RC_FEC)
+    fecEncode(packet, _packetLen);
+    _packetLen += FEC_PARITY_LEN;
+#endif
 
     if(LoRa.beginPacket())
     {
@@ -857,40 +1176,160 @@ void transmitRCdata()
       delay(1);
 
       transmitInitiated = true;
-      hopPending = true;
+      txSlot = slotCount;
       totalPacketsSent++;
+      hasPendingRCData = false; //data coming in from now on goes in the next slot
     }
+    else
+      hopToSlot(slotCount + 1);
   }
   
   /// ON TRANSMIT DONE
-  if(!LoRa.isTransmitting())
+  if(transmitInitiated && !LoRa.isTransmitting())
   {
-    hasPendingRCData = false;
     transmitInitiated = false;
     
-    if(hopPending)
+    //if telemetry was requested, the receiver replies in the next slot
+    if(isRequestingTelemetry)
     {
-      hop();
-      hopPending = false;
+      hopToSlot(txSlot + 1);
+      isRequestingTelemetry = false;
+      operatingMode = MODE_GET_TELEM;
+      telemModeEntrySlot = txSlot;
+      ++telemSlotsUsed;
     }
+    else //the next slot we can send in. If the tx done came late, that is the one after
+      hopToSlot(slotCount + 1);
   }
 }
 
 //--------------------------------------------------------------------------------------------------
 
+uint8_t getNextSecondaryGroup(bool isFailsafe)
+{
+  /* Picks which group of secondary channels to send in this frame.
+  Each group accumulates a score every frame it is not sent. Groups whose values have changed 
+  since they were last sent accumulate faster, so fast moving channels get more frames while 
+  static ones are still refreshed periodically. 
+  Failsafe frames simply cycle through the groups. */
+  
+  static uint8_t _score[NUM_SECONDARY_GROUPS + 1];
+  static uint16_t _lastSentVals[2 * NUM_SECONDARY_GROUPS + 1];
+  static uint8_t _failsafeGroup = 0;
+  
+  const uint8_t _changeThreshold = 4; //ignore changes smaller than this, ie noise
+  const uint8_t _changedWeight = 4;   //score increment if changed. Unchanged groups increment by 1
+  
+  if(isFailsafe)
+  {
+    _failsafeGroup++;
+    if(_failsafeGroup >= NUM_SECONDARY_GROUPS)
+      _failsafeGroup = 0;
+    return _failsafeGroup;
+  }
+  
+  uint8_t _bestGroup = 0;
+  for(uint8_t g = 0; g < NUM_SECONDARY_GROUPS; g++)
+  {
+    bool _changed = false;
+    for(uint8_t k = 0; k < 2; k++)
+    {
+      uint8_t _idxCh = NUM_PRIMARY_CHANNELS + 2 * g + k;
+      if(_idxCh < NUM_RC_CHANNELS && abs((int)chData[_idxCh] - (int)_lastSentVals[2 * g + k]) >= _changeThreshold)
+        _changed = true;
+    }
+    uint8_t _inc = _changed ? _changedWeight : 1;
+    _score[g] = (_score[g] > 0xFF - _inc) ? 0xFF : _score[g] + _inc;
+    if(_score[g] > _score[_bestGroup])
+      _bestGroup = g;
+  }
+  
+  //reset the chosen group
+  _score[_bestGroup] = 0;
+  for(uint8_t k = 0; k < 2; k++)
+  {
+    uint8_t _idxCh = NUM_PRIMARY_CHANNELS + 2 * _bestGroup + k;
+    if(_idxCh < NUM_RC_CHANNELS)
+      _lastSentVals[2 * _bestGroup + k] = chData[_idxCh];
+  }
+  
+  return _bestGroup;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool writeRedundancyRecord(uint8_t *buff)
+{
+  /* Writes into bytes 12 to 14 what the receiver needs to rebuild the previous frame.
+  Ch1 to Ch4, normally the sticks, are sent as the change from the previous frame, scaled down by 
+  1, 2, 4 or 8 so as to fit in 5 bits. Ch5 to Ch9 are only flagged if they didn't change.
+  Returns false if the sticks haven't moved, in which case there is nothing worth sending, or if 
+  one moved too far to fit even scaled by 8, in which case a secondary group is better sent. */
+  
+  int16_t _delta[4];
+  int16_t _maxDelta = 0;
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    _delta[i] = (int16_t)prevFrameVals[i] - (int16_t)chData[i];
+    if(abs(_delta[i]) > _maxDelta)
+      _maxDelta = abs(_delta[i]);
+  }
+  if(_maxDelta == 0 || _maxDelta > (15 << 3))
+    return false;
+  
+  bool _othersSame = true;
+  for(uint8_t i = 4; i < NUM_PRIMARY_CHANNELS; i++)
+  {
+    if(prevFrameVals[i] != chData[i])
+      _othersSame = false;
+  }
+  
+  uint8_t _shift = 0;
+  while(_maxDelta > (15 << _shift))
+    ++_shift;
+  
+  writeBits(buff, 96, 2, _shift);
+  int16_t _half = (1 << _shift) / 2;
+  for(uint8_t i = 0; i < 4; i++)
+  {
+    int16_t _q = (_delta[i] + (_delta[i] >= 0 ? _half : -_half)) / (1 << _shift); //rounded
+    _q = constrain(_q, -16, 15);
+    writeBits(buff, 98 + i * 5, 5, _q & 0x1F);
+  }
+  writeBits(buff, 118, 1, _othersSame);
+  
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void getReceiverConfig()
 {
   static bool transmitInitiated = false;
   static bool isListeningForReply = false;
-  
-  static uint32_t listenEntryTime = 0;
-  const int maxListenTime = 40;
+  static bool gotReply = false;
+  static uint32_t requestSlot = 0;
   
   static int retryCount = 0;
-  const int maxRetries  = 5 * sizeof(fhss_schema) / sizeof(fhss_schema[0]);
+  const int maxRetries  = 2 * NUM_FREQ_CHANNELS;
+
+  //End of the reply slot. Hop, then either retry or go back to sending rc data
+  if(isListeningForReply && isNewSlot && slotCount - requestSlot >= 2)
+  {
+    hopToSlot(slotCount);
+    isListeningForReply = false;
+    transmitInitiated = false;
+    ++retryCount;
+    if(gotReply || retryCount > maxRetries)
+    {
+      retryCount = 0;
+      operatingMode = MODE_RC_DATA;
+      return;
+    }
+  }
 
-  //Start transmit
-  if(!transmitInitiated)
+  //Start transmit at the start of a slot
+  if(!transmitInitiated && isNewSlot)
   {
     uint8_t _packetLen = buildPacket(transmitterID, receiverID, PAC_READ_OUTPUT_CH_CONFIG, NULL, 0);
     if(LoRa.beginPacket())
@@ -900,17 +1339,20 @@ void getReceiverConfig()
       delay(1);
 
       transmitInitiated = true;
+      gotReply = false;
+      requestSlot = slotCount;
     }
+    else
+      hopToSlot(requestSlot + 1);
   }
   
-  //On transmit done, listen for reply
-  if(!LoRa.isTransmitting())
+  //On transmit done, listen for reply in the next slot
+  if(transmitInitiated && !LoRa.isTransmitting())
   {
     if(!isListeningForReply)
     {
-      hop();
+      hopToSlot(slotCount + 1);
       isListeningForReply = true;
-      listenEntryTime = millis();
     }
     
     int packetSize = LoRa.parsePacket();
@@ -918,57 +1360,21 @@ void getReceiverConfig()
     {
       uint8_t msgBuff[30];
       memset(msgBuff, 0, sizeof(msgBuff));
-      uint8_t cntr = 0;
-      while (LoRa.available() > 0) 
-      {
-        if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
-        {
-          msgBuff[cntr] = LoRa.read();
-          cntr++;
-        }
-        else // discard any extra data
-          LoRa.read(); 
-      }
-      
-      hop();
+      LoRa.readPacket(msgBuff, sizeof(msgBuff));
       
       //Check if packet is valid and extract the data
       if(checkPacket(receiverID, transmitterID, PAC_READ_OUTPUT_CH_CONFIG, msgBuff, packetSize))
       {
         //check length
-        if((msgBuff[2] & 0x0F) == 9) //9 bytes
+        if((msgBuff[2] & 0x0F) == NUM_RX_OUTPUT_CHANNELS) //1 byte per output
         {
+          gotReply = true;
           gotOutputChConfig = true;
-          for(uint8_t i = 0; i < 9; i++)
+          for(uint8_t i = 0; i < NUM_RX_OUTPUT_CHANNELS; i++)
             outputChConfig[i] = msgBuff[3 + i];
-          
-          //Change mode
-          operatingMode = MODE_RC_DATA;
-          
-          //reset
-          isListeningForReply = false;
-          transmitInitiated = false;
-          retryCount = 0;
-          
-          //exit
-          return;
         }
       }
     }
-    
-    //Retry if nothing was received
-    if(isListeningForReply && (millis() - listenEntryTime) > maxListenTime)
-    {
-      isListeningForReply = false;
-      transmitInitiated = false;
-      ++retryCount;
-      if(retryCount > maxRetries) //timeout
-      {
-        retryCount = 0;
-        operatingMode = MODE_RC_DATA;
-        hop();
-      }
-    }
   }
 }
 
@@ -978,15 +1384,31 @@ void transmitReceiverConfig()
 {
   static bool transmitInitiated = false;
   static bool isListeningForReply = false;
-  
-  static uint32_t listenEntryTime = 0;
-  const int maxListenTime = 40;
+  static bool gotReply = false;
+  static uint32_t requestSlot = 0;
   
   static int retryCount = 0;
-  const int maxRetries  = 5 * sizeof(fhss_schema) / sizeof(fhss_schema[0]);
+  const int maxRetries  = 2 * NUM_FREQ_CHANNELS;
+
+  //End of the reply slot. Hop, then either retry or go back to sending rc data
+  if(isListeningForReply && isNewSlot && slotCount - requestSlot >= 2)
+  {
+    hopToSlot(slotCount);
+    isListeningForReply = false;
+    transmitInitiated = false;
+    ++retryCount;
+    if(gotReply || retryCount > maxRetries)
+    {
+      if(!gotReply) 
+        receiverConfigStatusCode = 2; //indicate a failure
+      retryCount = 0;
+      operatingMode = MODE_RC_DATA;
+      return;
+    }
+  }
 
-  //Start transmit
-  if(!transmitInitiated)
+  //Start transmit at the start of a slot
+  if(!transmitInitiated && isNewSlot)
   {
     uint8_t _packetLen = buildPacket(transmitterID, receiverID, PAC_SET_OUTPUT_CH_CONFIG, outputChConfig, sizeof(outputChConfig));
     if(LoRa.beginPacket())
@@ -996,17 +1418,20 @@ void transmitReceiverConfig()
       delay(1);
 
       transmitInitiated = true;
+      gotReply = false;
+      requestSlot = slotCount;
     }
+    else
+      hopToSlot(requestSlot + 1);
   }
   
-  //On transmit done, listen for reply
-  if(!LoRa.isTransmitting())
+  //On transmit done, listen for reply in the next slot
+  if(transmitInitiated && !LoRa.isTransmitting())
   {
     if(!isListeningForReply)
     {
-      hop();
+      hopToSlot(slotCount + 1);
       isListeningForReply = true;
-      listenEntryTime = millis();
     }
     
     int packetSize = LoRa.parsePacket();
@@ -1014,53 +1439,95 @@ void transmitReceiverConfig()
     {
       uint8_t msgBuff[30];
       memset(msgBuff, 0, sizeof(msgBuff));
-      uint8_t cntr = 0;
-      while (LoRa.available() > 0) 
-      {
-        if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
-        {
-          msgBuff[cntr] = LoRa.read();
-          cntr++;
-        }
-        else // discard any extra data
-          LoRa.read(); 
-      }
+      LoRa.readPacket(msgBuff, sizeof(msgBuff));
       
-      hop();
-      
-      //Check if packet is valid and extract the data
+      //Check if packet is valid
       if(checkPacket(receiverID, transmitterID, PAC_ACK_OUTPUT_CH_CONFIG, msgBuff, packetSize))
       {
-        //indicate success
-        receiverConfigStatusCode = 1;
-        
-        //Change mode
-        operatingMode = MODE_RC_DATA;
-        
-        //reset
-        isListeningForReply = false;
-        transmitInitiated = false;
-        retryCount = 0;
-        
-        //exit
-        return;
+        gotReply = true;
+        receiverConfigStatusCode = 1; //indicate success
       }
     }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void transmitRateProfile()
+{
+  /* Asks the receiver to change to the requested rate profile. Both ends change over at the end of 
+  the slot carrying the receiver's ack, so the following slot is already on the new profile. 
+  Without an ack we still go to the long range profile, as the link is then likely failing and the 
+  receiver tries both profiles once it loses us. We don't go back to the fast profile without one. */
+  
+  static bool transmitInitiated = false;
+  static bool isListeningForReply = false;
+  static bool gotReply = false;
+  static uint32_t requestSlot = 0;
+  static uint8_t profile = RATE_PROFILE_FAST;
+  
+  static int retryCount = 0;
+  const int maxRetries  = 2; //few, as no rc data goes out meanwhile
+
+  //End of the reply slot. Hop, then either retry or change over and go back to sending rc data
+  if(isListeningForReply && isNewSlot && slotCount - requestSlot >= 2)
+  {
+    hopToSlot(slotCount);
+    isListeningForReply = false;
+    transmitInitiated = false;
+    ++retryCount;
+    if(gotReply || retryCount > maxRetries)
+    {
+      if(gotReply || profile == RATE_PROFILE_LONG_RANGE)
+        setRateProfile(profile);
+      else
+        requestedRateProfile = rateProfile; //give up. adjustAutoPower() asks again later
+      retryCount = 0;
+      operatingMode = MODE_RC_DATA;
+      return;
+    }
+  }
+
+  //Start transmit at the start of a slot
+  if(!transmitInitiated && isNewSlot)
+  {
+    profile = requestedRateProfile;
+    uint8_t _packetLen = buildPacket(transmitterID, receiverID, PAC_SET_RATE_PROFILE, &profile, 1);
+    if(LoRa.beginPacket())
+    {
+      LoRa.write(packet, _packetLen);
+      LoRa.endPacket(true); //async
+      delay(1);
+
+      transmitInitiated = true;
+      gotReply = false;
+      requestSlot = slotCount;
+    }
+    else
+      hopToSlot(requestSlot + 1);
+  }
+  
+  //On transmit done, listen for reply in the next slot
+  if(transmitInitiated && !LoRa.isTransmitting())
+  {
+    if(!isListeningForReply)
+    {
+      hopToSlot(slotCount + 1);
+      isListeningForReply = true;
+    }
     
-    //Retry if nothing was received
-    if(isListeningForReply && (millis() - listenEntryTime) > maxListenTime)
+    int packetSize = LoRa.parsePacket();
+    if (packetSize > 0) //received a packet
     {
-      isListeningForReply = false;
-      transmitInitiated = false;
-      ++retryCount;
-      if(retryCount > maxRetries) //timeout
+      uint8_t msgBuff[30];
+      memset(msgBuff, 0, sizeof(msgBuff));
+      LoRa.readPacket(msgBuff, sizeof(msgBuff));
+      
+      //Check if packet is valid and for the profile we asked for
+      if(checkPacket(receiverID, transmitterID, PAC_ACK_RATE_PROFILE, msgBuff, packetSize)
+         && (msgBuff[2] & 0x0F) == 1 && msgBuff[3] == profile)
       {
-        retryCount = 0;
-        //indicate a failure
-        receiverConfigStatusCode = 2;
-        
-        operatingMode = MODE_RC_DATA;
-        hop();
+        gotReply = true;
       }
     }
   }
@@ -1068,8 +1535,25 @@ void transmitReceiverConfig()
 
 //--------------------------------------------------------------------------------------------------
 
+void setRateProfile(uint8_t profile)
+{
+  //Changes the spreading factor and the slot period. Called at the start of a slot, which then 
+  //lasts the new period
+  uint32_t _period = (profile == RATE_PROFILE_LONG_RANGE) ? SLOT_PERIOD_LONG_RANGE_US : SLOT_PERIOD_FAST_US;
+  nextSlotMicros += _period - slotPeriodUs;
+  slotPeriodUs = _period;
+  rateProfile = profile;
+  LoRa.idle();
+  LoRa.setSpreadingFactor(profile == RATE_PROFILE_LONG_RANGE ? SF_LONG_RANGE : SF_FAST);
+}
+
+//--------------------------------------------------------------------------------------------------
+
 void getTelemetry()
 {
+  /* The receiver replies in the slot following the one that carried the request. 
+  We listen till the end of that slot, then hop and go back to sending rc data. */
+  
   static unsigned long timeOfLastTelemReception = 0;
 
   int packetSize = LoRa.parsePacket();
@@ -1077,43 +1561,198 @@ void getTelemetry()
   {
     uint8_t msgBuff[30];
     memset(msgBuff, 0, sizeof(msgBuff));
-    uint8_t cntr = 0;
-    while (LoRa.available() > 0) 
-    {
-      if(cntr < (sizeof(msgBuff)/sizeof(msgBuff[0])))
-      {
-        msgBuff[cntr] = LoRa.read();
-        cntr++;
-      }
-      else // discard any extra data
-        LoRa.read(); 
-    }
-    
-    hop();
+    LoRa.readPacket(msgBuff, sizeof(msgBuff));
     
     //Check if packet is valid and extract the data
     if(checkPacket(receiverID, transmitterID, PAC_TELEMETRY, msgBuff, packetSize))
     {
       //check length
-      if((msgBuff[2] & 0x0F) == 3) //3 bytes
+      if((msgBuff[2] & 0x0F) == 13) //13 bytes
       {
         timeOfLastTelemReception = millis();
+        telemBytesReceived += msgBuff[2] & 0x0F;
         //extract
         receiverPacketRate = msgBuff[3];
         telem_volts = ((uint16_t)msgBuff[4] << 4 & 0xFF0) | ((uint16_t)msgBuff[5] >> 4 & 0x0F);
+        receiverSlowestChRate = msgBuff[6];
+        receiverLinkQuality = msgBuff[7];
+        uplinkRssi = msgBuff[8];
+        uplinkSnr = (int8_t) msgBuff[9];
+        receiverCrcFailRate = msgBuff[10];
+        receiverFecFixRate = msgBuff[11];
+        receiverRecoveryRate = msgBuff[12];
+        receiverOutputDelay = msgBuff[13];
+        receiverProcessTime = msgBuff[14];
+        receiverFailsafeDelay = msgBuff[15];
+        
+        //downlink signal, as seen by us
+        int _rssi = LoRa.packetRssi();
+        downlinkRssi = (_rssi < -255) ? 255 : (_rssi > -1 ? 1 : -_rssi);
+        downlinkSnr = (int8_t) LoRa.packetSnr();
+        
+        adjustAutoPower(true);
       }
     }
-    
-    //Change mode
+    else if(checkPacket(receiverID, transmitterID, PAC_LINK_STATS, msgBuff, packetSize))
+    {
+      if((msgBuff[2] & 0x0F) == RX_STATS_PAGE_LEN)
+      {
+        timeOfLastTelemReception = millis();
+        telemBytesReceived += RX_STATS_PAGE_LEN;
+        memcpy(receiverStatsPage, msgBuff + 3, RX_STATS_PAGE_LEN);
+      }
+    }
+    else if(checkPacket(receiverID, transmitterID, PAC_SENSORS, msgBuff, packetSize))
+    {
+      uint8_t _len = msgBuff[2] & 0x0F;
+      if(_len > 0 && _len <= RX_SENSOR_PAGE_LEN && _len % 3 == 0) //whole entries of 3 bytes
+      {
+        timeOfLastTelemReception = millis();
+        telemBytesReceived += _len;
+        receiverSensorPage[0] = _len;
+        memcpy(receiverSensorPage + 1, msgBuff + 3, _len);
+      }
+    }
+  }
+  
+  //End of the reply slot
+  if(isNewSlot && slotCount - telemModeEntrySlot >= 2)
+  {
+    hopToSlot(slotCount);
     operatingMode = MODE_RC_DATA;
   }
 
-  //reset data if no telemetry received
-  if(millis() - timeOfLastTelemReception > 3000)
+  //reset data if no telemetry received. Allow for at least 3 telemetry slots, which are far apart 
+  //with the long range profile and a low ratio
+  uint32_t _telemTimeout = 3UL * telemRatio * slotPeriodUs / 1000;
+  if(_telemTimeout < 3000)
+    _telemTimeout = 3000;
+  if(millis() - timeOfLastTelemReception > _telemTimeout)
   {
     receiverPacketRate = 0;
+    receiverSlowestChRate = 0;
     telem_volts = 0x0FFF;
+    receiverLinkQuality = 0;
+    receiverCrcFailRate = 0;
+    receiverFecFixRate = 0;
+    receiverRecoveryRate = 0;
+    receiverOutputDelay = 0;
+    receiverProcessTime = 0;
+    receiverFailsafeDelay = 0;
+    uplinkRssi = 0;
+    uplinkSnr = 0;
+    downlinkRssi = 0;
+    downlinkSnr = 0;
+    receiverSensorPage[0] = 0;
+    
+    adjustAutoPower(false);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void adjustAutoPower(bool gotTelemetry)
+{
+  static uint8_t _goodReports = 0;
+  static bool _hadTelemetry = false; //since the link was last lost
+  
+  if(rfPowerSetting < RF_POWER_AUTO_FIRST || rfPowerSetting == 0xFF) //fixed power
+    return;
+  
+  uint8_t _maxLevel = rfPowerSetting - RF_POWER_AUTO_FIRST + 2;
+  
+  if(!gotTelemetry) //lost the link. Go to max and work down from there once it is back
+  {
+    idxRFPowerLevel = _maxLevel;
+    if(isLongRangeAllowed && _hadTelemetry) //not on power up, when there was no link to lose
+      requestedRateProfile = RATE_PROFILE_LONG_RANGE;
+    _hadTelemetry = false;
+    _goodReports = 0;
+    return;
+  }
+  _hadTelemetry = true;
+  
+  int8_t _upMargin = getLinkMargin(uplinkRssi, uplinkSnr);
+  int8_t _downMargin = getLinkMargin(downlinkRssi, downlinkSnr);
+  int8_t _margin = _upMargin < _downMargin ? _upMargin : _downMargin;
+  
+  if(receiverLinkQuality < APC_LQ_LOW || _margin < APC_MARGIN_LOW)
+  {
+    _goodReports = 0;
+    if(idxRFPowerLevel < _maxLevel)
+      ++idxRFPowerLevel;
+    else if(isLongRangeAllowed && _margin < APC_MARGIN_LOW) //it won't help with interference
+      requestedRateProfile = RATE_PROFILE_LONG_RANGE;
+  }
+  else if(receiverLinkQuality >= APC_LQ_HIGH && _margin >= APC_MARGIN_HIGH)
+  {
+    ++_goodReports;
+    if(_goodReports >= APC_GOOD_REPORTS)
+    {
+      _goodReports = 0;
+      if(rateProfile == RATE_PROFILE_LONG_RANGE)
+        requestedRateProfile = RATE_PROFILE_FAST;
+      else if(idxRFPowerLevel > 0)
+        --idxRFPowerLevel;
+    }
+  }
+  else
+    _goodReports = 0;
+  
+  if(idxRFPowerLevel > _maxLevel) //max may have been lowered
+    idxRFPowerLevel = _maxLevel;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int8_t getLinkMargin(uint8_t rssi, int8_t snr)
+{
+  /* Returns how many dB the signal is above what we can receive. Lora demodulates down to about 
+  -7.5dB snr at SF7. Snr stops rising at about +10dB though, so for strong signals use the rssi 
+  above the sensitivity (about -120dBm at SF7, BW 250kHz) instead. Both are LONG_RANGE_GAIN_DB lower
+  with the long range profile. Rssi is in -dBm, 0 is no data */
+  if(rssi == 0)
+    return 0;
+  int8_t _gain = (rateProfile == RATE_PROFILE_LONG_RANGE) ? LONG_RANGE_GAIN_DB : 0;
+  if(snr < 8)
+    return snr + 8 + _gain;
+  int16_t _margin = 120 + _gain - (int16_t)rssi;
+  if(_margin < 16 + _gain)
+    _margin = 16 + _gain;
+  if(_margin > 100)
+    _margin = 100;
+  return _margin;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void writeBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits, uint16_t val)
+{
+  //Writes the lower numBits (max 16) of val starting at bitPos. Bits are packed msb first
+  for(uint8_t i = 0; i < numBits; i++)
+  {
+    uint8_t _pos = bitPos + i;
+    uint8_t _mask = 0x80 >> (_pos % 8);
+    if((val >> (numBits - 1 - i)) & 0x01)
+      buff[_pos / 8] |= _mask;
+    else
+      buff[_pos / 8] &= ~_mask;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint16_t readBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits)
+{
+  //Reads numBits (max 16) starting at bitPos. Bits are packed msb first
+  uint16_t rslt = 0;
+  for(uint8_t i = 0; i < numBits; i++)
+  {
+    uint8_t _pos = bitPos + i;
+    rslt <<= 1;
+    rslt |= (buff[_pos / 8] >> (7 - (_pos % 8))) & 0x01;
   }
+  return rslt;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1132,6 +1771,10 @@ uint8_t buildPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8
     ++dataBuff;
   }
   packet[3 + dataLen] = crc8Maxim(packet, 3 + dataLen);
+  //Tag with the position in the hop sequence. Lets the receiver know where in the sequence we are.
+  //Not done on bind as the sequence isn't known yet.
+  if(dataIdentifier != PAC_BIND && dataIdentifier != PAC_ACK_BIND)
+    packet[3 + dataLen] ^= idxHopSequence;
   return 4 + dataLen; 
 }
 
@@ -1145,9 +1788,11 @@ bool checkPacket(uint8_t srcID, uint8_t destID, uint8_t dataIdentifier, uint8_t
   if(packetBuff[0] != srcID || packetBuff[1] != destID || (packetBuff[2] >> 4) != dataIdentifier)
     return false;
   
-  //check packet crc
+  //check packet crc. Also checks that we are at the same position in the hop sequence. See buildPacket()
   uint8_t _crcQQ = packetBuff[packetSize - 1];
   uint8_t _computedCRC = crc8Maxim(packetBuff, packetSize - 1);
+  if(dataIdentifier != PAC_BIND && dataIdentifier != PAC_ACK_BIND)
+    _computedCRC ^= idxHopSequence;
   if(_crcQQ != _computedCRC)
     return false;
   
@@ -0,0 +1,35 @@
+// EEPROM library. Reads and writes wait for a write in progress to finish, as eeprom_read_byte()
+// and eeprom_write_byte() do
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() { return 1024; }
+
+  template<typename T> T &get(int idx, T &t)
+  {
+    uint8_t *ptr = (uint8_t *)&t;
+    for(size_t i = 0; i < sizeof(T); i++)
+      ptr[i] = read(idx + i);
+    return t;
+  }
+
+  template<typename T> const T &put(int idx, const T &t)
+  {
+    const uint8_t *ptr = (const uint8_t *)&t;
+    for(size_t i = 0; i < sizeof(T); i++)
+      update(idx + i, ptr[i]);
+    return t;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,35 @@
+// SPI master. Bytes go to the SX127x on the board while its NSS pin is low
+
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include <Arduino.h>
+
+#define SPI_HAS_TRANSACTION 1
+#define SPI_HAS_NOTUSINGINTERRUPT 1
+
+#define SPI_MODE0 0x00
+
+class SPISettings {
+public:
+  SPISettings() {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) { (void)clock; (void)bitOrder; (void)dataMode; }
+};
+
+class SPIClass {
+public:
+  void begin();
+  void end();
+  void usingInterrupt(uint8_t interruptNumber);
+  void notUsingInterrupt(uint8_t interruptNumber);
+  void beginTransaction(SPISettings settings);
+  uint8_t transfer(uint8_t data);
+  void endTransaction();
+
+private:
+  uint8_t interruptMask = 0; //external interrupts held off during a transaction
+};
+
+extern SPIClass SPI;
+
+#endif
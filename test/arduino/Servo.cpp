@@ -0,0 +1,149 @@
+// The Arduino Servo library's AVR code for Timer1, see Servo.h
+
+#include "Servo.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define usToTicks(_us)    ((clockCyclesPerMicrosecond() * (_us)) / 8)
+#define ticksToUs(_ticks) (((unsigned)(_ticks) * 8) / clockCyclesPerMicrosecond())
+
+#define TRIM_DURATION  2 //compensation ticks to trim adjust for digitalWrite delays
+
+struct ServoPin {
+  uint8_t nbr;
+  bool isActive;
+};
+
+struct servo_t {
+  ServoPin Pin;
+  volatile unsigned int ticks;
+};
+
+static servo_t servos[MAX_SERVOS];
+static volatile int8_t Channel = -1; //counter for the servo being pulsed
+static bool isTimerActive = false;
+static uint8_t ServoCount = 0;
+
+#define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)
+#define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)
+
+//--------------------------------------------------------------------------------------------------
+
+void ServoTimer1Isr()
+{
+  if(Channel < 0)
+    TCNT1 = 0; //the refresh interval has completed, so reset the timer
+  else if(Channel < ServoCount && servos[Channel].Pin.isActive)
+    digitalWrite(servos[Channel].Pin.nbr, LOW); //end this channel's pulse
+
+  Channel++;
+  if(Channel < ServoCount && Channel < SERVOS_PER_TIMER)
+  {
+    OCR1A = TCNT1 + servos[Channel].ticks;
+    if(servos[Channel].Pin.isActive)
+      digitalWrite(servos[Channel].Pin.nbr, HIGH);
+  }
+  else
+  {
+    //finished all channels, so wait for the refresh period to expire before starting over
+    if((unsigned)TCNT1 + 4 < usToTicks(REFRESH_INTERVAL)) //a few ticks so the next match isn't missed
+      OCR1A = (unsigned int)usToTicks(REFRESH_INTERVAL);
+    else
+      OCR1A = TCNT1 + 4; //at least REFRESH_INTERVAL has elapsed
+    Channel = -1; //incremented at the end of the refresh period to start again at the first channel
+  }
+}
+
+static void initISR()
+{
+  TCCR1A = 0;           //normal counting mode
+  TCCR1B = _BV(CS11);   //prescaler of 8
+  TCNT1 = 0;
+  TIFR1 |= _BV(OCF1A);  //clear any pending interrupts
+  TIMSK1 |= _BV(OCIE1A);
+  isTimerActive = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Servo::Servo()
+{
+  if(ServoCount < MAX_SERVOS)
+  {
+    servoIndex = ServoCount++;
+    servos[servoIndex].ticks = usToTicks(DEFAULT_PULSE_WIDTH);
+  }
+  else
+    servoIndex = INVALID_SERVO;
+  min = 0;
+  max = 0;
+}
+
+uint8_t Servo::attach(int pin)
+{
+  return attach(pin, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+}
+
+uint8_t Servo::attach(int pin, int min, int max)
+{
+  if(servoIndex < MAX_SERVOS)
+  {
+    pinMode(pin, OUTPUT);
+    servos[servoIndex].Pin.nbr = pin;
+    this->min = (MIN_PULSE_WIDTH - min) / 4; //resolution of min and max is 4us
+    this->max = (MAX_PULSE_WIDTH - max) / 4;
+    if(!isTimerActive)
+      initISR();
+    servos[servoIndex].Pin.isActive = true;
+  }
+  return servoIndex;
+}
+
+void Servo::detach()
+{
+  servos[servoIndex].Pin.isActive = false;
+}
+
+void Servo::write(int value)
+{
+  if(value < MIN_PULSE_WIDTH)
+  {
+    if(value < 0)
+      value = 0;
+    if(value > 180)
+      value = 180;
+    value = map(value, 0, 180, SERVO_MIN(), SERVO_MAX());
+  }
+  writeMicroseconds(value);
+}
+
+void Servo::writeMicroseconds(int value)
+{
+  uint8_t channel = servoIndex;
+  if(channel < MAX_SERVOS)
+  {
+    if(value < SERVO_MIN())
+      value = SERVO_MIN();
+    else if(value > SERVO_MAX())
+      value = SERVO_MAX();
+    value = value - TRIM_DURATION;
+    value = usToTicks(value);
+
+    uint8_t oldSREG = SREG;
+    cli();
+    servos[channel].ticks = value;
+    SREG = oldSREG;
+  }
+}
+
+int Servo::readMicroseconds()
+{
+  if(servoIndex == INVALID_SERVO)
+    return 0;
+  return ticksToUs(servos[servoIndex].ticks) + TRIM_DURATION;
+}
+
+bool Servo::attached()
+{
+  return servos[servoIndex].Pin.isActive;
+}
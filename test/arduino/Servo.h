@@ -0,0 +1,39 @@
+// The Arduino Servo library, as the receiver used it before servos.h. Only its Timer1 code, the
+// only timer it takes on the Atmega328p with up to 12 servos. Pulses go out one after another,
+// each started and ended with digitalWrite() from the compare interrupt, and the sequence starts
+// again every REFRESH_INTERVAL. Link in Servo.cpp and list ServoTimer1Isr() against
+// VEC_TIMER1_COMPA in the sketch.
+
+#ifndef Servo_h
+#define Servo_h
+
+#include <Arduino.h>
+
+#define MIN_PULSE_WIDTH       544
+#define MAX_PULSE_WIDTH      2400
+#define DEFAULT_PULSE_WIDTH  1500
+#define REFRESH_INTERVAL    20000 //in microseconds
+
+#define SERVOS_PER_TIMER       12
+#define MAX_SERVOS             12
+#define INVALID_SERVO         255
+
+class Servo {
+public:
+  Servo();
+  uint8_t attach(int pin);
+  uint8_t attach(int pin, int min, int max);
+  void detach();
+  void write(int value); //degrees, or microseconds if 544 or more
+  void writeMicroseconds(int value);
+  int readMicroseconds();
+  bool attached();
+private:
+  uint8_t servoIndex;
+  int8_t min; //minimum is this value times 4 added to MIN_PULSE_WIDTH
+  int8_t max; //maximum is this value times 4 added to MAX_PULSE_WIDTH
+};
+
+void ServoTimer1Isr();
+
+#endif
@@ -0,0 +1,453 @@
+// Arduino core functions on the board model. Costs are in sim::Costs
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "EEPROM.h"
+#include "sx127x.h"
+
+using sim::cur;
+using sim::Mcu;
+
+HardwareSerial Serial;
+SPIClass SPI;
+EEPROMClass EEPROM;
+
+//--------------------------------------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.pinMode);
+  uint8_t p, b;
+  if(!Mcu::pinToPort(pin, p, b))
+    return;
+  if(mode == OUTPUT)
+    m.ddr[p] |= 1 << b;
+  else
+  {
+    m.ddr[p] &= ~(1 << b);
+    if(mode == INPUT_PULLUP)
+      m.port[p] |= 1 << b;
+    else
+      m.port[p] &= ~(1 << b);
+  }
+  m.checkPorts();
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.digitalWrite);
+  uint8_t p, b;
+  if(!Mcu::pinToPort(pin, p, b))
+    return;
+  if(val == LOW)
+    m.port[p] &= ~(1 << b);
+  else
+    m.port[p] |= 1 << b;
+  m.checkPorts();
+}
+
+int digitalRead(uint8_t pin)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.digitalRead);
+  return m.getPin(pin) ? HIGH : LOW;
+}
+
+static uint8_t analogRef = DEFAULT;
+
+void analogReference(uint8_t mode)
+{
+  analogRef = mode;
+}
+
+int analogRead(uint8_t pin)
+{
+  Mcu &m = cur();
+  if(pin >= 14)
+    pin -= 14;
+  m.writeReg8(sim::R_ADMUX, (analogRef << 6) | (pin & 0x07));
+  m.writeReg8(sim::R_ADCSRA, m.adcsra | 0x40);
+  while(m.readReg8(sim::R_ADCSRA) & 0x40)
+    m.charge(m.adcDone - m.now);
+  return m.readReg16(sim::R_ADC);
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+  Mcu &m = cur();
+  pinMode(pin, OUTPUT);
+  m.charge(m.costs.analogWrite);
+  (void)val;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+unsigned long millis(void)
+{
+  Mcu &m = cur();
+  uint32_t ms = m.timer0Millis;
+  m.charge(m.costs.millis);
+  return ms;
+}
+
+unsigned long micros(void)
+{
+  Mcu &m = cur();
+  uint32_t us = m.micros();
+  m.charge(m.costs.micros);
+  return us;
+}
+
+void delay(unsigned long ms)
+{
+  Mcu &m = cur();
+  uint32_t start = micros();
+  while(ms > 0)
+  {
+    yield();
+    uint32_t elapsed = (uint32_t)micros() - start;
+    while(ms > 0 && elapsed >= 1000)
+    {
+      ms--;
+      start += 1000;
+      elapsed -= 1000;
+    }
+    if(ms > 0)
+      m.charge((1000 - elapsed) * sim::CYCLES_PER_US);
+  }
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  cur().charge(us * sim::CYCLES_PER_US);
+}
+
+void yield(void)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.yield);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+  if(interruptNum > 1)
+    return;
+  Mcu &m = cur();
+  m.extHandler[interruptNum] = userFunc;
+  m.extMode[interruptNum] = mode;
+  m.charge(40);
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+  if(interruptNum > 1)
+    return;
+  Mcu &m = cur();
+  m.extHandler[interruptNum] = NULL;
+  m.extFlag[interruptNum] = false;
+  m.charge(30);
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration)
+{
+  (void)pin;
+  (void)frequency;
+  (void)duration;
+  cur().charge(400);
+}
+
+void noTone(uint8_t pin)
+{
+  (void)pin;
+  cur().charge(100);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+//random() of avr-libc: Park and Miller's minimal standard generator
+static long doRandom()
+{
+  Mcu &m = cur();
+  int32_t x = m.randomState;
+  if(x == 0)
+    x = 123459876L;
+  int32_t hi = x / 127773L;
+  int32_t lo = x % 127773L;
+  x = 16807L * lo - 2836L * hi;
+  if(x < 0)
+    x += 0x7fffffffL;
+  m.randomState = x;
+  m.charge(300);
+  return x % 0x80000000UL;
+}
+
+long random(long howbig)
+{
+  if(howbig == 0)
+    return 0;
+  return doRandom() % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if(howsmall >= howbig)
+    return howsmall;
+  long diff = howbig - howsmall;
+  return random(diff) + howsmall;
+}
+
+void randomSeed(unsigned long seed)
+{
+  if(seed != 0)
+    cur().randomState = (uint32_t)seed;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while(size--)
+  {
+    if(write(*buffer++))
+      n++;
+    else
+      break;
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base)
+{
+  if(base == 0)
+    return write((uint8_t)n);
+  if(base == 10 && n < 0)
+  {
+    size_t t = print('-');
+    return t + printNumber(-(unsigned long)n, 10);
+  }
+  return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  if(base == 0)
+    return write((uint8_t)n);
+  return printNumber((uint32_t)n, base);
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if(base < 2)
+    base = 10;
+  do
+  {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while(n);
+  return write(str);
+}
+
+size_t Print::print(double number, int digits)
+{
+  size_t n = 0;
+  if(isnan(number))
+    return print("nan");
+  if(isinf(number))
+    return print("inf");
+  if(number < 0.0)
+  {
+    n += print('-');
+    number = -number;
+  }
+  double rounding = 0.5;
+  for(uint8_t i = 0; i < digits; ++i)
+    rounding /= 10.0;
+  number += rounding;
+  unsigned long intPart = (unsigned long)number;
+  double remainder = number - (double)intPart;
+  n += print(intPart);
+  if(digits > 0)
+    n += print('.');
+  while(digits-- > 0)
+  {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void HardwareSerial::begin(unsigned long baud, uint8_t config)
+{
+  Mcu &m = cur();
+  m.baud = baud;
+  //start bit, 8 data bits, parity, stop bits
+  m.frameBits = 1 + 8 + ((config & 0x30) ? 1 : 0) + ((config & 0x08) ? 2 : 1);
+  m.charge(200);
+}
+
+void HardwareSerial::end()
+{
+  flush();
+  cur().baud = 0;
+}
+
+int HardwareSerial::available()
+{
+  Mcu &m = cur();
+  m.charge(m.costs.serialAvailable);
+  return m.rxBuffer.size();
+}
+
+int HardwareSerial::peek()
+{
+  Mcu &m = cur();
+  m.charge(m.costs.serialRead);
+  return m.rxBuffer.empty() ? -1 : m.rxBuffer.front();
+}
+
+int HardwareSerial::read()
+{
+  Mcu &m = cur();
+  m.charge(m.costs.serialRead);
+  if(m.rxBuffer.empty())
+    return -1;
+  uint8_t b = m.rxBuffer.front();
+  m.rxBuffer.pop_front();
+  return b;
+}
+
+void HardwareSerial::flush()
+{
+  Mcu &m = cur();
+  while(!m.txBuffer.empty() || m.isTxShifting || m.isUdrFull)
+    m.charge(16);
+}
+
+int HardwareSerial::availableForWrite()
+{
+  Mcu &m = cur();
+  m.charge(m.costs.serialAvailable);
+  return 63 - m.txBuffer.size();
+}
+
+size_t HardwareSerial::write(uint8_t b)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.serialWrite);
+  m.serialSend(b);
+  return 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void SPIClass::begin()
+{
+  //SCK and MOSI out, SS out and high so the hardware stays in master mode
+  Mcu &m = cur();
+  if(!(m.ddr[0] & 0x04))
+    digitalWrite(10, HIGH);
+  pinMode(10, OUTPUT);
+  pinMode(13, OUTPUT);
+  pinMode(11, OUTPUT);
+}
+
+void SPIClass::end()
+{
+}
+
+void SPIClass::usingInterrupt(uint8_t interruptNumber)
+{
+  if(interruptNumber < 2)
+    interruptMask |= 1 << interruptNumber;
+}
+
+void SPIClass::notUsingInterrupt(uint8_t interruptNumber)
+{
+  if(interruptNumber < 2)
+    interruptMask &= ~(1 << interruptNumber);
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  (void)settings;
+  Mcu &m = cur();
+  for(int i = 0; i < 2; i++)
+    if(interruptMask & (1 << i))
+      m.extEnabled[i] = false;
+  m.spiTransactions++;
+  m.charge(m.costs.spiTransaction);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  Mcu &m = cur();
+  m.charge(m.costs.spiByte);
+  m.spiBytes++;
+  if(m.onSpiByte)
+    m.onSpiByte(data);
+  if(m.radio && !m.getPin(m.radioSsPin))
+    return m.radio->transfer(data);
+  return 0;
+}
+
+void SPIClass::endTransaction()
+{
+  Mcu &m = cur();
+  m.charge(m.costs.spiTransaction);
+  for(int i = 0; i < 2; i++)
+    if(interruptMask & (1 << i))
+      m.extEnabled[i] = true;
+  m.pollInterrupts();
+  if(m.onSpiEnd)
+    m.onSpiEnd();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void eepromWait(Mcu &m)
+{
+  while(m.now < m.eeBusyUntil)
+    m.charge(m.eeBusyUntil - m.now);
+}
+
+uint8_t EEPROMClass::read(int idx)
+{
+  Mcu &m = cur();
+  eepromWait(m);
+  m.charge(m.costs.eepromAccess);
+  return m.eeprom[idx & 0x3FF];
+}
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+  Mcu &m = cur();
+  eepromWait(m);
+  m.charge(m.costs.eepromAccess);
+  m.eeprom[idx & 0x3FF] = val;
+  m.eeBusyUntil = m.now + sim::us(3400);
+  m.eepromWrites++;
+}
+
+void EEPROMClass::update(int idx, uint8_t val)
+{
+  if(read(idx) != val)
+    write(idx, val);
+}
@@ -0,0 +1,14 @@
+// Interrupt control. An ISR() in a sketch is a plain function, listed against its vector in the
+// sketch wrapper, see sketch_rx.h
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#include "sim.h"
+
+#define cli() (sim::cur().iFlag = false, sim::cur().charge(1))
+#define sei() (sim::cur().iFlag = true, sim::cur().charge(1))
+
+#define ISR(vector, ...) void vector(void)
+
+#endif
@@ -0,0 +1,86 @@
+// Registers of the Atmega328p the sketches touch directly. Each is a proxy that reads or writes the
+// board model, so peripherals react to the access as they would on the chip.
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+#include "sim.h"
+
+namespace sim {
+
+template<int R> struct Reg8 {
+  operator uint8_t() const { return cur().readReg8(R); }
+  Reg8 &operator=(uint8_t v) { cur().writeReg8(R, v); return *this; }
+  Reg8 &operator|=(uint8_t v) { uint8_t x = *this; return *this = x | v; }
+  Reg8 &operator&=(uint8_t v) { uint8_t x = *this; return *this = x & v; }
+  Reg8 &operator^=(uint8_t v) { uint8_t x = *this; return *this = x ^ v; }
+};
+
+template<int R> struct Reg16 {
+  operator uint16_t() const { return cur().readReg16(R); }
+  Reg16 &operator=(uint16_t v) { cur().writeReg16(R, v); return *this; }
+  Reg16 &operator+=(uint16_t v) { uint16_t x = *this; return *this = x + v; }
+  Reg16 &operator-=(uint16_t v) { uint16_t x = *this; return *this = x - v; }
+};
+
+}
+
+#define SREG   (sim::Reg8<sim::R_SREG>{})
+#define TCCR1A (sim::Reg8<sim::R_TCCR1A>{})
+#define TCCR1B (sim::Reg8<sim::R_TCCR1B>{})
+#define TIMSK1 (sim::Reg8<sim::R_TIMSK1>{})
+#define TIFR1  (sim::Reg8<sim::R_TIFR1>{})
+#define TCNT1  (sim::Reg16<sim::R_TCNT1>{})
+#define OCR1A  (sim::Reg16<sim::R_OCR1A>{})
+#define OCR1B  (sim::Reg16<sim::R_OCR1B>{})
+#define EECR   (sim::Reg8<sim::R_EECR>{})
+#define EEDR   (sim::Reg8<sim::R_EEDR>{})
+#define EEAR   (sim::Reg16<sim::R_EEAR>{})
+#define ADCSRA (sim::Reg8<sim::R_ADCSRA>{})
+#define ADMUX  (sim::Reg8<sim::R_ADMUX>{})
+#define ADC    (sim::Reg16<sim::R_ADC>{})
+
+#define _BV(bit) (1 << (bit))
+
+//TCCR1B
+#define CS10  0
+#define CS11  1
+#define CS12  2
+#define WGM12 3
+#define WGM13 4
+//TCCR1A
+#define WGM10 0
+#define WGM11 1
+//TIMSK1
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+//TIFR1
+#define TOV1  0
+#define OCF1A 1
+#define OCF1B 2
+//EECR
+#define EERE  0
+#define EEPE  1
+#define EEMPE 2
+#define EERIE 3
+//ADCSRA
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE  3
+#define ADIF  4
+#define ADATE 5
+#define ADSC  6
+#define ADEN  7
+//ADMUX
+#define MUX0  0
+#define MUX1  1
+#define MUX2  2
+#define MUX3  3
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+
+#endif
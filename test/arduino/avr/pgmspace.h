@@ -0,0 +1,45 @@
+// Flash and RAM are the same on the host
+
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) sim_pgm_read_word(addr)
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strlcpy_P sim_strlcpy
+
+//avr-libc has strlcpy() in string.h, glibc only from 2.38
+static inline size_t sim_strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if(size > 0)
+  {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#define strlcpy sim_strlcpy
+
+//Pointers are 16 bits on the avr, so a table of strings is read a word at a time. Here they need
+//reading whole
+static inline uint16_t sim_pgm_read_word(const void *addr)
+{
+  return *(const uint16_t *)addr;
+}
+
+template<typename T> static inline T *sim_pgm_read_word(T *const *addr)
+{
+  return *addr;
+}
+
+#endif
@@ -0,0 +1,21 @@
+// ATOMIC_BLOCK(ATOMIC_RESTORESTATE) from avr-libc
+
+#ifndef SIM_UTIL_ATOMIC_H
+#define SIM_UTIL_ATOMIC_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace sim {
+struct AtomicRestore {
+  uint8_t sreg;
+  bool isDone;
+  AtomicRestore() : sreg(SREG), isDone(false) { cli(); }
+  ~AtomicRestore() { SREG = sreg; }
+};
+}
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) for(sim::AtomicRestore _atomic; !_atomic.isDone; _atomic.isDone = true)
+
+#endif
@@ -0,0 +1,65 @@
+// How long the receiver takes to get back in sync after the link drops out, sweeping the channels
+// with CAD probes and, for comparison, dwelling on each channel as it does without
+// ENABLE_CAD_SYNC. The time is from the end of the outage to the next rc frame the receiver
+// takes, seen as its orange led coming on.
+
+#include "link.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+namespace rx_dwell { sim::Sketch sketch(); }
+
+using namespace sim;
+
+const uint8_t PIN_LED_ORANGE = 6;
+const int NUM_OUTAGES = 40;
+
+static std::string runOutages(const Sketch &rxSketch)
+{
+  Link link(stx::sketch(), rxSketch);
+  bool isBlocked = false;
+  link.medium.dropFilter = [&](const Packet &, const Sx127x &) { return isBlocked; };
+  Time restoredAt = NEVER;
+  Time reacquiredAt = NEVER;
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin == PIN_LED_ORANGE && e.level && e.time >= restoredAt && reacquiredAt == NEVER)
+      reacquiredAt = e.time;
+  };
+  link.run(ms(3000));
+
+  std::vector<double> times;
+  std::mt19937 rng(1);
+  for(int i = 0; i < NUM_OUTAGES; i++)
+  {
+    //long enough to lose sync, and ending at a random point in the hop sequence
+    isBlocked = true;
+    link.run(ms(std::uniform_real_distribution<double>(1000, 2500)(rng)));
+    isBlocked = false;
+    restoredAt = link.sim.now();
+    reacquiredAt = NEVER;
+    while(reacquiredAt == NEVER && link.sim.now() - restoredAt < ms(10000))
+      link.run(ms(10));
+    times.push_back(reacquiredAt == NEVER ? 10000 : toMs(reacquiredAt - restoredAt));
+    link.run(ms(500));
+  }
+
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for(double t : times)
+    sum += t;
+  char buff[200];
+  snprintf(buff, sizeof(buff), "%8.0f  %8.0f  %8.0f  %8.0f\n", sum / times.size(),
+           times[times.size() / 2], times[times.size() * 9 / 10], times.back());
+  return buff;
+}
+
+int main()
+{
+  printf("time to the first rc frame after an outage, ms, over %d outages\n", NUM_OUTAGES);
+  printf("               mean    median       90%%       max\n");
+  printf("cad sweep  %s", isolated([] { return runOutages(rx::sketch()); }).c_str());
+  printf("dwell      %s", isolated([] { return runOutages(rx_dwell::sketch()); }).c_str());
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Polling the radio over SPI against DIO0 wired to pin 2, on both the transmitter's slave mcu and
+// the receiver, over the simulated link in sync. Txn/s is SPI transactions per second. The gap is
+// from the radio finishing a transmission to the next hop being written to it: rc packets on the
+// transmitter, replies on the receiver. Either way the tx done is acted on in the loop, so the gap
+// is mostly how long the loop takes to come round.
+
+#include "link.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace stx_dio0 { sim::Sketch sketch(); }
+namespace rx_dio0 { sim::Sketch sketch(); }
+
+using namespace sim;
+
+const uint8_t REG_FRF_LSB = 0x08; //the last register a hop writes
+
+//From the end of each transmission to the next hop
+struct HopGap {
+  Time sum = 0;
+  Time longest = 0;
+  uint32_t num = 0;
+
+  void watch(Sx127x &radio)
+  {
+    radio.onWrite = [this, &radio](uint8_t addr, uint8_t, Time at) {
+      if(addr != REG_FRF_LSB || radio.txDoneAt == NEVER)
+        return;
+      sum += at - radio.txDoneAt;
+      longest = std::max(longest, at - radio.txDoneAt);
+      num++;
+      radio.txDoneAt = NEVER;
+    };
+  }
+};
+
+static std::string runLink(const Sketch &stxSketch, const Sketch &rxSketch)
+{
+  Link link(stxSketch, rxSketch);
+  link.run(ms(3000));
+
+  HopGap stxGap, rxGap;
+  stxGap.watch(link.stxRadio);
+  rxGap.watch(link.rxRadio);
+  link.stxRadio.txDoneAt = NEVER;
+  link.rxRadio.txDoneAt = NEVER;
+  uint64_t stxTxn = link.stx.spiTransactions;
+  uint64_t rxTxn = link.rx.spiTransactions;
+  uint64_t rxStart = link.rxRadio.numRxDone;
+  const double seconds = 20;
+  link.run(ms(seconds * 1000));
+
+  char buff[160];
+  snprintf(buff, sizeof(buff), "%8.0f %7.1f %7.1f  %8.0f %7.1f %7.1f  %7.1f",
+           (link.stx.spiTransactions - stxTxn) / seconds, toUs(stxGap.sum) / std::max(stxGap.num, 1u),
+           toUs(stxGap.longest), (link.rx.spiTransactions - rxTxn) / seconds,
+           toUs(rxGap.sum) / std::max(rxGap.num, 1u), toUs(rxGap.longest),
+           (link.rxRadio.numRxDone - rxStart) / seconds);
+  return buff;
+}
+
+int main()
+{
+  printf("in sync over 20s\n");
+  printf("          -------- stx ---------  --------- rx ---------\n");
+  printf("           txn/s  gap us  max us     txn/s  gap us  max us     rx/s\n");
+  printf("polling  %s\n", isolated([] { return runLink(stx::sketch(), rx::sketch()); }).c_str());
+  printf("dio0     %s\n", isolated([] { return runLink(stx_dio0::sketch(), rx_dio0::sketch()); }).c_str());
+  return 0;
+}
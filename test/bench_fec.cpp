@@ -0,0 +1,46 @@
+// Rc frames through a channel with random bit errors, sent with forward error correction and,
+// for comparison, without it as when ENABLE_RC_FEC is commented out. Bit errors hit every byte
+// that gets through on their own, at the given rate. The lora header is taken as always received.
+
+#include "sketch_rx.h"
+#include "link.h"
+
+#include <stdio.h>
+
+namespace stx_nofec { sim::Sketch sketch(); }
+
+using namespace sim;
+
+static std::string runErrors(const Sketch &stxSketch, double bitErrorRate)
+{
+  Link link(stxSketch, rx::sketch());
+  link.run(ms(3000));
+  link.medium.bitErrorRate = bitErrorRate;
+
+  uint64_t txStart = link.stxRadio.numTx;
+  uint32_t rcStart = rx::rcPacketCount;
+  uint16_t fixedStart = rx::fecCorrectedCount;
+  const double seconds = 20;
+  link.run(ms(seconds * 1000));
+  uint64_t sent = link.stxRadio.numTx - txStart;
+  uint32_t taken = rx::rcPacketCount - rcStart;
+
+  char buff[100];
+  snprintf(buff, sizeof(buff), "%7.1f  %8.1f%%  %9.1f", taken / seconds, 100.0 * (sent - taken) / sent,
+           (uint16_t)(rx::fecCorrectedCount - fixedStart) / seconds);
+  return buff;
+}
+
+int main()
+{
+  printf("rc frames taken by the receiver over 20s, by bit error rate\n");
+  printf("                 ------- with fec -------    ---- without ----\n");
+  printf("     ber      rc/s     lost   fixed/s      rc/s     lost\n");
+  for(double ber : {0.0, 2e-4, 5e-4, 1e-3, 2e-3, 4e-3})
+  {
+    std::string fec = isolated([ber] { return runErrors(stx::sketch(), ber); });
+    std::string plain = isolated([ber] { return runErrors(stx_nofec::sketch(), ber); });
+    printf("%8.0e  %s  %.18s\n", ber, fec.c_str(), plain.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+// How long a hop takes on the receiver board: retuning from the precomputed frequency registers in
+// standby, against the way hop() did it before, through sleep with setFrequency() writing the
+// registers one at a time. Mcu is the time in hop(), radio ready is until the radio can transmit
+// or listen on the new channel, which out of sleep means waiting on its oscillator.
+
+#include "sketch_rx.h"
+#include "sx127x.h"
+
+#include <stdio.h>
+
+namespace rx_oldhop { sim::Sketch sketch(); void hop(); }
+
+using namespace sim;
+
+const int NUM_HOPS = 1000;
+
+/* The sim doesn't charge plain arithmetic. Before, setFrequency() also did a 64-bit division, which
+avr-gcc leaves to __udivmod64 in libgcc: 64 rounds of shifting and subtracting 8 byte values. */
+const Time DIV64_CYCLES = 2500;
+
+static std::string runHops(const Sketch &sketch, void (*hop)())
+{
+  Sim s;
+  Medium medium;
+  s.medium = &medium;
+  Mcu &board = s.add("rx", sketch);
+  Sx127x radio(medium, board, "rx");
+  s.run(ms(500)); //past setup
+
+  Time mcuTime = 0;
+  Time readyTime = 0;
+  uint64_t numTransactions = 0;
+  uint64_t numBytes = 0;
+  uint64_t numOscStarts = 0;
+  bool isDone = false;
+  board.onLoop = [&](Mcu &m) {
+    if(isDone)
+      return;
+    for(int i = 0; i < NUM_HOPS; i++)
+    {
+      Time start = m.now;
+      uint64_t transactions = m.spiTransactions;
+      uint64_t bytes = m.spiBytes;
+      uint64_t oscStarts = radio.numOscStarts;
+      hop();
+      mcuTime += m.now - start;
+      numTransactions += m.spiTransactions - transactions;
+      numBytes += m.spiBytes - bytes;
+      numOscStarts += radio.numOscStarts - oscStarts;
+      readyTime += std::max(m.now, radio.oscReadyAt) - start;
+      m.charge(ms(1)); //apart, as hops are
+    }
+    isDone = true;
+  };
+  while(!isDone)
+    s.run(ms(100));
+
+  char buff[100];
+  snprintf(buff, sizeof(buff), "%8.1f %8.1f %8.1f %8.1f %8.2f", toUs(mcuTime) / NUM_HOPS,
+           (double)numTransactions / NUM_HOPS, (double)numBytes / NUM_HOPS,
+           toUs(readyTime) / NUM_HOPS, (double)numOscStarts / NUM_HOPS);
+  return buff;
+}
+
+int main()
+{
+  printf("per hop, mean over %d hops\n", NUM_HOPS);
+  printf("                   mcu us  spi txn    bytes  ready us  sleeps\n");
+  printf("sleep, setFreq  %s\n", isolated([] { return runHops(rx_oldhop::sketch(), rx_oldhop::hop); }).c_str());
+  printf("setFrf          %s\n", isolated([] { return runHops(rx::sketch(), rx::hop); }).c_str());
+  printf("\nnot in the mcu time above: the 64-bit division setFrequency() did, about %.0fus\n",
+         toUs(DIV64_CYCLES));
+  return 0;
+}
@@ -0,0 +1,44 @@
+// The radio link end to end: the master sending stick data every 27ms, the slave mcu sending it
+// on in slots, the receiver hopping along and replying with telemetry. Prints what gets through,
+// on a clean channel and with packets lost at random.
+
+#include "sketch_rx.h"
+#include "link.h"
+
+#include <stdio.h>
+
+using namespace sim;
+
+static std::string runLink(double lossRate)
+{
+  Link link;
+  link.medium.lossRate = lossRate;
+
+  //give the receiver time to find the transmitter
+  link.run(ms(3000));
+  uint64_t txStart = link.stxRadio.numTx;
+  uint64_t telemStart = link.stxRadio.numRxDone;
+  uint32_t rcStart = rx::rcPacketCount;
+  uint16_t lossesStart = rx::stats[rx::STAT_SYNC_LOSSES];
+  const double seconds = 20;
+  link.run(ms(seconds * 1000));
+
+  char buff[200];
+  snprintf(buff, sizeof(buff), "%5.0f%%  %8.1f  %8.1f  %8.1f  %5u  %9u  %7u\n",
+           lossRate * 100,
+           (link.stxRadio.numTx - txStart) / seconds,
+           (rx::rcPacketCount - rcStart) / seconds,
+           (link.stxRadio.numRxDone - telemStart) / seconds,
+           master::reply.linkQuality,
+           rx::stats[rx::STAT_SYNC_LOSSES] - lossesStart,
+           rx::stats[rx::STAT_LONGEST_GAP]);
+  return buff;
+}
+
+int main()
+{
+  printf("loss    stx tx/s  rc rx/s  telem/s    LQ  sync lost  gap ms\n");
+  for(double loss : {0.0, 0.1, 0.3})
+    printf("%s", isolated([loss] { return runLink(loss); }).c_str());
+  return 0;
+}
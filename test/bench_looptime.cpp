@@ -0,0 +1,69 @@
+// The receiver's loop time while it sends replies: telemetry in its slots, then the reply to a
+// read of the receiver config. The receiver as it is, with the reply queue, against a copy that
+// sends its replies as before it: a delay, then a blocking endPacket(), within the pass of the loop
+// that queues them. The loop time is from one call of loop() to the next, interrupts included.
+
+#include "link.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace rx_blockreply { sim::Sketch sketch(); }
+
+using namespace sim;
+
+//Longest loop and loops over 2ms while the link runs for the given time
+struct LoopTimes {
+  Time last = 0;
+  Time longest = 0;
+  uint32_t numLoops = 0;
+  uint32_t numOver2ms = 0;
+
+  void onLoop(Mcu &m)
+  {
+    if(last)
+    {
+      longest = std::max(longest, m.now - last);
+      if(m.now - last > ms(2))
+        numOver2ms++;
+    }
+    last = m.now;
+    numLoops++;
+  }
+
+  std::string report()
+  {
+    char buff[100];
+    snprintf(buff, sizeof(buff), "%8.2f  %8u  %8u", toMs(longest), numOver2ms, numLoops);
+    longest = 0;
+    numOver2ms = 0;
+    numLoops = 0;
+    return buff;
+  }
+};
+
+static std::string runReplies(const Sketch &rxSketch)
+{
+  Link link(stx::sketch(), rxSketch);
+  link.run(ms(3000));
+
+  LoopTimes times;
+  link.rx.onLoop = [&](Mcu &m) { times.onLoop(m); };
+  link.run(ms(10000));
+  std::string telemetry = times.report();
+
+  master::settings.requestRxConfig = true;
+  link.run(ms(1000));
+  std::string config = times.report();
+
+  return "telemetry, 10s  " + telemetry + "\nconfig read, 1s " + config + "\n";
+}
+
+int main()
+{
+  printf("receiver loop time while replying\n");
+  printf("                 longest ms  over 2ms     loops\n");
+  printf("blocking reply, as before\n%s", isolated([] { return runReplies(rx_blockreply::sketch()); }).c_str());
+  printf("reply queue\n%s", isolated([] { return runReplies(rx::sketch()); }).c_str());
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Automatic power control over a link that fades out and comes back. The path loss goes from 90dB
+// up to 140dB over a minute, stays there for 10s, then comes back down over a minute, with 2dB of
+// random fading on each packet. At 140dB a packet sent at 17dBm arrives about 1.5dB below the SF7
+// floor, and 3.5dB above the SF9 one. Prints what the receiver gets and the power used, at a fixed
+// 17dBm and in the automatic modes, with and without the long range profile.
+
+#include "sketch_stx.h"
+#include "link.h"
+
+#include <stdio.h>
+
+using namespace sim;
+
+const double SEGMENT_S = 10;
+const int NUM_SEGMENTS = 14;
+
+static double pathLossAt(double s)
+{
+  if(s < 10)
+    return 90;
+  if(s < 70)
+    return 90 + (s - 10) * 50 / 60;
+  if(s < 80)
+    return 140;
+  if(s < 140)
+    return 140 - (s - 80) * 50 / 60;
+  return 90;
+}
+
+static std::string runPower(uint8_t rfPower, bool isLongRangeAllowed)
+{
+  Link link;
+  master::settings.rfPower = rfPower;
+  master::settings.isLongRangeAllowed = isLongRangeAllowed;
+  link.medium.fadingDb = 2;
+  link.run(ms(3000));
+  Time start = link.sim.now();
+  link.medium.pathLoss = [start](const Sx127x &, const Sx127x &, Time at) {
+    return pathLossAt(at > start ? toMs(at - start) / 1000 : 0);
+  };
+
+  const double mW[NUM_RF_POWER_LEVELS] = {2, 5, 10, 25, 50};
+  std::string out;
+  double totalMw = 0;
+  uint32_t numSamples = 0;
+  uint32_t numChanges = 0;
+  uint8_t prevLevel = stx::idxRFPowerLevel;
+  for(int seg = 0; seg < NUM_SEGMENTS; seg++)
+  {
+    uint64_t rxStart = link.rxRadio.numRxDone;
+    double segMw = 0;
+    int segSamples = 0;
+    for(int i = 0; i < SEGMENT_S * 10; i++)
+    {
+      link.run(ms(100));
+      segMw += mW[stx::idxRFPowerLevel];
+      segSamples++;
+      if(stx::idxRFPowerLevel != prevLevel)
+        numChanges++;
+      prevLevel = stx::idxRFPowerLevel;
+    }
+    totalMw += segMw;
+    numSamples += segSamples;
+    char buff[40];
+    snprintf(buff, sizeof(buff), " %5.1f %4.0f", (link.rxRadio.numRxDone - rxStart) / SEGMENT_S,
+             segMw / segSamples);
+    out += buff;
+  }
+  char buff[60];
+  snprintf(buff, sizeof(buff), "|%5.1f %4u", totalMw / numSamples, numChanges);
+  return out + buff;
+}
+
+int main()
+{
+  printf("rc packets received per second and mean power in mW, by 10s segment, then the mean power\n");
+  printf("over the run and the number of level changes\n\n");
+  printf("loss dB    ");
+  for(int seg = 0; seg < NUM_SEGMENTS; seg++)
+    printf(" %10.0f", pathLossAt(seg * SEGMENT_S + SEGMENT_S / 2));
+  printf("\n");
+  struct { const char *name; uint8_t setting; bool isLongRangeAllowed; } modes[] = {
+    {"17dBm      ", 4, false},
+    {"Auto<50mW  ", RF_POWER_AUTO_FIRST + 2, false},
+    {"Auto<25mW  ", RF_POWER_AUTO_FIRST + 1, false},
+    {"AutoLR<50mW", RF_POWER_AUTO_FIRST + 2, true},
+  };
+  for(auto &m : modes)
+  {
+    std::string row = isolated([&m] { return runPower(m.setting, m.isLongRangeAllowed); });
+    printf("%s%s\n", m.name, row.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+// The receiver's radio in continuous RX mode, as parsePacket() leaves it, against single RX mode
+// as the driver used before, re-armed whenever a poll finds the radio out of RX. Both poll, with
+// DIO0 not wired as on the receiver board. Deaf is the rate of packets on the receiver's channel
+// and settings that came while it was out of RX. Fifo top is the highest FIFO address a received
+// packet was written to, which should stay below the TX half at 0x80.
+
+#include "sketch_rx.h"
+#include "link.h"
+
+#include <stdio.h>
+
+namespace rx_single { sim::Sketch sketch(); }
+
+using namespace sim;
+
+static std::string runMode(const Sketch &rxSketch, double lossRate, bool isFromBoot)
+{
+  Link link(stx::sketch(), rxSketch);
+  link.medium.lossRate = lossRate;
+  int fifoTop = 0;
+  link.rxRadio.onPacket = [&](const Packet &, bool isReceived) {
+    if(isReceived)
+      fifoTop = std::max(fifoTop, (int)(uint8_t)(link.rxRadio.rxWritePtr - 1));
+  };
+  if(!isFromBoot)
+    link.run(ms(3000));
+
+  uint64_t rxStart = link.rxRadio.numRxDone;
+  uint64_t missedStart = link.rxRadio.numMissed;
+  const double seconds = isFromBoot ? 5 : 20;
+  link.run(ms(seconds * 1000));
+
+  char buff[100];
+  snprintf(buff, sizeof(buff), "%7.1f  %6.1f  %6.2X", (link.rxRadio.numRxDone - rxStart) / seconds,
+           (link.rxRadio.numMissed - missedStart) / seconds, fifoTop);
+  return buff;
+}
+
+int main()
+{
+  printf("packets received per second, in sync over 20s and from boot over 5s\n");
+  printf("                   ------ continuous ------    -------- single --------\n");
+  printf("                   rx/s    deaf/s  fifo top     rx/s    deaf/s  fifo top\n");
+  struct { const char *name; double loss; bool isFromBoot; } runs[] = {
+    {"in sync, 0%   ", 0, false},
+    {"in sync, 30%  ", 0.3, false},
+    {"from boot     ", 0, true},
+  };
+  for(auto &r : runs)
+  {
+    std::string cont = isolated([&r] { return runMode(rx::sketch(), r.loss, r.isFromBoot); });
+    std::string single = isolated([&r] { return runMode(rx_single::sketch(), r.loss, r.isFromBoot); });
+    printf("%s  %s    %s\n", r.name, cont.c_str(), single.c_str());
+  }
+  return 0;
+}
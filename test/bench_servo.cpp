@@ -0,0 +1,201 @@
+// Servo pulse jitter: the pulse engine in servos.h against the Servo library the receiver used
+// before. Each drives the receiver's 9 servo pins on a board of its own, under the same load: a
+// new set of values every 30ms as packets would bring, an SBUS frame out of the serial port every
+// 14ms, and the millis() tick. As before, the Servo library is given the values on every loop.
+// Then the receiver sketch itself, over the simulated link.
+// Widths are measured at the pins. Jitter is the spread of the widths a pin puts out for the same
+// value, and the spread of the frame period. Offset is how far the mean width is from the value.
+
+#include "sketch_rx.h"
+#include "link.h"
+#include <Servo.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace sim;
+
+const uint8_t PINS[] = {2, 5, 3, 4, A5, A4, A3, A2, A1}; //as in the receiver
+const int NUM_PINS = sizeof(PINS);
+const uint16_t SPREAD_US[NUM_PINS] = {1000, 1900, 1100, 1800, 1200, 1700, 1300, 1600, 1400};
+const uint16_t CENTRED_US[NUM_PINS] = {1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500};
+
+const uint16_t *widthsUs = SPREAD_US;
+uint16_t framePeriodUs = 20000;
+
+//The load both engines run under. Calls writeAll() when a packet would have come
+static void loadLoop(void (*writeAll)())
+{
+  static uint32_t lastPacketMicros = 0;
+  static uint32_t lastSbusMicros = 0;
+  uint32_t now = micros();
+  if(now - lastPacketMicros >= 30000)
+  {
+    lastPacketMicros = now;
+    writeAll();
+  }
+  if(now - lastSbusMicros >= 14000)
+  {
+    lastSbusMicros = now;
+    uint8_t frame[25] = {0x0F};
+    Serial.write(frame, sizeof(frame));
+  }
+}
+
+namespace engine {
+#include "../rx/servos.h"
+
+void writeAll()
+{
+  for(int i = 0; i < NUM_PINS; i++)
+    servoWrite(i, widthsUs[i]);
+  servoCommit();
+}
+
+void setup()
+{
+  Serial.begin(100000, SERIAL_8E2);
+  for(int i = 0; i < NUM_PINS; i++)
+    servoAttach(PINS[i]);
+  writeAll();
+  servoBegin(framePeriodUs);
+}
+
+void loop()
+{
+  loadLoop(writeAll);
+}
+
+Sketch sketch()
+{
+  return Sketch{"engine", setup, loop, {{VEC_TIMER1_COMPA, TIMER1_COMPA_vect}, {VEC_TIMER1_COMPB, TIMER1_COMPB_vect}}};
+}
+}
+
+namespace library {
+Servo servos[NUM_PINS];
+
+void writeAll()
+{
+  for(int i = 0; i < NUM_PINS; i++)
+    servos[i].writeMicroseconds(widthsUs[i]);
+}
+
+void setup()
+{
+  Serial.begin(100000, SERIAL_8E2);
+  for(int i = 0; i < NUM_PINS; i++)
+    servos[i].attach(PINS[i]);
+  writeAll();
+}
+
+void loop()
+{
+  writeAll(); //as the receiver did, every loop
+  loadLoop(writeAll);
+}
+
+Sketch sketch()
+{
+  return Sketch{"library", setup, loop, {{VEC_TIMER1_COMPA, ServoTimer1Isr}}};
+}
+}
+
+//Widths per pin and the period between the starts of the first pin's pulses
+struct PulseLog {
+  Time riseAt[Mcu::NUM_PINS] = {};
+  std::vector<double> widths[Mcu::NUM_PINS];
+  std::vector<double> periods;
+  bool isRecording = false;
+
+  void onPin(const PinEvent &e)
+  {
+    if(!isRecording)
+      return;
+    if(e.level)
+    {
+      if(e.pin == PINS[0] && riseAt[e.pin])
+        periods.push_back(toUs(e.time - riseAt[e.pin]));
+      riseAt[e.pin] = e.time;
+    }
+    else if(riseAt[e.pin])
+      widths[e.pin].push_back(toUs(e.time - riseAt[e.pin]));
+  }
+
+  //worst width spread, rms width deviation, worst offset from the value, frame period spread
+  std::string report(const uint16_t *values, bool hasFramePeriod)
+  {
+    double worstSpread = 0, sumSq = 0, worstOffset = 0;
+    size_t n = 0;
+    for(int i = 0; i < NUM_PINS; i++)
+    {
+      std::vector<double> &w = widths[PINS[i]];
+      if(w.empty())
+        return "no pulses";
+      double mean = 0;
+      for(double x : w)
+        mean += x;
+      mean /= w.size();
+      for(double x : w)
+        sumSq += (x - mean) * (x - mean);
+      n += w.size();
+      worstSpread = std::max(worstSpread, *std::max_element(w.begin(), w.end()) - *std::min_element(w.begin(), w.end()));
+      worstOffset = std::max(worstOffset, fabs(mean - values[i]));
+    }
+    char buff[120];
+    if(hasFramePeriod)
+      snprintf(buff, sizeof(buff), "%8.2f %8.2f %8.2f %8.2f", worstSpread, sqrt(sumSq / n), worstOffset,
+               *std::max_element(periods.begin(), periods.end()) - *std::min_element(periods.begin(), periods.end()));
+    else
+      snprintf(buff, sizeof(buff), "%8.2f %8.2f %8.2f %8s", worstSpread, sqrt(sumSq / n), worstOffset, "-");
+    return buff;
+  }
+};
+
+static std::string runBoard(const Sketch &sketch, const uint16_t *widths, uint16_t period)
+{
+  widthsUs = widths;
+  framePeriodUs = period;
+  Sim s;
+  Mcu &board = s.add(sketch.name, sketch);
+  PulseLog log;
+  board.onPinChange = [&](const PinEvent &e) { log.onPin(e); };
+  s.run(ms(500));
+  log.isRecording = true;
+  s.run(ms(20000));
+  return log.report(widths, true);
+}
+
+static std::string runReceiver()
+{
+  Link link;
+  PulseLog log;
+  link.rx.onPinChange = [&](const PinEvent &e) { log.onPin(e); };
+  link.run(ms(3000));
+  log.isRecording = true;
+  link.run(ms(20000));
+  //the master's sticks are centred
+  return log.report(CENTRED_US, false);
+}
+
+int main()
+{
+  printf("over 20s, in us   spread      rms   offset  frame spread\n");
+  struct { const char *name; bool isLibrary; const uint16_t *widths; uint16_t period; } runs[] = {
+    {"library, spread ", true, SPREAD_US, 20000},
+    {"engine, spread  ", false, SPREAD_US, 20000},
+    {"library, centred", true, CENTRED_US, 20000},
+    {"engine, centred ", false, CENTRED_US, 20000},
+    {"engine, 333Hz   ", false, SPREAD_US, 3000},
+  };
+  for(auto &r : runs)
+  {
+    std::string row = isolated([&r] {
+      return runBoard(r.isLibrary ? library::sketch() : engine::sketch(), r.widths, r.period);
+    });
+    printf("%s %s\n", r.name, row.c_str());
+  }
+  printf("receiver sketch  %s\n", isolated(runReceiver).c_str());
+  return 0;
+}
@@ -0,0 +1,54 @@
+// Slot timing under packet loss. The transmitter sends in fixed slots and hops after each one,
+// and the receiver hops on the same schedule whether or not the packet came in. This measures
+// how well the two stay in step as more and more packets are lost at random.
+
+#include "sketch_rx.h"
+#include "link.h"
+
+#include <stdio.h>
+
+using namespace sim;
+
+static std::string runLoss(double lossRate)
+{
+  Link link;
+  link.run(ms(3000));
+  link.medium.lossRate = lossRate;
+
+  //every packet on the receiver's channel comes through here, whether it was received or not
+  uint64_t onChannel = 0;
+  link.rxRadio.onPacket = [&](const Packet &p, bool) {
+    if(p.sender == &link.stxRadio)
+      onChannel++;
+  };
+
+  uint64_t txStart = link.stxRadio.numTx;
+  uint32_t rcStart = rx::rcPacketCount;
+  uint16_t missedStart = rx::stats[rx::STAT_MISSED_SLOTS];
+  uint16_t lossesStart = rx::stats[rx::STAT_SYNC_LOSSES];
+  uint16_t failsafesStart = rx::stats[rx::STAT_FAILSAFES];
+  const double seconds = 20;
+  link.run(ms(seconds * 1000));
+  uint64_t sent = link.stxRadio.numTx - txStart;
+
+  char buff[200];
+  snprintf(buff, sizeof(buff), "%4.0f%%  %7.1f  %7.1f  %7.1f  %9.1f%%  %9u  %9u  %6u\n",
+           lossRate * 100,
+           sent / seconds,
+           (rx::rcPacketCount - rcStart) / seconds,
+           (rx::stats[rx::STAT_MISSED_SLOTS] - missedStart) / seconds,
+           100.0 * onChannel / sent,
+           rx::stats[rx::STAT_SYNC_LOSSES] - lossesStart,
+           rx::stats[rx::STAT_FAILSAFES] - failsafesStart,
+           rx::stats[rx::STAT_LONGEST_GAP]);
+  return buff;
+}
+
+int main()
+{
+  printf("over 20s with the link in sync to start with, slots of %lums\n", SLOT_PERIOD_FAST_US / 1000);
+  printf("loss   sent/s   rc rx/s  missed/s  on channel  sync lost  failsafes  gap ms\n");
+  for(double loss : {0.0, 0.1, 0.3, 0.5, 0.7, 0.9})
+    printf("%s", isolated([loss] { return runLoss(loss); }).c_str());
+  return 0;
+}
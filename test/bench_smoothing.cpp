@@ -0,0 +1,127 @@
+// Output smoothing on the receiver: what a stick moved steadily looks like at a servo pin, and what
+// the smoothing costs. The receiver as it is, with 20ms servo frames, against a copy with
+// ENABLE_OUTPUT_SMOOTHING on and 5ms frames. Step is the largest change from one pulse to the
+// next while channel 1 crosses its range in a second, 30us a packet. Lag is how far the pulses
+// are behind the stick, from the master through the link to the pin, in the middle of the move.
+
+#include "link.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+namespace rx_smooth {
+extern int smoothFrom[];
+extern int smoothTo[];
+extern int smoothOut[];
+extern volatile bool isServoFrameStarted;
+void updateSmoothOutputs();
+sim::Sketch sketch();
+}
+
+using namespace sim;
+
+const uint8_t PIN_CH1 = 2;
+const int NUM_OUTPUTS = 9;
+const int NUM_CALLS = 200;
+
+/* The sim doesn't charge plain arithmetic, so this part is counted from the AVR instruction
+timings, for code as avr-gcc would make it. Per moving output: loading and comparing smoothOut[]
+and smoothTo[], the subtraction, the 16x16 multiply in libgcc's __usmulhisi3 with its call,
+rounding and the shift by 8, the store and servoWrite(). Per frame with any output moving: the
+32-bit divide in smoothFraction(), __udivmodsi4 in libgcc, and servoCommit() rebuilding the edge
+schedule for 9 outputs. */
+const Time OUTPUT_CYCLES = 85;
+const Time DIVIDE_CYCLES = 650;
+const Time COMMIT_CYCLES = 500;
+
+static std::string runRamp(const Sketch &rxSketch)
+{
+  Link link(stx::sketch(), rxSketch);
+  master::settings.channels[0] = -500;
+  link.run(ms(3000));
+
+  std::vector<std::pair<Time, double>> pulses;
+  Time riseAt = 0;
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin != PIN_CH1)
+      return;
+    if(e.level)
+      riseAt = e.time;
+    else if(riseAt)
+      pulses.push_back(std::make_pair(riseAt, toUs(e.time - riseAt)));
+  };
+  Time start = link.sim.now();
+  for(int i = 1; i <= 100; i++)
+  {
+    master::settings.channels[0] = -500 + i * 10;
+    link.run(ms(10));
+  }
+  link.run(ms(200));
+
+  double maxStep = 0;
+  double lagSum = 0;
+  int numLag = 0;
+  for(size_t k = 1; k < pulses.size(); k++)
+  {
+    maxStep = std::max(maxStep, fabs(pulses[k].second - pulses[k - 1].second));
+    //the stick moves 1us of pulse every ms
+    if(pulses[k].second > 1200 && pulses[k].second < 1800)
+    {
+      lagSum += toMs(pulses[k].first - start) - (pulses[k].second - 1000);
+      numLag++;
+    }
+  }
+  char buff[100];
+  snprintf(buff, sizeof(buff), "%8.1f  %8.1f", maxStep, numLag ? lagSum / numLag : 0.0);
+  return buff;
+}
+
+//Time in updateSmoothOutputs() with the given number of outputs moving, the least over a number
+//of calls so that interrupts are left out
+static std::string runCost(int numMoving)
+{
+  Link link(stx::sketch(), rx_smooth::sketch());
+  link.run(ms(3000));
+
+  Time least = NEVER;
+  int numCalls = 0;
+  link.rx.onLoop = [&](Mcu &m) {
+    if(numCalls >= NUM_CALLS)
+      return;
+    for(int i = 0; i < NUM_OUTPUTS; i++)
+    {
+      rx_smooth::smoothFrom[i] = 1000;
+      rx_smooth::smoothTo[i] = i < numMoving ? 2000 : 1000;
+      rx_smooth::smoothOut[i] = 1000;
+    }
+    rx_smooth::isServoFrameStarted = true;
+    Time t = m.now;
+    rx_smooth::updateSmoothOutputs();
+    least = std::min(least, m.now - t);
+    numCalls++;
+  };
+  while(numCalls < NUM_CALLS)
+    link.run(ms(10));
+
+  Time counted = numMoving ? numMoving * OUTPUT_CYCLES + DIVIDE_CYCLES + COMMIT_CYCLES : 0;
+  char buff[100];
+  snprintf(buff, sizeof(buff), "%8.1f  %8.1f  %8.1f", toUs(least), toUs(counted), toUs(least + counted));
+  return buff;
+}
+
+int main()
+{
+  printf("channel 1 crossing its range in 1s\n");
+  printf("                        step us    lag ms\n");
+  printf("as is, 20ms frames    %s\n", isolated([] { return runRamp(rx::sketch()); }).c_str());
+  printf("smoothed, 5ms frames  %s\n", isolated([] { return runRamp(rx_smooth::sketch()); }).c_str());
+
+  printf("\nupdateSmoothOutputs() per servo frame, in us\n");
+  printf("outputs moving       charged   counted     total\n");
+  for(int n : {0, 1, NUM_OUTPUTS})
+    printf("%d                   %s\n", n, isolated([n] { return runCost(n); }).c_str());
+  printf("\ncharged is what the sim charges, the micros() call. counted is the arithmetic, %.1fus an\n"
+         "output, see the top of the file\n", toUs(OUTPUT_CYCLES));
+  return 0;
+}
@@ -0,0 +1,48 @@
+// Checks for the host tests. A failed check prints where it is and the test carries on, then
+// checkReport() at the end of main() gives the exit code.
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <math.h>
+
+inline int checkCount = 0;
+inline int checkFailures = 0;
+
+inline void checkFailed(const char *file, int line, const char *what)
+{
+  checkFailures++;
+  printf("%s:%d: check failed: %s\n", file, line, what);
+}
+
+#define CHECK(cond) \
+  do { checkCount++; if(!(cond)) checkFailed(__FILE__, __LINE__, #cond); } while(0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    checkCount++; \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if(_a != _b) { \
+      checkFailed(__FILE__, __LINE__, #a " == " #b); \
+      printf("  %lld != %lld\n", _a, _b); \
+    } \
+  } while(0)
+
+#define CHECK_NEAR(a, b, tol) \
+  do { \
+    checkCount++; \
+    double _a = (double)(a), _b = (double)(b); \
+    if(fabs(_a - _b) > (tol)) { \
+      checkFailed(__FILE__, __LINE__, #a " ~= " #b); \
+      printf("  %g vs %g, tolerance %g\n", _a, _b, (double)(tol)); \
+    } \
+  } while(0)
+
+inline int checkReport(const char *name)
+{
+  printf("%s: %d checks, %d failed\n", name, checkCount, checkFailures);
+  return checkFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,19 @@
+// See link.h
+
+#include "link.h"
+
+namespace sim {
+
+Link::Link(const Sketch &stxSketch, const Sketch &rxSketch) :
+  master(sim.add("master", master::sketch())),
+  stx(sim.add("stx", stxSketch)),
+  rx(sim.add("rx", rxSketch)),
+  stxRadio(medium, stx, "stx"),
+  rxRadio(medium, rx, "rx")
+{
+  sim.medium = &medium;
+  sim.connectSerial(master, stx);
+  sim.connectSerial(stx, master);
+}
+
+}
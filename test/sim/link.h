@@ -0,0 +1,35 @@
+// The whole radio link on one timeline: the master mcu stand-in, the transmitter's slave mcu and
+// the receiver, with an SX127x each on one medium, wired as on the boards.
+//
+// The sketches come from sketch_stx.h and sketch_rx.h, which the test builds in its own
+// translation units. Sketch state is global, so one Link per process, see sim::isolated().
+
+#ifndef LINK_H
+#define LINK_H
+
+#include "sim.h"
+#include "sx127x.h"
+#include "master.h"
+
+namespace stx { sim::Sketch sketch(); }
+namespace rx { sim::Sketch sketch(); }
+
+namespace sim {
+
+struct Link {
+  Sim sim;
+  Medium medium;
+  Mcu &master;
+  Mcu &stx;
+  Mcu &rx;
+  Sx127x stxRadio;
+  Sx127x rxRadio;
+
+  Link() : Link(stx::sketch(), rx::sketch()) {}
+  Link(const Sketch &stxSketch, const Sketch &rxSketch);
+  void run(Time duration) { sim.run(duration); }
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+// Stand-in for the master MCU. See master.h
+
+#include "master.h"
+#include <Arduino.h>
+
+namespace master {
+
+Settings settings;
+Reply reply;
+uint32_t numReplies = 0;
+uint32_t numBadReplies = 0;
+std::function<void(const Reply &)> onReply;
+uint16_t rxStats[RX_STATS_MAX];
+uint8_t rxSensorType[RX_SENSORS_MAX];
+int16_t rxSensorValue[RX_SENSORS_MAX];
+
+static uint32_t loopNum = 0;
+
+static uint8_t crc8Maxim(const uint8_t *data, uint8_t len)
+{
+  uint8_t crc = 0;
+  while(len--)
+  {
+    uint8_t b = *data++;
+    for(uint8_t i = 0; i < 8; i++)
+    {
+      uint8_t mix = (crc ^ b) & 0x01;
+      crc >>= 1;
+      if(mix)
+        crc ^= 0x8C;
+      b >>= 1;
+    }
+  }
+  return crc;
+}
+
+static void writeBits(uint8_t *buff, uint16_t bitPos, uint8_t numBits, uint16_t val)
+{
+  //msb first
+  for(uint8_t i = 0; i < numBits; i++)
+  {
+    uint16_t pos = bitPos + i;
+    if((val >> (numBits - 1 - i)) & 1)
+      buff[pos / 8] |= 0x80 >> (pos % 8);
+  }
+}
+
+static void sendMessage()
+{
+  uint8_t buff[24];
+  memset(buff, 0, sizeof(buff));
+  buff[0] = (settings.rfPower & 0x07) | (settings.isRfEnabled ? 0x08 : 0);
+  uint8_t status1 = (settings.telemRatioIdx & 0x07) << 5;
+  if(settings.isLongRangeAllowed)
+    status1 |= 0x08;
+  if(settings.requestBind)
+  {
+    status1 |= 0x10;
+    settings.requestBind = false;
+  }
+  else if(settings.requestRxConfig)
+  {
+    status1 |= 0x04;
+    settings.requestRxConfig = false;
+  }
+  else if(settings.isFailsafeEvery600ms && loopNum % (600 / settings.loopMs) == 1)
+    status1 |= 0x01;
+  buff[1] = status1;
+  bool isFailsafe = (status1 & 0x01) && settings.isFailsafeSet;
+  for(uint8_t i = 0; i < 16; i++)
+    writeBits(buff + 3, i * 10, 10, isFailsafe ? settings.failsafes[i] & 0x3FF
+                                               : constrain(settings.channels[i], -500, 500) + 500);
+  buff[23] = crc8Maxim(buff, 23);
+  Serial.write(buff, sizeof(buff));
+}
+
+static void readReply()
+{
+  if(Serial.available() < REPLY_LEN)
+    return;
+  uint8_t buff[64];
+  uint8_t n = 0;
+  while(Serial.available() > 0)
+  {
+    int b = Serial.read();
+    if(n < sizeof(buff))
+      buff[n++] = b;
+  }
+  if(n != REPLY_LEN || buff[REPLY_LEN - 1] != crc8Maxim(buff, REPLY_LEN - 1))
+  {
+    numBadReplies++;
+    return;
+  }
+  Reply &r = reply;
+  memcpy(r.raw, buff, REPLY_LEN);
+  r.bindStatus = (buff[0] >> 4) & 0x03;
+  r.txPacketRate = buff[2];
+  r.rxPacketRate = buff[3];
+  r.volts = ((uint16_t)buff[4] << 8) | buff[5];
+  r.slowestChRate = buff[6];
+  r.telemBytesPs = buff[7];
+  r.telemSlotsPs = buff[8];
+  r.linkQuality = buff[9];
+  r.uplinkRssi = buff[10];
+  r.uplinkSnr = (int8_t)buff[11];
+  r.crcFailRate = buff[12];
+  r.downlinkRssi = buff[13];
+  r.downlinkSnr = (int8_t)buff[14];
+  r.fecFixRate = buff[15];
+  r.recoveryRate = buff[16];
+  r.rfPowerLevel = buff[17] & 0x07;
+  r.isLongRange = (buff[17] >> 7) & 0x01;
+  r.outputDelay = buff[18];
+  r.processTime = buff[19];
+  r.failsafeDelay = buff[20];
+  r.statsPage = buff[21];
+  if(r.statsPage < RX_STATS_MAX / RX_STATS_PER_PAGE)
+  {
+    for(uint8_t i = 0; i < RX_STATS_PER_PAGE; i++)
+      rxStats[r.statsPage * RX_STATS_PER_PAGE + i] = ((uint16_t)buff[22 + 2 * i] << 8) | buff[23 + 2 * i];
+  }
+  r.sensorPageLen = buff[32];
+  if(r.sensorPageLen == 0) //telemetry lost
+  {
+    for(uint8_t i = 0; i < RX_SENSORS_MAX; i++)
+      rxSensorValue[i] = RX_SENSOR_NO_DATA;
+  }
+  for(uint8_t i = 0; i + 3 <= r.sensorPageLen && i + 3 <= 12; i += 3)
+  {
+    uint8_t idx = buff[33 + i] >> 4;
+    if(idx >= RX_SENSORS_MAX)
+      continue;
+    rxSensorType[idx] = buff[33 + i] & 0x0F;
+    rxSensorValue[idx] = (int16_t)(((uint16_t)buff[34 + i] << 8) | buff[35 + i]);
+  }
+  numReplies++;
+  if(onReply)
+    onReply(r);
+}
+
+static void setup()
+{
+  Serial.begin(115200);
+  for(uint8_t i = 0; i < RX_SENSORS_MAX; i++)
+    rxSensorValue[i] = RX_SENSOR_NO_DATA;
+}
+
+static void loop()
+{
+  unsigned long start = millis();
+  loopNum++;
+  sendMessage();
+  readReply();
+  unsigned long took = millis() - start;
+  if(took < settings.loopMs)
+    delay(settings.loopMs - took);
+}
+
+sim::Sketch sketch()
+{
+  sim::Sketch s;
+  s.name = "master";
+  s.setup = setup;
+  s.loop = loop;
+  return s;
+}
+
+}
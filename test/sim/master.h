@@ -0,0 +1,73 @@
+// Stand-in for the master MCU (mtx). Sends the 24 byte message to the slave every 27ms, as the
+// master's fixed loop time does, and decodes the replies. See doSerialCommunication() in stx.ino
+
+#ifndef MASTER_H
+#define MASTER_H
+
+#include "sim.h"
+
+namespace master {
+
+struct Settings {
+  uint8_t rfPower = 4;        //0 to 4 fixed, 5 to 7 automatic
+  bool isLongRangeAllowed = false; //lets automatic mode use the long range rate profile
+  bool isRfEnabled = true;
+  uint8_t telemRatioIdx = 3;  //ratio is 2 << idx
+  int16_t channels[16] = {};  //-500 to 500
+  bool isFailsafeEvery600ms = true;
+  //Sent in place of the channels in failsafe frames once set, as on air: 0 to 1000, or 1022 for no 
+  //pulses and 1023 to hold
+  bool isFailsafeSet = false;
+  uint16_t failsafes[16] = {};
+  bool requestBind = false;
+  bool requestRxConfig = false;
+  uint16_t loopMs = 27;
+};
+
+struct Reply {
+  uint8_t bindStatus;
+  uint8_t txPacketRate;
+  uint8_t rxPacketRate;
+  uint16_t volts;
+  uint8_t slowestChRate;
+  uint8_t telemBytesPs;
+  uint8_t telemSlotsPs;
+  uint8_t linkQuality;
+  uint8_t uplinkRssi;
+  int8_t uplinkSnr;
+  uint8_t crcFailRate;
+  uint8_t downlinkRssi;
+  int8_t downlinkSnr;
+  uint8_t fecFixRate;
+  uint8_t recoveryRate;
+  uint8_t rfPowerLevel;
+  bool isLongRange;           //the long range rate profile is in use
+  uint8_t outputDelay;
+  uint8_t processTime;
+  uint8_t failsafeDelay;
+  uint8_t statsPage;          //receiver link statistics page carried. 0xFF is no data
+  uint8_t sensorPageLen;      //receiver sensor page carried, 3 bytes an entry. 0 is no data
+  uint8_t raw[64];
+};
+
+const uint8_t REPLY_LEN = 55;
+const uint8_t RX_STATS_PER_PAGE = 5;
+const uint8_t RX_STATS_MAX = 15;
+const uint8_t RX_SENSORS_MAX = 6;
+const int16_t RX_SENSOR_NO_DATA = (int16_t)0x8000;
+
+extern Settings settings;
+extern Reply reply;           //the last valid reply
+extern uint32_t numReplies;
+extern uint32_t numBadReplies;
+extern std::function<void(const Reply &)> onReply;
+//Built up from the pages in the replies, as getSerialData() in mtx.cpp does
+extern uint16_t rxStats[RX_STATS_MAX];
+extern uint8_t rxSensorType[RX_SENSORS_MAX];
+extern int16_t rxSensorValue[RX_SENSORS_MAX];
+
+sim::Sketch sketch();
+
+}
+
+#endif
@@ -0,0 +1,567 @@
+// Atmega328p board model: clock, interrupts and the peripherals the sketches use. See sim.h
+
+#include "sim.h"
+#include "sx127x.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace sim {
+
+static Mcu *current = NULL;
+
+Mcu &cur()
+{
+  return *current;
+}
+
+void setCurrent(Mcu *mcu)
+{
+  current = mcu;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Mcu::Mcu(const std::string &name, const Sketch &sketch) : name(name), sketch(sketch)
+{
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  for(const Sketch::Isr &isr : sketch.isrs)
+    vectors[isr.vector] = isr.handler;
+  //Arduino core init(): timer1 is left at prescaler 64 for analogWrite()
+  tccr1b = 0x03;
+}
+
+Mcu::~Mcu()
+{
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Mcu::charge(Time cycles)
+{
+  checkPorts();
+
+  Time remaining = cycles;
+  for(;;)
+  {
+    //interrupts are taken between instructions, and the one that is pending still needs
+    //doing when the code that was running is paused
+    if(iFlag && !inIsr)
+      dispatch();
+
+    if(remaining == 0)
+      break;
+
+    Time next = nextEvent();
+    Time stop = now + remaining;
+    if(next < stop)
+      stop = next;
+    if(sliceEnd < stop && sliceEnd > now)
+      stop = sliceEnd;
+    remaining -= stop - now;
+    now = stop;
+
+    processEvents(now);
+
+    if(now >= sliceEnd)
+      yieldToScheduler();
+  }
+}
+
+void Mcu::pollInterrupts()
+{
+  processEvents(now);
+  if(iFlag && !inIsr)
+    dispatch();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Time Mcu::nextEvent()
+{
+  Time t = nextTimer0Ovf;
+  t = std::min(t, t1MatchA);
+  t = std::min(t, t1MatchB);
+  if(eeBusyUntil > now)
+    t = std::min(t, eeBusyUntil);
+  t = std::min(t, adcDone);
+  t = std::min(t, txShiftDone);
+  if(!rxWire.empty())
+    t = std::min(t, std::max(rxWire.front().first, now));
+  if(radio)
+    t = std::min(t, std::max(radio->nextEvent(), now));
+  return t;
+}
+
+void Mcu::processEvents(Time upTo)
+{
+  while(nextTimer0Ovf <= upTo)
+  {
+    tov0 = true; //a second overflow before the first is served is lost, as on the chip
+    nextTimer0Ovf += 1024 * CYCLES_PER_US;
+  }
+
+  Time ps = t1Prescale();
+  while(t1MatchA <= upTo)
+  {
+    tifr1 |= 0x02;
+    t1MatchA += 65536 * ps;
+  }
+  while(t1MatchB <= upTo)
+  {
+    tifr1 |= 0x04;
+    t1MatchB += 65536 * ps;
+  }
+
+  if(adcDone <= upTo)
+    adcDone = NEVER;
+
+  while(txShiftDone <= upTo)
+  {
+    Time done = txShiftDone;
+    uint8_t b = txShiftByte;
+    if(isUdrFull)
+    {
+      txShiftByte = udrByte;
+      isUdrFull = false;
+      txShiftDone = done + byteCycles();
+    }
+    else
+    {
+      isTxShifting = false;
+      txShiftDone = NEVER;
+    }
+    serialText += (char)b;
+    if(onSerialByte)
+      onSerialByte(*this, b, done);
+  }
+
+  while(!rxWire.empty() && rxWire.front().first <= upTo)
+  {
+    if(baud == 0)
+      ; //receiver not enabled
+    else if(rxPending.size() >= 2) //the receive buffer of the usart holds 2 bytes
+      rxOverruns++;
+    else
+      rxPending.push_back(rxWire.front().second);
+    rxWire.pop_front();
+  }
+
+  if(radio)
+    radio->process(upTo);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Mcu::dispatch()
+{
+  for(;;)
+  {
+    int v = -1;
+    if(extFlag[0] && extHandler[0] && extEnabled[0])
+      v = VEC_INT0;
+    else if(extFlag[1] && extHandler[1] && extEnabled[1])
+      v = VEC_INT1;
+    else if((tifr1 & 0x02) && (timsk1 & 0x02))
+      v = VEC_TIMER1_COMPA;
+    else if((tifr1 & 0x04) && (timsk1 & 0x04))
+      v = VEC_TIMER1_COMPB;
+    else if(tov0)
+      v = VEC_TIMER0_OVF;
+    else if(!rxPending.empty())
+      v = VEC_USART_RX;
+    else if(isUdrePending && !isUdrFull)
+      v = VEC_USART_UDRE;
+    else if((eecr & 0x08) && now >= eeBusyUntil)
+      v = VEC_EE_READY;
+    if(v < 0)
+      return;
+    runIsr(v);
+  }
+}
+
+void Mcu::runIsr(int v)
+{
+  Time start = now;
+  inIsr = true;
+  iFlag = false;
+  isrCount[v]++;
+  charge(costs.isrEntry);
+
+  switch(v)
+  {
+    case VEC_INT0:
+    case VEC_INT1:
+      extFlag[v - VEC_INT0] = false;
+      charge(costs.isrExternal);
+      extHandler[v - VEC_INT0]();
+      break;
+    case VEC_TIMER0_OVF:
+      tov0 = false;
+      timer0Overflows++;
+      timer0Millis += 1;
+      timer0Fract += 3;
+      if(timer0Fract >= 125)
+      {
+        timer0Fract -= 125;
+        timer0Millis += 1;
+      }
+      charge(costs.isrTimer0);
+      break;
+    case VEC_USART_RX:
+      if(rxBuffer.size() < 63)
+        rxBuffer.push_back(rxPending.front());
+      else
+        rxOverruns++;
+      rxPending.pop_front();
+      charge(costs.isrUartRx);
+      break;
+    case VEC_USART_UDRE:
+      writeUdr(txBuffer.front());
+      txBuffer.pop_front();
+      if(txBuffer.empty())
+        isUdrePending = false;
+      charge(costs.isrUartUdre);
+      break;
+    default:
+      if(v == VEC_TIMER1_COMPA)
+        tifr1 &= ~0x02;
+      else if(v == VEC_TIMER1_COMPB)
+        tifr1 &= ~0x04;
+      charge(costs.isrUser);
+      if(vectors[v])
+        vectors[v]();
+      else
+      {
+        fprintf(stderr, "%s: no handler for vector %d\n", name.c_str(), v);
+        abort();
+      }
+      break;
+  }
+
+  checkPorts();
+  isrCycles[v] += now - start;
+  inIsr = false;
+  iFlag = true; //reti
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool Mcu::pinToPort(uint8_t pin, uint8_t &portIdx, uint8_t &bit)
+{
+  if(pin < 8)
+  {
+    portIdx = 2;
+    bit = pin;
+  }
+  else if(pin < 14)
+  {
+    portIdx = 0;
+    bit = pin - 8;
+  }
+  else if(pin < 20)
+  {
+    portIdx = 1;
+    bit = pin - 14;
+  }
+  else
+    return false;
+  return true;
+}
+
+bool Mcu::getPin(uint8_t pin)
+{
+  uint8_t p, b;
+  if(!pinToPort(pin, p, b))
+    return false;
+  if(ddr[p] & (1 << b))
+    return port[p] & (1 << b);
+  if(isInputDriven[pin])
+    return inputLevel[pin];
+  return port[p] & (1 << b); //pull-up
+}
+
+void Mcu::setPin(uint8_t pin, bool level)
+{
+  bool old = getPin(pin);
+  inputLevel[pin] = level;
+  isInputDriven[pin] = true;
+  bool now_ = getPin(pin);
+  if(old == now_)
+    return;
+  if(pin == 2 || pin == 3)
+    raiseExternal(pin - 2, old, now_);
+  if(onPinChange)
+    onPinChange(PinEvent{now, pin, now_});
+}
+
+void Mcu::raiseExternal(uint8_t num, bool oldLevel, bool newLevel)
+{
+  if(!extHandler[num])
+    return;
+  bool fire = false;
+  switch(extMode[num])
+  {
+    case 0: fire = !newLevel; break;             //LOW
+    case 1: fire = true; break;                  //CHANGE
+    case 2: fire = oldLevel && !newLevel; break; //FALLING
+    case 3: fire = !oldLevel && newLevel; break; //RISING
+  }
+  if(fire)
+    extFlag[num] = true;
+}
+
+void Mcu::checkPorts()
+{
+  for(uint8_t p = 0; p < 3; p++)
+  {
+    uint8_t diff = port[p] ^ portShadow[p];
+    if(!diff)
+      continue;
+    portShadow[p] = port[p];
+    for(uint8_t b = 0; b < 8; b++)
+    {
+      if(!(diff & (1 << b)))
+        continue;
+      uint8_t pin = p == 2 ? b : (p == 0 ? b + 8 : b + 14);
+      bool level = port[p] & (1 << b);
+      if(radio && pin == radioSsPin)
+        radio->setNss(level);
+      if(radio && pin == radioResetPin && !level)
+        radio->reset();
+      if(onPinChange && (ddr[p] & (1 << b)))
+        onPinChange(PinEvent{now, pin, level});
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Time Mcu::t1Prescale()
+{
+  static const Time ps[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  return ps[tccr1b & 0x07];
+}
+
+uint16_t Mcu::t1Count()
+{
+  Time ps = t1Prescale();
+  if(ps == 0)
+    return t1Stopped;
+  return (uint16_t)(((int64_t)now - t1Origin) / (int64_t)ps);
+}
+
+void Mcu::t1Schedule()
+{
+  t1MatchA = t1MatchB = NEVER;
+  Time ps = t1Prescale();
+  if(ps == 0)
+    return;
+  int64_t ticks = ((int64_t)now - t1Origin) / (int64_t)ps;
+  uint16_t count = (uint16_t)ticks;
+  uint16_t toA = (uint16_t)(ocr1a - count);
+  uint16_t toB = (uint16_t)(ocr1b - count);
+  //a match with the value the counter already holds is blocked, as after a write to OCR1x
+  t1MatchA = t1Origin + (ticks + (toA ? toA : 65536)) * ps;
+  t1MatchB = t1Origin + (ticks + (toB ? toB : 65536)) * ps;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint8_t Mcu::readReg8(int reg)
+{
+  uint8_t val = 0;
+  switch(reg)
+  {
+    case R_SREG:   val = iFlag ? 0x80 : 0; break;
+    case R_TCCR1A: val = tccr1a; break;
+    case R_TCCR1B: val = tccr1b; break;
+    case R_TIMSK1: val = timsk1; break;
+    case R_TIFR1:  val = tifr1; break;
+    case R_EECR:
+      val = eecr & 0x08;
+      if(now < eeBusyUntil)
+        val |= 0x02;
+      if(now <= eeMasterWriteEnd)
+        val |= 0x04;
+      break;
+    case R_EEDR:   val = eedr; break;
+    case R_ADCSRA: val = adcsra | (adcDone != NEVER ? 0x40 : 0); break;
+    case R_ADMUX:  val = admux; break;
+    default:
+      fprintf(stderr, "%s: read of register %d\n", name.c_str(), reg);
+      abort();
+  }
+  charge(costs.registerAccess);
+  return val;
+}
+
+void Mcu::writeReg8(int reg, uint8_t val)
+{
+  switch(reg)
+  {
+    case R_SREG:
+      iFlag = val & 0x80;
+      break;
+    case R_TCCR1A:
+      tccr1a = val;
+      break;
+    case R_TCCR1B:
+    {
+      uint16_t count = t1Count();
+      tccr1b = val;
+      Time ps = t1Prescale();
+      if(ps)
+        t1Origin = (int64_t)now - (int64_t)count * (int64_t)ps;
+      else
+        t1Stopped = count;
+      t1Schedule();
+      break;
+    }
+    case R_TIMSK1:
+      timsk1 = val;
+      break;
+    case R_TIFR1:
+      tifr1 &= ~val;
+      break;
+    case R_EECR:
+      if(val & 0x01) //EERE
+      {
+        eedr = eeprom[eear & 0x3FF];
+        charge(4);
+      }
+      if((val & 0x02) && now <= eeMasterWriteEnd && now >= eeBusyUntil) //EEPE
+      {
+        if(!eepromWriteFails || !eepromWriteFails(eear & 0x3FF))
+          eeprom[eear & 0x3FF] = eedr;
+        eeBusyUntil = now + us(3400);
+        eeMasterWriteEnd = 0;
+        eepromWrites++;
+        charge(2);
+      }
+      else if((val & 0x04) && !(eecr & 0x04)) //EEMPE
+        eeMasterWriteEnd = now + 4;
+      eecr = val & 0x08;
+      break;
+    case R_EEDR:
+      eedr = val;
+      break;
+    case R_ADCSRA:
+      adcsra = val & ~0x40;
+      if((val & 0x40) && adcDone == NEVER)
+      {
+        adcResult = analogInput[admux & 0x07];
+        adcDone = now + 13 * 128;
+      }
+      break;
+    case R_ADMUX:
+      admux = val;
+      break;
+    default:
+      fprintf(stderr, "%s: write of register %d\n", name.c_str(), reg);
+      abort();
+  }
+  charge(costs.registerAccess);
+  if(reg == R_SREG && iFlag)
+    pollInterrupts();
+}
+
+uint16_t Mcu::readReg16(int reg)
+{
+  uint16_t val = 0;
+  switch(reg)
+  {
+    case R_TCNT1: val = t1Count(); break;
+    case R_OCR1A: val = ocr1a; break;
+    case R_OCR1B: val = ocr1b; break;
+    case R_EEAR:  val = eear; break;
+    case R_ADC:   val = adcResult; break;
+    default:
+      fprintf(stderr, "%s: read of register %d\n", name.c_str(), reg);
+      abort();
+  }
+  charge(2 * costs.registerAccess);
+  return val;
+}
+
+void Mcu::writeReg16(int reg, uint16_t val)
+{
+  switch(reg)
+  {
+    case R_TCNT1:
+    {
+      Time ps = t1Prescale();
+      if(ps)
+        t1Origin = (int64_t)now - (int64_t)val * (int64_t)ps;
+      else
+        t1Stopped = val;
+      t1Schedule();
+      break;
+    }
+    case R_OCR1A: ocr1a = val; t1Schedule(); break;
+    case R_OCR1B: ocr1b = val; t1Schedule(); break;
+    case R_EEAR:  eear = val & 0x3FF; break;
+    default:
+      fprintf(stderr, "%s: write of register %d\n", name.c_str(), reg);
+      abort();
+  }
+  charge(2 * costs.registerAccess);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+uint32_t Mcu::micros()
+{
+  uint32_t m = timer0Overflows;
+  Time sinceOvf = now + 1024 * CYCLES_PER_US - nextTimer0Ovf;
+  uint8_t t = (uint8_t)std::min<Time>(sinceOvf / 64, 255);
+  if(tov0 && t < 255)
+    m++;
+  return ((m << 8) + t) * 4;
+}
+
+void Mcu::writeUdr(uint8_t b)
+{
+  if(!isTxShifting)
+  {
+    isTxShifting = true;
+    txShiftByte = b;
+    txShiftDone = now + byteCycles();
+  }
+  else
+  {
+    isUdrFull = true;
+    udrByte = b;
+  }
+}
+
+void Mcu::serialSend(uint8_t b)
+{
+  //HardwareSerial::write()
+  if(txBuffer.empty() && !isUdrFull)
+  {
+    writeUdr(b);
+    return;
+  }
+  while(txBuffer.size() >= 63)
+  {
+    if(!iFlag && !isUdrFull)
+    {
+      //interrupts off, the core moves the bytes on itself
+      writeUdr(txBuffer.front());
+      txBuffer.pop_front();
+    }
+    charge(8);
+  }
+  txBuffer.push_back(b);
+  isUdrePending = true;
+}
+
+void Mcu::serialReceive(uint8_t b, Time at)
+{
+  rxWire.push_back(std::make_pair(at, b));
+}
+
+}
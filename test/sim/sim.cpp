@@ -0,0 +1,170 @@
+// Scheduler that runs the boards on one timeline. See sim.h
+
+#include "sim.h"
+#include "sx127x.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace sim {
+
+Sim *Sim::active = NULL;
+
+static const size_t STACK_SIZE = 1 << 20;
+
+static void boardMain()
+{
+  //main() of the Arduino core
+  Mcu &m = cur();
+  m.iFlag = true;
+  m.sketch.setup();
+  for(;;)
+  {
+    if(m.onLoop)
+      m.onLoop(m);
+    m.sketch.loop();
+    m.loopCount++;
+    m.charge(m.costs.loopCall);
+  }
+}
+
+void yieldToScheduler()
+{
+  Mcu &m = cur();
+  swapcontext(&m.context, &Sim::active->schedulerContext);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Sim::Sim()
+{
+  active = this;
+}
+
+Sim::~Sim()
+{
+  for(Mcu *m : mcus)
+    delete m;
+  if(active == this)
+    active = NULL;
+}
+
+Mcu &Sim::add(const std::string &name, const Sketch &sketch)
+{
+  Mcu *m = new Mcu(name, sketch);
+  m->stack.resize(STACK_SIZE);
+  mcus.push_back(m);
+  return *m;
+}
+
+Time Sim::now()
+{
+  Time t = NEVER;
+  for(Mcu *m : mcus)
+    if(m->now < t)
+      t = m->now;
+  return t == NEVER ? 0 : t;
+}
+
+void Sim::run(Time duration)
+{
+  runUntil(now() + duration);
+}
+
+void Sim::runUntil(Time t)
+{
+  active = this;
+  for(;;)
+  {
+    //resume the board that is furthest behind
+    Mcu *m = NULL;
+    Time second = NEVER;
+    for(Mcu *x : mcus)
+    {
+      if(!m || x->now < m->now)
+      {
+        if(m)
+          second = std::min(second, m->now);
+        m = x;
+      }
+      else
+        second = std::min(second, x->now);
+    }
+    if(!m || m->now >= t)
+      break;
+
+    Time end = (second == NEVER ? m->now : std::max(second, m->now)) + quantum;
+    m->sliceEnd = std::min(end, t);
+
+    if(!m->isStarted)
+    {
+      getcontext(&m->context);
+      m->context.uc_stack.ss_sp = m->stack.data();
+      m->context.uc_stack.ss_size = m->stack.size();
+      m->context.uc_link = NULL;
+      makecontext(&m->context, boardMain, 0);
+      m->isStarted = true;
+    }
+    setCurrent(m);
+    swapcontext(&schedulerContext, &m->context);
+    setCurrent(NULL);
+
+    if(medium)
+      medium->prune(now());
+  }
+}
+
+void Sim::connectSerial(Mcu &from, Mcu &to)
+{
+  from.onSerialByte = [&to](Mcu &, uint8_t b, Time t) { to.serialReceive(b, t); };
+}
+
+//--------------------------------------------------------------------------------------------------
+
+std::string isolated(const std::function<std::string()> &fn)
+{
+  int fds[2];
+  if(pipe(fds) != 0)
+  {
+    perror("pipe");
+    exit(1);
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if(pid == 0)
+  {
+    close(fds[0]);
+    std::string out = fn();
+    size_t done = 0;
+    while(done < out.size())
+    {
+      ssize_t n = write(fds[1], out.data() + done, out.size() - done);
+      if(n <= 0)
+        break;
+      done += n;
+    }
+    close(fds[1]);
+    fflush(stdout);
+    _exit(0);
+  }
+  close(fds[1]);
+  std::string out;
+  char buf[4096];
+  ssize_t n;
+  while((n = read(fds[0], buf, sizeof(buf))) > 0)
+    out.append(buf, n);
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    fprintf(stderr, "isolated run failed\n");
+    exit(1);
+  }
+  return out;
+}
+
+}
@@ -0,0 +1,265 @@
+// Host simulation of the Atmega328p boards.
+//
+// Each board (Mcu) runs a sketch in its own coroutine against a virtual clock counted in cpu
+// cycles at 16MHz. The clock only moves when the sketch does something that takes time on the
+// real board: a call into the Arduino core, a register access, a delay. Interrupts are raised
+// by the peripherals as the clock passes their event times and are dispatched at those points,
+// in vector order, whenever the sketch has them enabled. Plain computation in the sketch is
+// free, so loop times here are a lower bound set by the I/O, waits and interrupts.
+//
+// Boards share one timeline. The scheduler always resumes the board that is furthest behind and
+// lets it run at most QUANTUM past the next one, which keeps them within a small fraction of a
+// LoRa symbol of each other.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <ucontext.h>
+
+namespace sim {
+
+typedef uint64_t Time; //cpu cycles at 16MHz
+
+const Time CYCLES_PER_US = 16;
+inline Time us(double x) { return (Time)(x * CYCLES_PER_US + 0.5); }
+inline Time ms(double x) { return (Time)(x * 1000 * CYCLES_PER_US + 0.5); }
+inline double toUs(Time t) { return (double)t / CYCLES_PER_US; }
+inline double toMs(Time t) { return (double)t / (1000 * CYCLES_PER_US); }
+
+const Time NEVER = ~(Time)0;
+
+//Interrupt vectors, numbered as on the Atmega328p. Lower numbers have priority
+enum Vector {
+  VEC_INT0 = 1,
+  VEC_INT1 = 2,
+  VEC_TIMER1_COMPA = 11,
+  VEC_TIMER1_COMPB = 12,
+  VEC_TIMER0_OVF = 16,
+  VEC_USART_RX = 18,
+  VEC_USART_UDRE = 19,
+  VEC_ADC = 21,
+  VEC_EE_READY = 22,
+  NUM_VECTORS = 26
+};
+
+//Registers reachable from sketch code, see arduino/avr/io.h
+enum Register {
+  R_SREG,
+  R_TCCR1A, R_TCCR1B, R_TIMSK1, R_TIFR1, R_TCNT1, R_OCR1A, R_OCR1B,
+  R_EECR, R_EEDR, R_EEAR,
+  R_ADCSRA, R_ADMUX, R_ADC
+};
+
+/* Cycles taken by the Arduino core and by the interrupt handlers built into it, from the
+Arduino AVR core at 16MHz. Interrupt costs include entry and return. */
+struct Costs {
+  Time digitalWrite = 56;
+  Time digitalRead = 50;
+  Time pinMode = 60;
+  Time analogWrite = 80;
+  Time analogRead = 1792;   //13 ADC clocks at 125kHz plus the call
+  Time micros = 56;
+  Time millis = 24;
+  Time registerAccess = 2;
+  Time spiByte = 24;        //8MHz SPI clock plus the transfer loop
+  Time spiTransaction = 16; //beginTransaction() or endTransaction()
+  Time serialAvailable = 20;
+  Time serialRead = 32;
+  Time serialWrite = 40;
+  Time eepromAccess = 20;
+  Time loopCall = 30;       //main() calling loop() and serialEventRun()
+  Time yield = 8;
+  Time isrEntry = 8;        //interrupt response, jump and the start of the prologue
+  Time isrTimer0 = 72;      //millis() tick
+  Time isrUartRx = 68;
+  Time isrUartUdre = 60;
+  Time isrExternal = 52;    //attachInterrupt() dispatch, before the user function
+  Time isrUser = 40;        //prologue and epilogue of an ISR() in the sketch
+};
+
+class Mcu;
+class Sx127x;
+class Medium;
+
+//A sketch built for the host, see sketch_rx.h and sketch_stx.h
+struct Sketch {
+  const char *name;
+  void (*setup)();
+  void (*loop)();
+  struct Isr { int vector; void (*handler)(); };
+  std::vector<Isr> isrs;
+};
+
+struct PinEvent {
+  Time time;
+  uint8_t pin;
+  bool level;
+};
+
+class Mcu {
+public:
+  Mcu(const std::string &name, const Sketch &sketch);
+  ~Mcu();
+
+  std::string name;
+  Sketch sketch;
+  Costs costs;
+
+  //--- clock ---
+  Time now = 0;
+  void charge(Time cycles); //time taken by the code that is running, interrupts are served within
+  void pollInterrupts();    //serve anything pending, eg after interrupts are enabled again
+  uint64_t loopCount = 0;
+  std::function<void(Mcu &)> onLoop; //called before each loop()
+
+  //--- pins. Arduino Uno numbering, A0 is 14 ---
+  static const int NUM_PINS = 22;
+  volatile uint8_t port[3] = {0, 0, 0}; //output registers of ports B, C and D
+  uint8_t ddr[3] = {0, 0, 0};
+  bool pullup[NUM_PINS] = {};
+  bool inputLevel[NUM_PINS] = {}; //driven from outside
+  bool isInputDriven[NUM_PINS] = {};
+  uint16_t analogInput[8] = {};   //ADC counts on A0 to A7
+  std::function<void(const PinEvent &)> onPinChange;
+  void setPin(uint8_t pin, bool level); //drive an input from outside
+  bool getPin(uint8_t pin);             //level on the pin, whoever drives it
+  static bool pinToPort(uint8_t pin, uint8_t &portIdx, uint8_t &bit);
+  void checkPorts(); //logs output changes made by direct port writes
+
+  //--- interrupts ---
+  bool iFlag = false; //global interrupt enable, bit 7 of SREG
+  bool inIsr = false;
+  void (*vectors[NUM_VECTORS])() = {};
+  void (*extHandler[2])() = {NULL, NULL};
+  int extMode[2] = {0, 0};
+  bool extFlag[2] = {false, false};
+  bool extEnabled[2] = {true, true}; //EIMSK, cleared by SPI.beginTransaction() after usingInterrupt()
+  uint64_t isrCount[NUM_VECTORS] = {};
+  Time isrCycles[NUM_VECTORS] = {};
+
+  //--- timer0, just the millis() tick ---
+  Time nextTimer0Ovf = 1024 * CYCLES_PER_US;
+  bool tov0 = false;
+  uint32_t timer0Overflows = 0;
+  uint32_t timer0Millis = 0;
+  uint8_t timer0Fract = 0;
+  uint32_t micros(); //as the Arduino core works it out from timer0
+
+  //--- timer1 ---
+  uint8_t tccr1a = 0, tccr1b = 0, timsk1 = 0, tifr1 = 0;
+  uint16_t ocr1a = 0, ocr1b = 0;
+  int64_t t1Origin = 0; //when the count was 0, counting at the current prescaler
+  uint16_t t1Stopped = 0;
+  Time t1MatchA = NEVER, t1MatchB = NEVER;
+  Time t1Prescale();
+  uint16_t t1Count();
+  void t1Schedule();
+
+  //--- eeprom ---
+  uint8_t eeprom[1024];
+  uint8_t eecr = 0, eedr = 0;
+  uint16_t eear = 0;
+  Time eeBusyUntil = 0;
+  Time eeMasterWriteEnd = 0; //EEMPE only holds for 4 cycles
+  uint32_t eepromWrites = 0;
+  std::function<bool(uint16_t addr)> eepromWriteFails; //return true to leave the byte as it was
+
+  //--- adc ---
+  uint8_t adcsra = 0x87, admux = 0;
+  uint16_t adcResult = 0;
+  Time adcDone = NEVER;
+
+  //--- usart ---
+  uint32_t baud = 0;
+  uint8_t frameBits = 10;
+  std::deque<uint8_t> txBuffer; //bytes waiting for the data register, at most 64
+  bool isTxShifting = false;
+  uint8_t txShiftByte = 0;
+  bool isUdrFull = false;
+  uint8_t udrByte = 0;
+  void writeUdr(uint8_t b);
+  Time txShiftDone = NEVER;
+  std::deque<uint8_t> rxBuffer; //at most 64, as in HardwareSerial
+  std::deque<std::pair<Time, uint8_t>> rxWire; //bytes on their way in
+  std::deque<uint8_t> rxPending; //received, waiting for the interrupt to buffer it
+  bool isUdrePending = false;
+  uint32_t rxOverruns = 0;
+  std::function<void(Mcu &, uint8_t, Time)> onSerialByte; //a byte has finished going out
+  std::string serialText; //everything sent, for debug prints
+  Time byteCycles() { return baud ? (Time)frameBits * 16000000ULL / baud : 0; }
+  void serialSend(uint8_t b); //HardwareSerial::write()
+  void serialReceive(uint8_t b, Time at); //queue a byte arriving from outside
+
+  //--- spi ---
+  Sx127x *radio = NULL;
+  uint8_t radioSsPin = 10;
+  uint8_t radioDio0Pin = 2;
+  uint8_t radioResetPin = 8;
+  uint64_t spiTransactions = 0;
+  uint64_t spiBytes = 0;
+  bool isSpiSelected = false;
+  std::function<void(uint8_t)> onSpiByte; //each byte sent, whichever device takes it
+  std::function<void()> onSpiEnd;         //as each transaction ends
+
+  //--- register access from the sketch ---
+  uint8_t readReg8(int reg);
+  void writeReg8(int reg, uint8_t val);
+  uint16_t readReg16(int reg);
+  void writeReg16(int reg, uint16_t val);
+
+  //--- prng, as avr-libc random() ---
+  uint32_t randomState = 1;
+
+  //--- coroutine ---
+  ucontext_t context;
+  std::vector<char> stack;
+  bool isStarted = false;
+  Time sliceEnd = NEVER;
+
+private:
+  Time nextEvent();
+  void processEvents(Time upTo);
+  void dispatch();
+  void runIsr(int vector);
+  void raiseExternal(uint8_t num, bool oldLevel, bool newLevel);
+  uint8_t portShadow[3] = {0, 0, 0};
+};
+
+//The board whose code is running
+Mcu &cur();
+void setCurrent(Mcu *mcu);
+
+class Sim {
+public:
+  Sim();
+  ~Sim();
+  std::vector<Mcu *> mcus;
+  Time quantum = 100 * CYCLES_PER_US;
+  Mcu &add(const std::string &name, const Sketch &sketch);
+  void run(Time duration);
+  void runUntil(Time t);
+  Time now(); //the time every board has reached
+  //Connects a TX pin to another board's RX pin, bytes arrive one frame time after they start
+  void connectSerial(Mcu &from, Mcu &to);
+  Medium *medium = NULL; //pruned of old packets as the boards move on
+  ucontext_t schedulerContext;
+  static Sim *active;
+};
+
+//Switch from a board's coroutine back to the scheduler once the board has run its slice
+void yieldToScheduler();
+
+/* Sketches keep their state in globals, so a board can only be started once per process. Runs fn
+in a child process and returns what it returned, so a test can start the boards afresh for each
+case. */
+std::string isolated(const std::function<std::string()> &fn);
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+// The transmitter's master MCU sketch built for the host, in its own namespace. The Arduino IDE
+// builds each of its .cpp files, so they are all included here. They are found on the include
+// path, so a copy with some option changed is built by putting its directory there instead of
+// ../mtx. Include from one translation unit only
+
+#ifndef SKETCH_MTX_H
+#define SKETCH_MTX_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <EEPROM.h>
+
+#ifndef SKETCH_MTX_NS
+#define SKETCH_MTX_NS mtx
+#endif
+
+namespace SKETCH_MTX_NS {
+
+#include <common.cpp>
+#include <eestore.cpp>
+#include <io.cpp>
+#include <GFX.cpp>
+#include <LCDKS0108.cpp>
+#include <LCDCGM12864G_595.cpp>
+#include <ui_128x64.cpp>
+#include <mtx.cpp>
+
+sim::Sketch sketch()
+{
+  sim::Sketch s;
+  s.name = "mtx";
+  s.setup = setup;
+  s.loop = loop;
+  return s;
+}
+
+}
+
+#endif
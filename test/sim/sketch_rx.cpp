@@ -0,0 +1,3 @@
+// The receiver sketch in a translation unit of its own, for tests that only need to run it.
+// See sketch_rx.h
+#include "sketch_rx.h"
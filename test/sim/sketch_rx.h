@@ -0,0 +1,43 @@
+// The receiver sketch built for the host. Everything in it, LoRa.cpp included, goes in its own
+// namespace, so a test can run it next to the transmitter, or next to another copy of itself
+// built from a second translation unit with SKETCH_RX_NS set to another name.
+// Include from one translation unit only.
+
+#ifndef SKETCH_RX_H
+#define SKETCH_RX_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <EEPROM.h>
+#include <util/atomic.h>
+
+#ifndef SKETCH_RX_NS
+#define SKETCH_RX_NS rx
+#endif
+
+//The sources. A benchmark can point these at a copy with some option changed
+#ifndef SKETCH_RX_INO
+#define SKETCH_RX_INO "../../rx/rx.ino"
+#define SKETCH_RX_LORA "../../rx/LoRa.cpp"
+#endif
+
+namespace SKETCH_RX_NS {
+
+#include SKETCH_RX_INO
+#include SKETCH_RX_LORA
+
+sim::Sketch sketch()
+{
+  sim::Sketch s;
+  s.name = "rx";
+  s.setup = setup;
+  s.loop = loop;
+  s.isrs.push_back({sim::VEC_TIMER1_COMPA, TIMER1_COMPA_vect});
+  s.isrs.push_back({sim::VEC_TIMER1_COMPB, TIMER1_COMPB_vect});
+  s.isrs.push_back({sim::VEC_EE_READY, EE_READY_vect});
+  return s;
+}
+
+}
+
+#endif
@@ -0,0 +1,3 @@
+// The transmitter's slave mcu sketch in a translation unit of its own, for tests that only
+// need to run it. See sketch_stx.h
+#include "sketch_stx.h"
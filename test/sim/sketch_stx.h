@@ -0,0 +1,40 @@
+// The transmitter's slave MCU sketch built for the host, in its own namespace. See sketch_rx.h
+
+#ifndef SKETCH_STX_H
+#define SKETCH_STX_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <EEPROM.h>
+#include <util/atomic.h>
+
+#ifndef SKETCH_STX_NS
+#define SKETCH_STX_NS stx
+#endif
+
+//The sources. A benchmark can point these at a copy with some option changed
+#ifndef SKETCH_STX_INO
+#define SKETCH_STX_INO "../../stx/stx.ino"
+#define SKETCH_STX_LORA "../../stx/LoRa.cpp"
+#define SKETCH_STX_RTTTL "../../stx/NonBlockingRtttl.cpp"
+#endif
+
+namespace SKETCH_STX_NS {
+
+#include SKETCH_STX_INO
+#include SKETCH_STX_LORA
+#include SKETCH_STX_RTTTL
+
+sim::Sketch sketch()
+{
+  sim::Sketch s;
+  s.name = "stx";
+  s.setup = setup;
+  s.loop = loop;
+  s.isrs.push_back({sim::VEC_EE_READY, EE_READY_vect});
+  return s;
+}
+
+}
+
+#endif
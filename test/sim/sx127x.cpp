@@ -0,0 +1,766 @@
+// SX127x LoRa modem and radio channel model. See sx127x.h
+
+#include "sx127x.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+namespace sim {
+
+//registers
+enum {
+  REG_FIFO = 0x00,
+  REG_OP_MODE = 0x01,
+  REG_FRF_MSB = 0x06,
+  REG_FRF_MID = 0x07,
+  REG_FRF_LSB = 0x08,
+  REG_PA_CONFIG = 0x09,
+  REG_FIFO_ADDR_PTR = 0x0D,
+  REG_FIFO_TX_BASE_ADDR = 0x0E,
+  REG_FIFO_RX_BASE_ADDR = 0x0F,
+  REG_FIFO_RX_CURRENT_ADDR = 0x10,
+  REG_IRQ_FLAGS_MASK = 0x11,
+  REG_IRQ_FLAGS = 0x12,
+  REG_RX_NB_BYTES = 0x13,
+  REG_MODEM_STAT = 0x18,
+  REG_PKT_SNR_VALUE = 0x19,
+  REG_PKT_RSSI_VALUE = 0x1A,
+  REG_RSSI_VALUE = 0x1B,
+  REG_MODEM_CONFIG_1 = 0x1D,
+  REG_MODEM_CONFIG_2 = 0x1E,
+  REG_SYMB_TIMEOUT_LSB = 0x1F,
+  REG_PREAMBLE_MSB = 0x20,
+  REG_PREAMBLE_LSB = 0x21,
+  REG_PAYLOAD_LENGTH = 0x22,
+  REG_FIFO_RX_BYTE_ADDR = 0x25,
+  REG_MODEM_CONFIG_3 = 0x26,
+  REG_RSSI_WIDEBAND = 0x2C,
+  REG_INVERTIQ = 0x33,
+  REG_SYNC_WORD = 0x39,
+  REG_DIO_MAPPING_1 = 0x40,
+  REG_VERSION = 0x42,
+  REG_PA_DAC = 0x4D
+};
+
+enum {
+  MODE_SLEEP = 0,
+  MODE_STDBY = 1,
+  MODE_FSTX = 2,
+  MODE_TX = 3,
+  MODE_FSRX = 4,
+  MODE_RX_CONTINUOUS = 5,
+  MODE_RX_SINGLE = 6,
+  MODE_CAD = 7
+};
+
+enum {
+  IRQ_CAD_DETECTED = 0x01,
+  IRQ_CAD_DONE = 0x04,
+  IRQ_TX_DONE = 0x08,
+  IRQ_VALID_HEADER = 0x10,
+  IRQ_PAYLOAD_CRC_ERROR = 0x20,
+  IRQ_RX_DONE = 0x40,
+  IRQ_RX_TIMEOUT = 0x80
+};
+
+//from the write of the op mode to the start of the preamble: PLL lock and PA ramp up
+static const Time TX_STARTUP = 100 * CYCLES_PER_US;
+
+//out of sleep, the crystal oscillator has to start again. TS_OSC in the datasheet, typical
+static const Time OSC_STARTUP = 250 * CYCLES_PER_US;
+
+//symbols of preamble a receiver needs to catch to lock on
+static const int PREAMBLE_TO_LOCK = 4;
+
+//--------------------------------------------------------------------------------------------------
+
+double LoraConfig::frequencyHz() const
+{
+  return frf * (32e6 / (1 << 19));
+}
+
+double LoraConfig::bandwidthHz() const
+{
+  static const double bws[10] = {7.8e3, 10.4e3, 15.6e3, 20.8e3, 31.25e3, 41.7e3, 62.5e3, 125e3, 250e3, 500e3};
+  return bws[bw < 10 ? bw : 9];
+}
+
+Time LoraConfig::symbolTime() const
+{
+  return (Time)((double)(1 << sf) / bandwidthHz() * 16e6 + 0.5);
+}
+
+bool LoraConfig::isSameChannel(const LoraConfig &o) const
+{
+  return sf == o.sf && bw == o.bw && fabs(frequencyHz() - o.frequencyHz()) < bandwidthHz() / 4;
+}
+
+bool LoraConfig::matches(const LoraConfig &o) const
+{
+  if(!isSameChannel(o))
+    return false;
+  if(syncWord != o.syncWord || isIqInverted != o.isIqInverted || isImplicit != o.isImplicit)
+    return false;
+  if(isLowDataRate != o.isLowDataRate)
+    return false;
+  //in implicit header mode the receiver must already know the coding rate
+  if(isImplicit && cr != o.cr)
+    return false;
+  return true;
+}
+
+Time timeOnAir(const LoraConfig &cfg, uint8_t len)
+{
+  double tsym = (double)(1 << cfg.sf) / cfg.bandwidthHz();
+  double preamble = (cfg.preamble + 4.25) * tsym;
+  int de = cfg.isLowDataRate ? 1 : 0;
+  int ih = cfg.isImplicit ? 1 : 0;
+  int crc = cfg.isCrcOn ? 1 : 0;
+  double num = 8.0 * len - 4.0 * cfg.sf + 28 + 16 * crc - 20 * ih;
+  double den = 4.0 * (cfg.sf - 2 * de);
+  double symbols = 8 + std::max(ceil(num / den) * (cfg.cr + 4), 0.0);
+  return (Time)((preamble + symbols * tsym) * 16e6 + 0.5);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Medium::Medium() : rng(12345)
+{
+}
+
+uint64_t Medium::send(Sx127x *sender, const LoraConfig &cfg, const std::vector<uint8_t> &data,
+                      Time start, double powerDbm)
+{
+  Packet p;
+  p.id = nextId++;
+  p.sender = sender;
+  p.cfg = cfg;
+  p.data = data;
+  p.start = start;
+  p.end = start + timeOnAir(cfg, data.size());
+  p.powerDbm = powerDbm;
+  p.doneBy.push_back(sender);
+  packets.push_back(p);
+  numSent++;
+  return p.id;
+}
+
+Packet *Medium::find(uint64_t id)
+{
+  for(Packet &p : packets)
+    if(p.id == id)
+      return &p;
+  return NULL;
+}
+
+void Medium::prune(Time before)
+{
+  //keep a second of history for the collision checks of packets still in the air
+  const Time keep = ms(1000);
+  while(!packets.empty())
+  {
+    Packet &p = packets.front();
+    if(p.end + keep > before || p.doneBy.size() < radios.size())
+      break;
+    packets.pop_front();
+  }
+}
+
+double Medium::noiseFloorDbm(const LoraConfig &cfg) const
+{
+  return -174 + 10 * log10(cfg.bandwidthHz()) + noiseFigureDb;
+}
+
+double Medium::snrThresholdDb(uint8_t sf)
+{
+  static const double thr[13] = {0, 0, 0, 0, 0, 0, -5, -7.5, -10, -12.5, -15, -17.5, -20};
+  return thr[sf <= 12 ? sf : 12];
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Sx127x::Sx127x(Medium &medium, Mcu &mcu, const std::string &name) : medium(medium), mcu(mcu), name(name)
+{
+  reset();
+  medium.radios.push_back(this);
+  mcu.radio = this;
+}
+
+void Sx127x::reset()
+{
+  memset(regs, 0, sizeof(regs));
+  memset(fifo, 0, sizeof(fifo));
+  regs[REG_OP_MODE] = 0x09;
+  regs[REG_FRF_MSB] = 0x6C;
+  regs[REG_FRF_MID] = 0x80;
+  regs[REG_FRF_LSB] = 0x00;
+  regs[REG_PA_CONFIG] = 0x4F;
+  regs[0x0A] = 0x09; //PaRamp
+  regs[0x0B] = 0x2B; //Ocp
+  regs[0x0C] = 0x20; //Lna
+  regs[REG_FIFO_TX_BASE_ADDR] = 0x80;
+  regs[REG_FIFO_RX_BASE_ADDR] = 0x00;
+  regs[REG_MODEM_CONFIG_1] = 0x72;
+  regs[REG_MODEM_CONFIG_2] = 0x70;
+  regs[REG_SYMB_TIMEOUT_LSB] = 0x64;
+  regs[REG_PREAMBLE_LSB] = 0x08;
+  regs[REG_PAYLOAD_LENGTH] = 0x01;
+  regs[0x23] = 0xFF; //MaxPayloadLength
+  regs[REG_MODEM_CONFIG_3] = 0x04;
+  regs[0x31] = 0xC3; //DetectionOptimize
+  regs[REG_INVERTIQ] = 0x27;
+  regs[0x37] = 0x0A; //DetectionThreshold
+  regs[REG_SYNC_WORD] = 0x12;
+  regs[0x3B] = 0x1D; //InvertIQ2
+  regs[REG_VERSION] = 0x12;
+  regs[REG_PA_DAC] = 0x84;
+
+  if(txEnd != NEVER)
+  {
+    Packet *p = medium.find(txPacketId);
+    if(p)
+    {
+      p->isAborted = true;
+      p->end = std::max(mcu.now, p->start);
+    }
+  }
+  txEnd = cadEnd = rxSingleTimeout = NEVER;
+  isUnreadPacket = false;
+  isAddressPhase = false;
+  updateDio0();
+  noteListening(mcu.now);
+}
+
+LoraConfig Sx127x::config() const
+{
+  LoraConfig c;
+  c.frf = ((uint32_t)regs[REG_FRF_MSB] << 16) | ((uint32_t)regs[REG_FRF_MID] << 8) | regs[REG_FRF_LSB];
+  c.bw = regs[REG_MODEM_CONFIG_1] >> 4;
+  c.cr = (regs[REG_MODEM_CONFIG_1] >> 1) & 0x07;
+  c.isImplicit = regs[REG_MODEM_CONFIG_1] & 0x01;
+  c.sf = regs[REG_MODEM_CONFIG_2] >> 4;
+  c.isCrcOn = regs[REG_MODEM_CONFIG_2] & 0x04;
+  c.isLowDataRate = regs[REG_MODEM_CONFIG_3] & 0x08;
+  c.syncWord = regs[REG_SYNC_WORD];
+  c.isIqInverted = regs[REG_INVERTIQ] & 0x40;
+  c.preamble = ((uint16_t)regs[REG_PREAMBLE_MSB] << 8) | regs[REG_PREAMBLE_LSB];
+  return c;
+}
+
+double Sx127x::txPowerDbm() const
+{
+  uint8_t pa = regs[REG_PA_CONFIG];
+  if(pa & 0x80) //PA_BOOST
+    return 2 + (pa & 0x0F) + (regs[REG_PA_DAC] == 0x87 ? 3 : 0);
+  double pmax = 10.8 + 0.6 * ((pa >> 4) & 0x07);
+  return pmax - (15 - (pa & 0x0F));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sx127x::setNss(bool level)
+{
+  isSelected = !level;
+  isAddressPhase = isSelected;
+}
+
+uint8_t Sx127x::transfer(uint8_t mosi)
+{
+  if(!isSelected)
+    return 0;
+  if(isAddressPhase)
+  {
+    isAddressPhase = false;
+    address = mosi & 0x7F;
+    isWrite = mosi & 0x80;
+    return 0;
+  }
+  uint8_t out;
+  if(isWrite)
+  {
+    out = regs[address];
+    writeReg(address, mosi);
+    numSpiWrites++;
+    if(onWrite)
+      onWrite(address, mosi, mcu.now);
+  }
+  else
+  {
+    out = readReg(address);
+    numSpiReads++;
+  }
+  //burst access moves on to the next register, except on the FIFO
+  if(address != REG_FIFO)
+    address = (address + 1) & 0x7F;
+  return out;
+}
+
+uint8_t Sx127x::readReg(uint8_t addr)
+{
+  process(mcu.now);
+  switch(addr)
+  {
+    case REG_FIFO:
+    {
+      uint8_t ptr = regs[REG_FIFO_ADDR_PTR];
+      if(isUnreadPacket && ptr == unreadStart)
+        isUnreadPacket = false;
+      regs[REG_FIFO_ADDR_PTR] = ptr + 1;
+      return fifo[ptr];
+    }
+    case REG_RSSI_VALUE:
+    {
+      //strongest packet on our channel right now, or the noise
+      LoraConfig cfg = config();
+      double dbm = medium.noiseFloorDbm(cfg);
+      for(Packet &p : medium.packets)
+        if(p.sender != this && p.start <= mcu.now && p.end > mcu.now && p.cfg.isSameChannel(cfg))
+          dbm = std::max(dbm, signalDbm(p));
+      int v = (int)lround(dbm) + (cfg.frequencyHz() < 779e6 ? 164 : 157);
+      return (uint8_t)std::min(std::max(v, 0), 255);
+    }
+    case REG_RSSI_WIDEBAND:
+      return (uint8_t)(medium.rng() & 0xFF);
+    case REG_MODEM_STAT:
+    {
+      //signal detected and synchronized once a packet on our settings is past where we lock onto
+      //its preamble, then header info valid. Modem clear otherwise
+      if(!isListening())
+        return 0x00;
+      LoraConfig cfg = config();
+      for(Packet &p : medium.packets)
+      {
+        Time tsym = p.cfg.symbolTime();
+        Time lockBy = p.start + std::max(0, (int)p.cfg.preamble - PREAMBLE_TO_LOCK) * tsym;
+        if(p.sender == this || lockBy > mcu.now || p.end <= mcu.now || !p.cfg.matches(cfg) ||
+           !wasListening(p.cfg, lockBy, mcu.now))
+          continue;
+        if(signalDbm(p) - medium.noiseFloorDbm(p.cfg) < Medium::snrThresholdDb(p.cfg.sf))
+          continue;
+        Time headerEnd = p.start + (p.cfg.preamble + 4) * tsym + tsym / 4 + 8 * tsym;
+        return mcu.now >= headerEnd ? 0x0F : 0x07;
+      }
+      return 0x10;
+    }
+    default:
+      return regs[addr];
+  }
+}
+
+void Sx127x::writeReg(uint8_t addr, uint8_t val)
+{
+  process(mcu.now);
+  switch(addr)
+  {
+    case REG_FIFO:
+    {
+      if(mode() == MODE_SLEEP)
+        return; //no FIFO access in sleep
+      uint8_t ptr = regs[REG_FIFO_ADDR_PTR];
+      if(isUnreadPacket && (uint8_t)(ptr - unreadStart) < unreadLen)
+      {
+        numFifoOverwrites++;
+        isUnreadPacket = false;
+      }
+      fifo[ptr] = val;
+      regs[REG_FIFO_ADDR_PTR] = ptr + 1;
+      return;
+    }
+    case REG_OP_MODE:
+    {
+      uint8_t oldMode = mode();
+      //the LoRa bit only changes in sleep
+      if(oldMode != MODE_SLEEP)
+        val = (val & 0x7F) | (regs[REG_OP_MODE] & 0x80);
+      regs[REG_OP_MODE] = val;
+      setMode(oldMode, mcu.now);
+      return;
+    }
+    case REG_IRQ_FLAGS:
+      regs[REG_IRQ_FLAGS] &= ~val;
+      updateDio0();
+      return;
+    case REG_DIO_MAPPING_1:
+      regs[addr] = val;
+      updateDio0();
+      return;
+    //read only
+    case REG_FIFO_RX_CURRENT_ADDR:
+    case REG_RX_NB_BYTES:
+    case 0x14: case 0x15: case 0x16: case 0x17:
+    case REG_MODEM_STAT:
+    case REG_PKT_SNR_VALUE:
+    case REG_PKT_RSSI_VALUE:
+    case REG_RSSI_VALUE:
+    case 0x1C:
+    case REG_FIFO_RX_BYTE_ADDR:
+    case 0x28: case 0x29: case 0x2A:
+    case REG_RSSI_WIDEBAND:
+    case REG_VERSION:
+      return;
+    default:
+      regs[addr] = val;
+      break;
+  }
+
+  //a new frequency takes effect once the lsb is written
+  if(addr == REG_FRF_LSB || addr == REG_MODEM_CONFIG_1 || addr == REG_MODEM_CONFIG_2 ||
+     addr == REG_MODEM_CONFIG_3 || addr == REG_SYNC_WORD || addr == REG_INVERTIQ)
+    noteListening(mcu.now);
+}
+
+void Sx127x::setMode(uint8_t oldMode, Time at)
+{
+  uint8_t newMode = mode();
+  if(newMode == oldMode)
+    return;
+
+  if(oldMode == MODE_TX && txEnd != NEVER)
+  {
+    //cut short
+    Packet *p = medium.find(txPacketId);
+    if(p)
+    {
+      p->isAborted = true;
+      p->end = std::max(at, p->start);
+    }
+    txEnd = NEVER;
+  }
+  if(oldMode == MODE_CAD)
+    cadEnd = NEVER;
+  if(oldMode == MODE_RX_SINGLE)
+    rxSingleTimeout = NEVER;
+  if(oldMode == MODE_SLEEP)
+  {
+    oscReadyAt = at + OSC_STARTUP;
+    numOscStarts++;
+  }
+
+  if(!isLora())
+  {
+    noteListening(at);
+    return;
+  }
+
+  LoraConfig cfg = config();
+  switch(newMode)
+  {
+    case MODE_SLEEP:
+      memset(fifo, 0, sizeof(fifo)); //the FIFO is cleared in sleep
+      isUnreadPacket = false;
+      break;
+    case MODE_TX:
+    {
+      uint8_t len = regs[REG_PAYLOAD_LENGTH];
+      std::vector<uint8_t> data(len);
+      for(uint8_t i = 0; i < len; i++)
+        data[i] = fifo[(uint8_t)(regs[REG_FIFO_TX_BASE_ADDR] + i)];
+      Time start = std::max(at, oscReadyAt) + TX_STARTUP;
+      txPacketId = medium.send(this, cfg, data, start, txPowerDbm());
+      txEnd = start + timeOnAir(cfg, len);
+      break;
+    }
+    case MODE_RX_CONTINUOUS:
+    case MODE_RX_SINGLE:
+      if(oldMode != MODE_RX_CONTINUOUS && oldMode != MODE_RX_SINGLE)
+      {
+        rxWritePtr = regs[REG_FIFO_RX_BASE_ADDR];
+        rxSession++;
+      }
+      if(newMode == MODE_RX_SINGLE)
+      {
+        uint16_t symbols = ((uint16_t)(regs[REG_MODEM_CONFIG_2] & 0x03) << 8) | regs[REG_SYMB_TIMEOUT_LSB];
+        rxSingleTimeout = at + symbols * cfg.symbolTime();
+      }
+      break;
+    case MODE_CAD:
+      cadStart = std::max(at, oscReadyAt);
+      cadEnd = cadStart + 2 * cfg.symbolTime();
+      break;
+  }
+  noteListening(at);
+}
+
+void Sx127x::setIrq(uint8_t flags)
+{
+  regs[REG_IRQ_FLAGS] |= flags & ~regs[REG_IRQ_FLAGS_MASK];
+  updateDio0();
+}
+
+void Sx127x::updateDio0()
+{
+  static const uint8_t masks[4] = {IRQ_RX_DONE, IRQ_TX_DONE, IRQ_CAD_DONE, 0};
+  bool level = regs[REG_IRQ_FLAGS] & masks[regs[REG_DIO_MAPPING_1] >> 6];
+  if(level == dio0)
+    return;
+  dio0 = level;
+  mcu.setPin(mcu.radioDio0Pin, level);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void Sx127x::noteListening(Time at)
+{
+  ListenSpan s = {at, isListening(), config(), rxSession};
+  if(!history.empty())
+  {
+    ListenSpan &last = history.back();
+    if(last.isListening == s.isListening && (!s.isListening || last.cfg.matches(s.cfg)) &&
+       last.cfg.frf == s.cfg.frf && last.session == s.session)
+      return;
+    if(last.since == at)
+    {
+      last = s;
+      return;
+    }
+  }
+  history.push_back(s);
+
+  //forget what can no longer matter
+  if(history.size() > 4096)
+  {
+    Time cutoff = at > ms(2000) ? at - ms(2000) : 0;
+    size_t keepFrom = 0;
+    while(keepFrom + 1 < history.size() && history[keepFrom + 1].since <= cutoff)
+      keepFrom++;
+    history.erase(history.begin(), history.begin() + keepFrom);
+  }
+}
+
+bool Sx127x::wasListening(const LoraConfig &cfg, Time from, Time to) const
+{
+  //listening with matching settings over the whole of [from, to]
+  if(history.empty() || history.front().since > from)
+    return false;
+  size_t i = history.size();
+  while(i > 0 && history[i - 1].since > from)
+    i--;
+  uint32_t session = history[i - 1].session;
+  for(i = i - 1; i < history.size() && history[i].since < to; i++)
+    if(!history[i].isListening || !history[i].cfg.matches(cfg) || history[i].session != session)
+      return false;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+Time Sx127x::nextEvent()
+{
+  Time t = std::min(txEnd, std::min(cadEnd, rxSingleTimeout));
+  for(const Packet &p : medium.packets)
+    if(p.end < t && std::find(p.doneBy.begin(), p.doneBy.end(), this) == p.doneBy.end())
+      t = p.end;
+  return t;
+}
+
+void Sx127x::process(Time now)
+{
+  for(;;)
+  {
+    Time t = nextEvent();
+    if(t > now)
+      return;
+
+    if(t == txEnd)
+    {
+      txEnd = NEVER;
+      Packet *p = medium.find(txPacketId);
+      if(p)
+        txAirtime += p->end - p->start;
+      numTx++;
+      txDoneAt = t;
+      regs[REG_OP_MODE] = (regs[REG_OP_MODE] & 0xF8) | MODE_STDBY;
+      setIrq(IRQ_TX_DONE);
+      noteListening(t);
+    }
+    else if(t == cadEnd)
+      finishCad();
+    else if(t == rxSingleTimeout)
+    {
+      //a packet whose preamble was caught keeps the receiver busy past the timeout
+      LoraConfig cfg = config();
+      Time busyUntil = 0;
+      for(const Packet &p : medium.packets)
+      {
+        Time lockBy = p.start + std::max(0, (int)p.cfg.preamble - PREAMBLE_TO_LOCK) * p.cfg.symbolTime();
+        if(p.sender != this && lockBy <= t && p.end > t && p.cfg.matches(cfg) && wasListening(p.cfg, lockBy, t))
+          busyUntil = std::max(busyUntil, p.end);
+      }
+      if(busyUntil)
+      {
+        rxSingleTimeout = busyUntil + 1;
+        continue;
+      }
+      rxSingleTimeout = NEVER;
+      numRxTimeouts++;
+      regs[REG_OP_MODE] = (regs[REG_OP_MODE] & 0xF8) | MODE_STDBY;
+      setIrq(IRQ_RX_TIMEOUT);
+      noteListening(t);
+    }
+    else
+    {
+      for(Packet &p : medium.packets)
+      {
+        if(p.end == t && std::find(p.doneBy.begin(), p.doneBy.end(), this) == p.doneBy.end())
+        {
+          p.doneBy.push_back(this);
+          receive(p);
+          break;
+        }
+      }
+    }
+  }
+}
+
+double Sx127x::signalDbm(Packet &p)
+{
+  for(auto &s : p.signal)
+    if(s.first == this)
+      return s.second;
+  double loss = medium.pathLoss ? medium.pathLoss(*p.sender, *this, p.start) : medium.defaultPathLoss;
+  double dbm = p.powerDbm - loss;
+  if(medium.fadingDb > 0)
+    dbm += std::normal_distribution<double>(0, medium.fadingDb)(medium.rng);
+  p.signal.push_back(std::make_pair(this, dbm));
+  return dbm;
+}
+
+void Sx127x::receive(Packet &p)
+{
+  //were we listening for it, from the end of the preamble to the end?
+  Time lockBy = p.start + std::max(0, (int)p.cfg.preamble - PREAMBLE_TO_LOCK) * p.cfg.symbolTime();
+  if(!wasListening(p.cfg, lockBy, p.end))
+  {
+    //on our settings, just not listening right through
+    if(config().matches(p.cfg))
+    {
+      numMissed++;
+      if(onPacket)
+        onPacket(p, false);
+    }
+    return;
+  }
+
+  double signal = signalDbm(p);
+  double snr = signal - medium.noiseFloorDbm(p.cfg);
+
+  bool isLost = p.isAborted;
+
+  //below the demodulator floor
+  double pOk = 1 / (1 + exp(-(snr - Medium::snrThresholdDb(p.cfg.sf)) / 0.5));
+  if(medium.uniform() > pOk)
+    isLost = true;
+
+  //other packets on the channel at the same time
+  for(Packet &q : medium.packets)
+  {
+    if(&q == &p || q.sender == this || q.end <= p.start || q.start >= p.end || !q.cfg.isSameChannel(p.cfg))
+      continue;
+    if(signalDbm(q) > signal - Medium::CAPTURE_DB)
+    {
+      isLost = true;
+      medium.numCollisions++;
+    }
+  }
+
+  if(medium.lossRate > 0 && medium.uniform() < medium.lossRate)
+    isLost = true;
+  if(!isLost && medium.dropFilter && medium.dropFilter(p, *this))
+    isLost = true;
+
+  if(isLost)
+  {
+    numLost++;
+    if(onPacket)
+      onPacket(p, false);
+    return;
+  }
+
+  //into the FIFO
+  std::vector<uint8_t> data = p.data;
+  if(p.cfg.isImplicit)
+    data.resize(regs[REG_PAYLOAD_LENGTH]);
+  bool isCorrupt = false;
+  if(medium.bitErrorRate > 0)
+  {
+    for(uint8_t &b : data)
+      for(int bit = 0; bit < 8; bit++)
+        if(medium.uniform() < medium.bitErrorRate)
+        {
+          b ^= 1 << bit;
+          isCorrupt = true;
+        }
+  }
+
+  uint8_t start = rxWritePtr;
+  if(isUnreadPacket && data.size() > 0)
+  {
+    uint8_t overlap = (uint8_t)(unreadStart - start);
+    if(overlap < data.size() || (uint8_t)(start - unreadStart) < unreadLen)
+      numFifoOverwrites++;
+  }
+  for(uint8_t b : data)
+    fifo[rxWritePtr++] = b;
+  regs[REG_FIFO_RX_CURRENT_ADDR] = start;
+  regs[REG_RX_NB_BYTES] = data.size();
+  regs[REG_FIFO_RX_BYTE_ADDR] = rxWritePtr - 1;
+  unreadStart = start;
+  unreadLen = data.size();
+  isUnreadPacket = data.size() > 0;
+
+  int snrReg = (int)lround(snr * 4);
+  regs[REG_PKT_SNR_VALUE] = (uint8_t)(int8_t)std::min(std::max(snrReg, -128), 127);
+  int rssiReg = (int)lround(signal) + (p.cfg.frequencyHz() < 779e6 ? 164 : 157);
+  if(snr < 0)
+    rssiReg -= (int)lround(snr);
+  regs[REG_PKT_RSSI_VALUE] = (uint8_t)std::min(std::max(rssiReg, 0), 255);
+
+  uint8_t flags = IRQ_RX_DONE | IRQ_VALID_HEADER;
+  if(p.cfg.isCrcOn && isCorrupt)
+  {
+    flags |= IRQ_PAYLOAD_CRC_ERROR;
+    numCrcErrors++;
+  }
+  numRxDone++;
+  if(mode() == MODE_RX_SINGLE)
+  {
+    rxSingleTimeout = NEVER;
+    regs[REG_OP_MODE] = (regs[REG_OP_MODE] & 0xF8) | MODE_STDBY;
+    noteListening(p.end);
+  }
+  setIrq(flags);
+  if(onPacket)
+    onPacket(p, true);
+}
+
+void Sx127x::finishCad()
+{
+  cadEnd = NEVER;
+  numCad++;
+  LoraConfig cfg = config();
+  Time tsym = cfg.symbolTime();
+  Time end = cadStart + 2 * tsym;
+  bool isDetected = false;
+  for(Packet &p : medium.packets)
+  {
+    if(p.sender == this || p.start >= end || p.end <= cadStart || !p.cfg.isSameChannel(cfg))
+      continue;
+    double snr = signalDbm(p) - medium.noiseFloorDbm(cfg);
+    double pOk = 1 / (1 + exp(-(snr - Medium::snrThresholdDb(cfg.sf)) / 0.5));
+    //a symbol of preamble within the window is what CAD looks for
+    Time preambleEnd = p.start + (p.cfg.preamble + 4) * tsym;
+    if(p.start + tsym > end || preambleEnd < cadStart + tsym)
+      pOk *= medium.cadPayloadDetect;
+    if(medium.uniform() < pOk)
+      isDetected = true;
+  }
+  if(isDetected)
+    numCadDetected++;
+  regs[REG_OP_MODE] = (regs[REG_OP_MODE] & 0xF8) | MODE_STDBY;
+  setIrq(IRQ_CAD_DONE | (isDetected ? IRQ_CAD_DETECTED : 0));
+  noteListening(end);
+}
+
+}
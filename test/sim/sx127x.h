@@ -0,0 +1,191 @@
+// SX1276/77/78 in LoRa mode, as seen over SPI, and the radio channel between modules.
+//
+// The register map, the 256 byte FIFO with its pointers, the op mode transitions, the IRQ flags
+// and DIO0 behave as in the datasheet for what the driver in LoRa.cpp uses. Packets take their
+// time on air, worked out from the modem settings, and TX done, RX done, RX timeout and CAD done
+// come at the end of it. Out of sleep, TX and CAD wait for the oscillator to start. The modem
+// status shows a packet the receiver has locked onto, and when its header is through.
+//
+// Every transmission goes on a shared Medium. A module receives a packet if it was listening
+// with matching settings (frequency, spreading factor, bandwidth, sync word, IQ and header mode)
+// from before the end of the preamble to the end of the packet, the signal cleared the noise
+// floor, no other packet on the same channel came within CAPTURE_DB of it, and the loss model
+// let it through. FSK mode, the FIFO level flags and frequency hopping spread spectrum are not
+// modelled.
+
+#ifndef SX127X_H
+#define SX127X_H
+
+#include "sim.h"
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <random>
+#include <functional>
+
+namespace sim {
+
+class Sx127x;
+
+//The modem settings a packet is sent with, or a receiver is listening with
+struct LoraConfig {
+  uint32_t frf = 0;     //frequency register, 61.035Hz steps
+  uint8_t sf = 7;
+  uint8_t bw = 7;       //register value, see bandwidthHz()
+  uint8_t cr = 1;       //4/(4+cr)
+  bool isImplicit = false;
+  bool isCrcOn = false;
+  bool isLowDataRate = false;
+  uint8_t syncWord = 0x12;
+  bool isIqInverted = false;
+  uint16_t preamble = 8;
+
+  double frequencyHz() const;
+  double bandwidthHz() const;
+  Time symbolTime() const;
+  bool isSameChannel(const LoraConfig &o) const; //close enough in frequency, same SF and bandwidth
+  bool matches(const LoraConfig &o) const; //a receiver with one hears a packet sent with the other
+};
+
+//Time on air of a packet with len bytes of payload, datasheet section 4.1.1.7
+Time timeOnAir(const LoraConfig &cfg, uint8_t len);
+
+struct Packet {
+  uint64_t id;
+  Sx127x *sender;
+  LoraConfig cfg;
+  std::vector<uint8_t> data;
+  Time start;
+  Time end;
+  double powerDbm;
+  bool isAborted = false;    //the sender left TX mode before the end
+  std::vector<Sx127x *> doneBy; //modules that have dealt with it, the sender included
+  std::vector<std::pair<const Sx127x *, double>> signal; //dBm at each receiver, once worked out
+};
+
+class Medium {
+public:
+  Medium();
+
+  std::deque<Packet> packets;
+  std::vector<Sx127x *> radios;
+  std::mt19937 rng;
+
+  //--- channel model ---
+  //Path loss in dB between two modules. Constant unless set
+  std::function<double(const Sx127x &from, const Sx127x &to, Time at)> pathLoss;
+  double defaultPathLoss = 80;
+  double fadingDb = 0;       //standard deviation of a random variation per packet
+  double lossRate = 0;       //packets lost at random, on top of everything else
+  double bitErrorRate = 0;   //bit errors in packets that get through
+  //Decides the fate of each packet at each receiver, after the rest of the model. Return true to lose it
+  std::function<bool(const Packet &pkt, const Sx127x &to)> dropFilter;
+  double noiseFigureDb = 6;
+  static constexpr double CAPTURE_DB = 6;   //a packet survives interference this much weaker
+  double cadPayloadDetect = 0.5; //chance CAD picks up a packet past its preamble
+
+  //--- stats ---
+  uint64_t numSent = 0;
+  uint64_t numCollisions = 0;
+
+  uint64_t send(Sx127x *sender, const LoraConfig &cfg, const std::vector<uint8_t> &data, Time start,
+                double powerDbm);
+  Packet *find(uint64_t id);
+  void prune(Time before); //forget packets everyone has dealt with
+  double noiseFloorDbm(const LoraConfig &cfg) const;
+  static double snrThresholdDb(uint8_t sf); //demodulator floor, datasheet table 13
+  double uniform() { return std::uniform_real_distribution<double>(0, 1)(rng); }
+
+private:
+  uint64_t nextId = 1;
+};
+
+class Sx127x {
+public:
+  Sx127x(Medium &medium, Mcu &mcu, const std::string &name);
+
+  Medium &medium;
+  Mcu &mcu;
+  std::string name;
+
+  uint8_t regs[0x80];
+  uint8_t fifo[256];
+  uint8_t rxWritePtr = 0;
+
+  //--- board side ---
+  void setNss(bool level);
+  uint8_t transfer(uint8_t mosi);
+  void reset();
+  Time nextEvent();
+  void process(Time now);
+  bool dio0 = false;
+
+  //--- settings and state ---
+  uint8_t mode() const { return regs[0x01] & 0x07; }
+  bool isLora() const { return regs[0x01] & 0x80; }
+  LoraConfig config() const;
+  double txPowerDbm() const;
+  bool isListening() const { return isLora() && (mode() == 5 || mode() == 6); }
+  Time oscReadyAt = 0; //when the oscillator is running again after sleep. TX and CAD wait for it
+
+  //--- stats ---
+  uint64_t numTx = 0;
+  uint64_t numRxDone = 0;
+  uint64_t numCrcErrors = 0;
+  uint64_t numRxTimeouts = 0;
+  uint64_t numCad = 0;
+  uint64_t numCadDetected = 0;
+  uint64_t numMissed = 0;   //packets on our settings that we were not listening for
+  uint64_t numLost = 0;     //heard, but lost to noise, collisions or the loss model
+  uint64_t numFifoOverwrites = 0; //received bytes written over a packet not yet read
+  uint64_t numSpiWrites = 0;
+  uint64_t numSpiReads = 0;
+  uint64_t numOscStarts = 0; //times out of sleep
+  Time txAirtime = 0;
+  Time txDoneAt = NEVER; //when the last transmission finished
+  std::function<void(const Packet &pkt, bool isReceived)> onPacket; //each packet on our settings
+  std::function<void(uint8_t addr, uint8_t val, Time at)> onWrite; //each register written over SPI
+
+private:
+  //what the receiver was doing since a point in time
+  struct ListenSpan {
+    Time since;
+    bool isListening;
+    LoraConfig cfg;
+    uint32_t session; //counts entries into RX. Leaving RX loses a packet, however briefly
+  };
+  std::vector<ListenSpan> history;
+  uint32_t rxSession = 0;
+
+  bool isSelected = false;
+  bool isAddressPhase = false;
+  uint8_t address = 0;
+  bool isWrite = false;
+
+  uint64_t txPacketId = 0;
+  Time txEnd = NEVER;
+  Time cadEnd = NEVER;
+  Time cadStart = 0;
+  Time rxSingleTimeout = NEVER;
+  //the last packet received, until the board starts reading it. For counting overwrites
+  bool isUnreadPacket = false;
+  uint8_t unreadStart = 0;
+  uint8_t unreadLen = 0;
+
+  uint8_t readReg(uint8_t addr);
+  void writeReg(uint8_t addr, uint8_t val);
+  void setMode(uint8_t oldMode, Time at); //after a write to the op mode
+  void setIrq(uint8_t flags);
+  void updateDio0();
+  void noteListening(Time at);
+  bool wasListening(const LoraConfig &cfg, Time from, Time to) const;
+  void receive(Packet &pkt);
+  double signalDbm(Packet &pkt);
+  void finishCad();
+};
+
+}
+
+#endif
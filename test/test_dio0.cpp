@@ -0,0 +1,74 @@
+// Checks of the link with DIO0 of the lora module wired to pin 2 on both the transmitter's slave
+// mcu and the receiver, so that tx done and rx done come in as interrupts: the receiver finds the
+// transmitter from boot and keeps in sync, every packet each way is taken, and the radios are not
+// polled over SPI.
+
+#include "link.h"
+#include "check.h"
+
+#include <algorithm>
+
+namespace stx_dio0 { sim::Sketch sketch(); }
+
+//the receiver's sync state, from its own translation unit
+namespace rx_dio0 {
+extern uint8_t syncState;
+extern uint8_t missedSlots;
+sim::Sketch sketch();
+}
+
+using namespace sim;
+
+const uint8_t RX_SYNC_LOCKED = 1;
+const uint8_t PIN_DIO0 = 2;
+
+int main()
+{
+  Link link(stx_dio0::sketch(), rx_dio0::sketch());
+  link.run(ms(3000));
+  CHECK_EQ(rx_dio0::syncState, RX_SYNC_LOCKED);
+
+  uint64_t stxRises = 0, rxRises = 0;
+  link.stx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin == PIN_DIO0 && e.level)
+      stxRises++;
+  };
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin == PIN_DIO0 && e.level)
+      rxRises++;
+  };
+  //out of sync even once would show as a run of missed slots
+  uint8_t mostMissed = 0;
+  bool isLockLost = false;
+  link.rx.onLoop = [&](Mcu &) {
+    mostMissed = std::max(mostMissed, rx_dio0::missedSlots);
+    if(rx_dio0::syncState != RX_SYNC_LOCKED)
+      isLockLost = true;
+  };
+
+  uint64_t stxSent = link.stxRadio.numTx, stxTaken = link.stxRadio.numRxDone;
+  uint64_t rxSent = link.rxRadio.numTx, rxTaken = link.rxRadio.numRxDone;
+  uint64_t stxTxn = link.stx.spiTransactions, rxTxn = link.rx.spiTransactions;
+  const int seconds = 10;
+  link.run(ms(seconds * 1000));
+  stxSent = link.stxRadio.numTx - stxSent;
+  stxTaken = link.stxRadio.numRxDone - stxTaken;
+  rxSent = link.rxRadio.numTx - rxSent;
+  rxTaken = link.rxRadio.numRxDone - rxTaken;
+
+  CHECK(!isLockLost);
+  CHECK_EQ(mostMissed, 0);
+  CHECK(stxSent > 30 * seconds);
+  CHECK(rxSent > 0); //telemetry
+  //the last one may still be on air
+  CHECK_NEAR(rxTaken, stxSent, 1);
+  CHECK_NEAR(stxTaken, rxSent, 1);
+  //a rise for every tx done and rx done
+  CHECK_NEAR(stxRises, stxSent + stxTaken, 2);
+  CHECK_NEAR(rxRises, rxSent + rxTaken, 2);
+  //polling would take tens of thousands a second
+  CHECK((link.stx.spiTransactions - stxTxn) / seconds < 2000);
+  CHECK((link.rx.spiTransactions - rxTxn) / seconds < 2000);
+
+  return checkReport("test_dio0");
+}
@@ -0,0 +1,166 @@
+// Checks of the master mcu's lcd driver, running the whole sketch on the board model. Built once
+// with the KS0108 as mtx/config.h has it, and once with the CGM12864G. The bytes on SPI are decoded
+// as the lcd would take them, and the picture on the lcd must match what was drawn. On a home
+// screen with nothing changing, each frame must send only the one 32 byte run refreshed in turn.
+// When an icon appears, that frame must send only the run it is in on top of that.
+
+#include "sketch_mtx.h"
+#include "check.h"
+
+#include <set>
+
+using namespace sim;
+using namespace mtx;
+
+const uint8_t PIN_COL_SELECT = PIN_COL1;
+const int NUM_RUNS = 1024 / FLUSH_RUN_LEN;
+
+//The lcd's memory, written through the commands and data on SPI
+struct Lcd {
+  uint8_t mem[1024] = {};
+  uint8_t page = 0;
+  uint8_t column = 0; //on the KS0108, within each controller
+  std::set<int> runs; //written to since last cleared
+
+#if defined (DISPLAY_CGM12864G)
+  void take(Mcu &m, uint8_t b)
+  {
+    if(!m.getPin(PIN_CGM_RSEL)) //command
+    {
+      if((b & 0xF0) == 0xB0)
+        page = b & 0x0F;
+      else if((b & 0xF0) == 0x00)
+        column = (column & 0xF0) | (b & 0x0F);
+      else if((b & 0xF0) == 0x10)
+        column = (column & 0x0F) | ((b & 0x0F) << 4);
+      return;
+    }
+    write(page * LCDWIDTH + column - 4, b); //its columns start at 4
+    column++;
+  }
+#else
+  void take(Mcu &m, uint8_t b)
+  {
+    if(!m.getPin(PIN_KS_RS)) //command, to both controllers
+    {
+      if((b & 0xF8) == SET_PAGE)
+        page = b & 0x07;
+      else if((b & 0xC0) == SET_Y_ADDRESS)
+        column = b & 0x3F;
+      return;
+    }
+    bool isLeft = m.getPin(PIN_KS_CS1);
+    CHECK(isLeft != m.getPin(PIN_KS_CS2)); //one controller at a time
+    write(page * LCDWIDTH + (isLeft ? 0 : 64) + column, b);
+    column = (column + 1) & 0x3F;
+  }
+#endif
+
+  void write(int idx, uint8_t b)
+  {
+    if(idx < 0 || idx >= (int)sizeof(mem))
+    {
+      CHECK(false);
+      return;
+    }
+    mem[idx] = b;
+    runs.insert(idx / FLUSH_RUN_LEN);
+  }
+
+  //Whether the lcd shows what is in the driver's buffer
+  bool isShowing()
+  {
+    for(uint8_t y = 0; y < LCDHEIGHT; y++)
+      for(uint8_t x = 0; x < LCDWIDTH; x++)
+        if(((mem[x + (y / 8) * LCDWIDTH] >> (y % 8)) & 0x01) != display.getPixel(x, y))
+          return false;
+    return true;
+  }
+};
+
+//Holds the select key down for a while. The keys are read through a matrix, a column at a time
+static void clickSelect(Sim &s, Mcu &board)
+{
+  board.onPinChange = [&board](const PinEvent &e) {
+    if(e.pin == PIN_COL_SELECT)
+      board.setPin(PIN_ROW2, e.level);
+  };
+  s.run(ms(300));
+  board.onPinChange = nullptr;
+  board.setPin(PIN_ROW2, LOW);
+  s.run(ms(300));
+}
+
+static void setSticks(Sim &s, Mcu &board, uint16_t val)
+{
+  for(uint8_t pin = PIN_THROTTLE; pin <= PIN_ROLL; pin++)
+    board.analogInput[pin - A0] = val;
+  s.run(ms(500));
+}
+
+int main()
+{
+  Sim s;
+  Mcu &board = s.add("mtx", sketch());
+  board.analogInput[PIN_BATTVOLTS - A0] = 775; //3.9V
+  Lcd lcd;
+  board.onSpiByte = [&](uint8_t b) { lcd.take(board, b); };
+
+  //a fresh eeprom is formatted at any key, then the sticks are calibrated
+  s.run(ms(1000));
+  clickSelect(s, board);
+  s.run(ms(6000)); //erasing takes a while
+  setSticks(s, board, 100);
+  setSticks(s, board, 900);
+  setSticks(s, board, 512);
+  clickSelect(s, board); //then the deadzone, left as it is
+  clickSelect(s, board);
+  s.run(ms(8000)); //past the toast
+
+  //each frame from here, as display() ends and before the buffer is cleared for the next. The run
+  //refreshed goes round in turn, so any other run sent is one that changed
+  int numFrames = 0;
+  int numShowing = 0;
+  int numRefreshed = 0;
+  int refreshRun = -1;
+  std::set<int> changed;
+  int numChangedFrames = 0;
+  lcd.runs.clear();
+  board.onSpiEnd = [&]() {
+    numFrames++;
+    if(lcd.isShowing())
+      numShowing++;
+    if(refreshRun < 0)
+      refreshRun = *lcd.runs.begin();
+    else
+      refreshRun = (refreshRun + 1) % NUM_RUNS;
+    if(lcd.runs.erase(refreshRun))
+      numRefreshed++;
+    if(!lcd.runs.empty())
+    {
+      numChangedFrames++;
+      changed = lcd.runs;
+    }
+    lcd.runs.clear();
+  };
+  s.run(ms(3000));
+  CHECK(numFrames > NUM_RUNS); //every run in turn
+  CHECK_EQ(numShowing, numFrames);
+  CHECK_EQ(numRefreshed, numFrames);
+  CHECK_EQ(numChangedFrames, 0);
+
+  //the mute icon, drawn in columns 41 to 47 of page 0
+  numChangedFrames = 0;
+  Sys.soundMode = SOUND_OFF;
+  s.run(ms(500));
+  CHECK_EQ(numShowing, numFrames);
+  CHECK_EQ(numRefreshed, numFrames);
+  CHECK_EQ(numChangedFrames, 1); //once, as it appears
+  CHECK(changed == std::set<int>{41 / FLUSH_RUN_LEN});
+
+#if defined (DISPLAY_CGM12864G)
+  return checkReport("test_display_cgm");
+#else
+  return checkReport("test_display");
+#endif
+}
@@ -0,0 +1,168 @@
+// Checks of the background EEPROM writer in eequeue.h on the board model: bytes that already hold
+// the value are not written again, a put that doesn't fit in the queue is turned down whole while
+// smaller ones still go in, and a byte that doesn't read back right is written again up to
+// EEQ_MAX_RETRIES times, then counted in eeqErrorCount. The transmitter's copy must be the same.
+
+#include <Arduino.h>
+#include "check.h"
+
+#include <string.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+using namespace sim;
+
+namespace eeq {
+#include "../rx/eequeue.h"
+
+void setup() {}
+void loop() {}
+
+Sketch sketch()
+{
+  return Sketch{"eeq", setup, loop, {{VEC_EE_READY, EE_READY_vect}}};
+}
+}
+
+using namespace eeq;
+
+static std::string readFile(const char *path)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+//Runs fn on the board, then lets the queue empty
+static void onBoard(Sim &s, Mcu &board, std::function<void()> fn)
+{
+  bool isDone = false;
+  board.onLoop = [&](Mcu &) {
+    if(!isDone)
+      fn();
+    isDone = true;
+  };
+  s.run(ms(200));
+  board.onLoop = nullptr;
+}
+
+static void testSkip()
+{
+  Sim s;
+  Mcu &board = s.add("eeq", sketch());
+  const uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  memcpy(board.eeprom + 10, data, sizeof(data));
+  board.eeprom[11] = 0xFF;
+  board.eeprom[14] = 0;
+  board.eeprom[17] = 0x55;
+  s.run(ms(10));
+
+  uint32_t writes = board.eepromWrites;
+  Time start = s.now();
+  Time doneAt = 0;
+  bool isPut = false;
+  board.onLoop = [&](Mcu &m) {
+    if(!isPut)
+      isPut = eeqPut(10, data, sizeof(data));
+    else if(!doneAt && eeqIsDone())
+      doneAt = m.now;
+  };
+  s.run(ms(200));
+  CHECK(isPut);
+  CHECK_EQ(board.eepromWrites - writes, 3); //only the ones that differed
+  CHECK(memcmp(board.eeprom + 10, data, sizeof(data)) == 0);
+  CHECK(doneAt - start < ms(3 * 3.4 + 2));
+  CHECK_EQ(eeqErrorCount, 0);
+}
+
+static void testFull()
+{
+  Sim s;
+  Mcu &board = s.add("eeq", sketch());
+  s.run(ms(10));
+
+  uint8_t first[20], tooMany[4], last[3];
+  memset(first, 0x11, sizeof(first));
+  memset(tooMany, 0x22, sizeof(tooMany));
+  memset(last, 0x33, sizeof(last));
+  bool isFirstPut = false, isTooManyPut = true, isLastPut = false;
+  onBoard(s, board, [&] {
+    //one entry is always kept free, so the queue holds EEQ_SIZE - 1 bytes
+    isFirstPut = eeqPut(0, first, sizeof(first));
+    isTooManyPut = eeqPut(100, tooMany, sizeof(tooMany));
+    isLastPut = eeqPut(200, last, sizeof(last));
+  });
+  CHECK_EQ(sizeof(first) + sizeof(last), EEQ_SIZE - 1);
+  CHECK(isFirstPut);
+  CHECK(!isTooManyPut);
+  CHECK(isLastPut);
+  CHECK(eeqIsDone());
+  CHECK_EQ(board.eepromWrites, EEQ_SIZE - 1);
+  CHECK_EQ(board.eeprom[19], 0x11);
+  CHECK_EQ(board.eeprom[100], 0xFF); //turned down whole, nothing written
+  CHECK_EQ(board.eeprom[103], 0xFF);
+  CHECK_EQ(board.eeprom[202], 0x33);
+
+  //room again once written
+  bool isPutAfter = false;
+  onBoard(s, board, [&] { isPutAfter = eeqPut(100, tooMany, sizeof(tooMany)); });
+  CHECK(isPutAfter);
+  CHECK_EQ(board.eeprom[103], 0x22);
+}
+
+static void testRetries()
+{
+  Sim s;
+  Mcu &board = s.add("eeq", sketch());
+  s.run(ms(10));
+
+  //300 never takes a write. 301 takes the second one
+  int triesAt[3] = {};
+  board.eepromWriteFails = [&](uint16_t addr) {
+    if(addr >= 300 && addr < 303)
+      triesAt[addr - 300]++;
+    return addr == 300 || (addr == 301 && triesAt[1] == 1);
+  };
+  const uint8_t data[3] = {0xA0, 0xA1, 0xA2};
+  onBoard(s, board, [&] { eeqPut(300, data, sizeof(data)); });
+  CHECK(eeqIsDone());
+  CHECK_EQ(triesAt[0], 1 + EEQ_MAX_RETRIES);
+  CHECK_EQ(triesAt[1], 2);
+  CHECK_EQ(triesAt[2], 1);
+  CHECK_EQ(board.eeprom[300], 0xFF);
+  CHECK_EQ(board.eeprom[301], 0xA1);
+  CHECK_EQ(board.eeprom[302], 0xA2); //the queue moved on
+  CHECK_EQ(eeqErrorCount, 1);
+  CHECK_EQ(eeqRetries, 0);
+}
+
+//Runs a test in a process of its own, as the queue is global, and adds up its checks
+static void runIsolated(void (*test)())
+{
+  std::string counts = isolated([test] {
+    checkCount = 0;
+    checkFailures = 0;
+    test();
+    return std::to_string(checkCount) + " " + std::to_string(checkFailures);
+  });
+  int n = 0, failed = 0;
+  sscanf(counts.c_str(), "%d %d", &n, &failed);
+  checkCount += n;
+  checkFailures += failed;
+}
+
+int main()
+{
+  runIsolated(testSkip);
+  runIsolated(testFull);
+  runIsolated(testRetries);
+
+  //the receiver and the transmitter each carry a copy
+  std::string rxCopy = readFile("../rx/eequeue.h");
+  CHECK(rxCopy.size() > 0);
+  CHECK(rxCopy == readFile("../stx/eequeue.h"));
+
+  return checkReport("test_eequeue");
+}
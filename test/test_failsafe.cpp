@@ -0,0 +1,140 @@
+// Checks of the receiver's failsafe over the simulated link, at each rate profile. The master
+// sends failsafe values of a position on ch1, hold on ch2 and no pulses on ch3, then the link is
+// cut. Failsafe must come on once FAILSAFE_MISSED_SLOTS rc slots have gone by since the last rc
+// packet, ch1 must go to its position, ch2 keep the width it had and ch3 stop pulsing. Once the link is back, the delay
+// from the last packet to failsafe on the outputs is reported in telemetry to within a servo frame.
+
+#include "sketch_stx.h"
+#include "link.h"
+#include "check.h"
+
+#include <string>
+
+//the receiver's state, from its own translation unit
+namespace rx {
+extern uint8_t rateProfile;
+extern uint8_t syncState;
+extern bool isFailsafeActive;
+extern bool failsafeEverBeenReceived;
+}
+
+using namespace sim;
+
+const uint8_t SYNC_LOCKED = 1;
+const int FAILSAFE_MISSED_SLOTS = 8; //should match the receiver
+const uint16_t FAILSAFE_NO_PULSES = 1022;
+const uint16_t FAILSAFE_HOLD = 1023;
+//the outputs of ch1, ch2 and ch3
+const uint8_t PIN_POSITION = 2;
+const uint8_t PIN_HOLD = 5;
+const uint8_t PIN_NO_PULSES = 3;
+
+static void testFailsafe(uint8_t profile)
+{
+  Link link;
+  master::settings.rfPower = RF_POWER_AUTO_FIRST + 2;
+  master::settings.isLongRangeAllowed = true;
+  master::settings.channels[0] = 200;  //1700us
+  master::settings.channels[1] = 100;  //1600us
+  master::settings.channels[2] = -100; //1400us
+  master::settings.failsafes[0] = 200; //1200us
+  master::settings.failsafes[1] = FAILSAFE_HOLD;
+  master::settings.failsafes[2] = FAILSAFE_NO_PULSES;
+  master::settings.isFailsafeSet = true;
+  int numRises[Mcu::NUM_PINS] = {};
+  Time riseAt[Mcu::NUM_PINS] = {};
+  double widthUs[Mcu::NUM_PINS] = {};
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.level)
+    {
+      numRises[e.pin]++;
+      riseAt[e.pin] = e.time;
+    }
+    else if(riseAt[e.pin])
+      widthUs[e.pin] = toUs(e.time - riseAt[e.pin]);
+  };
+  Time lastRcAt = 0;
+  uint64_t repliesAtLastRc = 0;
+  link.rxRadio.onPacket = [&](const Packet &p, bool isReceived) {
+    if(isReceived && p.sender == &link.stxRadio)
+    {
+      lastRcAt = p.end;
+      repliesAtLastRc = link.rxRadio.numTx;
+    }
+  };
+  link.run(ms(3000));
+  //changed over once in sync, and kept there even though the link is strong
+  link.stx.onLoop = [profile](Mcu &) {
+    if(profile == stx::RATE_PROFILE_LONG_RANGE)
+      stx::requestedRateProfile = stx::RATE_PROFILE_LONG_RANGE;
+  };
+  link.run(ms(3000));
+  CHECK_EQ(stx::rateProfile, profile);
+  CHECK_EQ(rx::rateProfile, profile);
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+  CHECK(rx::failsafeEverBeenReceived);
+  CHECK(!rx::isFailsafeActive);
+  CHECK_NEAR(widthUs[PIN_POSITION], 1700, 2);
+  CHECK_NEAR(widthUs[PIN_HOLD], 1600, 2);
+  CHECK_NEAR(widthUs[PIN_NO_PULSES], 1400, 2);
+  CHECK(numRises[PIN_NO_PULSES] > 0);
+
+  //cut the link
+  bool isCut = true;
+  link.medium.dropFilter = [&](const Packet &, const Sx127x &) { return isCut; };
+  Time failsafeAt = 0;
+  uint64_t repliesAtFailsafe = 0;
+  link.rx.onLoop = [&](Mcu &m) {
+    if(!failsafeAt && rx::isFailsafeActive)
+    {
+      failsafeAt = m.now;
+      repliesAtFailsafe = link.rxRadio.numTx;
+    }
+  };
+  link.run(ms(1000));
+  Time cutAt = lastRcAt;
+  int noPulseRises = numRises[PIN_NO_PULSES];
+  link.run(ms(1000));
+  CHECK(failsafeAt > 0);
+  Time slot = us(profile == stx::RATE_PROFILE_LONG_RANGE ? SLOT_PERIOD_LONG_RANGE_US : SLOT_PERIOD_FAST_US);
+  //a slot taken by a reply was never due an rc packet, so doesn't count as missed
+  int numReplies = repliesAtFailsafe - repliesAtLastRc;
+  CHECK(numReplies <= 1);
+  Time due = (FAILSAFE_MISSED_SLOTS + numReplies) * slot;
+  CHECK(failsafeAt - cutAt > due);
+  CHECK(failsafeAt - cutAt < due + slot / 4);
+  CHECK_NEAR(widthUs[PIN_POSITION], 1200, 2);
+  CHECK_NEAR(widthUs[PIN_HOLD], 1600, 2);
+  CHECK_EQ(numRises[PIN_NO_PULSES], noPulseRises);
+  CHECK(riseAt[PIN_NO_PULSES] < failsafeAt + ms(20));
+
+  //back again, the delay goes out in telemetry in 10ms steps
+  isCut = false;
+  Time start = link.sim.now();
+  while(master::reply.failsafeDelay == 0 && link.sim.now() - start < ms(15000))
+    link.run(ms(10));
+  CHECK(master::reply.failsafeDelay > 0);
+  CHECK_NEAR(master::reply.failsafeDelay * 10.0, toMs(failsafeAt - cutAt), 20 + 10);
+}
+
+//Runs a test in a process of its own, as each needs a fresh link, and adds up its checks
+static void runIsolated(uint8_t profile)
+{
+  std::string counts = isolated([profile] {
+    checkCount = 0;
+    checkFailures = 0;
+    testFailsafe(profile);
+    return std::to_string(checkCount) + " " + std::to_string(checkFailures);
+  });
+  int n = 0, failed = 0;
+  sscanf(counts.c_str(), "%d %d", &n, &failed);
+  checkCount += n;
+  checkFailures += failed;
+}
+
+int main()
+{
+  runIsolated(stx::RATE_PROFILE_FAST);
+  runIsolated(stx::RATE_PROFILE_LONG_RANGE);
+  return checkReport("test_failsafe");
+}
@@ -0,0 +1,84 @@
+// Checks of the Reed-Solomon code in fec.h on rc frame sized packets: clean codewords pass, every
+// single corrupted byte is put right, and two corrupted bytes are never taken for a clean packet.
+
+#include <Arduino.h>
+#include "../stx/fec.h"
+#include "check.h"
+
+#include <string.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+
+static std::string readFile(const char *path)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+static void checkLength(uint8_t dataLen, std::mt19937 &rng)
+{
+  uint8_t data[19];
+  for(uint8_t i = 0; i < dataLen; i++)
+    data[i] = rng();
+  uint8_t code[19 + FEC_PARITY_LEN];
+  memcpy(code, data, dataLen);
+  fecEncode(code, dataLen);
+  CHECK(memcmp(code, data, dataLen) == 0); //the data is sent as it is
+  uint8_t len = dataLen + FEC_PARITY_LEN;
+
+  uint8_t buff[sizeof(code)];
+  memcpy(buff, code, len);
+  CHECK_EQ(fecDecode(buff, len), FEC_NO_ERROR);
+  CHECK(memcmp(buff, code, len) == 0);
+
+  //any error pattern in any one byte, the parity bytes included
+  int numWrong = 0;
+  for(uint8_t pos = 0; pos < len; pos++)
+    for(int err = 1; err < 256; err++)
+    {
+      memcpy(buff, code, len);
+      buff[pos] ^= err;
+      if(fecDecode(buff, len) != FEC_CORRECTED || memcmp(buff, code, len) != 0)
+        numWrong++;
+    }
+  CHECK_EQ(numWrong, 0);
+
+  //two bytes wrong. The code has a distance of 3, so this can not look like a clean codeword.
+  //It may be miscorrected, which the crc8 in the packet is there to catch
+  int numClean = 0;
+  for(int n = 0; n < 20000; n++)
+  {
+    uint8_t pos1 = rng() % len;
+    uint8_t pos2 = (pos1 + 1 + rng() % (len - 1)) % len;
+    memcpy(buff, code, len);
+    buff[pos1] ^= 1 + rng() % 255;
+    buff[pos2] ^= 1 + rng() % 255;
+    if(fecDecode(buff, len) == FEC_NO_ERROR)
+      numClean++;
+  }
+  CHECK_EQ(numClean, 0);
+}
+
+int main()
+{
+  std::mt19937 rng(1);
+
+  //rc frames are 16 bytes with just the primary channels, 19 with a secondary group or record
+  checkLength(16, rng);
+  checkLength(19, rng);
+  checkLength(1, rng);
+
+  uint8_t buff[4] = {1, 2, 3, 4};
+  CHECK_EQ(fecDecode(buff, FEC_PARITY_LEN), FEC_UNCORRECTABLE);
+
+  //the receiver and the transmitter each carry a copy
+  std::string rxCopy = readFile("../rx/fec.h");
+  CHECK(rxCopy.size() > 0);
+  CHECK(rxCopy == readFile("../stx/fec.h"));
+
+  return checkReport("test_fec");
+}
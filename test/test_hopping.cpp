@@ -0,0 +1,106 @@
+// Checks of the channel plan and of generateHopSequence() over every possible seed: both ends make
+// the same sequence, each block uses every channel once, no channel comes twice in a row, the
+// wrap from the end of the sequence back to the start included, and different seeds give
+// different sequences.
+
+#include "sketch_stx.h"
+#include "check.h"
+
+#include <set>
+#include <vector>
+
+//the receiver's copy, from its own translation unit
+namespace rx {
+extern uint8_t hopSequence[HOP_SEQUENCE_LENGTH];
+void generateHopSequence(uint16_t seed);
+uint32_t getChannelFreq(uint8_t channel);
+}
+
+using namespace stx;
+
+int main()
+{
+  //channels inside the band, far enough apart, and the same at both ends
+  CHECK_EQ(NUM_FREQ_CHANNELS, 6);
+  CHECK(getChannelFreq(0) - FREQ_CH_BANDWIDTH / 2 >= FREQ_BAND_START);
+  CHECK(getChannelFreq(NUM_FREQ_CHANNELS - 1) + FREQ_CH_BANDWIDTH / 2 <= FREQ_BAND_END);
+  for(uint8_t ch = 0; ch < NUM_FREQ_CHANNELS; ch++)
+  {
+    CHECK_EQ(rx::getChannelFreq(ch), getChannelFreq(ch));
+    if(ch > 0)
+      CHECK(getChannelFreq(ch) - getChannelFreq(ch - 1) >= FREQ_CH_SPACING);
+  }
+
+  int numMismatched = 0;
+  int numOutOfPlan = 0;
+  int numBadBlocks = 0;
+  int numRepeats = 0;
+  int numWrapRepeats = 0;
+  int numUneven = 0;
+  uint64_t numAdjacent = 0; //hops to the channel next door
+  uint64_t hopDistance = 0;
+  std::set<std::vector<uint8_t>> sequences;
+  for(uint32_t seed = 0; seed <= 0xFFFF; seed++)
+  {
+    generateHopSequence(seed);
+    rx::generateHopSequence(seed);
+    if(memcmp(hopSequence, rx::hopSequence, HOP_SEQUENCE_LENGTH) != 0)
+      numMismatched++;
+
+    int count[NUM_FREQ_CHANNELS] = {};
+    for(uint8_t i = 0; i < HOP_SEQUENCE_LENGTH; i++)
+    {
+      uint8_t ch = hopSequence[i];
+      if(ch >= NUM_FREQ_CHANNELS)
+      {
+        numOutOfPlan++;
+        continue;
+      }
+      count[ch]++;
+      uint8_t next = hopSequence[(i + 1) % HOP_SEQUENCE_LENGTH];
+      if(next == ch)
+      {
+        if(i + 1 == HOP_SEQUENCE_LENGTH)
+          numWrapRepeats++;
+        else
+          numRepeats++;
+      }
+      int dist = abs((int)next - (int)ch);
+      hopDistance += dist;
+      if(dist == 1)
+        numAdjacent++;
+    }
+    for(uint8_t ch = 0; ch < NUM_FREQ_CHANNELS; ch++)
+      if(count[ch] != HOP_SEQUENCE_LENGTH / NUM_FREQ_CHANNELS)
+        numUneven++;
+
+    for(uint8_t b = 0; b < HOP_SEQUENCE_LENGTH; b += NUM_FREQ_CHANNELS)
+    {
+      uint8_t seen = 0;
+      for(uint8_t i = b; i < b + NUM_FREQ_CHANNELS; i++)
+        seen |= 1 << hopSequence[i];
+      if(seen != (1 << NUM_FREQ_CHANNELS) - 1)
+        numBadBlocks++;
+    }
+
+    sequences.insert(std::vector<uint8_t>(hopSequence, hopSequence + HOP_SEQUENCE_LENGTH));
+  }
+
+  CHECK_EQ(numMismatched, 0);
+  CHECK_EQ(numOutOfPlan, 0);
+  CHECK_EQ(numBadBlocks, 0);
+  CHECK_EQ(numUneven, 0);
+  CHECK_EQ(numRepeats, 0);
+  CHECK_EQ(numWrapRepeats, 0);
+
+  //Spread. With 6 channels and no repeats, a random next channel is one of the 5 others, and is
+  //next door 1/3 of the time on average, at a mean distance of 7/3 channels
+  double numHops = 65536.0 * HOP_SEQUENCE_LENGTH;
+  CHECK_NEAR(numAdjacent / numHops, 1.0 / 3, 0.02);
+  CHECK_NEAR(hopDistance / numHops, 7.0 / 3, 0.05);
+
+  //the xorshift state is 16 bits, and seed 0 stands in for 0xACE1, so at most 65535 sequences
+  CHECK(sequences.size() >= 65535 * 0.99);
+
+  return checkReport("test_hopping");
+}
@@ -0,0 +1,108 @@
+// Checks of the LoRa driver on a board, polling as the receiver does: continuous RX takes
+// packets that come one after another without re-arming, each is read back whole, and each is
+// written at the RX base so received packets stay out of the TX half of the FIFO. The receiver's
+// and the transmitter's copies of the driver must be the same.
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "sx127x.h"
+#include "check.h"
+
+#include <string.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+namespace drv {
+#include "../rx/LoRa.cpp"
+}
+
+using namespace sim;
+
+static std::string readFile(const char *path)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+const uint8_t PACKET_LEN = 21;
+const int NUM_PACKETS = 40;
+
+Sx127x *rxRadio = NULL;
+int numReceived = 0;
+int numIntact = 0;
+int numWrongLength = 0;
+int fifoTop = 0;
+uint8_t txFifoStart = 0;
+
+void receiverSetup()
+{
+  drv::LoRa.setPins(10, 8, -1);
+  drv::LoRa.begin(433195000);
+  drv::LoRa.setSpreadingFactor(7);
+  drv::LoRa.setCodingRate4(5);
+  drv::LoRa.setSignalBandwidth(250E3);
+  drv::LoRa.disableCrc();
+}
+
+void receiverLoop()
+{
+  int len = drv::LoRa.parsePacket();
+  if(len <= 0)
+    return;
+  numReceived++;
+  if(len != PACKET_LEN)
+    numWrongLength++;
+  uint8_t start = rxRadio->regs[0x10]; //FIFO rx current addr
+  fifoTop = std::max(fifoTop, start + len - 1);
+  uint8_t buff[32];
+  int n = drv::LoRa.readPacket(buff, sizeof(buff));
+  bool isIntact = n == PACKET_LEN;
+  for(int i = 1; i < n; i++)
+    isIntact = isIntact && buff[i] == (uint8_t)(buff[0] + i);
+  if(isIntact)
+    numIntact++;
+}
+
+int main()
+{
+  Sim s;
+  Medium medium;
+  s.medium = &medium;
+  Sketch receiver = {"receiver", receiverSetup, receiverLoop, {}};
+  Mcu &rx = s.add("receiver", receiver);
+  Sx127x radio(medium, rx, "rx");
+  rxRadio = &radio;
+  Mcu senderMcu("sender", Sketch());
+  Sx127x sender(medium, senderMcu, "sender");
+
+  //a packet every 30ms on the receiver's channel, with nothing in between to take it out of RX
+  s.run(ms(100));
+  CHECK_EQ(radio.mode(), 5); //continuous RX
+  for(int n = 0; n < NUM_PACKETS; n++)
+  {
+    std::vector<uint8_t> data(PACKET_LEN);
+    for(uint8_t i = 0; i < PACKET_LEN; i++)
+      data[i] = n * 7 + i;
+    medium.send(&sender, radio.config(), data, s.now(), 17);
+    s.run(ms(30));
+  }
+  CHECK_EQ(numReceived, NUM_PACKETS);
+  CHECK_EQ(numIntact, NUM_PACKETS);
+  CHECK_EQ(numWrongLength, 0);
+  CHECK(fifoTop < 0x80);
+  CHECK_EQ(radio.numFifoOverwrites, 0);
+  CHECK_EQ(radio.numMissed, 0);
+
+  //the receiver and the transmitter each carry a copy
+  for(const char *name : {"LoRa.cpp", "LoRa.h"})
+  {
+    std::string rxCopy = readFile((std::string("../rx/") + name).c_str());
+    CHECK(rxCopy.size() > 0);
+    CHECK(rxCopy == readFile((std::string("../stx/") + name).c_str()));
+  }
+
+  return checkReport("test_lora");
+}
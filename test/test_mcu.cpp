@@ -0,0 +1,157 @@
+// Checks of the board model: the millis() tick, timer1 compare interrupts, the usart between two
+// boards and EEPROM write timing.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "check.h"
+
+using namespace sim;
+
+//--- a board that only keeps time ---
+
+uint32_t clockMillis[11];
+uint32_t clockMicros[11];
+
+void clockSetup() {}
+
+void clockLoop()
+{
+  static int n = 0;
+  if(n <= 10)
+  {
+    clockMillis[n] = millis();
+    clockMicros[n] = micros();
+    n++;
+  }
+  delay(1000);
+}
+
+//--- timer1 compare A every 1000us, as the receiver's pulse engine uses it ---
+
+volatile uint32_t t1Matches = 0;
+uint32_t t1FirstMicros = 0;
+uint32_t t1LastMicros = 0;
+
+void t1CompA()
+{
+  OCR1A += 2000;
+  if(t1Matches == 0)
+    t1FirstMicros = micros();
+  t1LastMicros = micros();
+  t1Matches++;
+}
+
+void t1Setup()
+{
+  TCCR1A = 0;
+  TCCR1B = (1 << CS11); //2MHz
+  OCR1A = TCNT1 + 2000;
+  TIFR1 = (1 << OCF1A);
+  TIMSK1 |= (1 << OCIE1A);
+}
+
+void t1Loop()
+{
+  delay(10);
+}
+
+//--- usart, one board sending to another ---
+
+const char *serialMessage = "0123456789";
+uint32_t serialSendMicros = 0;
+uint32_t serialReceivedMicros[10];
+int serialNumReceived = 0;
+
+void senderSetup()
+{
+  Serial.begin(115200);
+  delay(5);
+  serialSendMicros = micros();
+  Serial.write(serialMessage);
+}
+
+void senderLoop()
+{
+  delay(10);
+}
+
+void receiverSetup()
+{
+  Serial.begin(115200);
+}
+
+void receiverLoop()
+{
+  while(Serial.available() && serialNumReceived < 10)
+  {
+    Serial.read();
+    serialReceivedMicros[serialNumReceived++] = micros();
+  }
+}
+
+//--- eeprom ---
+
+uint32_t eeWriteMicros[3];
+
+void eeSetup()
+{
+  for(int i = 0; i < 3; i++)
+  {
+    EEPROM.write(i, i + 1);
+    eeWriteMicros[i] = micros();
+  }
+}
+
+void eeLoop()
+{
+  delay(10);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+int main()
+{
+  Sim s;
+  Sketch clock = {"clock", clockSetup, clockLoop, {}};
+  Sketch t1 = {"timer1", t1Setup, t1Loop, {{VEC_TIMER1_COMPA, t1CompA}}};
+  Sketch sender = {"sender", senderSetup, senderLoop, {}};
+  Sketch receiver = {"receiver", receiverSetup, receiverLoop, {}};
+  Sketch ee = {"eeprom", eeSetup, eeLoop, {}};
+  s.add("clock", clock);
+  Mcu &t1Board = s.add("timer1", t1);
+  Mcu &tx = s.add("sender", sender);
+  Mcu &rx = s.add("receiver", receiver);
+  Mcu &eeBoard = s.add("eeprom", ee);
+  s.connectSerial(tx, rx);
+  s.run(ms(10500));
+
+  //millis() runs 1.024ms per tick with the fraction carried, so it keeps time over the long run
+  CHECK_EQ(clockMillis[0], 0);
+  for(int i = 1; i <= 10; i++)
+  {
+    CHECK_NEAR(clockMillis[i] - clockMillis[i - 1], 1000, 2);
+    CHECK_NEAR(clockMicros[i] - clockMicros[i - 1], 1000000, 100);
+  }
+  CHECK_NEAR(clockMillis[10], 10000, 3);
+  CHECK_NEAR(clockMicros[10] / 1000.0, clockMillis[10], 2);
+
+  //every 1000us, give or take the interrupt latency
+  CHECK_NEAR(t1Matches, 10500, 2);
+  CHECK_NEAR(t1LastMicros - t1FirstMicros, (t1Matches - 1) * 1000.0, 30);
+  CHECK(t1Board.isrCount[VEC_TIMER1_COMPA] == t1Matches);
+
+  //10 bits per byte at 115200 baud, 86.8us each, back to back
+  CHECK_EQ(serialNumReceived, 10);
+  CHECK_NEAR(serialReceivedMicros[0] - serialSendMicros, 86.8, 30);
+  CHECK_NEAR(serialReceivedMicros[9] - serialReceivedMicros[0], 9 * 86.8, 30);
+  CHECK_EQ(rx.rxOverruns, 0);
+  CHECK(tx.serialText == serialMessage);
+
+  //each write waits for the one before it, 3.4ms
+  CHECK_NEAR(eeWriteMicros[1] - eeWriteMicros[0], 3400, 50);
+  CHECK_NEAR(eeWriteMicros[2] - eeWriteMicros[1], 3400, 50);
+  CHECK_EQ(eeBoard.eeprom[2], 3);
+  CHECK_EQ(eeBoard.eepromWrites, 3);
+
+  return checkReport("test_mcu");
+}
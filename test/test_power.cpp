@@ -0,0 +1,187 @@
+// Checks of the transmitter's automatic power control, getLinkMargin() and adjustAutoPower(),
+// fed telemetry values straight, with and without the change to the long range profile.
+
+#include "sketch_stx.h"
+#include "check.h"
+
+using namespace stx;
+
+//A telemetry report with the given link quality and the same signal both ways
+static void report(uint8_t lq, uint8_t rssi, int8_t snr)
+{
+  receiverLinkQuality = lq;
+  uplinkRssi = rssi;
+  uplinkSnr = snr;
+  downlinkRssi = rssi;
+  downlinkSnr = snr;
+  adjustAutoPower(true);
+}
+
+static void testLinkMargin()
+{
+  CHECK_EQ(getLinkMargin(0, 5), 0); //no data
+
+  //snr above the SF7 floor of about -7.5dB, while it still tracks the signal
+  CHECK_EQ(getLinkMargin(118, -8), 0);
+  CHECK_EQ(getLinkMargin(118, -7), 1);
+  CHECK_EQ(getLinkMargin(110, 2), 10);
+  CHECK_EQ(getLinkMargin(105, 7), 15);
+
+  //rssi above the -120dBm sensitivity once snr saturates, never less than the snr branch gives
+  CHECK_EQ(getLinkMargin(103, 8), 17);
+  CHECK_EQ(getLinkMargin(95, 10), 25);
+  CHECK_EQ(getLinkMargin(60, 10), 60);
+  CHECK_EQ(getLinkMargin(112, 9), 16);
+  CHECK_EQ(getLinkMargin(10, 10), 100);
+  CHECK_EQ(getLinkMargin(1, 10), 100);
+
+  //a signal getting stronger never loses margin, across the switch from snr to rssi. Until snr
+  //saturates, it rises along with rssi
+  int numDips = 0;
+  int8_t prev = getLinkMargin(127, -10);
+  for(int step = 1; step < 120; step++)
+  {
+    int8_t m = getLinkMargin(127 - step, std::min(-10 + step, 10));
+    if(m < prev)
+      numDips++;
+    prev = m;
+  }
+  CHECK_EQ(numDips, 0);
+}
+
+static void testFixedPower()
+{
+  rfPowerSetting = 3;
+  idxRFPowerLevel = 3;
+  report(50, 118, -7);
+  CHECK_EQ(idxRFPowerLevel, 3);
+  adjustAutoPower(false);
+  CHECK_EQ(idxRFPowerLevel, 3);
+  for(int i = 0; i < 10; i++)
+    report(100, 40, 10);
+  CHECK_EQ(idxRFPowerLevel, 3);
+}
+
+static void testAutoPower()
+{
+  //Auto<50mW, started at the max as doSerialCommunication() does
+  rfPowerSetting = RF_POWER_AUTO_FIRST + 2;
+  idxRFPowerLevel = 4;
+
+  //down one step per APC_GOOD_REPORTS good reports, and no further than level 0
+  for(int i = 0; i < APC_GOOD_REPORTS - 1; i++)
+    report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 4);
+  report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 3);
+  for(int i = 0; i < 20 * APC_GOOD_REPORTS; i++)
+    report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 0);
+
+  //up at once on low link quality, and on a low margin in either direction
+  report(APC_LQ_LOW - 1, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 1);
+  receiverLinkQuality = 100;
+  uplinkRssi = 60;
+  uplinkSnr = 10;
+  downlinkRssi = 115;
+  downlinkSnr = APC_MARGIN_LOW - 9; //margin of APC_MARGIN_LOW - 1
+  adjustAutoPower(true);
+  CHECK_EQ(idxRFPowerLevel, 2);
+  report(100, 115, APC_MARGIN_LOW - 8); //just enough margin, holds
+  CHECK_EQ(idxRFPowerLevel, 2);
+
+  //between the thresholds it holds, and a report there starts the count of good ones over
+  report(100, 60, 10);
+  report(100, 60, 10);
+  report(APC_LQ_HIGH - 1, 60, 10);
+  report(100, 60, 10);
+  report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 2);
+  report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 1);
+  for(int i = 0; i < 2 * APC_GOOD_REPORTS; i++)
+    report(100, 120 - APC_MARGIN_HIGH + 1, 10); //margin of APC_MARGIN_HIGH - 1
+  CHECK_EQ(idxRFPowerLevel, 1);
+
+  //never above the max
+  for(int i = 0; i < 10; i++)
+    report(0, 118, -7);
+  CHECK_EQ(idxRFPowerLevel, 4);
+
+  //telemetry lost, straight to the max
+  for(int i = 0; i < 20 * APC_GOOD_REPORTS; i++)
+    report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 0);
+  adjustAutoPower(false);
+  CHECK_EQ(idxRFPowerLevel, 4);
+
+  //a lower max takes effect on the next report
+  rfPowerSetting = RF_POWER_AUTO_FIRST; //Auto<10mW, level 2
+  report(50, 118, -7);
+  CHECK_EQ(idxRFPowerLevel, 2);
+  adjustAutoPower(false);
+  CHECK_EQ(idxRFPowerLevel, 2);
+}
+
+static void testLongRange()
+{
+  rfPowerSetting = RF_POWER_AUTO_FIRST + 2;
+  isLongRangeAllowed = true;
+  rateProfile = RATE_PROFILE_FAST;
+  requestedRateProfile = RATE_PROFILE_FAST;
+  idxRFPowerLevel = 3;
+
+  //the long range profile demodulates LONG_RANGE_GAIN_DB further down
+  CHECK_EQ(getLinkMargin(118, -7), 1);
+  CHECK_EQ(getLinkMargin(95, 10), 25);
+  rateProfile = RATE_PROFILE_LONG_RANGE;
+  CHECK_EQ(getLinkMargin(118, -7), 1 + LONG_RANGE_GAIN_DB);
+  CHECK_EQ(getLinkMargin(95, 10), 25 + LONG_RANGE_GAIN_DB);
+  CHECK_EQ(getLinkMargin(112, 9), 16 + LONG_RANGE_GAIN_DB);
+  rateProfile = RATE_PROFILE_FAST;
+
+  //power first. The profile only once at the max with a low margin, and not for low link quality
+  report(100, 115, APC_MARGIN_LOW - 9);
+  CHECK_EQ(idxRFPowerLevel, 4);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_FAST);
+  report(APC_LQ_LOW - 1, 60, 10);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_FAST);
+  report(100, 115, APC_MARGIN_LOW - 9);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_LONG_RANGE);
+  rateProfile = RATE_PROFILE_LONG_RANGE;
+
+  //back after good reports, before any power step down
+  for(int i = 0; i < APC_GOOD_REPORTS; i++)
+    report(100, 60, 10);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_FAST);
+  CHECK_EQ(idxRFPowerLevel, 4);
+  rateProfile = RATE_PROFILE_FAST;
+  for(int i = 0; i < APC_GOOD_REPORTS; i++)
+    report(100, 60, 10);
+  CHECK_EQ(idxRFPowerLevel, 3);
+
+  //telemetry lost after a link, straight to the max and the long range profile
+  adjustAutoPower(false);
+  CHECK_EQ(idxRFPowerLevel, 4);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_LONG_RANGE);
+
+  //but not again before a report comes, nor when it isn't allowed
+  requestedRateProfile = RATE_PROFILE_FAST;
+  adjustAutoPower(false);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_FAST);
+  isLongRangeAllowed = false;
+  report(100, 60, 10);
+  adjustAutoPower(false);
+  report(100, 115, APC_MARGIN_LOW - 9);
+  CHECK_EQ(requestedRateProfile, RATE_PROFILE_FAST);
+}
+
+int main()
+{
+  testLinkMargin();
+  testFixedPower();
+  testAutoPower();
+  testLongRange();
+  return checkReport("test_power");
+}
@@ -0,0 +1,155 @@
+// Checks of the rate profile change over the simulated link, in automatic power mode with long
+// range allowed. The transmitter changes to the long range profile once the max power isn't
+// enough, and back once the link is strong again, with the receiver following it in sync. If the
+// link is too weak for the change to be acknowledged, the transmitter changes anyway and the
+// receiver finds it again. A receiver left on the fast profile finds a transmitter on the long
+// range one.
+
+#include "sketch_stx.h"
+#include "link.h"
+#include "check.h"
+
+#include <string>
+
+//the receiver's state, from its own translation unit
+namespace rx {
+extern uint8_t rateProfile;
+extern uint8_t syncState;
+void setRateProfile(uint8_t profile);
+}
+
+using namespace sim;
+
+const uint8_t SYNC_LOCKED = 1;
+
+static double pathLossDb = 90;
+
+//Receiver packets per second over the given time
+static double rxRate(Link &link, double seconds)
+{
+  uint64_t start = link.rxRadio.numRxDone;
+  link.run(ms(seconds * 1000));
+  return (link.rxRadio.numRxDone - start) / seconds;
+}
+
+static void testFollowsInSync()
+{
+  Link link;
+  link.medium.pathLoss = [](const Sx127x &, const Sx127x &, Time) { return pathLossDb; };
+  master::settings.rfPower = RF_POWER_AUTO_FIRST + 2; //Auto<50mW
+  master::settings.isLongRangeAllowed = true;
+  link.run(ms(15000));
+  CHECK_EQ(stx::rateProfile, stx::RATE_PROFILE_FAST);
+  CHECK_EQ(rx::rateProfile, stx::RATE_PROFILE_FAST);
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+
+  uint32_t numOutOfSync = 0;
+  link.rx.onLoop = [&](Mcu &) {
+    if(rx::syncState != SYNC_LOCKED)
+      numOutOfSync++;
+  };
+
+  //Fading out over 30s to 136dB, where a packet sent at 17dBm arrives about 2.5dB above the SF7
+  //floor. The power goes up to the max first, then the margin falls under APC_MARGIN_LOW while
+  //packets still get through, so the change is acknowledged and the receiver keeps in step
+  for(int i = 1; i <= 30; i++)
+  {
+    pathLossDb = 90 + i * 46 / 30.0;
+    link.run(ms(1000));
+  }
+  link.run(ms(10000));
+  CHECK_EQ(stx::idxRFPowerLevel, 4);
+  CHECK_EQ(stx::rateProfile, stx::RATE_PROFILE_LONG_RANGE);
+  CHECK_EQ(rx::rateProfile, stx::RATE_PROFILE_LONG_RANGE);
+  CHECK_EQ(master::reply.isLongRange, true);
+  CHECK_NEAR(rxRate(link, 10), 1e6 / SLOT_PERIOD_LONG_RANGE_US * 15 / 16, 0.5);
+
+  //strong again. Back to the fast profile, then down in power
+  pathLossDb = 90;
+  link.run(ms(30000));
+  CHECK_EQ(stx::rateProfile, stx::RATE_PROFILE_FAST);
+  CHECK_EQ(rx::rateProfile, stx::RATE_PROFILE_FAST);
+  CHECK(stx::idxRFPowerLevel < 2);
+  CHECK_NEAR(rxRate(link, 10), 1e6 / SLOT_PERIOD_FAST_US * 15 / 16, 1); //1 in 16 slots for telemetry
+  CHECK_EQ(numOutOfSync, 0);
+
+  //reading the receiver config, whose request is a short packet, doesn't cost sync either
+  master::settings.requestRxConfig = true;
+  link.run(ms(2000));
+  CHECK_EQ(numOutOfSync, 0);
+}
+
+static void testChangesWithoutAck()
+{
+  Link link;
+  link.medium.pathLoss = [](const Sx127x &, const Sx127x &, Time) { return pathLossDb; };
+  master::settings.rfPower = RF_POWER_AUTO_FIRST + 2;
+  master::settings.isLongRangeAllowed = true;
+  //at the max power, with the margin just above APC_MARGIN_LOW
+  pathLossDb = 128;
+  link.run(ms(10000));
+  CHECK_EQ(stx::idxRFPowerLevel, 4);
+  CHECK_EQ(stx::rateProfile, stx::RATE_PROFILE_FAST);
+
+  //a sudden drop to 2.5dB below the SF7 floor, but 2.5dB above the SF9 one. Telemetry is lost
+  pathLossDb = 141;
+  link.run(ms(15000));
+  CHECK_EQ(stx::rateProfile, stx::RATE_PROFILE_LONG_RANGE);
+  CHECK_EQ(rx::rateProfile, stx::RATE_PROFILE_LONG_RANGE);
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+  CHECK(rxRate(link, 10) > 0.9 * 1e6 / SLOT_PERIOD_LONG_RANGE_US * 15 / 16);
+}
+
+static void testAcquiresLongRange()
+{
+  Link link;
+  master::settings.rfPower = RF_POWER_AUTO_FIRST + 2;
+  master::settings.isLongRangeAllowed = true;
+  link.run(ms(3000));
+
+  //put the transmitter on the long range profile and the receiver out of sync on the fast one
+  bool isDone = false;
+  link.stx.onLoop = [&](Mcu &) {
+    if(!isDone)
+      stx::requestedRateProfile = stx::RATE_PROFILE_LONG_RANGE;
+  };
+  link.rx.onLoop = [&](Mcu &) {
+    if(!isDone && stx::rateProfile == stx::RATE_PROFILE_LONG_RANGE)
+    {
+      rx::syncState = 0;
+      rx::setRateProfile(stx::RATE_PROFILE_FAST);
+      isDone = true;
+    }
+  };
+  link.run(ms(1000));
+  CHECK(isDone);
+  Time start = link.sim.now();
+  while(rx::syncState != SYNC_LOCKED && link.sim.now() - start < ms(10000))
+    link.run(ms(10));
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+  CHECK_EQ(rx::rateProfile, stx::RATE_PROFILE_LONG_RANGE);
+  CHECK(link.sim.now() - start < ms(3000));
+}
+
+//Runs a test in a process of its own, as each needs a fresh link, and adds up its checks
+static void runIsolated(void (*test)())
+{
+  std::string counts = isolated([test] {
+    checkCount = 0;
+    checkFailures = 0;
+    test();
+    return std::to_string(checkCount) + " " + std::to_string(checkFailures);
+  });
+  int n = 0, failed = 0;
+  sscanf(counts.c_str(), "%d %d", &n, &failed);
+  checkCount += n;
+  checkFailures += failed;
+}
+
+int main()
+{
+  runIsolated(testFollowsInSync);
+  runIsolated(testChangesWithoutAck);
+  runIsolated(testAcquiresLongRange);
+  return checkReport("test_rateprofile");
+}
@@ -0,0 +1,147 @@
+// Checks of the redundancy records, in a copy of the transmitter with ENABLE_RC_REDUNDANCY on, over
+// the simulated link. The sticks move steadily, with a jump on one of them now and then, and single
+// rc frames are dropped on the way to the receiver. Each frame dropped before one carrying a record
+// is rebuilt by the receiver, and rebuildPreviousFrame() gives back the dropped frame's values to
+// within the scale the record was sent at. A frame after a jump too large for a record carries a
+// secondary group instead.
+
+#include "link.h"
+#include "check.h"
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+namespace stx_redundancy { sim::Sketch sketch(); }
+
+//the receiver's side of the records, from its own translation unit
+namespace rx {
+extern int chVals[];
+extern uint16_t recoveredFrameCount;
+void rebuildPreviousFrame(uint8_t *dataBuff, int *curVals);
+uint16_t readBits(uint8_t *buff, uint8_t bitPos, uint8_t numBits);
+}
+
+using namespace sim;
+
+const uint8_t PAC_RC_DATA = 0x5;
+const int DROP_EVERY = 7; //never two in a row
+
+//An rc frame as it went on air, its payload after the 3 header bytes
+struct Frame {
+  std::vector<uint8_t> data;
+  bool isDropped;
+
+  uint8_t *payload() { return data.data() + 3; }
+  int ch(uint8_t i) { return rx::readBits(payload(), i * 10, 10); }
+  bool isFailsafe() { return (payload()[11] >> 4) & 0x01; }
+  bool hasRecord() { return (payload()[11] >> 5) & 0x01; }
+  uint8_t shift() { return rx::readBits(payload(), 96, 2); }
+  bool isOthersSame() { return rx::readBits(payload(), 118, 1); }
+};
+
+int main()
+{
+  Link link(stx_redundancy::sketch(), rx::sketch());
+
+  //sticks on a slow sine, and the third one jumping by 300 every 1.5s
+  link.master.onLoop = [](Mcu &m) {
+    double t = toMs(m.now) / 1000.0;
+    for(int i = 0; i < 4; i++)
+      master::settings.channels[i] = 200 * sin(2 * M_PI * (t / 2 + i / 4.0));
+    if((int)(t / 1.5) % 2)
+      master::settings.channels[2] += 300;
+  };
+  link.run(ms(3000));
+
+  std::vector<Frame> frames;
+  bool isRecording = false;
+  link.medium.dropFilter = [&](const Packet &p, const Sx127x &to) {
+    if(!isRecording || &to != &link.rxRadio || p.data.size() < 3 + 15 || (p.data[2] >> 4) != PAC_RC_DATA)
+      return false;
+    Frame f = {p.data, false};
+    if(!f.isFailsafe() && frames.size() % DROP_EVERY == DROP_EVERY - 1)
+      f.isDropped = true;
+    frames.push_back(f);
+    return f.isDropped;
+  };
+  uint16_t recoveredStart = rx::recoveredFrameCount;
+  isRecording = true;
+  link.run(ms(20000));
+  isRecording = false;
+  uint16_t recovered = rx::recoveredFrameCount - recoveredStart;
+
+  //every dropped frame followed by one with a record can be rebuilt
+  int numDropped = 0;
+  int numRebuildable = 0;
+  int numWithinScale = 0;
+  int numOthersRight = 0;
+  int numOthersSame = 0;
+  for(size_t n = 0; n + 1 < frames.size(); n++)
+  {
+    Frame &dropped = frames[n];
+    Frame &next = frames[n + 1];
+    if(!dropped.isDropped)
+      continue;
+    numDropped++;
+    if(next.isFailsafe() || !next.hasRecord())
+      continue;
+    numRebuildable++;
+
+    int curVals[9];
+    for(uint8_t i = 0; i < 9; i++)
+      curVals[i] = next.ch(i);
+    rx::rebuildPreviousFrame(next.payload(), curVals);
+    bool isWithinScale = true;
+    for(uint8_t i = 0; i < 4; i++)
+      if(abs(rx::chVals[i] + 500 - dropped.ch(i)) > (1 << next.shift()) / 2)
+        isWithinScale = false;
+    if(isWithinScale)
+      numWithinScale++;
+    if(next.isOthersSame())
+    {
+      numOthersSame++;
+      bool isRight = true;
+      for(uint8_t i = 4; i < 9; i++)
+        if(rx::chVals[i] + 500 != dropped.ch(i))
+          isRight = false;
+      if(isRight)
+        numOthersRight++;
+    }
+  }
+  CHECK(numDropped > 50);
+  CHECK(numRebuildable > numDropped / 2);
+  CHECK_EQ(numWithinScale, numRebuildable);
+  CHECK(numOthersSame > 0);
+  CHECK_EQ(numOthersRight, numOthersSame);
+  //the receiver rebuilt them all over the link, and no more than were dropped
+  CHECK(recovered >= numRebuildable);
+  CHECK(recovered <= numDropped);
+
+  //after a jump of more than 8 * 15 on a stick, a secondary group goes instead of a record
+  int numJumps = 0;
+  int numGroupAfterJump = 0;
+  int prev = -1;
+  for(size_t n = 0; n < frames.size(); n++)
+  {
+    if(frames[n].isFailsafe())
+      continue;
+    if(prev >= 0)
+    {
+      int maxDelta = 0;
+      for(uint8_t i = 0; i < 4; i++)
+        maxDelta = std::max(maxDelta, abs(frames[prev].ch(i) - frames[n].ch(i)));
+      if(maxDelta > 15 << 3)
+      {
+        numJumps++;
+        if(!frames[n].hasRecord())
+          numGroupAfterJump++;
+      }
+    }
+    prev = n;
+  }
+  CHECK(numJumps >= 10);
+  CHECK_EQ(numGroupAfterJump, numJumps);
+
+  return checkReport("test_redundancy");
+}
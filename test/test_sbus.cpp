@@ -0,0 +1,100 @@
+// Checks of sbusEncode() in the receiver's sbus.h: the frame layout, the 11 bit channel packing
+// and the mapping of channel values onto the SBUS range.
+
+#include <Arduino.h>
+#include "../rx/sbus.h"
+#include "check.h"
+
+#include <string.h>
+
+//Channel from a frame, a bit at a time, lsb first from byte 1
+static uint16_t channel(const uint8_t *frame, int ch)
+{
+  uint16_t val = 0;
+  for(int i = 0; i < 11; i++)
+  {
+    int bit = ch * 11 + i;
+    if(frame[1 + bit / 8] & (1 << (bit % 8)))
+      val |= 1 << i;
+  }
+  return val;
+}
+
+int main()
+{
+  uint8_t frame[SBUS_FRAME_LEN];
+  int chVals[SBUS_NUM_CHANNELS];
+
+  //header, flags and footer
+  memset(chVals, 0, sizeof(chVals));
+  memset(frame, 0xAA, sizeof(frame));
+  sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, SBUS_FLAG_FRAME_LOST | SBUS_FLAG_FAILSAFE);
+  CHECK_EQ(frame[0], 0x0F);
+  CHECK_EQ(frame[23], 0x0C);
+  CHECK_EQ(frame[24], 0x00);
+  sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, 0);
+  CHECK_EQ(frame[23], 0x00);
+
+  //end points and centre
+  chVals[0] = -500;
+  chVals[1] = 0;
+  chVals[2] = 500;
+  sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, 0);
+  CHECK_EQ(channel(frame, 0), 172);
+  CHECK_EQ(channel(frame, 1), 992);
+  CHECK_EQ(channel(frame, 2), 1811);
+
+  //packing across byte boundaries, worked out by hand. 1811 is 0x713, 172 is 0x0AC, 992 is 0x3E0
+  chVals[0] = 500;
+  chVals[1] = -500;
+  chVals[2] = 0;
+  sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, 0);
+  CHECK_EQ(frame[1], 0x13); //ch0 bits 0-7
+  CHECK_EQ(frame[2], 0x67); //ch0 bits 8-10, ch1 bits 0-4
+  CHECK_EQ(frame[3], 0x05); //ch1 bits 5-10, ch2 bits 0-1
+  CHECK_EQ(frame[4], 0xF8); //ch2 bits 2-9
+  CHECK_EQ(frame[5] & 0x01, 0x00); //ch2 bit 10
+
+  //every channel in every position, the last ending on the last bit of byte 22
+  int numWrong = 0;
+  for(int v = -500; v <= 500; v++)
+  {
+    for(int i = 0; i < SBUS_NUM_CHANNELS; i++)
+      chVals[i] = (i % 2) ? v : -v;
+    sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, 0);
+    for(int i = 0; i < SBUS_NUM_CHANNELS; i++)
+    {
+      double expected = 172 + (chVals[i] + 500) * 1.639;
+      if(fabs(channel(frame, i) - expected) > 0.5)
+        numWrong++;
+    }
+  }
+  CHECK_EQ(numWrong, 0);
+
+  //out of range values are clamped
+  chVals[0] = -501;
+  chVals[1] = -20000;
+  chVals[2] = 501;
+  chVals[3] = 20000;
+  sbusEncode(frame, chVals, SBUS_NUM_CHANNELS, 0);
+  CHECK_EQ(channel(frame, 0), 172);
+  CHECK_EQ(channel(frame, 1), 172);
+  CHECK_EQ(channel(frame, 2), 1811);
+  CHECK_EQ(channel(frame, 3), 1811);
+
+  //channels past numChannels are sent centred, and chVals is not read past it
+  for(int i = 0; i < SBUS_NUM_CHANNELS; i++)
+    chVals[i] = 500;
+  sbusEncode(frame, chVals, 10, 0);
+  for(int i = 0; i < 10; i++)
+    CHECK_EQ(channel(frame, i), 1811);
+  for(int i = 10; i < SBUS_NUM_CHANNELS; i++)
+    CHECK_EQ(channel(frame, i), 992);
+  int shortVals[1] = {-500};
+  sbusEncode(frame, shortVals, 1, 0);
+  CHECK_EQ(channel(frame, 0), 172);
+  CHECK_EQ(channel(frame, 15), 992);
+  CHECK_EQ(frame[24], 0x00);
+
+  return checkReport("test_sbus");
+}
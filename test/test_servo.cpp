@@ -0,0 +1,99 @@
+// Checks of adding outputs to the pulse engine in servos.h: pins without a port (A6 and A7 on the
+// Atmega328p) and outputs past the end of the table are turned down with 0xFF, the outputs that
+// were taken still pulse, and ppm is not started on a pin without a port.
+
+#include <Arduino.h>
+#include "check.h"
+
+using namespace sim;
+
+namespace engine {
+#include "../rx/servos.h"
+
+const uint8_t PINS[SERVO_MAX_OUTPUTS] = {2, 3, 4, 5, 6, 7, 8, 11, 12, 13, 14, 15, 16, 17, 18};
+
+uint8_t idxNoPort = 0;
+uint8_t idx[SERVO_MAX_OUTPUTS];
+uint8_t idxFull = 0;
+
+void setup()
+{
+  idxNoPort = servoAttach(A6);
+  for(int i = 0; i < SERVO_MAX_OUTPUTS; i++)
+    idx[i] = servoAttach(PINS[i]);
+  idxFull = servoAttach(19);
+  for(int i = 0; i < SERVO_MAX_OUTPUTS; i++)
+    servoWrite(idx[i], 1000 + 50 * i);
+  servoWrite(idxFull, 2000); //ignored
+  servoCommit();
+  servoBegin(20000);
+}
+
+void loop() {}
+
+Sketch sketch()
+{
+  return Sketch{"servo", setup, loop, {{VEC_TIMER1_COMPA, TIMER1_COMPA_vect}}};
+}
+}
+
+namespace ppm {
+#include "../rx/servos.h"
+
+bool isStartedNoPort = true;
+bool isStarted = false;
+bool isStartedNoPortTimer = true;
+
+void setup()
+{
+  isStartedNoPort = ppmBegin(A7);
+  isStartedNoPortTimer = TIMSK1 & _BV(OCIE1B);
+  isStarted = ppmBegin(9);
+}
+
+void loop() {}
+
+Sketch sketch()
+{
+  return Sketch{"ppm", setup, loop, {{VEC_TIMER1_COMPB, TIMER1_COMPB_vect}}};
+}
+}
+
+int main()
+{
+  Sim s;
+  Mcu &servoBoard = s.add("servo", engine::sketch());
+  s.add("ppm", ppm::sketch());
+  int numRises[Mcu::NUM_PINS] = {};
+  Time riseAt[Mcu::NUM_PINS] = {};
+  double widthUs[Mcu::NUM_PINS] = {};
+  servoBoard.onPinChange = [&](const PinEvent &e)
+  {
+    if(e.level)
+    {
+      numRises[e.pin]++;
+      riseAt[e.pin] = e.time;
+    }
+    else if(riseAt[e.pin])
+      widthUs[e.pin] = toUs(e.time - riseAt[e.pin]);
+  };
+  s.run(ms(1000));
+
+  CHECK_EQ(engine::idxNoPort, 0xFF);
+  CHECK_EQ(engine::idxFull, 0xFF);
+  CHECK_EQ(engine::numServos, SERVO_MAX_OUTPUTS);
+  for(int i = 0; i < SERVO_MAX_OUTPUTS; i++)
+  {
+    uint8_t pin = engine::PINS[i];
+    CHECK_EQ(engine::idx[i], i);
+    CHECK(numRises[pin] >= 45); //a frame every 20ms
+    CHECK_NEAR(widthUs[pin], 1000 + 50 * i, 2);
+  }
+  CHECK_EQ(numRises[19], 0);
+
+  CHECK(!ppm::isStartedNoPort);
+  CHECK(!ppm::isStartedNoPortTimer);
+  CHECK(ppm::isStarted);
+
+  return checkReport("test_servo");
+}
@@ -0,0 +1,69 @@
+// Checks of the transmitter's slot timing: every packet goes out on the channel of the slot it is
+// sent in, even when the slave mcu only gets round to the tx done after the next slot has started.
+
+#include "sketch_stx.h"
+#include "link.h"
+#include "check.h"
+
+using namespace sim;
+
+const uint8_t SX_MODE_TX = 3;
+
+int main()
+{
+  Link link;
+  link.run(ms(3000));
+  CHECK_EQ(stx::operatingMode, stx::MODE_RC_DATA);
+
+  //Hold up the slave mcu near the end of every other transmission, so that it sees the tx done
+  //some way into the next slot
+  bool wasTransmitting = false;
+  Time txStart = 0;
+  uint32_t numStarts = 0;
+  bool isStalled = false;
+  uint32_t numStalls = 0;
+  uint32_t numLateTxDone = 0;
+  uint32_t numOffSlot = 0;
+  link.stx.onLoop = [&](Mcu &m) {
+    bool isTransmitting = link.stxRadio.mode() == SX_MODE_TX;
+    if(isTransmitting && !wasTransmitting)
+    {
+      //started in the loop before this one, at the start of a slot
+      txStart = m.now;
+      isStalled = false;
+      numStarts++;
+      if(stx::idxHopSequence != stx::slotCount % HOP_SEQUENCE_LENGTH)
+        numOffSlot++;
+    }
+    wasTransmitting = isTransmitting;
+    if(isTransmitting && !isStalled && numStarts % 2 == 0 && m.now - txStart > ms(24))
+    {
+      isStalled = true;
+      numStalls++;
+      m.charge(ms(8));
+      if((int32_t)(micros() - stx::nextSlotMicros) >= 0)
+        numLateTxDone++;
+    }
+  };
+
+  //every packet on the receiver's channel comes through here
+  uint64_t onChannel = 0;
+  link.rxRadio.onPacket = [&](const Packet &p, bool) {
+    if(p.sender == &link.stxRadio)
+      onChannel++;
+  };
+
+  uint64_t sentStart = link.stxRadio.numTx;
+  uint64_t rxStart = link.rxRadio.numRxDone;
+  link.run(ms(10000));
+  uint64_t sent = link.stxRadio.numTx - sentStart;
+
+  CHECK(numStalls > 100);
+  CHECK_EQ(numLateTxDone, numStalls);
+  CHECK_EQ(numOffSlot, 0);
+  //the last one may still be on air
+  CHECK_NEAR(onChannel, sent, 1);
+  CHECK_NEAR(link.rxRadio.numRxDone - rxStart, sent, 1);
+
+  return checkReport("test_slots");
+}
@@ -0,0 +1,208 @@
+// Checks of the receiver's output smoothing, in a copy of the receiver with ENABLE_OUTPUT_SMOOTHING
+// on and 5ms servo frames. The fraction and the step are checked against exact arithmetic over
+// the whole range of servo values, then the cases where an output jumps instead of moving. Then
+// over the simulated link: a stick moved steadily comes out a little every servo frame rather
+// than all at once when a packet comes in, and a switch still snaps.
+
+#include "sketch_stx.h"
+#include "link.h"
+#include "check.h"
+
+#include <vector>
+#include <algorithm>
+
+//the receiver's smoothing, from its own translation unit
+namespace rx_smooth {
+extern int smoothFrom[];
+extern int smoothTo[];
+extern int smoothOut[];
+extern bool isNewRcVals;
+uint16_t smoothFraction(uint32_t elapsedUs, uint32_t periodUs);
+int smoothStep(int from, int to, uint16_t frac);
+void setSmoothTarget(uint8_t idx, int val);
+sim::Sketch sketch();
+}
+
+using namespace sim;
+using namespace rx_smooth;
+
+const uint8_t PIN_CH1 = 2; //first two output pins, for rc channels 1 and 2
+const uint8_t PIN_CH2 = 5;
+
+static void testFraction()
+{
+  CHECK_EQ(smoothFraction(0, 30000), 0);
+  CHECK_EQ(smoothFraction(15000, 30000), 128);
+  CHECK_EQ(smoothFraction(30000, 30000), 256);
+  CHECK_EQ(smoothFraction(45000, 30000), 256);
+  CHECK_EQ(smoothFraction(0xFFFFFFFF, 30000), 256); //micros() gone back, which it shouldn't
+
+  //within a 256th of exact and never going back, over the periods a move can take
+  int numOff = 0;
+  int numBack = 0;
+  for(uint32_t period = 15000; period <= 60000; period += 5000)
+  {
+    uint16_t last = 0;
+    for(uint32_t elapsed = 0; elapsed <= period + 1000; elapsed += 7)
+    {
+      uint16_t frac = smoothFraction(elapsed, period);
+      double exact = std::min(256.0, 256.0 * elapsed / period);
+      if(frac > exact || exact - frac >= 1)
+        numOff++;
+      if(frac < last)
+        numBack++;
+      last = frac;
+    }
+  }
+  CHECK_EQ(numOff, 0);
+  CHECK_EQ(numBack, 0);
+}
+
+static void testStep()
+{
+  //to the nearest microsecond, from the start to the end, never past either, for every move
+  //within the servo range and every fraction
+  int numOff = 0;
+  int numOutside = 0;
+  int numBack = 0;
+  for(int from = 1000; from <= 2000; from += 3)
+  {
+    for(int to = 1000; to <= 2000; to += 7)
+    {
+      int last = from;
+      for(uint16_t frac = 0; frac <= 256; frac++)
+      {
+        int out = smoothStep(from, to, frac);
+        double exact = from + (to - from) * frac / 256.0;
+        if(fabs(out - exact) > 0.5)
+          numOff++;
+        if(out < std::min(from, to) || out > std::max(from, to))
+          numOutside++;
+        if((to > from && out < last) || (to < from && out > last))
+          numBack++;
+        last = out;
+      }
+    }
+  }
+  CHECK_EQ(numOff, 0);
+  CHECK_EQ(numOutside, 0);
+  CHECK_EQ(numBack, 0);
+  CHECK_EQ(smoothStep(1000, 2000, 0), 1000);
+  CHECK_EQ(smoothStep(1000, 2000, 256), 2000);
+  CHECK_EQ(smoothStep(2000, 1000, 256), 1000);
+}
+
+static void testTarget()
+{
+  //a packet starts a move from where the output is
+  isNewRcVals = true;
+  smoothOut[0] = 1500;
+  setSmoothTarget(0, 1700);
+  CHECK_EQ(smoothFrom[0], 1500);
+  CHECK_EQ(smoothTo[0], 1700);
+  CHECK_EQ(smoothOut[0], 1500);
+
+  //a move further than SMOOTH_MAX_STEP, as a switch makes, is made at once
+  setSmoothTarget(0, 1000);
+  CHECK_EQ(smoothOut[0], 1000);
+  CHECK_EQ(smoothFrom[0], 1000);
+
+  //and so is stopping the pulses, and starting them again
+  setSmoothTarget(0, 0);
+  CHECK_EQ(smoothOut[0], 0);
+  setSmoothTarget(0, 1100);
+  CHECK_EQ(smoothOut[0], 1100);
+
+  //as is a change not from a packet, failsafe
+  isNewRcVals = false;
+  setSmoothTarget(0, 1200);
+  CHECK_EQ(smoothOut[0], 1200);
+}
+
+//Pulse widths on two pins, in the order they went out
+struct Widths {
+  Time riseAt[Mcu::NUM_PINS] = {};
+  std::vector<double> ch1;
+  std::vector<double> ch2;
+
+  void onPin(const PinEvent &e)
+  {
+    if(e.level)
+      riseAt[e.pin] = e.time;
+    else if(riseAt[e.pin] && e.pin == PIN_CH1)
+      ch1.push_back(toUs(e.time - riseAt[e.pin]));
+    else if(riseAt[e.pin] && e.pin == PIN_CH2)
+      ch2.push_back(toUs(e.time - riseAt[e.pin]));
+  }
+};
+
+static void testOverLink()
+{
+  Link link(stx::sketch(), rx_smooth::sketch());
+  master::settings.channels[0] = -500;
+  master::settings.channels[1] = -500;
+  link.run(ms(3000));
+
+  Widths widths;
+  link.rx.onPinChange = [&](const PinEvent &e) { widths.onPin(e); };
+
+  //channel 1 across its range in a second, 30us a packet
+  for(int i = 1; i <= 100; i++)
+  {
+    master::settings.channels[0] = -500 + i * 10;
+    link.run(ms(10));
+  }
+  link.run(ms(200));
+  std::vector<double> ramp = widths.ch1;
+
+  //the first frames are the ones before the first new packet, and the last after it stopped
+  CHECK(ramp.size() > 180);
+  CHECK_NEAR(ramp.front(), 1000, 6);
+  CHECK_NEAR(ramp.back(), 2000, 6);
+  double maxStep = 0;
+  int numBack = 0;
+  for(size_t k = 1; k < ramp.size(); k++)
+  {
+    maxStep = std::max(maxStep, ramp[k] - ramp[k - 1]);
+    if(ramp[k] < ramp[k - 1] - 6) //more than the pulse jitter
+      numBack++;
+  }
+  //a packet brings 30us, 60us after the telemetry slot. A frame moves a fifth of that or so,
+  //plus up to 5us of jitter in the measured widths
+  CHECK(maxStep < 20);
+  CHECK_EQ(numBack, 0);
+
+  //channel 2 thrown like a switch
+  widths.ch2.clear();
+  master::settings.channels[1] = 500;
+  link.run(ms(300));
+  std::vector<double> &sw = widths.ch2;
+  size_t firstMoved = std::find_if(sw.begin(), sw.end(), [](double w) { return w > 1010; }) - sw.begin();
+  CHECK(firstMoved < sw.size());
+  if(firstMoved < sw.size())
+    CHECK_NEAR(sw[firstMoved], 2000, 6);
+}
+
+//Runs a test in a process of its own, as the link needs a fresh receiver, and adds up its checks
+static void runIsolated(void (*test)())
+{
+  std::string counts = isolated([test] {
+    checkCount = 0;
+    checkFailures = 0;
+    test();
+    return std::to_string(checkCount) + " " + std::to_string(checkFailures);
+  });
+  int n = 0, failed = 0;
+  sscanf(counts.c_str(), "%d %d", &n, &failed);
+  checkCount += n;
+  checkFailures += failed;
+}
+
+int main()
+{
+  testFraction();
+  testStep();
+  testTarget();
+  runIsolated(testOverLink);
+  return checkReport("test_smoothing");
+}
@@ -0,0 +1,581 @@
+// Checks of the SX127x model against the datasheet. The radios here are driven straight over
+// their SPI interface from the test, on boards that run no sketch.
+
+#include "sim.h"
+#include "sx127x.h"
+#include "check.h"
+
+#include <string.h>
+#include <math.h>
+
+using namespace sim;
+
+const uint32_t FRF_CH0 = 0x6C4C7A; //433.195MHz
+const uint32_t FRF_CH1 = 0x6C5E8A; //433.477MHz
+
+struct Module {
+  Mcu mcu;
+  Sx127x radio;
+
+  Module(Medium &medium, const char *name) : mcu(name, Sketch()), radio(medium, mcu, name) {}
+
+  void write(uint8_t addr, uint8_t val)
+  {
+    radio.setNss(false);
+    radio.transfer(addr | 0x80);
+    radio.transfer(val);
+    radio.setNss(true);
+  }
+
+  uint8_t read(uint8_t addr)
+  {
+    radio.setNss(false);
+    radio.transfer(addr);
+    uint8_t val = radio.transfer(0);
+    radio.setNss(true);
+    return val;
+  }
+
+  void at(Time t)
+  {
+    mcu.now = t;
+    radio.process(t);
+  }
+
+  //LoRa at SF7, 250kHz, CR 4/5, explicit header, no crc, +17dBm. Left in standby
+  void setup(uint32_t frf)
+  {
+    write(0x01, 0x00);
+    write(0x01, 0x80);
+    write(0x06, frf >> 16);
+    write(0x07, frf >> 8);
+    write(0x08, frf);
+    write(0x1D, 0x82);
+    write(0x1E, 0x70);
+    write(0x09, 0x8F);
+    write(0x01, 0x81);
+  }
+
+  void send(const uint8_t *data, uint8_t len)
+  {
+    write(0x0D, read(0x0E));
+    for(uint8_t i = 0; i < len; i++)
+      write(0x00, data[i]);
+    write(0x22, len);
+    write(0x01, 0x83);
+  }
+};
+
+//noise floor at 250kHz with a 6dB noise figure, -114dBm
+const double NOISE_DBM = -174 + 10 * log10(250e3) + 6;
+
+static LoraConfig linkConfig(bool isCrcOn = false)
+{
+  LoraConfig c;
+  c.frf = FRF_CH0;
+  c.sf = 7;
+  c.bw = 8;
+  c.cr = 1;
+  c.isCrcOn = isCrcOn;
+  return c;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void testTimeOnAir()
+{
+  //symbols of payload: 8 + ceil((8 * len - 4 * SF + 28 + 16 * crc) / (4 * SF)) * (CR + 4)
+  //plus 12.25 of preamble, at 512us each
+  CHECK_EQ(timeOnAir(linkConfig(), 19), us(25728));
+  CHECK_EQ(timeOnAir(linkConfig(), 21), us(25728));
+  CHECK_EQ(timeOnAir(linkConfig(), 22), us(28288));
+  CHECK_EQ(timeOnAir(linkConfig(true), 21), us(28288));
+  CHECK_EQ(timeOnAir(linkConfig(), 16), us(23168));
+  CHECK_EQ(linkConfig().symbolTime(), us(512));
+
+  LoraConfig slow = linkConfig();
+  slow.sf = 12;
+  slow.bw = 7;
+  slow.isLowDataRate = true;
+  //SF12 at 125kHz, 10 bytes: 8 + ceil((80 - 48 + 28) / 40) * 5 = 18 symbols + 12.25, 32.768ms each
+  CHECK_NEAR(toUs(timeOnAir(slow, 10)), 30.25 * 32768, 1);
+}
+
+static void testRegisters()
+{
+  Medium medium;
+  Module m(medium, "m");
+
+  CHECK_EQ(m.read(0x42), 0x12); //version
+  CHECK_EQ(m.read(0x01), 0x09); //FSK, standby
+  CHECK_EQ(m.read(0x0E), 0x80); //tx base
+  CHECK_EQ(m.read(0x0F), 0x00); //rx base
+  CHECK_EQ(m.read(0x39), 0x12); //sync word
+
+  //the LoRa bit only changes in sleep
+  m.write(0x01, 0x81);
+  CHECK_EQ(m.read(0x01), 0x01);
+  m.write(0x01, 0x00);
+  m.write(0x01, 0x80);
+  CHECK_EQ(m.read(0x01), 0x80);
+  m.write(0x01, 0x81);
+  CHECK_EQ(m.read(0x01), 0x81);
+  CHECK(m.radio.isLora());
+
+  //burst access moves through the registers
+  m.radio.setNss(false);
+  m.radio.transfer(0x06 | 0x80);
+  m.radio.transfer(0x6C);
+  m.radio.transfer(0x4C);
+  m.radio.transfer(0x7A);
+  m.radio.setNss(true);
+  CHECK_EQ(m.radio.config().frf, FRF_CH0);
+
+  //read only registers keep their value
+  m.write(0x42, 0x55);
+  CHECK_EQ(m.read(0x42), 0x12);
+
+  //the reset pin brings back the defaults
+  m.radio.reset();
+  CHECK_EQ(m.read(0x01), 0x09);
+  CHECK_EQ(m.radio.config().frf, 0x6C8000u);
+}
+
+static void testFifo()
+{
+  Medium medium;
+  Module m(medium, "m");
+  m.setup(FRF_CH0);
+
+  //writes go in at the address pointer, which moves on with each byte
+  m.write(0x0D, 0xFE);
+  m.write(0x00, 0x11);
+  m.write(0x00, 0x22);
+  m.write(0x00, 0x33); //wraps round
+  CHECK_EQ(m.read(0x0D), 0x01);
+
+  //a burst on the FIFO stays on the FIFO
+  m.write(0x0D, 0xFE);
+  m.radio.setNss(false);
+  m.radio.transfer(0x00);
+  uint8_t a = m.radio.transfer(0);
+  uint8_t b = m.radio.transfer(0);
+  uint8_t c = m.radio.transfer(0);
+  m.radio.setNss(true);
+  CHECK_EQ(a, 0x11);
+  CHECK_EQ(b, 0x22);
+  CHECK_EQ(c, 0x33);
+
+  //no access in sleep, and the content is lost
+  m.write(0x01, 0x80);
+  m.write(0x0D, 0x10);
+  m.write(0x00, 0x44);
+  CHECK_EQ(m.read(0x0D), 0x10);
+  m.write(0x01, 0x81);
+  m.write(0x0D, 0xFE);
+  CHECK_EQ(m.read(0x00), 0x00);
+}
+
+static void testTx()
+{
+  Medium medium;
+  Module m(medium, "m");
+  m.setup(FRF_CH0);
+  m.write(0x40, 0x40); //DIO0 on TxDone
+
+  uint8_t data[21];
+  for(uint8_t i = 0; i < sizeof(data); i++)
+    data[i] = i;
+  Time start = ms(1);
+  m.at(start);
+  m.send(data, sizeof(data));
+  CHECK_EQ(m.read(0x01), 0x83);
+  CHECK_EQ(medium.packets.size(), 1);
+  const Packet &p = medium.packets.front();
+  CHECK_EQ(p.data.size(), 21);
+  CHECK(memcmp(p.data.data(), data, sizeof(data)) == 0);
+  CHECK_EQ(p.start, start + us(100));
+  CHECK_EQ(p.end - p.start, us(25728));
+  CHECK_NEAR(p.powerDbm, 17, 0.01);
+
+  //TxDone at the end of the packet, not before
+  m.at(p.end - 1);
+  CHECK_EQ(m.read(0x12), 0);
+  CHECK(!m.mcu.getPin(2));
+  m.at(p.end);
+  CHECK_EQ(m.read(0x12), 0x08);
+  CHECK(m.mcu.getPin(2));
+  CHECK_EQ(m.read(0x01), 0x81); //back in standby
+  CHECK_EQ(m.radio.numTx, 1);
+
+  //flags clear by writing 1s, which takes DIO0 down
+  m.write(0x12, 0x40);
+  CHECK_EQ(m.read(0x12), 0x08);
+  m.write(0x12, 0x08);
+  CHECK_EQ(m.read(0x12), 0);
+  CHECK(!m.mcu.getPin(2));
+
+  //leaving TX early cuts the packet short
+  m.at(ms(40));
+  m.send(data, sizeof(data));
+  m.at(ms(45));
+  m.write(0x01, 0x81);
+  CHECK(medium.packets.back().isAborted);
+  CHECK_EQ(medium.packets.back().end, ms(45));
+  m.at(ms(80));
+  CHECK_EQ(m.read(0x12), 0);
+
+  //out of sleep, the oscillator has to start before the PLL. A hop in standby doesn't wait
+  m.at(ms(100));
+  m.write(0x01, 0x80);
+  m.write(0x01, 0x81);
+  m.send(data, sizeof(data));
+  CHECK_EQ(medium.packets.back().start, ms(100) + us(250) + us(100));
+  CHECK_EQ(m.radio.numOscStarts, 2);
+  m.at(ms(200));
+  m.write(0x08, 0x8A);
+  m.send(data, sizeof(data));
+  CHECK_EQ(medium.packets.back().start, ms(200) + us(100));
+}
+
+static void testRx()
+{
+  Medium medium;
+  Module tx(medium, "tx");
+  Module rx(medium, "rx");
+  tx.setup(FRF_CH0);
+  rx.setup(FRF_CH0);
+  rx.write(0x40, 0x00); //DIO0 on RxDone
+  rx.write(0x01, 0x85); //continuous RX
+
+  uint8_t data[21];
+  for(uint8_t i = 0; i < sizeof(data); i++)
+    data[i] = 0xA0 + i;
+
+  //packets go in one after another from the rx base, wrapping round the whole FIFO
+  Time t = ms(1);
+  for(int n = 0; n < 14; n++)
+  {
+    tx.at(t);
+    rx.at(t);
+    tx.send(data, sizeof(data));
+    Time end = medium.packets.back().end;
+    tx.at(end);
+    rx.at(end - 1);
+    CHECK(!rx.mcu.getPin(2));
+    rx.at(end);
+    CHECK(rx.mcu.getPin(2));
+    CHECK_EQ(rx.read(0x12) & 0x60, 0x40); //RxDone, no crc error
+    CHECK_EQ(rx.read(0x13), 21);
+    CHECK_EQ(rx.read(0x10), (uint8_t)(n * 21));
+    CHECK_EQ(rx.read(0x01), 0x85); //still listening
+    rx.write(0x12, 0xFF);
+    tx.write(0x12, 0xFF);
+    t = end + ms(5);
+  }
+  CHECK_EQ(rx.radio.numRxDone, 14);
+
+  //the last packet, read out from its start
+  rx.write(0x0D, rx.read(0x10));
+  bool isSame = true;
+  for(uint8_t i = 0; i < sizeof(data); i++)
+    isSame = isSame && rx.read(0x00) == data[i];
+  CHECK(isSame);
+
+  //+17dBm, less the default 80dB of path loss
+  CHECK_EQ(rx.read(0x1A) - 164, 17 - 80);
+
+  //snr in quarter dB, and rssi corrected by it below the noise floor
+  for(double snr : {5.0, -5.0})
+  {
+    medium.defaultPathLoss = 17 - NOISE_DBM - snr;
+    t += ms(5);
+    tx.at(t);
+    rx.at(t);
+    tx.send(data, sizeof(data));
+    Time end = medium.packets.back().end;
+    tx.at(end);
+    rx.at(end);
+    CHECK_EQ((int8_t)rx.read(0x19), snr * 4);
+    CHECK_NEAR(rx.read(0x1A) - 164, (NOISE_DBM + snr) - (snr < 0 ? snr : 0), 1);
+    rx.write(0x12, 0xFF);
+    tx.write(0x12, 0xFF);
+    t = end;
+  }
+  medium.defaultPathLoss = 80;
+
+  //entering RX again starts from the rx base
+  rx.write(0x01, 0x81);
+  rx.write(0x01, 0x85);
+  tx.at(t);
+  rx.at(t);
+  tx.send(data, sizeof(data));
+  Time end = medium.packets.back().end;
+  tx.at(end);
+  rx.at(end);
+  CHECK_EQ(rx.read(0x10), 0x00);
+}
+
+static void testMissed()
+{
+  Medium medium;
+  Module tx(medium, "tx");
+  Module rx(medium, "rx");
+  Module other(medium, "other");
+  tx.setup(FRF_CH0);
+  rx.setup(FRF_CH0);
+  other.setup(FRF_CH1);
+  other.write(0x01, 0x85);
+
+  uint8_t data[10] = {1, 2, 3};
+  Time tsym = us(512);
+
+  //RX entered after the preamble could be caught: missed
+  tx.at(0);
+  tx.send(data, sizeof(data));
+  Packet p = medium.packets.back();
+  rx.at(p.start + 5 * tsym);
+  rx.write(0x01, 0x85);
+  other.at(p.start + 5 * tsym);
+  rx.at(p.end);
+  other.at(p.end);
+  tx.at(p.end);
+  CHECK_EQ(rx.read(0x12), 0);
+  CHECK_EQ(rx.radio.numMissed, 1);
+
+  //RX entered within the first symbols of preamble: received
+  tx.write(0x12, 0xFF);
+  tx.at(ms(100));
+  tx.send(data, sizeof(data));
+  p = medium.packets.back();
+  rx.at(p.start + 3 * tsym);
+  rx.write(0x01, 0x81);
+  rx.write(0x01, 0x85);
+  rx.at(p.end);
+  other.at(p.end);
+  CHECK_EQ(rx.read(0x12) & 0x40, 0x40);
+  CHECK_EQ(rx.radio.numRxDone, 1);
+
+  //going to standby for a moment during the packet: missed
+  rx.write(0x12, 0xFF);
+  tx.at(p.end);
+  tx.write(0x12, 0xFF);
+  tx.at(ms(200));
+  tx.send(data, sizeof(data));
+  p = medium.packets.back();
+  rx.at(p.start + 10 * tsym);
+  rx.write(0x01, 0x81);
+  rx.write(0x01, 0x85);
+  rx.at(p.end);
+  other.at(p.end);
+  CHECK_EQ(rx.read(0x12), 0);
+  CHECK_EQ(rx.radio.numMissed, 2);
+
+  //a module on another channel hears none of it
+  CHECK_EQ(other.radio.numRxDone, 0);
+  CHECK_EQ(other.radio.numMissed, 0);
+  CHECK_EQ(other.read(0x12), 0);
+}
+
+static void testCollisions()
+{
+  Medium medium;
+  Module a(medium, "a");
+  Module b(medium, "b");
+  Module rx(medium, "rx");
+  a.setup(FRF_CH0);
+  b.setup(FRF_CH0);
+  rx.setup(FRF_CH0);
+  rx.write(0x01, 0x85);
+  double lossFromB = 80;
+  medium.pathLoss = [&](const Sx127x &from, const Sx127x &, Time) {
+    return &from == &b.radio ? lossFromB : 80.0;
+  };
+
+  uint8_t data[10] = {1};
+  auto overlap = [&](Time t) {
+    a.at(t);
+    a.send(data, sizeof(data));
+    b.at(t + ms(5));
+    b.send(data, sizeof(data));
+    Time end = medium.packets.back().end;
+    a.at(end);
+    b.at(end);
+    rx.at(end);
+    a.write(0x12, 0xFF);
+    b.write(0x12, 0xFF);
+  };
+
+  //same strength: both lost
+  overlap(0);
+  CHECK_EQ(rx.radio.numRxDone, 0);
+  CHECK_EQ(rx.radio.numLost, 2);
+
+  //a 10dB stronger: a gets through, b does not
+  lossFromB = 90;
+  overlap(ms(100));
+  CHECK_EQ(rx.radio.numRxDone, 1);
+  CHECK_EQ(rx.radio.numLost, 3);
+
+  //on another channel: no effect
+  b.setup(FRF_CH1);
+  lossFromB = 80;
+  overlap(ms(200));
+  CHECK_EQ(rx.radio.numRxDone, 2);
+}
+
+static void testLossModel()
+{
+  Medium medium;
+  Module tx(medium, "tx");
+  Module rx(medium, "rx");
+  tx.setup(FRF_CH0);
+  rx.setup(FRF_CH0);
+  rx.write(0x01, 0x85);
+  uint8_t data[10] = {};
+
+  auto sendMany = [&](int n) {
+    uint64_t before = rx.radio.numRxDone;
+    for(int i = 0; i < n; i++)
+    {
+      Time t = tx.mcu.now + ms(1);
+      tx.at(t);
+      rx.at(t);
+      tx.send(data, sizeof(data));
+      Time end = medium.packets.back().end;
+      tx.at(end);
+      rx.at(end);
+      tx.write(0x12, 0xFF);
+      rx.write(0x12, 0xFF);
+      medium.prune(end + ms(2000));
+    }
+    return (double)(rx.radio.numRxDone - before) / n;
+  };
+
+  medium.lossRate = 0.3;
+  CHECK_NEAR(sendMany(2000), 0.7, 0.03);
+  medium.lossRate = 0;
+
+  //near the SF7 floor of -7.5dB snr half of them get through
+  medium.defaultPathLoss = 17 - NOISE_DBM + 7.5;
+  CHECK_NEAR(sendMany(2000), 0.5, 0.05);
+  medium.defaultPathLoss = 17 - NOISE_DBM + 3;
+  CHECK(sendMany(500) > 0.99);
+  medium.defaultPathLoss = 17 - NOISE_DBM + 12;
+  CHECK(sendMany(500) < 0.01);
+  medium.defaultPathLoss = 80;
+
+  //bit errors reach the FIFO, and are flagged only with the payload crc on
+  medium.bitErrorRate = 0.01;
+  sendMany(1);
+  uint64_t crcErrors = rx.radio.numCrcErrors;
+  rx.write(0x1E, 0x74);
+  tx.write(0x1E, 0x74);
+  int corrupted = 0;
+  for(int i = 0; i < 200; i++)
+  {
+    sendMany(1);
+    if(rx.radio.numCrcErrors > crcErrors)
+      corrupted++;
+    crcErrors = rx.radio.numCrcErrors;
+  }
+  CHECK_EQ(crcErrors, rx.radio.numCrcErrors);
+  //1 - 0.99^80 of the packets
+  CHECK_NEAR(corrupted / 200.0, 0.55, 0.1);
+}
+
+static void testSingleRxAndCad()
+{
+  Medium medium;
+  Module tx(medium, "tx");
+  Module rx(medium, "rx");
+  tx.setup(FRF_CH0);
+  rx.setup(FRF_CH0);
+
+  //single RX times out after SymbTimeout symbols, 100 by default
+  rx.at(ms(1));
+  rx.write(0x01, 0x86);
+  rx.at(ms(1) + 100 * us(512) - 1);
+  CHECK_EQ(rx.read(0x12), 0);
+  rx.at(ms(1) + 100 * us(512));
+  CHECK_EQ(rx.read(0x12), 0x80);
+  CHECK_EQ(rx.read(0x01), 0x81);
+  rx.write(0x12, 0xFF);
+
+  //and drops to standby after a packet
+  uint8_t data[10] = {};
+  rx.at(ms(100));
+  rx.write(0x01, 0x86);
+  tx.at(ms(100));
+  tx.send(data, sizeof(data));
+  Time end = medium.packets.back().end;
+  tx.at(end);
+  rx.at(end);
+  CHECK_EQ(rx.read(0x12) & 0x40, 0x40);
+  CHECK_EQ(rx.read(0x01), 0x81);
+  rx.write(0x12, 0xFF);
+  tx.write(0x12, 0xFF);
+
+  //CAD takes 2 symbols and finds a preamble on the channel
+  rx.write(0x40, 0x80); //DIO0 on CadDone
+  rx.at(ms(200));
+  rx.write(0x01, 0x87);
+  rx.at(ms(200) + 2 * us(512));
+  CHECK_EQ(rx.read(0x12), 0x04);
+  CHECK(rx.mcu.getPin(2));
+  CHECK_EQ(rx.read(0x01), 0x81);
+  rx.write(0x12, 0xFF);
+  CHECK(!rx.mcu.getPin(2));
+
+  tx.at(ms(300));
+  tx.send(data, sizeof(data));
+  Time start = medium.packets.back().start;
+  rx.at(start + us(512));
+  rx.write(0x01, 0x87);
+  rx.at(start + 3 * us(512));
+  CHECK_EQ(rx.read(0x12), 0x05);
+  CHECK_EQ(rx.radio.numCad, 2);
+  CHECK_EQ(rx.radio.numCadDetected, 1);
+  rx.write(0x12, 0xFF);
+
+  //listening from there, the modem status shows the preamble locked onto, then the header
+  rx.write(0x01, 0x85);
+  rx.at(start + 7 * us(512) / 2);
+  CHECK_EQ(rx.read(0x18), 0x10);
+  rx.at(start + 5 * us(512));
+  CHECK_EQ(rx.read(0x18), 0x07);
+  rx.at(start + 21 * us(512));
+  CHECK_EQ(rx.read(0x18), 0x0F);
+  end = medium.packets.back().end;
+  tx.at(end);
+  rx.at(end);
+  CHECK_EQ(rx.read(0x18), 0x10);
+  rx.write(0x12, 0xFF);
+  tx.write(0x12, 0xFF);
+
+  //but not for a packet caught after its preamble
+  rx.write(0x01, 0x81);
+  tx.at(ms(400));
+  tx.send(data, sizeof(data));
+  start = medium.packets.back().start;
+  rx.at(start + 15 * us(512));
+  rx.write(0x01, 0x85);
+  rx.at(start + 21 * us(512));
+  CHECK_EQ(rx.read(0x18), 0x10);
+  rx.write(0x01, 0x81);
+  CHECK_EQ(rx.read(0x18), 0x00);
+}
+
+int main()
+{
+  testTimeOnAir();
+  testRegisters();
+  testFifo();
+  testTx();
+  testRx();
+  testMissed();
+  testCollisions();
+  testLossModel();
+  testSingleRxAndCad();
+  return checkReport("test_sx127x");
+}
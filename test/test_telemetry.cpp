@@ -0,0 +1,132 @@
+// Checks of the receiver's telemetry as the master gets it in the slave's serial message, over the
+// simulated link with the link cut for a while in the middle. The link statistics pages come round
+// in turn and add up to the receiver's own statistics, the sensor page carries the voltage on the
+// sense pin, and the output timing figures match what is seen on the servo output: the frame
+// starting OUTPUT_LATCH_DELAY_US after each rc packet, and failsafe taking hold after the cut.
+
+#include "sketch_stx.h"
+#include "link.h"
+#include "check.h"
+
+#include <math.h>
+#include <vector>
+
+//the receiver's state, from its own translation unit
+namespace rx {
+extern uint16_t stats[];
+extern uint8_t syncState;
+}
+
+using namespace sim;
+
+const uint8_t SYNC_LOCKED = 1;
+//should match the receiver
+const uint8_t NUM_RX_STATS = 12;
+const uint8_t RX_STATS_NUM_PAGES = 3;
+const uint8_t STAT_MISSED_SLOTS = 2;
+const uint8_t STAT_SYNC_LOSSES = 4;
+const uint8_t STAT_FAILSAFES = 5;
+const uint8_t SENSOR_VOLTS = 0;
+const int16_t VOLTS_FULL_SCALE = 1666;
+const double OUTPUT_LATCH_DELAY_MS = 2.0;
+const uint8_t PIN_CH1 = 2;
+
+int main()
+{
+  Link link;
+  //ch1 moving between 1600us and 1650us, so each packet has new values to latch
+  link.master.onLoop = [](Mcu &m) { master::settings.channels[0] = 100 + (int)(toMs(m.now) / 27) % 50; };
+  master::settings.failsafes[0] = 300; //1300us
+  master::settings.isFailsafeSet = true;
+  link.rx.analogInput[0] = 614;
+
+  //from the end of each rc packet to the servo frame it starts
+  Time lastRcAt = 0;
+  Time untimedRcAt = 0;
+  link.rxRadio.onPacket = [&](const Packet &p, bool isReceived) {
+    if(isReceived && p.sender == &link.stxRadio)
+      lastRcAt = untimedRcAt = p.end;
+  };
+  Time delaySum = 0;
+  int numDelays = 0;
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin != PIN_CH1 || !e.level || !untimedRcAt || e.time - untimedRcAt > ms(5))
+      return;
+    delaySum += e.time - untimedRcAt;
+    numDelays++;
+    untimedRcAt = 0;
+  };
+
+  //each change of page should be to the next one
+  std::vector<uint8_t> pages;
+  int numSensorPages = 0;
+  master::onReply = [&](const master::Reply &r) {
+    if(r.statsPage != 0xFF && (pages.empty() || r.statsPage != pages.back()))
+      pages.push_back(r.statsPage);
+    if(r.sensorPageLen > 0)
+      numSensorPages++;
+  };
+  link.run(ms(5000));
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+  CHECK(numDelays > 100);
+  CHECK_EQ(master::reply.failsafeDelay, 0); //none yet
+
+  //cut the link long enough for failsafe and a loss of sync, and time the first pulse of the
+  //failsafe width from the last rc packet
+  bool isCut = true;
+  link.medium.dropFilter = [&](const Packet &, const Sx127x &) { return isCut; };
+  Time riseAt = 0;
+  Time failsafeOutAt = 0;
+  link.rx.onPinChange = [&](const PinEvent &e) {
+    if(e.pin != PIN_CH1)
+      return;
+    if(e.level)
+      riseAt = e.time;
+    else if(!failsafeOutAt && riseAt && fabs(toUs(e.time - riseAt) - 1300) < 2)
+      failsafeOutAt = riseAt;
+  };
+  link.run(ms(1500));
+  Time cutAt = lastRcAt;
+  CHECK(failsafeOutAt > cutAt);
+  CHECK_EQ(rx::stats[STAT_FAILSAFES], 1);
+  CHECK_EQ(rx::stats[STAT_SYNC_LOSSES], 1);
+
+  isCut = false;
+  link.rx.onPinChange = nullptr;
+  link.run(ms(20000));
+  CHECK_EQ(rx::syncState, SYNC_LOCKED);
+
+  //the pages come round in turn
+  CHECK(pages.size() >= 2 * RX_STATS_NUM_PAGES);
+  int numInTurn = 0;
+  for(size_t i = 1; i < pages.size(); i++)
+    if(pages[i] == (pages[i - 1] + 1) % RX_STATS_NUM_PAGES)
+      numInTurn++;
+  CHECK_EQ(numInTurn, (int)pages.size() - 1);
+  for(uint8_t i = 0; i < NUM_RX_STATS; i++)
+  {
+    if(i == STAT_MISSED_SLOTS) //may have gone up since the page was sent
+      CHECK(master::rxStats[i] <= rx::stats[i] && master::rxStats[i] + 2 >= rx::stats[i]);
+    else
+      CHECK_EQ(master::rxStats[i], rx::stats[i]);
+  }
+  CHECK_EQ(master::rxStats[STAT_FAILSAFES], 1);
+  for(uint8_t i = NUM_RX_STATS; i < RX_STATS_NUM_PAGES * master::RX_STATS_PER_PAGE; i++)
+    CHECK_EQ(master::rxStats[i], 0);
+
+  //the sensor page
+  CHECK(numSensorPages > 0);
+  CHECK_EQ(master::rxSensorType[0], SENSOR_VOLTS);
+  CHECK_NEAR(master::rxSensorValue[0], VOLTS_FULL_SCALE * 614 / 1024, 1);
+  CHECK_EQ(master::rxSensorValue[1], master::RX_SENSOR_NO_DATA);
+
+  //the timing figures
+  double delayMs = toMs(delaySum) / numDelays;
+  CHECK_NEAR(delayMs, OUTPUT_LATCH_DELAY_MS, 0.2);
+  CHECK_NEAR(master::reply.outputDelay / 10.0, delayMs, 0.15);
+  CHECK(master::reply.processTime > 0);
+  CHECK(master::reply.processTime <= master::reply.outputDelay);
+  CHECK_NEAR(master::reply.failsafeDelay * 10.0, toMs(failsafeOutAt - cutAt), 5.5);
+
+  return checkReport("test_telemetry");
+}